@@ -38,8 +38,8 @@ int main() {
     
     /**** CREATE ALLEGRO RESOURCES ****/
     
-    //set flags
-    al_set_new_display_flags(al_get_new_display_flags() | ALLEGRO_GENERATE_EXPOSE_EVENTS | ALLEGRO_RESIZABLE | ALLEGRO_WINDOWED);
+    //set flags; the display keeps its contents between frames, so as that only the invalidated parts are redrawn
+    al_set_new_display_flags(al_get_new_display_flags() | ALLEGRO_GENERATE_EXPOSE_EVENTS | ALLEGRO_RESIZABLE | ALLEGRO_WINDOWED | ALLEGRO_SINGLE_BUFFER);
     
     //create a al_display
     al_display = al_create_display(640, 480);
@@ -82,17 +82,6 @@ int main() {
                 algui_dispatch_event(algui_get_display_widget(display), &event);
                 break;                                
 
-            //redraw
-            case ALLEGRO_EVENT_DISPLAY_EXPOSE:
-                need_draw = 1;
-                break;            
-                
-            //remove the input focus                
-            case ALLEGRO_EVENT_DISPLAY_SWITCH_OUT:
-                algui_dispatch_event(algui_get_display_widget(display), &event);
-                need_draw = 1;
-                break;            
-                        
             //handle timers
             case ALLEGRO_EVENT_TIMER:
                 if (event.timer.source == loop_timer) need_draw = 1;
@@ -105,9 +94,9 @@ int main() {
                 break;
         }
 
+        //draw the invalidated parts of the gui; if nothing was drawn, there is no need to flip
         if (need_draw && al_is_event_queue_empty(queue)) {
-            algui_draw_widget(algui_get_display_widget(display));
-            al_flip_display();
+            if (algui_draw_invalidated(algui_get_display_widget(display))) al_flip_display();
             need_draw = false;
         }                
     }
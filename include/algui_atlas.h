@@ -0,0 +1,124 @@
+#ifndef ALGUI_ATLAS_H
+#define ALGUI_ATLAS_H
+
+
+#include <allegro5/allegro.h>
+#include "algui_version.h"
+
+
+/** a page of a texture atlas.
+    Bitmaps are packed into the page in shelves: rows of bitmaps, filled left to right, top to bottom.
+ */
+typedef struct ALGUI_ATLAS_PAGE {
+    ///the page bitmap.
+    ALLEGRO_BITMAP *bitmap;
+    
+    ///left coordinate of the next bitmap in the current shelf.
+    int shelf_x;
+    
+    ///top coordinate of the current shelf.
+    int shelf_y;
+    
+    ///height of the current shelf.
+    int shelf_height;
+    
+    ///area occupied by bitmaps, in pixels.
+    long used_area;
+} ALGUI_ATLAS_PAGE;
+
+
+/** a texture atlas.
+    Small bitmaps are copied into a few large page bitmaps, so as that drawing them does not switch textures;
+    the packed bitmaps are sub-bitmaps of the pages.
+    The pages and the packed bitmaps are resources of the resource manager;
+    the atlas holds a reference to each one of them, and a packed bitmap holds a reference to its page.
+ */
+typedef struct ALGUI_ATLAS {
+    int page_width;
+    int page_height;
+    int padding;
+    ALGUI_ATLAS_PAGE *pages;
+    int page_count;
+    void **resources;
+    int resource_count;
+    int resource_size;
+} ALGUI_ATLAS;
+
+
+/** returns the number of pages of an atlas.
+    @param atlas atlas to get the number of pages of.
+    @return the number of pages.
+ */
+int algui_get_atlas_page_count(ALGUI_ATLAS *atlas);
+
+
+/** returns a page bitmap of an atlas.
+    @param atlas atlas to get the page of.
+    @param index index of the page.
+    @return the page bitmap.
+ */
+ALLEGRO_BITMAP *algui_get_atlas_page(ALGUI_ATLAS *atlas, int index);
+
+
+/** returns the fraction of the area of the pages of an atlas that is occupied by bitmaps.
+    @param atlas atlas to get the occupancy of.
+    @return the occupancy, from 0 to 1; 0 if the atlas has no pages.
+ */
+double algui_get_atlas_occupancy(ALGUI_ATLAS *atlas);
+
+
+/** initializes an atlas.
+    @param atlas atlas to initialize.
+    @param page_width width of pages.
+    @param page_height height of pages.
+    @param padding empty space around packed bitmaps, in pixels.
+ */
+void algui_init_atlas(ALGUI_ATLAS *atlas, int page_width, int page_height, int padding);
+
+
+/** cleans up an atlas.
+    The references of the atlas to the pages and the packed bitmaps are released;
+    bitmaps still acquired elsewhere remain valid, along with their pages.
+    @param atlas atlas to cleanup.
+ */
+void algui_cleanup_atlas(ALGUI_ATLAS *atlas);
+
+
+/** creates an atlas.
+    @param page_width width of pages.
+    @param page_height height of pages.
+    @param padding empty space around packed bitmaps, in pixels.
+    @return the atlas.
+ */
+ALGUI_ATLAS *algui_create_atlas(int page_width, int page_height, int padding);
+
+
+/** destroys an atlas.
+    @param atlas atlas to destroy.
+ */
+void algui_destroy_atlas(ALGUI_ATLAS *atlas);
+
+
+/** adds a bitmap to an atlas.
+    The bitmap is copied into a page, and a sub-bitmap of the page is installed as a resource with the given name.
+    A bitmap that is too large for a page is installed as a resource itself.
+    The atlas takes ownership of the given bitmap.
+    @param atlas atlas to add the bitmap to.
+    @param bmp bitmap to add.
+    @param name name of the resource (UTF-8 string).
+    @return the resource, or null if a resource with the given name exists or the page could not be created.
+ */
+ALLEGRO_BITMAP *algui_add_atlas_bitmap(ALGUI_ATLAS *atlas, ALLEGRO_BITMAP *bmp, const char *name);
+
+
+/** adds bitmaps to an atlas, tallest first, so as that they are packed tighter.
+    @param atlas atlas to add the bitmaps to.
+    @param bitmaps bitmaps to add; the atlas takes ownership of them.
+    @param names names of the resources (UTF-8 strings).
+    @param count number of bitmaps.
+    @return number of bitmaps added.
+ */
+int algui_add_atlas_bitmaps(ALGUI_ATLAS *atlas, ALLEGRO_BITMAP **bitmaps, const char **names, int count);
+
+
+#endif //ALGUI_ATLAS_H
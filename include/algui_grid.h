@@ -0,0 +1,112 @@
+#ifndef ALGUI_GRID_H
+#define ALGUI_GRID_H
+
+
+#include "algui_rect.h"
+
+
+/** a cell of a grid.
+    It holds the items that overlap the cell, sorted with the compare function of the grid.
+ */
+typedef struct ALGUI_GRID_CELL {
+    void **items;
+    int count;
+    int size;
+} ALGUI_GRID_CELL;
+
+
+/** a uniform grid spatial index.
+    It divides a rectangle into cells of equal size;
+    each item is stored in every cell its rectangle overlaps.
+    The items of a cell are kept sorted with the given compare function,
+    so as that they can be visited in a specific order.
+ */
+typedef struct ALGUI_GRID {
+    ALGUI_RECT rect;
+    int columns;
+    int rows;
+    int cell_width;
+    int cell_height;
+    ALGUI_GRID_CELL *cells;
+    unsigned long count;
+    int (*compare)(void *item1, void *item2);
+} ALGUI_GRID;
+
+
+/** returns the number of items in a grid.
+    @param grid grid to get the number of items of.
+    @return the number of items.
+ */
+unsigned long algui_get_grid_item_count(ALGUI_GRID *grid);
+
+
+/** returns the number of cells of a grid.
+    @param grid grid to get the number of cells of.
+    @return the number of cells.
+ */
+int algui_get_grid_cell_count(ALGUI_GRID *grid);
+
+
+/** returns the items of the cell that contains the given point.
+    @param grid grid to get the items of.
+    @param x horizontal coordinate.
+    @param y vertical coordinate.
+    @param count pointer to variable to store the number of items; it receives zero if the point is outside of the grid.
+    @return the items of the cell in sorted order, or NULL if the point is outside of the grid.
+ */
+void **algui_get_grid_items(ALGUI_GRID *grid, int x, int y, int *count);
+
+
+/** initializes a grid.
+    @param grid grid to initialize.
+    @param rect the area covered by the grid.
+    @param columns number of columns; it must be greater than zero.
+    @param rows number of rows; it must be greater than zero.
+    @param compare function that returns a negative number if the first item must be placed before the second one, 
+           a positive number if it must be placed after the second one, zero if the order does not matter.
+ */
+void algui_init_grid(ALGUI_GRID *grid, ALGUI_RECT *rect, int columns, int rows, int (*compare)(void *item1, void *item2));
+
+
+/** cleans up a grid.
+    The items are not destroyed.
+    @param grid grid to cleanup.
+ */
+void algui_cleanup_grid(ALGUI_GRID *grid);
+
+
+/** allocates and initializes a grid.
+    @param rect the area covered by the grid.
+    @param columns number of columns; it must be greater than zero.
+    @param rows number of rows; it must be greater than zero.
+    @param compare items compare function.
+    @return the new grid.
+ */
+ALGUI_GRID *algui_create_grid(ALGUI_RECT *rect, int columns, int rows, int (*compare)(void *item1, void *item2));
+
+
+/** cleans up and frees a grid.
+    @param grid grid to destroy.
+ */
+void algui_destroy_grid(ALGUI_GRID *grid);
+
+
+/** inserts an item in a grid.
+    The item is placed in all the cells its rectangle overlaps;
+    the parts of the rectangle outside of the grid are ignored.
+    @param grid grid to insert the item to.
+    @param rect rectangle of the item.
+    @param item item to insert.
+ */
+void algui_insert_grid_item(ALGUI_GRID *grid, ALGUI_RECT *rect, void *item);
+
+
+/** removes an item from a grid.
+    @param grid grid to remove the item from.
+    @param rect rectangle of the item; it must be the rectangle the item was inserted with.
+    @param item item to remove.
+ */
+void algui_remove_grid_item(ALGUI_GRID *grid, ALGUI_RECT *rect, void *item);
+
+
+#endif //ALGUI_GRID_H
@@ -0,0 +1,77 @@
+#ifndef ALGUI_MAP_H
+#define ALGUI_MAP_H
+
+
+#include <stddef.h>
+#include "algui_version.h"
+
+
+/** static map initializer.
+ */
+#define ALGUI_MAP_INITIALIZER          {NULL, 0, 0} 
+
+
+/** map entry.
+ */
+typedef struct ALGUI_MAP_ENTRY {
+    void *key;
+    void *value;
+} ALGUI_MAP_ENTRY;
+
+
+/** hash map from pointers to pointers.
+    Keys are compared by address; null keys are not allowed.
+ */
+typedef struct ALGUI_MAP {
+    ALGUI_MAP_ENTRY *entries;
+    unsigned long size;
+    unsigned long count;
+} ALGUI_MAP;
+
+
+/** returns the number of entries in a map.
+    @param map map to get the number of entries of.
+    @return the number of entries.
+ */
+unsigned long algui_get_map_count(ALGUI_MAP *map); 
+
+
+/** returns the value of a key.
+    @param map map to search.
+    @param key key to search for.
+    @return the value of the key or null if the key is not in the map.
+ */
+void *algui_get_map_value(ALGUI_MAP *map, void *key);
+
+
+/** initializes a map.
+    @param map map to initialize.
+ */
+void algui_init_map(ALGUI_MAP *map);
+
+
+/** removes all entries from a map and frees its memory.
+    @param map map to cleanup.
+ */
+void algui_cleanup_map(ALGUI_MAP *map);
+
+
+/** sets the value of a key.
+    If the key exists, its value is replaced, otherwise a new entry is added.
+    @param map map to set the value of.
+    @param key key; it must not be null.
+    @param value value.
+ */
+void algui_set_map_value(ALGUI_MAP *map, void *key, void *value);
+
+
+/** removes a key from a map.
+    The memory of the map is kept, even if the map becomes empty; it is freed by algui_cleanup_map.
+    @param map map to remove the key from.
+    @param key key to remove.
+    @return non-zero if the key was found, zero otherwise.
+ */
+int algui_remove_map_value(ALGUI_MAP *map, void *key);
+
+
+#endif //ALGUI_MAP_H
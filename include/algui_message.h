@@ -2,6 +2,7 @@
 #define ALGUI_MESSAGE_H
 
 
+#include <stdint.h>
 #include "algui_rect.h"
 #include "algui_skin.h"
 
@@ -152,12 +153,36 @@ typedef enum ALGUI_MSG_ID {
     
     ///display resized
     ALGUI_MSG_DISPLAY_RESIZED,
+    
+    ///splice widgets
+    ALGUI_MSG_SPLICE_WIDGETS,
         
     ///1st user message
     ALGUI_MSG_USER = 0x10000
 } ALGUI_MSG_ID; 
 
 
+/** a set of message ids.
+    Only the ids below ALGUI_MESSAGE_MASK_SIZE have a bit; the rest, including the user messages, are never in a mask.
+ */
+typedef uint64_t ALGUI_MESSAGE_MASK;
+
+
+/** number of message ids a message mask can hold.
+ */
+#define ALGUI_MESSAGE_MASK_SIZE     64
+
+
+/** returns the bit of a message id in a message mask, or zero if the id has no bit.
+ */
+#define ALGUI_MESSAGE_BIT(ID)       ((ID) >= 0 && (ID) < ALGUI_MESSAGE_MASK_SIZE ? (ALGUI_MESSAGE_MASK)1 << (ID) : 0)
+
+
+/** a message mask with all the message ids.
+ */
+#define ALGUI_MESSAGE_MASK_ALL      (~(ALGUI_MESSAGE_MASK)0)
+
+
 ///drag and drop type.
 typedef enum ALGUI_DRAG_AND_DROP_TYPE {
     ///copy
@@ -229,6 +254,26 @@ typedef struct ALGUI_REMOVE_WIDGET_MESSAGE {
 } ALGUI_REMOVE_WIDGET_MESSAGE;
 
 
+/** the splice-widgets message.
+ */
+typedef struct ALGUI_SPLICE_WIDGETS_MESSAGE {
+    ///base message.
+    ALGUI_MESSAGE message;
+    
+    ///first widget to move.
+    struct ALGUI_WIDGET *first;
+    
+    ///last widget to move; it is the first widget or a higher sibling of it.
+    struct ALGUI_WIDGET *last;
+    
+    ///next sibling widget.
+    struct ALGUI_WIDGET *next;
+    
+    ///success.
+    int ok;
+} ALGUI_SPLICE_WIDGETS_MESSAGE;
+
+
 /** the set-rect message.
  */
 typedef struct ALGUI_SET_RECT_MESSAGE {
@@ -344,7 +389,8 @@ typedef struct ALGUI_MOUSE_MESSAGE {
     ///base message.
     ALGUI_MESSAGE message;
     
-    ///allegro event that caused the message.
+    ///allegro event that caused the message; it is null, and the other members are zero, for a mouse leave
+    ///caused by inserting the tree of the widget into a tree that has another widget under the mouse.
     ALLEGRO_EVENT *event;
     
     ///local mouse x (relative to widget)
@@ -640,8 +686,11 @@ typedef struct ALGUI_TIMER_MESSAGE {
     ///allegro event that caused the message.
     ALLEGRO_EVENT *event;
         
-    ///allegro timer
+    ///allegro timer; for wheel timers, it is the timer that drives the timer wheel
     ALLEGRO_TIMER *timer;
+    
+    ///wheel timer; null for allegro timers
+    struct ALGUI_TIMER *wheel_timer;
 } ALGUI_TIMER_MESSAGE;
 
 
@@ -824,6 +873,9 @@ typedef union ALGUI_MESSAGE_UNION {
     
     ///display resized message
     ALGUI_DISPLAY_RESIZED_MESSAGE display_resized;
+    
+    ///splice widgets message
+    ALGUI_SPLICE_WIDGETS_MESSAGE splice_widgets;
 } ALGUI_MESSAGE_UNION;
 
 
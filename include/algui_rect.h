@@ -144,4 +144,157 @@ void algui_get_rect_intersection(ALGUI_RECT *r1, ALGUI_RECT *r2, ALGUI_RECT *r);
 void algui_get_rect_union(ALGUI_RECT *r1, ALGUI_RECT *r2, ALGUI_RECT *r); 
 
 
+/** region; a set of non-overlapping rectangles, stored in one contiguous array.
+    The rectangles are sorted in horizontal bands, top to bottom; the rectangles
+    of a band have the same top and bottom coordinates, are sorted left to right and do not touch.
+    Touching bands with the same horizontal spans are merged into one band.
+ */
+typedef struct ALGUI_REGION {
+    ///rectangles.
+    ALGUI_RECT *rects;
+    
+    ///number of rectangles.
+    int count;
+    
+    ///number of allocated rectangles.
+    int size;
+    
+    ///bounding rectangle; valid only if the region is not empty.
+    ALGUI_RECT bounds;
+} ALGUI_REGION; 
+
+
+/** initializes a region to empty.
+    @param rgn region to initialize.
+ */
+void algui_init_region(ALGUI_REGION *rgn); 
+
+
+/** frees the memory of a region.
+    @param rgn region to cleanup.
+ */
+void algui_cleanup_region(ALGUI_REGION *rgn); 
+
+
+/** empties a region; the memory of the region is kept for reuse.
+    @param rgn region to clear.
+ */
+void algui_clear_region(ALGUI_REGION *rgn); 
+
+
+/** checks if a region is empty.
+    @param rgn region to check.
+    @return non-zero if the region is empty.
+ */
+int algui_is_region_empty(ALGUI_REGION *rgn); 
+
+
+/** checks if a region contains a point.
+    @param rgn region to check.
+    @param x horizontal coordinate.
+    @param y vertical coordinate.
+    @return non-zero if the point is in the region.
+ */
+int algui_region_intersects_point(ALGUI_REGION *rgn, int x, int y); 
+
+
+/** checks if a region intersects a rectangle.
+    @param rgn region to check.
+    @param rct rectangle to check.
+    @return non-zero if some part of the rectangle is in the region.
+ */
+int algui_region_intersects_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** checks if a region contains a rectangle.
+    @param rgn region to check.
+    @param rct rectangle to check.
+    @return non-zero if the whole rectangle is in the region.
+ */
+int algui_region_contains_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** sets a region to a rectangle.
+    @param rgn region to set.
+    @param rct rectangle; if it is not normalized, the region becomes empty.
+ */
+void algui_set_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** copies a region.
+    @param dst destination region.
+    @param src source region.
+ */
+void algui_copy_region(ALGUI_REGION *dst, ALGUI_REGION *src); 
+
+
+/** calculates the union of two regions.
+    @param r1 1st region; it can be the result.
+    @param r2 2nd region; it can be the result.
+    @param r result.
+ */
+void algui_get_region_union(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r); 
+
+
+/** calculates the intersection of two regions.
+    @param r1 1st region; it can be the result.
+    @param r2 2nd region; it can be the result.
+    @param r result.
+ */
+void algui_get_region_intersection(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r); 
+
+
+/** calculates the difference of two regions.
+    @param r1 region to subtract from; it can be the result.
+    @param r2 region to subtract; it can be the result.
+    @param r result.
+ */
+void algui_get_region_difference(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r); 
+
+
+/** adds a rectangle to a region.
+    @param rgn region to modify.
+    @param rct rectangle to add.
+ */
+void algui_add_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** removes a rectangle from a region.
+    @param rgn region to modify.
+    @param rct rectangle to remove.
+ */
+void algui_subtract_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** clips a region to a rectangle.
+    @param rgn region to modify.
+    @param rct rectangle to clip the region to.
+ */
+void algui_clip_region(ALGUI_REGION *rgn, ALGUI_RECT *rct); 
+
+
+/** moves a region relative to its current position.
+    @param rgn region to move.
+    @param x horizontal offset.
+    @param y vertical offset.
+ */
+void algui_offset_region(ALGUI_REGION *rgn, int x, int y); 
+
+
+/** merges the touching rectangles of a region.
+    The region operations keep their results merged; 
+    this is needed only after the rectangles of a region are modified directly.
+    @param rgn region to merge.
+ */
+void algui_merge_region(ALGUI_REGION *rgn); 
+
+
+/** reduces the number of rectangles of a region, by merging nearby rectangles.
+    The result covers the original region, and possibly some area outside of it.
+    @param rgn region to simplify.
+    @param max_rects maximum number of rectangles; must be greater than 0.
+ */
+void algui_simplify_region(ALGUI_REGION *rgn, int max_rects); 
+
+
 #endif //ALGUI_RECT_H
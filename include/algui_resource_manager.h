@@ -41,12 +41,34 @@ void *algui_acquire_resource(const char *name);
 int algui_release_resource(void *res); 
 
 
+/** increments the reference count of an installed resource.
+    @param res resource.
+    @return non-zero if the operation suceeded, zero if the resource does not exist.
+ */
+int algui_reference_resource(void *res); 
+
+
 /** destroys and uninstalls all resources.
     This is invoked automatically at exit.
  */
 void algui_destroy_resources(); 
 
 
+/** adds a function to be invoked before a resource is destroyed.
+    It allows caches of data derived from resources to drop the data of destroyed resources.
+    @param hook function to invoke; it receives the resource.
+    @return non-zero if the operation suceeded, zero if the function is already added.
+ */
+int algui_add_resource_destroy_hook(void (*hook)(void *)); 
+
+
+/** removes a function added with algui_add_resource_destroy_hook.
+    @param hook function to remove.
+    @return non-zero if the operation suceeded, zero if the function is not found.
+ */
+int algui_remove_resource_destroy_hook(void (*hook)(void *)); 
+
+
 /** destructor for a bitmap resource.
     It destroys the allegro bitmap.
     @param res pointer to resource to destroy.
@@ -54,6 +76,14 @@ void algui_destroy_resources();
 void algui_bitmap_resource_destructor(void *res); 
 
 
+/** destructor for a sub-bitmap resource.
+    It destroys the allegro sub-bitmap and releases the parent bitmap,
+    which must be a resource referenced once by each of its sub-bitmap resources.
+    @param res pointer to resource to destroy.
+ */
+void algui_sub_bitmap_resource_destructor(void *res); 
+
+
 /** destructor for a font resource.
     It destroys the allegro font.
     @param res pointer to resource to destroy.
@@ -5,16 +5,21 @@
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_font.h>
 #include "algui_version.h"
+#include "algui_atlas.h"
 
 
 /** an algui skin is nothing more an an Allegro config file with resource strings and a path.
     The folder of the skin must contain the config file and the resources.
     Widgets can then use the skin to load the resources from the disk,
     with the help of the skin functions.
+    The bitmaps of a loaded skin are packed into a texture atlas;
+    the section 'atlas' of the config file may set the 'page_width', 'page_height' and 'padding' of the atlas pages;
+    a 'page_width' of 0 disables the atlas.
  */
 typedef struct ALGUI_SKIN {
     ALLEGRO_USTR *filename;
     ALLEGRO_CONFIG *config;
+    ALGUI_ATLAS *atlas;
 } ALGUI_SKIN;
 
 
@@ -32,6 +37,13 @@ const char *algui_get_skin_filename(ALGUI_SKIN *skin);
 ALLEGRO_CONFIG *algui_get_skin_config(ALGUI_SKIN *skin); 
 
 
+/** returns the texture atlas of a skin.
+    @param skin skin to get the atlas of.
+    @return the atlas of the skin, or null if the skin has no atlas.
+ */
+ALGUI_ATLAS *algui_get_skin_atlas(ALGUI_SKIN *skin); 
+
+
 /** returns an integer value from a skin.
     @param skin skin to get the value from.
     @param wgt widget name (UTF-8 string).
@@ -0,0 +1,105 @@
+#ifndef ALGUI_TEXT_H
+#define ALGUI_TEXT_H
+
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_font.h>
+#include "algui_version.h"
+
+
+/** returns the width and the line height of a text, from the text cache.
+    The result is measured once and kept in the text cache, keyed by font and text.
+    @param font font of the text.
+    @param text text to measure (UTF-8 string).
+    @param width pointer to variable to receive the width of the text; can be null.
+    @param height pointer to variable to receive the line height of the font; can be null.
+ */
+void algui_get_cached_text_size(ALLEGRO_FONT *font, const char *text, int *width, int *height);
+
+
+/** returns the width of a text, from the text cache.
+    @param font font of the text.
+    @param text text to measure (UTF-8 string).
+    @return the width of the text.
+ */
+int algui_get_cached_text_width(ALLEGRO_FONT *font, const char *text);
+
+
+/** returns the memory budget of the text cache.
+    @return the budget, in bytes.
+ */
+size_t algui_get_text_cache_budget();
+
+
+/** returns the memory used by the text cache.
+    @return the memory used, in bytes.
+ */
+size_t algui_get_text_cache_size();
+
+
+/** returns the number of times a text was found in the text cache.
+    @return the number of text cache hits.
+ */
+unsigned long algui_get_text_cache_hit_count();
+
+
+/** returns the number of times a text had to be measured or rendered.
+    @return the number of text cache misses.
+ */
+unsigned long algui_get_text_cache_miss_count();
+
+
+/** returns the number of texts removed from the text cache to keep within the memory budget.
+    @return the number of text cache evictions.
+ */
+unsigned long algui_get_text_cache_eviction_count();
+
+
+/** checks if the text cache keeps rendered images of drawn texts.
+    @return non-zero if texts are rendered to images, zero otherwise.
+ */
+int algui_is_text_cache_rendering();
+
+
+/** draws a text through the text cache.
+    It is a replacement for al_draw_text; if the text cache keeps rendered images,
+    the image of the text is drawn, otherwise the text is drawn with al_draw_text.
+    Images are keyed by font, text, color and flags.
+    @param font font of the text.
+    @param color color of the text.
+    @param x horizontal position.
+    @param y vertical position.
+    @param flags alignment flags, as in al_draw_text.
+    @param text text to draw (UTF-8 string).
+ */
+void algui_draw_cached_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, const char *text);
+
+
+/** sets the memory budget of the text cache.
+    If the text cache uses more memory, the least recently used texts are removed.
+    @param size budget, in bytes.
+ */
+void algui_set_text_cache_budget(size_t size);
+
+
+/** sets the text cache to keep rendered images of drawn texts.
+    It is off by default; images are drawn faster than texts, but use video memory.
+    @param rendering non-zero to keep images of texts, zero to draw texts directly.
+ */
+void algui_set_text_cache_rendering(int rendering);
+
+
+/** removes the texts of a font from the text cache.
+    It must be invoked before destroying a font that is not a resource of the resource manager;
+    the texts of font resources are removed automatically when the resource is destroyed.
+    @param font font to remove the texts of.
+ */
+void algui_remove_text_cache_font(ALLEGRO_FONT *font);
+
+
+/** removes all texts from the text cache.
+ */
+void algui_clear_text_cache();
+
+
+#endif //ALGUI_TEXT_H
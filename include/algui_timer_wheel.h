@@ -0,0 +1,119 @@
+#ifndef ALGUI_TIMER_WHEEL_H
+#define ALGUI_TIMER_WHEEL_H
+
+
+#include <stdint.h>
+#include "algui_list.h"
+
+
+/** number of levels of a timer wheel.
+ */
+#define ALGUI_TIMER_WHEEL_LEVELS       4
+
+
+/** number of bits of the slot index of a level.
+ */
+#define ALGUI_TIMER_WHEEL_SLOT_BITS    6
+
+
+/** number of slots per level of a timer wheel.
+ */
+#define ALGUI_TIMER_WHEEL_SLOTS        (1 << ALGUI_TIMER_WHEEL_SLOT_BITS)
+
+
+/** timer wheel entry.
+    The data of the entry are kept in the list node.
+ */
+typedef struct ALGUI_TIMER_WHEEL_ENTRY {
+    ///node in the slot list; its data are the entry data.
+    ALGUI_LIST_NODE node;
+    
+    ///slot the entry is in; null if the entry is not scheduled.
+    ALGUI_LIST *slot;
+    
+    ///tick the entry expires at.
+    int64_t expires;
+} ALGUI_TIMER_WHEEL_ENTRY;
+
+
+/** hierarchical timer wheel.
+    Time is counted in ticks. Level 0 has one slot per tick;
+    each higher level has one slot per full turn of the level below it.
+    Entries are placed in the lowest level that reaches their expiration tick
+    and they move to lower levels as time advances.
+    Scheduling and canceling entries costs O(1).
+ */
+typedef struct ALGUI_TIMER_WHEEL {
+    ALGUI_LIST slots[ALGUI_TIMER_WHEEL_LEVELS][ALGUI_TIMER_WHEEL_SLOTS];
+    int64_t now;
+    unsigned long count;
+} ALGUI_TIMER_WHEEL;
+
+
+/** returns the current tick of a timer wheel.
+    @param wheel timer wheel to get the current tick of.
+    @return the current tick.
+ */
+int64_t algui_get_timer_wheel_time(ALGUI_TIMER_WHEEL *wheel);
+
+
+/** returns the number of entries scheduled in a timer wheel.
+    @param wheel timer wheel to get the number of entries of.
+    @return the number of scheduled entries.
+ */
+unsigned long algui_get_timer_wheel_count(ALGUI_TIMER_WHEEL *wheel);
+
+
+/** checks if an entry is scheduled.
+    @param entry entry to check.
+    @return non-zero if the entry is scheduled, zero otherwise.
+ */
+int algui_is_timer_wheel_entry_scheduled(ALGUI_TIMER_WHEEL_ENTRY *entry);
+
+
+/** initializes a timer wheel.
+    @param wheel timer wheel to initialize.
+    @param now initial tick.
+ */
+void algui_init_timer_wheel(ALGUI_TIMER_WHEEL *wheel, int64_t now);
+
+
+/** initializes a timer wheel entry.
+    @param entry entry to initialize.
+    @param data entry data.
+ */
+void algui_init_timer_wheel_entry(ALGUI_TIMER_WHEEL_ENTRY *entry, void *data);
+
+
+/** schedules an entry.
+    If the entry is already scheduled, it is rescheduled.
+    The expiration tick may be delayed by up to the given tolerance,
+    so as that entries with near expiration ticks expire together.
+    @param wheel timer wheel to schedule the entry in.
+    @param entry entry to schedule.
+    @param expires expiration tick; if it is not after the current tick, the entry expires at the next tick.
+    @param tolerance number of ticks the expiration may be delayed.
+ */
+void algui_schedule_timer_wheel_entry(ALGUI_TIMER_WHEEL *wheel, ALGUI_TIMER_WHEEL_ENTRY *entry, int64_t expires, int64_t tolerance);
+
+
+/** cancels a scheduled entry.
+    Nothing happens if the entry is not scheduled.
+    @param wheel timer wheel the entry is scheduled in.
+    @param entry entry to cancel.
+ */
+void algui_cancel_timer_wheel_entry(ALGUI_TIMER_WHEEL *wheel, ALGUI_TIMER_WHEEL_ENTRY *entry);
+
+
+/** advances a timer wheel up to the given tick.
+    Each entry that expires is unscheduled and then passed to the given callback;
+    the callback may schedule and cancel entries.
+    @param wheel timer wheel to advance.
+    @param now tick to advance to.
+    @param expired callback for expired entries.
+    @param context pointer passed to the callback.
+ */
+void algui_advance_timer_wheel(ALGUI_TIMER_WHEEL *wheel, int64_t now, void (*expired)(ALGUI_TIMER_WHEEL_ENTRY *entry, void *context), void *context);
+
+
+#endif //ALGUI_TIMER_WHEEL_H
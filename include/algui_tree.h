@@ -131,6 +131,17 @@ void algui_detach_tree(ALGUI_TREE *tree);
 void algui_clear_tree(ALGUI_TREE *tree); 
 
 
+/** moves a range of consecutive children of a node to another node, or to another position in the same node.
+    The nodes are relinked in constant time; the parent of each moved node is then set.
+    @param parent destination parent tree node.
+    @param next next sibling tree node in the destination; it may be null; it must not be in the range.
+    @param first first child of the range.
+    @param last last child of the range; it must be the first child or a sibling after it.
+    @return the number of nodes moved, or zero if the operation failed.
+ */
+unsigned long algui_splice_tree(ALGUI_TREE *parent, ALGUI_TREE *next, ALGUI_TREE *first, ALGUI_TREE *last); 
+
+
 /** sets the data of a tree node.
     @param tree tree node to set the data of.
     @param data data of the tree node.
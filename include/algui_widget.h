@@ -5,8 +5,10 @@
 #include <allegro5/allegro.h>
 #include "algui_message.h"
 #include "algui_tree.h"
+#include "algui_grid.h"
 #include "algui_skin.h"
 #include "algui_resource_manager.h"
+#include "algui_widget_arena.h"
 
 
 /** algui widget proc.
@@ -17,6 +19,71 @@
 typedef int (*ALGUI_WIDGET_PROC)(struct ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg);
 
 
+/** state of a widget tree, kept by its root widget.
+    It is private to the widget module; it is created on demand.
+ */
+struct ALGUI_WIDGET_ROOT;
+
+
+/** a widget timer driven by the timer wheel.
+    It is private to the widget module.
+ */
+typedef struct ALGUI_TIMER ALGUI_TIMER;
+
+
+/** offscreen image of a cacheable widget.
+    It is private to the widget module.
+ */
+struct ALGUI_WIDGET_CACHE;
+
+
+/** children of a widget sorted by tab order, for keyboard navigation.
+    It is private to the widget module.
+ */
+struct ALGUI_WIDGET_ARRAY;
+
+
+/** spatial index modes of widgets.
+ */
+typedef enum ALGUI_SPATIAL_INDEX {
+    ///the children are indexed when they are more than the spatial index threshold
+    ALGUI_SPATIAL_INDEX_AUTO,
+
+    ///the children are always indexed
+    ALGUI_SPATIAL_INDEX_ALWAYS,
+
+    ///the children are never indexed
+    ALGUI_SPATIAL_INDEX_NEVER
+} ALGUI_SPATIAL_INDEX;
+
+
+/** classes of events taken from event queues, in the order of their priority.
+ */
+typedef enum ALGUI_EVENT_CLASS {
+    ///keyboard and mouse events
+    ALGUI_EVENT_CLASS_INPUT,
+
+    ///expose and switch events of displays
+    ALGUI_EVENT_CLASS_DISPLAY,
+
+    ///events of widget timers
+    ALGUI_EVENT_CLASS_TIMER,
+
+    ///number of classes
+    ALGUI_EVENT_CLASS_COUNT
+} ALGUI_EVENT_CLASS;
+
+
+/** number of time ranges of queue wait histograms.
+ */
+#define ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE        16
+
+
+/** seconds of the first time range of queue wait histograms; each next range ends at twice the time.
+ */
+#define ALGUI_QUEUE_WAIT_HISTOGRAM_RESOLUTION  0.00025
+
+
 /** base struct for widgets.
  */
 typedef struct ALGUI_WIDGET {
@@ -24,10 +91,27 @@ typedef struct ALGUI_WIDGET {
     ALGUI_TREE tree;
     ALGUI_RECT rect;
     ALGUI_RECT screen_rect;
+    unsigned long screen_generation;
+    unsigned long geometry_generation;
+    unsigned long layout_generation;
+    int layout_depth;
+    unsigned long flags_generation;
+    int order_index;
     ALGUI_LIST timers;
+    ALGUI_LIST wheel_timers;
+    struct ALGUI_WIDGET_ROOT *root_state;
+    struct ALGUI_WIDGET_CACHE *cache;
+    ALGUI_GRID *grid;
+    struct ALGUI_WIDGET_ARRAY *tab_index;
     const char *id;
+    ALGUI_MESSAGE_MASK message_mask;
+    ALGUI_MESSAGE_MASK tree_message_mask;
+    unsigned long posted_count;
+    uint64_t posted_first;
+    uint64_t posted_last;
+    int z_key;
+    int tab_order;
     int capture:8;
-    int tab_order:15;
     int drawn:1;
     int layout:1;
     int visible:1;
@@ -37,6 +121,18 @@ typedef struct ALGUI_WIDGET {
     int focus:1;
     int mouse:1;
     int data_source:1;
+    unsigned int spatial_index:2;
+    unsigned int opaque:1;
+    unsigned int culled:2;
+    unsigned int layout_boundary:1;
+    unsigned int layout_queued:1;
+    unsigned int needs_measure_tree:1;
+    unsigned int needs_measure:1;
+    unsigned int needs_arrange:1;
+    unsigned int flags_queued:1;
+    unsigned int flags_covered:1;
+    unsigned int index_queued:1;
+    unsigned int coalesce_key_repeats:1;
 } ALGUI_WIDGET;
 
 
@@ -60,6 +156,9 @@ int algui_send_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg);
 
 /** sends a message to all widgets in the widget tree.
     It returns after the message has been processed by the widgets.
+    The procs of widgets whose message mask does not have the message are not called;
+    the default widget procedure is called instead, if it handles the message.
+    Subtrees in which no widget has the message in its mask are skipped, unless the default widget procedure handles it.
     @param wgt target widget.
     @param msg message to send to the widget.
     @return non-zero if the message was processed by any widget, zero otherwise.
@@ -67,6 +166,49 @@ int algui_send_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg);
 int algui_broadcast_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg); 
 
 
+/** posts a message to a widget.
+    The message is copied to a queue, and it is sent to the widget later, by algui_process_posted_messages.
+    If the widget is destroyed before that, the message is dropped.
+    @param wgt target widget.
+    @param msg message to post.
+    @param size size of the message struct, in bytes.
+ */
+void algui_post_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size);
+
+
+/** posts a message to a widget, merging it with a message with the same id that waits for the same widget.
+    The waiting message is overwritten with the given one and keeps its place in the queue;
+    if it has another size, it is dropped, and the given message is posted at the end of the queue.
+    @param wgt target widget.
+    @param msg message to post.
+    @param size size of the message struct, in bytes.
+    @return non-zero if the message was merged with a waiting message, zero if it was posted.
+ */
+int algui_post_coalesced_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size);
+
+
+/** sends the posted messages, in the order they were posted.
+    The messages posted while the function runs wait for the next call.
+    @param root root of the widget tree to send the messages of; if NULL, the messages of all trees are sent.
+    @param budget seconds after which the function returns, even if messages are left; 
+        at least one message is sent; if zero or less, there is no time limit.
+    @return the number of messages sent.
+ */
+int algui_process_posted_messages(ALGUI_WIDGET *root, double budget);
+
+
+/** returns the number of posted messages that wait to be sent.
+    @return the number of posted messages.
+ */
+unsigned long algui_get_posted_message_count();
+
+
+/** returns the number of posted messages that were merged with messages that waited to be sent.
+    @return the number of coalesced messages.
+ */
+unsigned long algui_get_coalesced_message_count();
+
+
 /** returns a widget's procedure.
     @param wgt widget to get the procedure of.
     @return the widget procedure.
@@ -74,6 +216,21 @@ int algui_broadcast_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg);
 ALGUI_WIDGET_PROC algui_get_widget_proc(ALGUI_WIDGET *wgt);
 
 
+/** returns the message mask of a widget.
+    @param wgt widget to get the message mask of.
+    @return the message mask.
+ */
+ALGUI_MESSAGE_MASK algui_get_widget_message_mask(ALGUI_WIDGET *wgt);
+
+
+/** returns the union of the message masks of a widget and its descendants.
+    It may have extra messages after widgets are removed, until the mask of the widget is set again.
+    @param wgt widget to get the mask of.
+    @return the message mask of the widget tree.
+ */
+ALGUI_MESSAGE_MASK algui_get_widget_tree_message_mask(ALGUI_WIDGET *wgt);
+
+
 /** returns the parent widget.
     @param wgt widget to get the parent of.
     @return the parent widget; it may be null.
@@ -191,6 +348,105 @@ int algui_is_widget_enabled(ALGUI_WIDGET *wgt);
 int algui_is_widget_tree_enabled(ALGUI_WIDGET *wgt); 
 
 
+/** returns a widget's opaque status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_opaque(ALGUI_WIDGET *wgt);
+
+
+/** returns a widget's layout boundary status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_layout_boundary(ALGUI_WIDGET *wgt);
+
+
+/** returns a widget's key repeat coalescing status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_coalescing_key_repeats(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of batches of drawing submitted during the last draw of a widget tree.
+    In batched mode, a batch is submitted each time the clipping or the target bitmap changes;
+    Allegro may split a batch further, when the texture changes.
+    Otherwise, each widget painted and each render cache image drawn count as a batch.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of batches.
+ */
+unsigned long algui_get_draw_batch_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of times the clipping changed during the last draw of a widget tree.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of clipping changes.
+ */
+unsigned long algui_get_clip_change_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of clipping changes avoided during the last draw of a widget tree,
+    because the clipping was already the one needed.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of skipped clipping changes.
+ */
+unsigned long algui_get_skipped_clip_change_count(ALGUI_WIDGET *wgt);
+
+
+/** checks if widgets are drawn in batched mode.
+    @return non-zero if widgets are drawn in batched mode.
+ */
+int algui_is_drawing_batched();
+
+
+/** returns a widget's cacheable status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_cacheable(ALGUI_WIDGET *wgt);
+
+
+/** returns the memory budget of the render caches.
+    @return the budget, in bytes.
+ */
+size_t algui_get_render_cache_budget();
+
+
+/** returns the memory used by the images of the render caches.
+    @return the memory used, in bytes.
+ */
+size_t algui_get_render_cache_size();
+
+
+/** returns the number of times a cacheable widget was drawn from its image.
+    @return the number of render cache hits.
+ */
+unsigned long algui_get_render_cache_hit_count();
+
+
+/** returns the number of times the image of a cacheable widget had to be rendered.
+    @return the number of render cache misses.
+ */
+unsigned long algui_get_render_cache_miss_count();
+
+
+/** returns the number of images of cacheable widgets destroyed to keep within the memory budget.
+    @return the number of render cache evictions.
+ */
+unsigned long algui_get_render_cache_eviction_count();
+
+
+/** returns the number of heap allocations made for widget timers and wheel timers.
+    It counts the timer records and the growth of the table that maps allegro timers to widgets.
+    The records of destroyed timers and the table are kept and reused by the timers created next,
+    so as that creating and destroying timers does not allocate memory once enough records exist;
+    only the allegro timers of widget timers are created and destroyed each time, by allegro.
+    @return the number of allocations.
+ */
+unsigned long algui_get_timer_allocation_count();
+
+
 /** returns true if the given widget has the input focus.
     @param wgt widget to get the focus status of.
     @return non-zero if the widget has the focus, zero otherwise.
@@ -230,6 +486,38 @@ ALGUI_WIDGET *algui_get_mouse_widget(ALGUI_WIDGET *wgt);
 ALGUI_WIDGET *algui_get_widget_from_point(ALGUI_WIDGET *wgt, int x, int y); 
 
 
+/** returns the number of hit tests done for mouse events in a widget tree.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of hit tests.
+ */
+unsigned long algui_get_hit_test_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of hit tests done for mouse events in a widget tree
+    that did not have to search the tree, because the mouse was still over the widget found last.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of skipped hit tests.
+ */
+unsigned long algui_get_skipped_hit_test_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of widgets of a widget tree that were not painted during the last draw,
+    because opaque widgets in front of them covered them.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of culled widgets.
+ */
+unsigned long algui_get_culled_widget_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of pixels of a widget tree that were not painted during the last draw,
+    because opaque widgets in front of them covered them.
+    The pixels of a widget are counted once for the widget and once for each culled child that covers them.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of culled pixels.
+ */
+unsigned long algui_get_culled_pixel_count(ALGUI_WIDGET *wgt);
+
+
 /** returns the id of a widget.
     @param wgt widget to get the id of.
     @return the id of a widget.
@@ -252,6 +540,19 @@ int algui_get_widget_tab_order(ALGUI_WIDGET *wgt);
 int algui_get_widget_z_order(ALGUI_WIDGET *wgt); 
 
 
+/** returns the spatial index mode of a widget.
+    @param wgt widget to get the spatial index mode of.
+    @return one of the ALGUI_SPATIAL_INDEX values.
+ */
+int algui_get_widget_spatial_index(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of children above which widgets in automatic spatial index mode index their children.
+    @return the number of children.
+ */
+int algui_get_spatial_index_threshold();
+
+
 /** initializes a widget structure.
     @param wgt widget to initialize.
     @param proc widget proc.
@@ -273,11 +574,25 @@ void algui_cleanup_widget(ALGUI_WIDGET *wgt);
 
 /** cleans up a widget and its children, and then frees the memory it occupies.
     Every widget in the tree is cleaned up, and then widgets are freed using the al_free function.
+    Widgets allocated from a widget arena cannot be told apart from other widgets here, so a tree
+    with such widgets must be destroyed with algui_destroy_arena_widget instead.
     @param wgt widget to cleanup.
  */
 void algui_destroy_widget(ALGUI_WIDGET *wgt);
 
 
+/** cleans up a widget tree allocated from a widget arena, and then frees the memory of the arena at once.
+    Every widget in the tree is cleaned up; the widgets of the tree that were not allocated from the arena
+    are freed using the al_free function, and then the arena is reset.
+    An arena holds the widgets of a single tree, which is released as a whole: a subtree cannot be released on its own,
+    so every widget allocated from the arena must belong to the tree, or else it must have been cleaned up already.
+    The widget must not have a parent.
+    @param wgt root of the tree to destroy.
+    @param arena arena the widgets of the tree were allocated from.
+ */
+void algui_destroy_arena_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ARENA *arena);
+
+
 /** translates a point from the coordinate system of one widget to the other.
     @param src source widget; if null, the input point is considered to be in screen coordinates.
     @param src_x input x in the source coordinate system; can be the source.
@@ -299,7 +614,8 @@ void algui_translate_rect(ALGUI_WIDGET *src, ALGUI_RECT *src_rct, ALGUI_WIDGET *
 
 
 /** draws a part of a widget.
-    Every widget in the tree gets the paint message.
+    Every widget in the tree gets the paint message, 
+    except for the widgets that are covered by opaque widgets in front of them.
     @param wgt widget to draw; its children are also drawn.
     @param rct local rectangle of widget to draw.
  */
@@ -307,12 +623,41 @@ void algui_draw_widget_rect(ALGUI_WIDGET *wgt, ALGUI_RECT *rct);
 
 
 /** draws a whole widget.
-    Every widget in the tree gets the paint message.
+    Every widget in the tree gets the paint message, 
+    except for the widgets that are covered by opaque widgets in front of them.
     @param wgt widget to draw; its children are also drawn.
  */
 void algui_draw_widget(ALGUI_WIDGET *wgt); 
 
 
+/** marks a widget as needing to be drawn again.
+    The screen area of the widget is added to the damaged area of its tree,
+    which is drawn by algui_draw_invalidated.
+    @param wgt widget to invalidate.
+ */
+void algui_invalidate_widget(ALGUI_WIDGET *wgt);
+
+
+/** marks a part of a widget as needing to be drawn again.
+    The rect is added to the damaged area of the widget's tree,
+    which is drawn by algui_draw_invalidated.
+    @param wgt widget to invalidate.
+    @param rct local rectangle of widget to invalidate.
+ */
+void algui_invalidate_widget_rect(ALGUI_WIDGET *wgt, ALGUI_RECT *rct);
+
+
+/** draws the damaged area of a widget tree.
+    Only the widgets that intersect the damaged area receive the paint message,
+    clipped to the damaged area; the damaged area is then cleared.
+    A tree that has never been drawn is drawn entirely.
+    The target bitmap must keep its contents between calls (for example, a display with a single buffer).
+    @param wgt widget of the tree to draw.
+    @return non-zero if anything was drawn, zero if there was no damage.
+ */
+int algui_draw_invalidated(ALGUI_WIDGET *wgt);
+
+
 /** inserts a widget in another widget as a child.
     @param parent parent; it receives the insert-widget message.
     @param child child.
@@ -344,6 +689,19 @@ int algui_remove_widget(ALGUI_WIDGET *parent, ALGUI_WIDGET *child);
 void algui_detach_widget(ALGUI_WIDGET *child); 
 
 
+/** moves a range of consecutive children of a widget to another widget,
+    or to another position in the same widget.
+    The children are relinked in constant time, regardless of how many they are;
+    the rest of the work is proportional to the number of children moved.
+    @param parent new parent; it receives the splice-widgets message.
+    @param first lowest child to move.
+    @param last highest child to move; it is the first child or a higher sibling of it.
+    @param next next sibling in the new parent; it can be null; it must not be one of the moved children.
+    @return non-zero if the operation succeeded, zero otherwise.
+ */
+int algui_splice_widgets(ALGUI_WIDGET *parent, ALGUI_WIDGET *first, ALGUI_WIDGET *last, ALGUI_WIDGET *next); 
+
+
 /** sets the local rectangle of a widget.
     The widget receives the set-rect message.
     @param wgt widget to set.
@@ -387,11 +745,41 @@ void algui_resize_widget(ALGUI_WIDGET *wgt, int w, int h);
     that changes the widget's position or size.
     There is no need to invoke this function before drawing the widgets
     for the first time; they will be packed automatically.
+    The layout is calculated immediately, along with any other pending layout of the tree.
     @param wgt widget to start the layout management from.
  */
 void algui_pack_widget(ALGUI_WIDGET *wgt); 
 
 
+/** calculates the pending layout of a widget tree.
+    Inserting, removing, resizing, showing and hiding widgets does not calculate the layout immediately;
+    the affected widgets are marked, and their layout is calculated once, by this function,
+    which is invoked automatically before drawing a tree, dispatching an event to it or hit-testing it.
+    It may be invoked explicitly in order to get the updated rects of widgets.
+    @param wgt widget of the tree to calculate the layout of.
+ */
+void algui_flush_layout(ALGUI_WIDGET *wgt); 
+
+
+/** begins a bulk update of widget trees.
+    Until the matching call to algui_end_update, the work that follows each change of the trees is postponed:
+    the flags of the descendants of inserted, moved, shown, hidden, enabled and disabled widgets,
+    the validation of the input focus, the spatial indexes, the resuming of wheel timers,
+    the layout and the damaged areas.
+    The postponed work is then done once, for all the changes.
+    Calls may be nested; the work is done at the end of the outermost update.
+    While an update is in progress, the rects of widgets and the flags of the descendants of changed widgets may be out of date.
+ */
+void algui_begin_update(); 
+
+
+/** ends a bulk update of widget trees started by algui_begin_update.
+    At the end of the outermost update, the postponed work is done,
+    including the pending layout of all trees.
+ */
+void algui_end_update(); 
+
+
 /** sets the widget's visible state.
     The widget receives the set-visible message.
     @param wgt widget.
@@ -449,6 +837,19 @@ int algui_disable_widget(ALGUI_WIDGET *wgt);
 void algui_set_widget_proc(ALGUI_WIDGET *wgt, ALGUI_WIDGET_PROC proc); 
 
 
+/** sets the messages the proc of a widget handles beyond the ones the default widget procedure handles.
+    Broadcasts call the proc of a widget only for the messages in its mask, and they skip subtrees
+    that do not handle the message at all; the other messages are still sent directly.
+    Messages without a bit in the mask, such as the user messages, are always broadcast.
+    The messages the default widget procedure handles, such as the cleanup and set-skin messages,
+    are always added to the mask, so as that the widget proc gets them too.
+    The mask of new widgets is ALGUI_MESSAGE_MASK_ALL.
+    @param wgt widget to set the message mask of.
+    @param mask set of the message bits the widget proc handles, made with ALGUI_MESSAGE_BIT.
+ */
+void algui_set_widget_message_mask(ALGUI_WIDGET *wgt, ALGUI_MESSAGE_MASK mask); 
+
+
 /** sets the input focus to the given widget.
     The given widget receives a get-focus message;
     if the widget accepts the focus, then the previous focus widget, if there is one,
@@ -471,6 +872,112 @@ int algui_set_focus_widget(ALGUI_WIDGET *wgt);
 int algui_dispatch_event(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev); 
 
 
+/** dispatches an array of Allegro events to a widget tree, in one batch.
+    Consecutive mouse axes events are merged into one, with the sum of their movements;
+    consecutive repeats of the same key char are dispatched as one, 
+    if the focus widget coalesces key repeats. Other events keep their order.
+    The events must be input events, or events of timers of the tree.
+    @param wgt root of widget tree to dispatch the events to.
+    @param events events to dispatch.
+    @param count number of events.
+    @return the number of events dispatched, after merging.
+ */
+int algui_dispatch_events(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *events, int count);
+
+
+/** dispatches the events of an Allegro event queue to a widget tree, in one batch.
+    The events are taken from the queue until it is empty, or until the next event is not 
+    an input event or an event of a timer of the tree; that event is left in the queue for the application.
+    The events are then merged and dispatched like with algui_dispatch_events.
+    At most a few dozen events are taken at once; the events that arrive 
+    while the batch is dispatched are left for the next call.
+    @param wgt root of widget tree to dispatch the events to.
+    @param queue event queue to take the events from.
+    @return the number of events dispatched, after merging.
+ */
+int algui_dispatch_queue(ALGUI_WIDGET *wgt, ALLEGRO_EVENT_QUEUE *queue);
+
+
+/** dispatches an array of Allegro events to a widget tree, by priority.
+    The input events are dispatched first, merged like with algui_dispatch_events, then the display events, 
+    and then the timer events, after the ones deferred by previous invocations.
+    Timer events are dispatched, oldest first, while the time spent since the function was invoked
+    is within the budget; the rest are deferred to the next invocations.
+    To avoid starvation, the oldest deferred timer event is dispatched in every invocation,
+    and so is every timer event that has waited longer than a tenth of a second.
+    The time that each event waited since its timestamp is counted in the histogram of its class.
+    The events must be input events, expose and switch events of displays, or events of timers of the tree.
+    @param wgt root of widget tree to dispatch the events to.
+    @param events events to dispatch.
+    @param count number of events; it can be zero, to dispatch the deferred timer events only.
+    @param timer_budget seconds in which timer events can be dispatched; if zero or less, there is no limit.
+    @return the number of events dispatched, after merging.
+ */
+int algui_schedule_events(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *events, int count, double timer_budget);
+
+
+/** dispatches the events of an Allegro event queue to a widget tree, by priority.
+    The events are taken from the queue like with algui_dispatch_queue, along with the expose and 
+    switch events of displays; the first event that is not taken is left in the queue for the application.
+    The events are then dispatched like with algui_schedule_events; 
+    the deferred timer events are dispatched even if no event is taken.
+    @param wgt root of widget tree to dispatch the events to.
+    @param queue event queue to take the events from.
+    @param timer_budget seconds in which timer events can be dispatched; if zero or less, there is no limit.
+    @return the number of events dispatched, after merging.
+ */
+int algui_schedule_queue(ALGUI_WIDGET *wgt, ALLEGRO_EVENT_QUEUE *queue, double timer_budget);
+
+
+/** returns the number of timer events of a widget tree that algui_schedule_queue has deferred.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of deferred timer events.
+ */
+int algui_get_deferred_timer_event_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of events of a class dispatched to a widget tree from event queues, 
+    that waited in the queue for a range of time.
+    Range 0 holds the events that waited less than ALGUI_QUEUE_WAIT_HISTOGRAM_RESOLUTION seconds;
+    each next range ends at twice the time of the previous one,
+    and the last range holds all events that waited longer than the previous ranges.
+    @param wgt widget of the tree to get the counter of.
+    @param cls class of events.
+    @param range index of range, from 0 to ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE - 1.
+    @return the number of events.
+ */
+unsigned long algui_get_queue_wait_count(ALGUI_WIDGET *wgt, ALGUI_EVENT_CLASS cls, int range);
+
+
+/** resets the queue wait histograms of a widget tree.
+    @param wgt widget of the tree to reset the histograms of.
+ */
+void algui_reset_queue_wait_histograms(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of events dispatched to a widget tree from event queues.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of events dispatched by algui_dispatch_queue and algui_schedule_queue.
+ */
+unsigned long algui_get_dispatched_event_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of mouse axes events merged with the events before them 
+    by algui_dispatch_queue and algui_schedule_queue.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of coalesced mouse events.
+ */
+unsigned long algui_get_coalesced_mouse_event_count(ALGUI_WIDGET *wgt);
+
+
+/** returns the number of key char repeats skipped by algui_dispatch_queue and algui_schedule_queue,
+    because the focus widget coalesces key repeats.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of coalesced key events.
+ */
+unsigned long algui_get_coalesced_key_event_count(ALGUI_WIDGET *wgt);
+
+
 /** captures events.
     Until events are released, events are dispatched to the given
     widget or its children.
@@ -567,6 +1074,56 @@ int algui_destroy_widget_timer(ALGUI_WIDGET *wgt, ALLEGRO_TIMER *timer);
 void algui_destroy_widget_timers(ALGUI_WIDGET *wgt);
 
 
+/** starts the timer wheel.
+    Widget timers created with algui_create_widget_wheel_timer are driven by the timer wheel,
+    which is driven by a single allegro timer; the events of that timer must be dispatched
+    to the widget trees with algui_dispatch_event.
+    There is one timer wheel for all the widget trees: a tick event dispatched to any tree
+    expires the due wheel timers of every tree, each timer sending its message to its own widget.
+    Dispatching the same tick event to more trees does not advance the wheel again,
+    so the tick events need to be dispatched to one tree only.
+    @param queue event queue to register the tick timer with.
+    @param resolution seconds per tick; it should stay the same if the wheel is stopped and started again.
+    @return non-zero if the wheel was started, zero if the tick timer could not be created.
+ */
+int algui_start_timer_wheel(ALLEGRO_EVENT_QUEUE *queue, double resolution);
+
+
+/** stops the timer wheel and destroys its allegro timer.
+    Wheel timers are kept; they do not expire until the wheel is started again.
+ */
+void algui_stop_timer_wheel();
+
+
+/** creates a timer for a widget on the timer wheel.
+    The widget receives timer messages with the timer in the 'wheel_timer' field.
+    The timer does not expire while the widget is hidden; 
+    it starts again one period after the widget is shown.
+    The timer wheel must have been started.
+    @param wgt widget to add the timer to.
+    @param secs seconds, in timeout; it is rounded to the resolution of the timer wheel.
+    @param tolerance seconds the timer may be delayed so as that it expires together with other timers.
+    @param one_shot if non-zero, the timer expires once; it is kept until it is destroyed.
+    @return the timer.
+ */
+ALGUI_TIMER *algui_create_widget_wheel_timer(ALGUI_WIDGET *wgt, double secs, double tolerance, int one_shot);
+
+
+/** removes and destroys a wheel timer of a widget.
+    @param wgt widget to remove the timer from.
+    @param timer timer to destroy.
+    @return non-zero if the operation is successful, zero if the timer does not belong to the widget.
+ */
+int algui_destroy_widget_wheel_timer(ALGUI_WIDGET *wgt, ALGUI_TIMER *timer);
+
+
+/** removes and destroys all wheel timers of a widget.
+    This function is called automatically from the default cleanup message handler.
+    @param wgt widget to remove the timers from.
+ */
+void algui_destroy_widget_wheel_timers(ALGUI_WIDGET *wgt);
+
+
 /** allows the widgets in the tree to set themselves up from the given skin.
     Widgets receive a set-skin message.
     @param wgt root of tree to skin.
@@ -597,6 +1154,85 @@ void algui_set_translation(ALGUI_WIDGET *wgt, ALLEGRO_CONFIG *config);
 void algui_set_widget_tab_order(ALGUI_WIDGET *wgt, int tbo); 
 
 
+/** sets the spatial index mode of a widget.
+    A widget with a spatial index finds the child under a point
+    without sending a hit-test message to each one of its children;
+    it is useful for widgets with thousands of children.
+    @param wgt widget to set the spatial index mode of.
+    @param mode one of the ALGUI_SPATIAL_INDEX values.
+ */
+void algui_set_widget_spatial_index(ALGUI_WIDGET *wgt, int mode);
+
+
+/** sets the number of children above which widgets in automatic spatial index mode index their children.
+    The new threshold is applied to a widget the next time its children change.
+    @param count number of children.
+ */
+void algui_set_spatial_index_threshold(int count);
+
+
+/** sets the opaque status of a widget.
+    An opaque widget paints every pixel of its area, and therefore the widgets behind it
+    are not painted where it covers them. 
+    Widgets also get the opaque status from the 'opaque' value of the skin.
+    @param wgt widget to set the opaque status of.
+    @param opaque non-zero if the widget is opaque.
+ */
+void algui_set_widget_opaque(ALGUI_WIDGET *wgt, int opaque);
+
+
+/** sets the layout boundary status of a widget.
+    The size of a layout boundary does not depend on its children, like a container of fixed size;
+    when its children change, only the boundary is laid out again, not its ancestors.
+    @param wgt widget to set the layout boundary status of.
+    @param boundary non-zero if the widget is a layout boundary.
+ */
+void algui_set_widget_layout_boundary(ALGUI_WIDGET *wgt, int boundary);
+
+
+/** sets the key repeat coalescing status of a widget.
+    When the widget has the focus, algui_dispatch_queue dispatches only the last of consecutive repeats 
+    of the same key char, which suits widgets that only need to catch up, like scrolling lists.
+    @param wgt widget to set the key repeat coalescing status of.
+    @param coalesce non-zero if the widget coalesces key repeats.
+ */
+void algui_set_widget_coalescing_key_repeats(ALGUI_WIDGET *wgt, int coalesce);
+
+
+/** sets the cacheable status of a widget.
+    A cacheable widget is drawn once, along with its children, into an offscreen bitmap;
+    the bitmap is then drawn instead of the widgets, until something changes in the area of the widget:
+    its rect, its skin, the visibility or the rects of its children, or an explicit invalidation.
+    The images of cacheable widgets share a memory budget; the least recently used images are destroyed 
+    to make room for new ones.
+    A cacheable widget should be opaque, or at least not blend its pixels, 
+    since its image is blended once more when drawn.
+    @param wgt widget to set the cacheable status of.
+    @param cacheable non-zero if the widget is cacheable.
+ */
+void algui_set_widget_cacheable(ALGUI_WIDGET *wgt, int cacheable);
+
+
+/** sets the memory budget of the render caches.
+    If the images of the render caches use more memory, the least recently used ones are destroyed.
+    @param size budget, in bytes.
+ */
+void algui_set_render_cache_budget(size_t size);
+
+
+/** sets the batched drawing mode.
+    In batched mode, bitmap drawing is held while widgets are painted, 
+    so as that consecutive bitmaps and text are submitted together; 
+    the batch is submitted when the clipping or the target bitmap changes.
+    Widgets are clipped to the visible area of their parent, instead of their own area,
+    so as that siblings share the clipping; therefore, widgets must not draw outside of their rect.
+    Widgets that draw anything other than bitmaps and text must release the hold while doing so
+    (see al_is_bitmap_drawing_held and al_hold_bitmap_drawing).
+    @param batched non-zero to enable batched drawing.
+ */
+void algui_set_batched_drawing(int batched);
+
+
 /** moves the input focus backward within the given widget tree,
     depending on the tab order of widgets.
     @param wgt root of widget tree to move the focus backward into.
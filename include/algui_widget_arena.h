@@ -0,0 +1,122 @@
+#ifndef ALGUI_WIDGET_ARENA_H
+#define ALGUI_WIDGET_ARENA_H
+
+
+#include <stddef.h>
+
+
+/** default size of the slabs of a widget arena.
+ */
+#define ALGUI_WIDGET_ARENA_SLAB_SIZE    65536
+
+
+/** a block of memory of a widget arena.
+ */
+typedef struct ALGUI_WIDGET_ARENA_SLAB {
+    char *memory;
+    size_t size;
+} ALGUI_WIDGET_ARENA_SLAB;
+
+
+/** an arena that widget structs are allocated from.
+    Memory is taken from large slabs, one struct after the other;
+    structs are not freed one by one, but all together, when the arena is reset.
+    A growable arena allocates new slabs as needed;
+    a fixed-capacity arena reserves all its memory at once and never allocates more.
+    An arena holds the widgets of a single tree, which is destroyed with algui_destroy_arena_widget;
+    algui_destroy_widget must not be used on them, since it frees each widget using the al_free function.
+    The slabs are kept sorted by address, so as that it can be found quickly if a pointer belongs to the arena.
+ */
+typedef struct ALGUI_WIDGET_ARENA {
+    ALGUI_WIDGET_ARENA_SLAB *slabs;
+    int slab_count;
+    int slab_array_size;
+    size_t slab_size;
+    size_t capacity;
+    char *next;
+    char *limit;
+    size_t used_size;
+    size_t reserved_size;
+} ALGUI_WIDGET_ARENA;
+
+
+/** returns the number of bytes allocated from a widget arena.
+    @param arena arena to get the number of bytes of.
+    @return the number of bytes allocated, including alignment.
+ */
+size_t algui_get_widget_arena_used_size(ALGUI_WIDGET_ARENA *arena);
+
+
+/** returns the number of bytes a widget arena has reserved in slabs.
+    @param arena arena to get the number of bytes of.
+    @return the number of bytes reserved.
+ */
+size_t algui_get_widget_arena_reserved_size(ALGUI_WIDGET_ARENA *arena);
+
+
+/** returns the capacity of a widget arena.
+    @param arena arena to get the capacity of.
+    @return the capacity in bytes, or zero if the arena is growable.
+ */
+size_t algui_get_widget_arena_capacity(ALGUI_WIDGET_ARENA *arena);
+
+
+/** checks if a pointer points to memory allocated from a widget arena.
+    @param arena arena to check.
+    @param ptr pointer to check.
+    @return non-zero if the pointer belongs to the arena, zero otherwise.
+ */
+int algui_widget_arena_contains(ALGUI_WIDGET_ARENA *arena, const void *ptr);
+
+
+/** initializes a widget arena.
+    @param arena arena to initialize.
+    @param slab_size size of the slabs; if zero, ALGUI_WIDGET_ARENA_SLAB_SIZE is used.
+    @param capacity if non-zero, the arena has fixed capacity:
+        it reserves the given number of bytes at once, and allocations fail when they are exhausted;
+        if zero, the arena grows as needed.
+ */
+void algui_init_widget_arena(ALGUI_WIDGET_ARENA *arena, size_t slab_size, size_t capacity);
+
+
+/** cleans up a widget arena.
+    All the memory of the arena is freed; the widgets allocated from it must have been cleaned up already.
+    @param arena arena to cleanup.
+ */
+void algui_cleanup_widget_arena(ALGUI_WIDGET_ARENA *arena);
+
+
+/** allocates and initializes a widget arena.
+    @param slab_size size of the slabs; if zero, ALGUI_WIDGET_ARENA_SLAB_SIZE is used.
+    @param capacity fixed capacity in bytes, or zero for a growable arena.
+    @return the new arena.
+ */
+ALGUI_WIDGET_ARENA *algui_create_widget_arena(size_t slab_size, size_t capacity);
+
+
+/** cleans up and frees a widget arena.
+    @param arena arena to destroy.
+ */
+void algui_destroy_widget_arena(ALGUI_WIDGET_ARENA *arena);
+
+
+/** allocates memory for a widget struct from a widget arena.
+    The memory is not initialized; it is suitably aligned for any struct.
+    Structs larger than a slab get a slab of their own.
+    @param arena arena to allocate the memory from.
+    @param size size of the struct.
+    @return pointer to the memory, or NULL if a fixed-capacity arena is exhausted.
+ */
+void *algui_allocate_widget_arena_memory(ALGUI_WIDGET_ARENA *arena, size_t size);
+
+
+/** frees all the memory allocated from a widget arena at once.
+    A growable arena keeps one slab for the next allocations and frees the rest;
+    a fixed-capacity arena keeps all its memory.
+    The widgets allocated from the arena must have been cleaned up already.
+    @param arena arena to reset.
+ */
+void algui_reset_widget_arena(ALGUI_WIDGET_ARENA *arena);
+
+
+#endif //ALGUI_WIDGET_ARENA_H
@@ -23,6 +23,11 @@ extern int _algui_init_log();
 extern void _algui_cleanup_log(); 
 extern int _algui_init_resource_manager(); 
 extern void _algui_cleanup_resource_manager(); 
+extern int _algui_init_text(); 
+extern void _algui_cleanup_text(); 
+extern void _algui_cleanup_posted_messages(); 
+extern void _algui_cleanup_timers(); 
+extern void _algui_cleanup_regions(); 
  
  
 /******************************************************************************
@@ -38,6 +43,7 @@ int algui_init() {
     if (_init_flag) return 1;
     if (!_algui_init_log()) return 0;
     if (!_algui_init_resource_manager()) return 0;
+    if (!_algui_init_text()) return 0;
     atexit(algui_cleanup);
     _init_flag = 1;
     return 1;
@@ -52,6 +58,10 @@ int algui_init() {
 void algui_cleanup(void) {
     if (_cleanup_flag) return;
     _algui_cleanup_log();
+    _algui_cleanup_text();
+    _algui_cleanup_posted_messages();
+    _algui_cleanup_timers();
+    _algui_cleanup_regions();
     _algui_cleanup_resource_manager();    
     _cleanup_flag = 1;
 }
@@ -0,0 +1,332 @@
+#include "algui_atlas.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "algui_resource_manager.h"
+
+
+/******************************************************************************
+    PRIVATE    
+ ******************************************************************************/
+
+
+//bitmap to add, for sorting
+typedef struct _ATLAS_ITEM {
+    ALLEGRO_BITMAP *bitmap;
+    const char *name;
+} _ATLAS_ITEM;
+
+
+//serial number of pages, for unique resource names
+static unsigned long _page_serial = 0;
+
+
+//keeps a reference to a resource
+static void _hold_resource(ALGUI_ATLAS *atlas, void *res) {
+    if (atlas->resource_count == atlas->resource_size) {
+        atlas->resource_size = atlas->resource_size ? atlas->resource_size * 2 : 16;
+        atlas->resources = (void **)al_realloc(atlas->resources, atlas->resource_size * sizeof(void *));
+        assert(atlas->resources);
+    }
+    atlas->resources[atlas->resource_count++] = res;
+}
+
+
+//draws a bitmap onto another one, replacing the destination pixels
+static void _copy_bitmap(ALLEGRO_BITMAP *src, ALLEGRO_BITMAP *dst, int x, int y) {
+    ALLEGRO_BITMAP *target = al_get_target_bitmap();
+    ALLEGRO_TRANSFORM transform, identity;
+    int op, src_blend, dst_blend;
+    
+    al_copy_transform(&transform, al_get_current_transform());
+    al_get_blender(&op, &src_blend, &dst_blend);
+    
+    al_set_target_bitmap(dst);
+    al_identity_transform(&identity);
+    al_use_transform(&identity);
+    al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+    if (src) {
+        al_draw_bitmap(src, x, y, 0);
+    }
+    else {
+        al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    }
+    
+    al_set_blender(op, src_blend, dst_blend);
+    if (target) al_set_target_bitmap(target);
+    al_use_transform(&transform);
+}
+
+
+//creates a new page
+static ALGUI_ATLAS_PAGE *_add_page(ALGUI_ATLAS *atlas) {
+    ALGUI_ATLAS_PAGE *page;
+    ALLEGRO_BITMAP *bmp;
+    ALLEGRO_USTR *name;
+    
+    bmp = al_create_bitmap(atlas->page_width, atlas->page_height);
+    if (!bmp) return NULL;
+    _copy_bitmap(NULL, bmp, 0, 0);
+    
+    name = al_ustr_newf("#atlas page %lu", ++_page_serial);
+    if (!algui_install_resource(bmp, al_cstr(name), algui_bitmap_resource_destructor)) {
+        al_ustr_free(name);
+        al_destroy_bitmap(bmp);
+        return NULL;
+    }
+    al_ustr_free(name);
+    _hold_resource(atlas, bmp);
+    
+    atlas->pages = (ALGUI_ATLAS_PAGE *)al_realloc(atlas->pages, (atlas->page_count + 1) * sizeof(ALGUI_ATLAS_PAGE));
+    assert(atlas->pages);
+    page = atlas->pages + atlas->page_count++;
+    page->bitmap = bmp;
+    page->shelf_x = atlas->padding;
+    page->shelf_y = atlas->padding;
+    page->shelf_height = 0;
+    page->used_area = 0;
+    return page;
+}
+
+
+//finds room for a bitmap in a page; returns zero if there is no room
+static int _find_room(ALGUI_ATLAS *atlas, ALGUI_ATLAS_PAGE *page, int w, int h, int *x, int *y) {
+    //in the current shelf; a shelf is as tall as its first bitmap
+    if (page->shelf_x + w + atlas->padding <= atlas->page_width && 
+        page->shelf_y + h + atlas->padding <= atlas->page_height &&
+        (h <= page->shelf_height || page->shelf_x == atlas->padding)) 
+    {
+        *x = page->shelf_x;
+        *y = page->shelf_y;
+        page->shelf_x += w + atlas->padding;
+        if (h > page->shelf_height) page->shelf_height = h;
+        return 1;
+    }
+    
+    //in a new shelf below the current one
+    if (page->shelf_height > 0 &&
+        atlas->padding + w + atlas->padding <= atlas->page_width &&
+        page->shelf_y + page->shelf_height + atlas->padding + h + atlas->padding <= atlas->page_height)
+    {
+        page->shelf_y += page->shelf_height + atlas->padding;
+        page->shelf_x = atlas->padding + w + atlas->padding;
+        page->shelf_height = h;
+        *x = atlas->padding;
+        *y = page->shelf_y;
+        return 1;
+    }
+    
+    return 0;
+}
+
+
+//compares atlas items by height, tallest first
+static int _compare_items(const void *a, const void *b) {
+    int h1 = al_get_bitmap_height(((const _ATLAS_ITEM *)a)->bitmap);
+    int h2 = al_get_bitmap_height(((const _ATLAS_ITEM *)b)->bitmap);
+    return h2 - h1;
+}
+
+
+/******************************************************************************
+    PUBLIC
+ ******************************************************************************/
+
+
+/** returns the number of pages of an atlas.
+    @param atlas atlas to get the number of pages of.
+    @return the number of pages.
+ */
+int algui_get_atlas_page_count(ALGUI_ATLAS *atlas) {
+    assert(atlas);
+    return atlas->page_count;
+}
+
+
+/** returns a page bitmap of an atlas.
+    @param atlas atlas to get the page of.
+    @param index index of the page.
+    @return the page bitmap.
+ */
+ALLEGRO_BITMAP *algui_get_atlas_page(ALGUI_ATLAS *atlas, int index) {
+    assert(atlas);
+    assert(index >= 0 && index < atlas->page_count);
+    return atlas->pages[index].bitmap;
+}
+
+
+/** returns the fraction of the area of the pages of an atlas that is occupied by bitmaps.
+    @param atlas atlas to get the occupancy of.
+    @return the occupancy, from 0 to 1; 0 if the atlas has no pages.
+ */
+double algui_get_atlas_occupancy(ALGUI_ATLAS *atlas) {
+    double used = 0;
+    int i;
+    assert(atlas);
+    if (atlas->page_count == 0) return 0;
+    for(i = 0; i < atlas->page_count; ++i) {
+        used += atlas->pages[i].used_area;
+    }
+    return used / ((double)atlas->page_width * atlas->page_height * atlas->page_count);
+}
+
+
+/** initializes an atlas.
+    @param atlas atlas to initialize.
+    @param page_width width of pages.
+    @param page_height height of pages.
+    @param padding empty space around packed bitmaps, in pixels.
+ */
+void algui_init_atlas(ALGUI_ATLAS *atlas, int page_width, int page_height, int padding) {
+    assert(atlas);
+    assert(page_width > 0);
+    assert(page_height > 0);
+    assert(padding >= 0);
+    atlas->page_width = page_width;
+    atlas->page_height = page_height;
+    atlas->padding = padding;
+    atlas->pages = NULL;
+    atlas->page_count = 0;
+    atlas->resources = NULL;
+    atlas->resource_count = 0;
+    atlas->resource_size = 0;
+}
+
+
+/** cleans up an atlas.
+    The references of the atlas to the pages and the packed bitmaps are released;
+    bitmaps still acquired elsewhere remain valid, along with their pages.
+    @param atlas atlas to cleanup.
+ */
+void algui_cleanup_atlas(ALGUI_ATLAS *atlas) {
+    assert(atlas);
+    while (atlas->resource_count > 0) {
+        algui_release_resource(atlas->resources[--atlas->resource_count]);
+    }
+    al_free(atlas->resources);
+    al_free(atlas->pages);
+    atlas->resources = NULL;
+    atlas->resource_size = 0;
+    atlas->pages = NULL;
+    atlas->page_count = 0;
+}
+
+
+/** creates an atlas.
+    @param page_width width of pages.
+    @param page_height height of pages.
+    @param padding empty space around packed bitmaps, in pixels.
+    @return the atlas.
+ */
+ALGUI_ATLAS *algui_create_atlas(int page_width, int page_height, int padding) {
+    ALGUI_ATLAS *atlas = (ALGUI_ATLAS *)al_malloc(sizeof(ALGUI_ATLAS));
+    assert(atlas);
+    algui_init_atlas(atlas, page_width, page_height, padding);
+    return atlas;
+}
+
+
+/** destroys an atlas.
+    @param atlas atlas to destroy.
+ */
+void algui_destroy_atlas(ALGUI_ATLAS *atlas) {
+    algui_cleanup_atlas(atlas);
+    al_free(atlas);
+}
+
+
+/** adds a bitmap to an atlas.
+    The bitmap is copied into a page, and a sub-bitmap of the page is installed as a resource with the given name.
+    A bitmap that is too large for a page is installed as a resource itself.
+    The atlas takes ownership of the given bitmap.
+    @param atlas atlas to add the bitmap to.
+    @param bmp bitmap to add.
+    @param name name of the resource (UTF-8 string).
+    @return the resource, or null if a resource with the given name exists or the page could not be created.
+ */
+ALLEGRO_BITMAP *algui_add_atlas_bitmap(ALGUI_ATLAS *atlas, ALLEGRO_BITMAP *bmp, const char *name) {
+    ALGUI_ATLAS_PAGE *page = NULL;
+    ALLEGRO_BITMAP *sub;
+    int w, h, x, y, i;
+    
+    assert(atlas);
+    assert(bmp);
+    assert(name);
+    
+    w = al_get_bitmap_width(bmp);
+    h = al_get_bitmap_height(bmp);
+    
+    //oversized bitmaps stay standalone
+    if (w + atlas->padding * 2 > atlas->page_width || h + atlas->padding * 2 > atlas->page_height) {
+        if (!algui_install_resource(bmp, name, algui_bitmap_resource_destructor)) {
+            al_destroy_bitmap(bmp);
+            return NULL;
+        }
+        _hold_resource(atlas, bmp);
+        return bmp;
+    }
+    
+    //find room in the existing pages first, then in a new page
+    for(i = 0; i < atlas->page_count; ++i) {
+        if (_find_room(atlas, atlas->pages + i, w, h, &x, &y)) {
+            page = atlas->pages + i;
+            break;
+        }
+    }
+    if (!page) {
+        page = _add_page(atlas);
+        if (!page || !_find_room(atlas, page, w, h, &x, &y)) {
+            al_destroy_bitmap(bmp);
+            return NULL;
+        }
+    }
+    
+    //copy the bitmap into the page
+    _copy_bitmap(bmp, page->bitmap, x, y);
+    al_destroy_bitmap(bmp);
+    
+    //install the sub-bitmap; it keeps its page alive;
+    //the room of a sub-bitmap that failed to install stays taken, but it is not counted as used
+    sub = al_create_sub_bitmap(page->bitmap, x, y, w, h);
+    if (!sub) return NULL;
+    if (!algui_install_resource(sub, name, algui_sub_bitmap_resource_destructor)) {
+        al_destroy_bitmap(sub);
+        return NULL;
+    }
+    algui_reference_resource(page->bitmap);
+    _hold_resource(atlas, sub);
+    page->used_area += (long)w * h;
+    return sub;
+}
+
+
+/** adds bitmaps to an atlas, tallest first, so as that they are packed tighter.
+    @param atlas atlas to add the bitmaps to.
+    @param bitmaps bitmaps to add; the atlas takes ownership of them.
+    @param names names of the resources (UTF-8 strings).
+    @param count number of bitmaps.
+    @return number of bitmaps added.
+ */
+int algui_add_atlas_bitmaps(ALGUI_ATLAS *atlas, ALLEGRO_BITMAP **bitmaps, const char **names, int count) {
+    _ATLAS_ITEM *items;
+    int i, added = 0;
+    
+    assert(atlas);
+    if (count <= 0) return 0;
+    assert(bitmaps);
+    assert(names);
+    
+    items = (_ATLAS_ITEM *)al_malloc(count * sizeof(_ATLAS_ITEM));
+    assert(items);
+    for(i = 0; i < count; ++i) {
+        items[i].bitmap = bitmaps[i];
+        items[i].name = names[i];
+    }
+    qsort(items, count, sizeof(_ATLAS_ITEM), _compare_items);
+    
+    for(i = 0; i < count; ++i) {
+        if (algui_add_atlas_bitmap(atlas, items[i].bitmap, items[i].name)) ++added;
+    }
+    
+    al_free(items);
+    return added;
+}
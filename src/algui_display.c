@@ -25,6 +25,8 @@ static int _msg_cleanup(ALGUI_DISPLAY *wgt, ALGUI_CLEANUP_MESSAGE *msg) {
  
 //paint message 
 static int _msg_paint(ALGUI_DISPLAY *wgt, ALGUI_PAINT_MESSAGE *msg) {
+    int held;
+    
     //draw bitmap
     if (wgt->background_bitmap) {
         al_draw_scaled_bitmap(
@@ -40,14 +42,17 @@ static int _msg_paint(ALGUI_DISPLAY *wgt, ALGUI_PAINT_MESSAGE *msg) {
             0);
     }
     
-    //else fill a rectangle
+    //else fill a rectangle; primitives cannot be drawn while bitmap drawing is held
     else {
+        held = al_is_bitmap_drawing_held();
+        if (held) al_hold_bitmap_drawing(0);
         al_draw_filled_rectangle(
             msg->widget_rect.left + 0.5f,
             msg->widget_rect.top + 0.5f,
             msg->widget_rect.right + 1.0f,
             msg->widget_rect.bottom + 1.0f,
             wgt->background_color);
+        if (held) al_hold_bitmap_drawing(1);
     }
     
     return 1;
@@ -63,7 +68,7 @@ static int _msg_set_skin(ALGUI_DISPLAY *wgt, ALGUI_SET_SKIN_MESSAGE *msg) {
     wgt->background_color = algui_get_skin_color(msg->skin, algui_get_widget_id(&wgt->widget), "background_color", _DEFAULT_BACKGROUND_COLOR);
     wgt->background_bitmap = algui_get_skin_bitmap(msg->skin, algui_get_widget_id(&wgt->widget), "background_bitmap", NULL);
     
-    return 1;
+    return algui_widget_proc(&wgt->widget, &msg->message);
 }
  
  
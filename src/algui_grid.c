@@ -0,0 +1,239 @@
+#include "algui_grid.h"
+#include <assert.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+
+
+/******************************************************************************
+    PRIVATE    
+ ******************************************************************************/
+ 
+ 
+#ifndef MIN
+#define MIN(A, B)  ((A) < (B) ? (A) : (B))
+#endif
+
+
+#ifndef MAX
+#define MAX(A, B)  ((A) > (B) ? (A) : (B))
+#endif
+
+
+//calculates the range of cells a rectangle overlaps; returns zero if the rectangle is outside of the grid
+static int _get_cell_range(ALGUI_GRID *grid, ALGUI_RECT *rect, int *col1, int *row1, int *col2, int *row2) {
+    ALGUI_RECT r;
+    algui_get_rect_intersection(rect, &grid->rect, &r);
+    if (!algui_is_rect_normalized(&r)) return 0;
+    *col1 = (r.left - grid->rect.left) / grid->cell_width;
+    *row1 = (r.top - grid->rect.top) / grid->cell_height;
+    *col2 = (r.right - grid->rect.left) / grid->cell_width;
+    *row2 = (r.bottom - grid->rect.top) / grid->cell_height;
+    return 1;
+}
+
+
+//inserts an item in a cell, in sorted position
+static void _insert_cell_item(ALGUI_GRID *grid, ALGUI_GRID_CELL *cell, void *item) {
+    int lo = 0, hi = cell->count, mid;
+    
+    //grow the cell
+    if (cell->count == cell->size) {
+        cell->size = cell->size ? cell->size * 2 : 4;
+        cell->items = (void **)al_realloc(cell->items, cell->size * sizeof(void *));
+        assert(cell->items);
+    }
+    
+    //find the position after the items that must be placed before the new one
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (grid->compare(cell->items[mid], item) <= 0) lo = mid + 1; else hi = mid;
+    }
+    
+    memmove(cell->items + lo + 1, cell->items + lo, (cell->count - lo) * sizeof(void *));
+    cell->items[lo] = item;
+    ++cell->count;
+}
+
+
+//removes an item from a cell; the items placed last are searched first
+static void _remove_cell_item(ALGUI_GRID_CELL *cell, void *item) {
+    int i;
+    for(i = cell->count - 1; i >= 0; --i) {
+        if (cell->items[i] == item) {
+            --cell->count;
+            memmove(cell->items + i, cell->items + i + 1, (cell->count - i) * sizeof(void *));
+            return;
+        }
+    }
+}
+
+
+/******************************************************************************
+    PUBLIC
+ ******************************************************************************/
+
+
+/** returns the number of items in a grid.
+    @param grid grid to get the number of items of.
+    @return the number of items.
+ */
+unsigned long algui_get_grid_item_count(ALGUI_GRID *grid) {
+    assert(grid);
+    return grid->count;
+}
+
+
+/** returns the number of cells of a grid.
+    @param grid grid to get the number of cells of.
+    @return the number of cells.
+ */
+int algui_get_grid_cell_count(ALGUI_GRID *grid) {
+    assert(grid);
+    return grid->columns * grid->rows;
+}
+
+
+/** returns the items of the cell that contains the given point.
+    @param grid grid to get the items of.
+    @param x horizontal coordinate.
+    @param y vertical coordinate.
+    @param count pointer to variable to store the number of items; it receives zero if the point is outside of the grid.
+    @return the items of the cell in sorted order, or NULL if the point is outside of the grid.
+ */
+void **algui_get_grid_items(ALGUI_GRID *grid, int x, int y, int *count) {
+    ALGUI_GRID_CELL *cell;
+    
+    assert(grid);
+    assert(count);
+    
+    if (!algui_rect_intersects_point(&grid->rect, x, y)) {
+        *count = 0;
+        return NULL;
+    }
+    
+    cell = grid->cells + ((y - grid->rect.top) / grid->cell_height) * grid->columns + (x - grid->rect.left) / grid->cell_width;
+    *count = cell->count;
+    return cell->items;
+}
+
+
+/** initializes a grid.
+    @param grid grid to initialize.
+    @param rect the area covered by the grid.
+    @param columns number of columns; it must be greater than zero.
+    @param rows number of rows; it must be greater than zero.
+    @param compare function that returns a negative number if the first item must be placed before the second one, 
+           a positive number if it must be placed after the second one, zero if the order does not matter.
+ */
+void algui_init_grid(ALGUI_GRID *grid, ALGUI_RECT *rect, int columns, int rows, int (*compare)(void *item1, void *item2)) {
+    int width, height;
+    
+    assert(grid);
+    assert(rect);
+    assert(algui_is_rect_normalized(rect));
+    assert(columns > 0);
+    assert(rows > 0);
+    assert(compare);
+    
+    width = algui_get_rect_width(rect);
+    height = algui_get_rect_height(rect);
+    
+    grid->rect = *rect;
+    grid->columns = MIN(columns, width);
+    grid->rows = MIN(rows, height);
+    grid->cell_width = (width + grid->columns - 1) / grid->columns;
+    grid->cell_height = (height + grid->rows - 1) / grid->rows;
+    grid->cells = (ALGUI_GRID_CELL *)al_malloc(grid->columns * grid->rows * sizeof(ALGUI_GRID_CELL));
+    assert(grid->cells);
+    memset(grid->cells, 0, grid->columns * grid->rows * sizeof(ALGUI_GRID_CELL));
+    grid->count = 0;
+    grid->compare = compare;
+}
+
+
+/** cleans up a grid.
+    The items are not destroyed.
+    @param grid grid to cleanup.
+ */
+void algui_cleanup_grid(ALGUI_GRID *grid) {
+    int i;
+    assert(grid);
+    for(i = grid->columns * grid->rows - 1; i >= 0; --i) {
+        al_free(grid->cells[i].items);
+    }
+    al_free(grid->cells);
+    grid->cells = NULL;
+    grid->count = 0;
+}
+
+
+/** allocates and initializes a grid.
+    @param rect the area covered by the grid.
+    @param columns number of columns; it must be greater than zero.
+    @param rows number of rows; it must be greater than zero.
+    @param compare items compare function.
+    @return the new grid.
+ */
+ALGUI_GRID *algui_create_grid(ALGUI_RECT *rect, int columns, int rows, int (*compare)(void *item1, void *item2)) {
+    ALGUI_GRID *grid = (ALGUI_GRID *)al_malloc(sizeof(ALGUI_GRID));
+    assert(grid);
+    algui_init_grid(grid, rect, columns, rows, compare);
+    return grid;
+}
+
+
+/** cleans up and frees a grid.
+    @param grid grid to destroy.
+ */
+void algui_destroy_grid(ALGUI_GRID *grid) {
+    assert(grid);
+    algui_cleanup_grid(grid);
+    al_free(grid);
+}
+
+
+/** inserts an item in a grid.
+    The item is placed in all the cells its rectangle overlaps;
+    the parts of the rectangle outside of the grid are ignored.
+    @param grid grid to insert the item to.
+    @param rect rectangle of the item.
+    @param item item to insert.
+ */
+void algui_insert_grid_item(ALGUI_GRID *grid, ALGUI_RECT *rect, void *item) {
+    int col1, row1, col2, row2, col, row;
+    
+    assert(grid);
+    assert(rect);
+    
+    ++grid->count;
+    if (!_get_cell_range(grid, rect, &col1, &row1, &col2, &row2)) return;
+    
+    for(row = row1; row <= row2; ++row) {
+        for(col = col1; col <= col2; ++col) {
+            _insert_cell_item(grid, grid->cells + row * grid->columns + col, item);
+        }
+    }
+}
+
+
+/** removes an item from a grid.
+    @param grid grid to remove the item from.
+    @param rect rectangle of the item; it must be the rectangle the item was inserted with.
+    @param item item to remove.
+ */
+void algui_remove_grid_item(ALGUI_GRID *grid, ALGUI_RECT *rect, void *item) {
+    int col1, row1, col2, row2, col, row;
+    
+    assert(grid);
+    assert(rect);
+    assert(grid->count > 0);
+    
+    --grid->count;
+    if (!_get_cell_range(grid, rect, &col1, &row1, &col2, &row2)) return;
+    
+    for(row = row1; row <= row2; ++row) {
+        for(col = col1; col <= col2; ++col) {
+            _remove_cell_item(grid->cells + row * grid->columns + col, item);
+        }
+    }
+}
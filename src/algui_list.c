@@ -185,6 +185,42 @@ void algui_clear_list(ALGUI_LIST *list) {
 }
 
 
+/** moves a range of consecutive nodes from a list to another list, or to another position in the same list.
+    It takes constant time.
+    @param dst destination list.
+    @param next node of the destination list to place the nodes before; if null, the nodes are appended;
+        it must not be in the range.
+    @param src source list.
+    @param first first node of the range.
+    @param last last node of the range; it must be the first node or a node after it.
+    @param count number of nodes in the range.
+ */
+void algui_splice_list(ALGUI_LIST *dst, ALGUI_LIST_NODE *next, ALGUI_LIST *src, ALGUI_LIST_NODE *first, ALGUI_LIST_NODE *last, unsigned long count) {
+    ALGUI_LIST_NODE *prev, *after;
+    
+    assert(dst);
+    assert(src);
+    assert(first);
+    assert(last);
+    assert(count > 0 && count <= src->length);
+    
+    //unlink the range from the source
+    prev = first->prev;
+    after = last->next;
+    if (prev) prev->next = after; else src->first = after;
+    if (after) after->prev = prev; else src->last = prev;
+    src->length -= count;
+    
+    //link the range in the destination
+    prev = next ? next->prev : dst->last;
+    first->prev = prev;
+    last->next = next;
+    if (prev) prev->next = first; else dst->first = first;
+    if (next) next->prev = last; else dst->last = last;
+    dst->length += count;
+}
+
+
 /** sets the data of a node.
     @param node node to set.
     @param data pointer to node's data.
@@ -0,0 +1,153 @@
+#include "algui_map.h"
+#include <assert.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+
+
+/******************************************************************************
+    PRIVATE    
+ ******************************************************************************/
+
+
+//initial number of entries of a map
+#define _MIN_SIZE            16
+
+
+//returns the entry index a key starts probing from; size is a power of 2
+static unsigned long _hash(void *key, unsigned long size) {
+    size_t h = (size_t)key;
+    h ^= h >> 16;
+    h *= (size_t)0x45d9f3bUL;
+    h ^= h >> 16;
+    return (unsigned long)h & (size - 1);
+}
+
+
+//returns the index of the entry of a key, or of the empty entry where the key would be placed
+static unsigned long _find(ALGUI_MAP *map, void *key) {
+    unsigned long i = _hash(key, map->size);
+    while (map->entries[i].key && map->entries[i].key != key) i = (i + 1) & (map->size - 1);
+    return i;
+}
+
+
+//changes the number of entries of a map, placing the existing keys again
+static void _resize(ALGUI_MAP *map, unsigned long size) {
+    ALGUI_MAP_ENTRY *entries = map->entries;
+    unsigned long old_size = map->size, i;
+    
+    map->entries = (ALGUI_MAP_ENTRY *)al_malloc(size * sizeof(ALGUI_MAP_ENTRY));
+    assert(map->entries);
+    memset(map->entries, 0, size * sizeof(ALGUI_MAP_ENTRY));
+    map->size = size;
+    
+    for(i = 0; i < old_size; ++i) {
+        if (entries[i].key) map->entries[_find(map, entries[i].key)] = entries[i];
+    }
+    
+    al_free(entries);
+}
+
+
+/******************************************************************************
+    PUBLIC
+ ******************************************************************************/
+
+
+/** returns the number of entries in a map.
+    @param map map to get the number of entries of.
+    @return the number of entries.
+ */
+unsigned long algui_get_map_count(ALGUI_MAP *map) {
+    assert(map);
+    return map->count;
+}
+
+
+/** returns the value of a key.
+    @param map map to search.
+    @param key key to search for.
+    @return the value of the key or null if the key is not in the map.
+ */
+void *algui_get_map_value(ALGUI_MAP *map, void *key) {
+    assert(map);
+    if (!map->count || !key) return NULL;
+    return map->entries[_find(map, key)].value;
+}
+
+
+/** initializes a map.
+    @param map map to initialize.
+ */
+void algui_init_map(ALGUI_MAP *map) {
+    assert(map);
+    map->entries = NULL;
+    map->size = 0;
+    map->count = 0;
+}
+
+
+/** removes all entries from a map and frees its memory.
+    @param map map to cleanup.
+ */
+void algui_cleanup_map(ALGUI_MAP *map) {
+    assert(map);
+    al_free(map->entries);
+    algui_init_map(map);
+}
+
+
+/** sets the value of a key.
+    If the key exists, its value is replaced, otherwise a new entry is added.
+    @param map map to set the value of.
+    @param key key; it must not be null.
+    @param value value.
+ */
+void algui_set_map_value(ALGUI_MAP *map, void *key, void *value) {
+    unsigned long i;
+    
+    assert(map);
+    assert(key);
+    
+    //keep the map at most half full
+    if ((map->count + 1) * 2 > map->size) _resize(map, map->size ? map->size * 2 : _MIN_SIZE);
+    
+    i = _find(map, key);
+    if (!map->entries[i].key) {
+        map->entries[i].key = key;
+        ++map->count;
+    }
+    map->entries[i].value = value;
+}
+
+
+/** removes a key from a map.
+    The memory of the map is kept, even if the map becomes empty; it is freed by algui_cleanup_map.
+    @param map map to remove the key from.
+    @param key key to remove.
+    @return non-zero if the key was found, zero otherwise.
+ */
+int algui_remove_map_value(ALGUI_MAP *map, void *key) {
+    unsigned long i, j, k;
+    
+    assert(map);
+    
+    if (!map->count || !key) return 0;
+    
+    i = _find(map, key);
+    if (!map->entries[i].key) return 0;
+    
+    //move back the entries of the probe sequence that follows, so as that no lookup stops at the hole
+    for(j = (i + 1) & (map->size - 1); map->entries[j].key; j = (j + 1) & (map->size - 1)) {
+        k = _hash(map->entries[j].key, map->size);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            map->entries[i] = map->entries[j];
+            i = j;
+        }
+    }
+    map->entries[i].key = NULL;
+    map->entries[i].value = NULL;
+    --map->count;
+    
+    return 1;
+}
@@ -1,5 +1,9 @@
 #include "algui_rect.h"
 #include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
 
 
 /******************************************************************************
@@ -17,6 +21,221 @@
 #endif
 
 
+//region operations
+#define _REGION_UNION         0
+#define _REGION_INTERSECTION  1
+#define _REGION_DIFFERENCE    2
+
+
+//minimum number of rectangles allocated for a region
+#define _MIN_REGION_SIZE      8
+
+
+//storage for the results of the operations whose destination is one of their operands;
+//it is swapped with the storage of the destination, so as that no memory is allocated once it is big enough
+static ALGUI_REGION _scratch_region = {NULL, 0, 0};
+
+
+//makes room for the given number of rectangles after the last rectangle of a region
+static void _reserve_region(ALGUI_REGION *rgn, int count) {
+    int size;
+    if (rgn->count + count <= rgn->size) return;
+    size = MAX(MAX(rgn->size * 2, rgn->count + count), _MIN_REGION_SIZE);
+    rgn->rects = (ALGUI_RECT *)al_realloc(rgn->rects, size * sizeof(ALGUI_RECT));
+    assert(rgn->rects);
+    rgn->size = size;
+}
+
+
+//returns the end of the band that starts at the given rectangle
+static int _get_band_end(ALGUI_REGION *rgn, int begin) {
+    int top = rgn->rects[begin].top;
+    for(++begin; begin < rgn->count && rgn->rects[begin].top == top; ++begin);
+    return begin;
+}
+
+
+//recalculates the bounding rectangle of a region
+static void _update_region_bounds(ALGUI_REGION *rgn) {
+    int i;
+    if (rgn->count == 0) return;
+    rgn->bounds = rgn->rects[0];
+    rgn->bounds.bottom = rgn->rects[rgn->count - 1].bottom;
+    for(i = 1; i < rgn->count; ++i) {
+        rgn->bounds.left  = MIN(rgn->bounds.left , rgn->rects[i].left );
+        rgn->bounds.right = MAX(rgn->bounds.right, rgn->rects[i].right);
+    }
+}
+
+
+//if the band from 'begin' to 'end' touches the previous band and has the same spans,
+//the previous band is extended to cover it; returns non-zero if the band was merged
+static int _coalesce_band(ALGUI_REGION *rgn, int prev, int begin, int end) {
+    int i;
+    if (prev < 0 || begin - prev != end - begin) return 0;
+    if (rgn->rects[prev].bottom + 1 != rgn->rects[begin].top) return 0;
+    for(i = 0; i < end - begin; ++i) {
+        if (rgn->rects[prev + i].left != rgn->rects[begin + i].left || rgn->rects[prev + i].right != rgn->rects[begin + i].right) return 0;
+    }
+    for(i = 0; i < end - begin; ++i) {
+        rgn->rects[prev + i].bottom = rgn->rects[begin + i].bottom;
+    }
+    return 1;
+}
+
+
+//combines the spans of two bands, by walking their edges left to right;
+//the resulting spans are appended to the result as rectangles from row 'top' to row 'bottom'
+static void _combine_bands(int op, ALGUI_RECT *b1, int n1, ALGUI_RECT *b2, int n2, int top, int bottom, ALGUI_REGION *r) {
+    int e1 = 0, e2 = 0, x1, x2, x, in1 = 0, in2 = 0, inside = 0, now_inside, left = 0;
+    ALGUI_RECT *rct;
+    
+    _reserve_region(r, n1 + n2);
+    
+    while (e1 < n1 * 2 || e2 < n2 * 2) {
+        //even edges are left edges, odd edges are the edges after the right edges
+        x1 = e1 < n1 * 2 ? (e1 & 1 ? b1[e1 >> 1].right + 1 : b1[e1 >> 1].left) : INT_MAX;
+        x2 = e2 < n2 * 2 ? (e2 & 1 ? b2[e2 >> 1].right + 1 : b2[e2 >> 1].left) : INT_MAX;
+        x = MIN(x1, x2);
+        if (x1 == x) in1 = !(e1++ & 1);
+        if (x2 == x) in2 = !(e2++ & 1);
+        
+        switch (op) {
+            case _REGION_UNION:
+                now_inside = in1 || in2;
+                break;
+            case _REGION_INTERSECTION:
+                now_inside = in1 && in2;
+                break;
+            default:
+                now_inside = in1 && !in2;
+                break;
+        }
+        
+        if (now_inside == inside) continue;
+        inside = now_inside;
+        if (inside) {
+            left = x;
+            continue;
+        }
+        rct = r->rects + r->count++;
+        rct->left = left;
+        rct->top = top;
+        rct->right = x - 1;
+        rct->bottom = bottom;
+    }
+}
+
+
+//combines two regions band by band; the result can be one of the operands;
+//the result is built in the storage of the destination, or in the scratch storage if the destination is an operand
+static void _combine_regions(int op, ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r) {
+    ALGUI_REGION *result = r == r1 || r == r2 ? &_scratch_region : r, temp;
+    int i1 = 0, i2 = 0, end1, end2, top1, top2, bottom1, bottom2, active1, active2, y = INT_MIN, next_y, begin, prev = -1;
+    
+    result->count = 0;
+    end1 = r1->count ? _get_band_end(r1, 0) : 0;
+    end2 = r2->count ? _get_band_end(r2, 0) : 0;
+    
+    while (i1 < r1->count || i2 < r2->count) {
+        top1    = i1 < r1->count ? r1->rects[i1].top : INT_MAX;
+        bottom1 = i1 < r1->count ? r1->rects[i1].bottom : INT_MAX;
+        top2    = i2 < r2->count ? r2->rects[i2].top : INT_MAX;
+        bottom2 = i2 < r2->count ? r2->rects[i2].bottom : INT_MAX;
+        
+        //skip the rows that belong to no band
+        y = MAX(y, MIN(top1, top2));
+        active1 = top1 <= y;
+        active2 = top2 <= y;
+        
+        //the current slice ends where a band of either region starts or ends
+        next_y = MIN(active1 ? bottom1 : top1 - 1, active2 ? bottom2 : top2 - 1);
+        
+        //combine the bands, unless the result is known to be empty
+        if (op == _REGION_UNION || (active1 && (active2 || op == _REGION_DIFFERENCE))) {
+            begin = result->count;
+            _combine_bands(op, 
+                r1->rects + i1, active1 ? end1 - i1 : 0, 
+                r2->rects + i2, active2 ? end2 - i2 : 0, 
+                y, next_y, result);
+            if (result->count > begin) {
+                if (_coalesce_band(result, prev, begin, result->count)) {
+                    result->count = begin;
+                }
+                else {
+                    prev = begin;
+                }
+            }
+        }
+        
+        //advance the bands that end at this slice
+        if (active1 && bottom1 == next_y) {
+            i1 = end1;
+            end1 = i1 < r1->count ? _get_band_end(r1, i1) : i1;
+        }
+        if (active2 && bottom2 == next_y) {
+            i2 = end2;
+            end2 = i2 < r2->count ? _get_band_end(r2, i2) : i2;
+        }
+        y = next_y + 1;
+    }
+    
+    _update_region_bounds(result);
+    if (result == r) return;
+    temp = *r;
+    *r = *result;
+    *result = temp;
+}
+
+
+//compares two integers for qsort
+static int _compare_ints(const void *a, const void *b) {
+    int i1 = *(const int *)a, i2 = *(const int *)b;
+    return i1 < i2 ? -1 : i1 > i2;
+}
+
+
+//closes the smallest gaps between the rectangles of a band, until the band has at most 'max_rects' rectangles;
+//returns the new end of the band
+static int _simplify_band(ALGUI_REGION *rgn, int begin, int end, int max_rects, int *gaps) {
+    int count = end - begin, i, out, threshold, closed_at_threshold, to_close;
+    if (count <= max_rects) return end;
+    
+    //find the largest gap that must be closed
+    for(i = begin + 1; i < end; ++i) {
+        gaps[i - begin - 1] = rgn->rects[i].left - rgn->rects[i - 1].right;
+    }
+    to_close = count - max_rects;
+    qsort(gaps, count - 1, sizeof(int), _compare_ints);
+    threshold = gaps[to_close - 1];
+    
+    //of the gaps equal to the threshold, close only as many as needed
+    closed_at_threshold = 0;
+    for(i = 0; i < to_close; ++i) {
+        if (gaps[i] == threshold) ++closed_at_threshold;
+    }
+    
+    //close the gaps
+    out = begin;
+    for(i = begin + 1; i < end; ++i) {
+        int gap = rgn->rects[i].left - rgn->rects[out].right;
+        if (gap < threshold || (gap == threshold && closed_at_threshold-- > 0)) {
+            rgn->rects[out].right = rgn->rects[i].right;
+        }
+        else {
+            rgn->rects[++out] = rgn->rects[i];
+        }
+    }
+    return out + 1;
+}
+
+
+//frees the scratch storage of region operations; invoked from algui_cleanup
+void _algui_cleanup_regions() {
+    algui_cleanup_region(&_scratch_region);
+}
+
+
 /******************************************************************************
     PUBLIC
  ******************************************************************************/
@@ -212,3 +431,331 @@ void algui_get_rect_union(ALGUI_RECT *r1, ALGUI_RECT *r2, ALGUI_RECT *r) {
     r->bottom = MAX(r1->bottom, r2->bottom);
 }
 
+
+/** initializes a region to empty.
+    @param rgn region to initialize.
+ */
+void algui_init_region(ALGUI_REGION *rgn) {
+    assert(rgn);
+    memset(rgn, 0, sizeof(ALGUI_REGION));
+}
+
+
+/** frees the memory of a region.
+    @param rgn region to cleanup.
+ */
+void algui_cleanup_region(ALGUI_REGION *rgn) {
+    assert(rgn);
+    al_free(rgn->rects);
+    algui_init_region(rgn);
+}
+
+
+/** empties a region; the memory of the region is kept for reuse.
+    @param rgn region to clear.
+ */
+void algui_clear_region(ALGUI_REGION *rgn) {
+    assert(rgn);
+    rgn->count = 0;
+}
+
+
+/** checks if a region is empty.
+    @param rgn region to check.
+    @return non-zero if the region is empty.
+ */
+int algui_is_region_empty(ALGUI_REGION *rgn) {
+    assert(rgn);
+    return rgn->count == 0;
+}
+
+
+/** checks if a region contains a point.
+    @param rgn region to check.
+    @param x horizontal coordinate.
+    @param y vertical coordinate.
+    @return non-zero if the point is in the region.
+ */
+int algui_region_intersects_point(ALGUI_REGION *rgn, int x, int y) {
+    int i;
+    assert(rgn);
+    if (rgn->count == 0 || !algui_rect_intersects_point(&rgn->bounds, x, y)) return 0;
+    for(i = 0; i < rgn->count && rgn->rects[i].top <= y; ++i) {
+        if (algui_rect_intersects_point(rgn->rects + i, x, y)) return 1;
+    }
+    return 0;
+}
+
+
+/** checks if a region intersects a rectangle.
+    @param rgn region to check.
+    @param rct rectangle to check.
+    @return non-zero if some part of the rectangle is in the region.
+ */
+int algui_region_intersects_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    int i;
+    assert(rgn);
+    assert(rct);
+    if (rgn->count == 0 || !algui_rect_intersects_rect(&rgn->bounds, rct)) return 0;
+    for(i = 0; i < rgn->count && rgn->rects[i].top <= rct->bottom; ++i) {
+        if (algui_rect_intersects_rect(rgn->rects + i, rct)) return 1;
+    }
+    return 0;
+}
+
+
+/** checks if a region contains a rectangle.
+    @param rgn region to check.
+    @param rct rectangle to check.
+    @return non-zero if the whole rectangle is in the region.
+ */
+int algui_region_contains_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    int i, end, y;
+    assert(rgn);
+    assert(rct);
+    if (!algui_is_rect_normalized(rct)) return 1;
+    if (rgn->count == 0 || 
+        rct->left < rgn->bounds.left || rct->top < rgn->bounds.top || 
+        rct->right > rgn->bounds.right || rct->bottom > rgn->bounds.bottom) return 0;
+    
+    //the rows of the rectangle must be covered band by band, without gaps;
+    //since the rects of a band do not touch, one rect of each band must cover the columns of the rectangle
+    y = rct->top;
+    for(i = 0; i < rgn->count && y <= rct->bottom; i = end) {
+        end = _get_band_end(rgn, i);
+        if (rgn->rects[i].bottom < y) continue;
+        if (rgn->rects[i].top > y) return 0;
+        for(; i < end && rgn->rects[i].right < rct->left; ++i);
+        if (i == end || rgn->rects[i].left > rct->left || rgn->rects[i].right < rct->right) return 0;
+        y = rgn->rects[i].bottom + 1;
+    }
+    return y > rct->bottom;
+}
+
+
+/** sets a region to a rectangle.
+    @param rgn region to set.
+    @param rct rectangle; if it is not normalized, the region becomes empty.
+ */
+void algui_set_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    assert(rgn);
+    assert(rct);
+    rgn->count = 0;
+    if (!algui_is_rect_normalized(rct)) return;
+    _reserve_region(rgn, 1);
+    rgn->rects[0] = *rct;
+    rgn->bounds = *rct;
+    rgn->count = 1;
+}
+
+
+/** copies a region.
+    @param dst destination region.
+    @param src source region.
+ */
+void algui_copy_region(ALGUI_REGION *dst, ALGUI_REGION *src) {
+    assert(dst);
+    assert(src);
+    if (dst == src) return;
+    dst->count = 0;
+    _reserve_region(dst, src->count);
+    memcpy(dst->rects, src->rects, src->count * sizeof(ALGUI_RECT));
+    dst->count = src->count;
+    dst->bounds = src->bounds;
+}
+
+
+/** calculates the union of two regions.
+    @param r1 1st region; it can be the result.
+    @param r2 2nd region; it can be the result.
+    @param r result.
+ */
+void algui_get_region_union(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r) {
+    assert(r1);
+    assert(r2);
+    assert(r);
+    _combine_regions(_REGION_UNION, r1, r2, r);
+}
+
+
+/** calculates the intersection of two regions.
+    @param r1 1st region; it can be the result.
+    @param r2 2nd region; it can be the result.
+    @param r result.
+ */
+void algui_get_region_intersection(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r) {
+    assert(r1);
+    assert(r2);
+    assert(r);
+    _combine_regions(_REGION_INTERSECTION, r1, r2, r);
+}
+
+
+/** calculates the difference of two regions.
+    @param r1 region to subtract from; it can be the result.
+    @param r2 region to subtract; it can be the result.
+    @param r result.
+ */
+void algui_get_region_difference(ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r) {
+    assert(r1);
+    assert(r2);
+    assert(r);
+    _combine_regions(_REGION_DIFFERENCE, r1, r2, r);
+}
+
+
+/** adds a rectangle to a region.
+    @param rgn region to modify.
+    @param rct rectangle to add.
+ */
+void algui_add_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    ALGUI_REGION r2 = {rct, 1, 1, *rct};
+    assert(rgn);
+    assert(rct);
+    if (!algui_is_rect_normalized(rct)) return;
+    if (rgn->count == 0) {
+        algui_set_region_rect(rgn, rct);
+        return;
+    }
+    _combine_regions(_REGION_UNION, rgn, &r2, rgn);
+}
+
+
+/** removes a rectangle from a region.
+    @param rgn region to modify.
+    @param rct rectangle to remove.
+ */
+void algui_subtract_region_rect(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    ALGUI_REGION r2 = {rct, 1, 1, *rct};
+    assert(rgn);
+    assert(rct);
+    if (!algui_is_rect_normalized(rct) || !algui_region_intersects_rect(rgn, rct)) return;
+    _combine_regions(_REGION_DIFFERENCE, rgn, &r2, rgn);
+}
+
+
+/** clips a region to a rectangle.
+    @param rgn region to modify.
+    @param rct rectangle to clip the region to.
+ */
+void algui_clip_region(ALGUI_REGION *rgn, ALGUI_RECT *rct) {
+    ALGUI_REGION r2 = {rct, 1, 1, *rct};
+    assert(rgn);
+    assert(rct);
+    if (!algui_is_rect_normalized(rct)) {
+        rgn->count = 0;
+        return;
+    }
+    _combine_regions(_REGION_INTERSECTION, rgn, &r2, rgn);
+}
+
+
+/** moves a region relative to its current position.
+    @param rgn region to move.
+    @param x horizontal offset.
+    @param y vertical offset.
+ */
+void algui_offset_region(ALGUI_REGION *rgn, int x, int y) {
+    int i;
+    assert(rgn);
+    for(i = 0; i < rgn->count; ++i) {
+        algui_offset_rect(rgn->rects + i, x, y);
+    }
+    algui_offset_rect(&rgn->bounds, x, y);
+}
+
+
+/** merges the touching rectangles of a region.
+    The region operations keep their results merged; 
+    this is needed only after the rectangles of a region are modified directly.
+    @param rgn region to merge.
+ */
+void algui_merge_region(ALGUI_REGION *rgn) {
+    int i, end, out = 0, begin, prev = -1;
+    assert(rgn);
+    
+    for(i = 0; i < rgn->count; i = end) {
+        end = _get_band_end(rgn, i);
+        
+        //join the touching rectangles of the band
+        begin = out;
+        for(; i < end; ++i) {
+            if (out > begin && rgn->rects[out - 1].right + 1 >= rgn->rects[i].left) {
+                rgn->rects[out - 1].right = MAX(rgn->rects[out - 1].right, rgn->rects[i].right);
+            }
+            else {
+                rgn->rects[out++] = rgn->rects[i];
+            }
+        }
+        
+        //join the band with the previous band
+        if (_coalesce_band(rgn, prev, begin, out)) {
+            out = begin;
+        }
+        else {
+            prev = begin;
+        }
+    }
+    
+    rgn->count = out;
+    _update_region_bounds(rgn);
+}
+
+
+/** reduces the number of rectangles of a region, by merging nearby rectangles.
+    The result covers the original region, and possibly some area outside of it.
+    @param rgn region to simplify.
+    @param max_rects maximum number of rectangles; must be greater than 0.
+ */
+void algui_simplify_region(ALGUI_REGION *rgn, int max_rects) {
+    int i, end, next, band_count = 0, max_band_rects = 0, out, band, group_end, *buffer;
+    assert(rgn);
+    assert(max_rects > 0);
+    if (rgn->count <= max_rects) return;
+    
+    for(i = 0; i < rgn->count; i = end) {
+        end = _get_band_end(rgn, i);
+        max_band_rects = MAX(max_band_rects, end - i);
+        ++band_count;
+    }
+    
+    //if there are few enough bands, close the smallest gaps within each band
+    if (band_count <= max_rects) {
+        buffer = (int *)al_malloc(max_band_rects * sizeof(int));
+        assert(buffer);
+        out = 0;
+        for(i = 0; i < rgn->count; i = next) {
+            next = _get_band_end(rgn, i);
+            end = _simplify_band(rgn, i, next, max_rects / band_count, buffer);
+            memmove(rgn->rects + out, rgn->rects + i, (end - i) * sizeof(ALGUI_RECT));
+            out += end - i;
+        }
+        rgn->count = out;
+    }
+    
+    //else replace runs of consecutive bands with their bounding rectangles
+    else {
+        buffer = (int *)al_malloc(band_count * sizeof(int));
+        assert(buffer);
+        for(i = 0, band = 0; i < rgn->count; i = end) {
+            end = _get_band_end(rgn, i);
+            buffer[band++] = i;
+        }
+        for(out = 0; out < max_rects; ++out) {
+            band = (int)((long long)out * band_count / max_rects);
+            group_end = (int)((long long)(out + 1) * band_count / max_rects);
+            group_end = group_end < band_count ? buffer[group_end] : rgn->count;
+            i = buffer[band];
+            rgn->rects[out] = rgn->rects[i];
+            rgn->rects[out].bottom = rgn->rects[group_end - 1].bottom;
+            for(++i; i < group_end; ++i) {
+                rgn->rects[out].left  = MIN(rgn->rects[out].left , rgn->rects[i].left );
+                rgn->rects[out].right = MAX(rgn->rects[out].right, rgn->rects[i].right);
+            }
+        }
+        rgn->count = out;
+    }
+    
+    al_free(buffer);
+    algui_merge_region(rgn);
+}
@@ -33,12 +33,17 @@ typedef struct _RESOURCE {
  ******************************************************************************/
  
  
-//mutex
+//mutex; recursive, because destructors may release other resources
 static ALLEGRO_MUTEX *_mutex = NULL; 
  
  
 //resources
 static ALGUI_LIST _resources = ALGUI_LIST_INITIALIZER; 
+
+
+//functions invoked before a resource is destroyed
+static void (**_destroy_hooks)(void *) = NULL;
+static int _destroy_hook_count = 0;
  
  
 /******************************************************************************
@@ -48,7 +53,7 @@ static ALGUI_LIST _resources = ALGUI_LIST_INITIALIZER;
  
 //initializes the resource manager; invoked from algui_init
 int _algui_init_resource_manager() {
-    _mutex = al_create_mutex();
+    _mutex = al_create_mutex_recursive();
     if (!_mutex) return 0;
     return 1;
 } 
@@ -58,6 +63,9 @@ int _algui_init_resource_manager() {
 void _algui_cleanup_resource_manager() {
     algui_destroy_resources();
     al_destroy_mutex(_mutex);
+    al_free(_destroy_hooks);
+    _destroy_hooks = NULL;
+    _destroy_hook_count = 0;
 } 
  
  
@@ -134,8 +142,15 @@ static _RESOURCE *_create_resource(void *data, const char *name, void (*dtor)(vo
 
 //destroys a resource
 static void _destroy_resource(_RESOURCE *res, int invoke_dtor) {
-    //invoke the destructor
-    if (invoke_dtor) res->destructor(res->data);
+    int i;
+    
+    //invoke the hooks and the destructor
+    if (invoke_dtor) {
+        for(i = 0; i < _destroy_hook_count; ++i) {
+            _destroy_hooks[i](res->data);
+        }
+        res->destructor(res->data);
+    }
     
     //destroy the name string
     al_ustr_free(res->name);
@@ -292,8 +307,40 @@ int algui_release_resource(void *res) {
     //if the ref count reaches 0, uninstall the resource
     if (!node->ref_count) _uninstall_resource(node, 1);
     
+    al_unlock_mutex(_mutex);
+        
+    //success
+    return 1;
+}
+
+
+/** increments the reference count of an installed resource.
+    @param res resource; can be null.
+    @return non-zero if the operation suceeded, zero if the resource does not exist.
+ */
+int algui_reference_resource(void *res) {
+    _RESOURCE *node;
+
+    //no resource
+    if (!res) return 0;    
+    
     al_lock_mutex(_mutex);
         
+    //find the resource
+    node = _find_resource_by_data(res);
+    
+    //if not found, return error
+    if (!node) {
+        al_unlock_mutex(_mutex);
+        return 0;
+    }        
+    
+    //increment the resource's ref count
+    ++node->ref_count;
+    assert(node->ref_count != 0);
+    
+    al_unlock_mutex(_mutex);
+        
     //success
     return 1;
 }
@@ -302,21 +349,16 @@ int algui_release_resource(void *res) {
 /** destroys and uninstalls all resources.
  */
 void algui_destroy_resources() {
-    ALGUI_LIST_NODE *node, *next;    
+    ALGUI_LIST_NODE *node;    
     
     //lock the resources
     al_lock_mutex(_mutex);
     
-    //iterate the resources
-    for(node = algui_get_first_list_node(&_resources); node; ) {    
-        //get next
-        next = algui_get_next_list_node(node);
-        
-        //uninstall the resource
+    //uninstall the resources from last to first; resources are installed after 
+    //the resources they depend on, and a destructor may release other resources,
+    //so the list is re-read after each destructor
+    while ((node = algui_get_last_list_node(&_resources))) {    
         _uninstall_resource((_RESOURCE *)algui_get_list_node_data(node), 1);
-        
-        //continue with the next
-        node = next;
     }
     
     //unlock the resources
@@ -324,6 +366,66 @@ void algui_destroy_resources() {
 }
 
 
+/** adds a function to be invoked before a resource is destroyed.
+    It allows caches of data derived from resources to drop the data of destroyed resources.
+    @param hook function to invoke; it receives the resource.
+    @return non-zero if the operation suceeded, zero if the function is already added.
+ */
+int algui_add_resource_destroy_hook(void (*hook)(void *)) {
+    int i;
+    
+    assert(hook);
+    
+    al_lock_mutex(_mutex);
+    
+    //if the hook is already added, return error
+    for(i = 0; i < _destroy_hook_count; ++i) {
+        if (_destroy_hooks[i] == hook) {
+            al_unlock_mutex(_mutex);
+            return 0;
+        }
+    }
+    
+    //add the hook
+    _destroy_hooks = (void (**)(void *))al_realloc(_destroy_hooks, (_destroy_hook_count + 1) * sizeof(*_destroy_hooks));
+    assert(_destroy_hooks);
+    _destroy_hooks[_destroy_hook_count++] = hook;
+    
+    al_unlock_mutex(_mutex);
+    
+    //success
+    return 1;
+}
+
+
+/** removes a function added with algui_add_resource_destroy_hook.
+    @param hook function to remove.
+    @return non-zero if the operation suceeded, zero if the function is not found.
+ */
+int algui_remove_resource_destroy_hook(void (*hook)(void *)) {
+    int i;
+    
+    al_lock_mutex(_mutex);
+    
+    //find the hook and move the following ones over it
+    for(i = 0; i < _destroy_hook_count; ++i) {
+        if (_destroy_hooks[i] == hook) {
+            --_destroy_hook_count;
+            for(; i < _destroy_hook_count; ++i) {
+                _destroy_hooks[i] = _destroy_hooks[i + 1];
+            }
+            al_unlock_mutex(_mutex);
+            return 1;
+        }
+    }
+    
+    al_unlock_mutex(_mutex);
+    
+    //not found
+    return 0;
+}
+
+
 /** destructor for a bitmap resource.
     It destroys the allegro bitmap.
     @param res pointer to resource to destroy.
@@ -334,6 +436,20 @@ void algui_bitmap_resource_destructor(void *res) {
 }
 
 
+/** destructor for a sub-bitmap resource.
+    It destroys the allegro sub-bitmap and releases the parent bitmap,
+    which must be a resource referenced once by each of its sub-bitmap resources.
+    @param res pointer to resource to destroy.
+ */
+void algui_sub_bitmap_resource_destructor(void *res) {
+    ALLEGRO_BITMAP *parent;
+    assert(res);
+    parent = al_get_parent_bitmap((ALLEGRO_BITMAP *)res);
+    al_destroy_bitmap((ALLEGRO_BITMAP *)res);
+    algui_release_resource(parent);
+}
+
+
 /** destructor for a font resource.
     It destroys the allegro font.
     @param res pointer to resource to destroy.
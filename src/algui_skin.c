@@ -4,9 +4,31 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <ctype.h>
 #include "algui_resource_manager.h"
 
 
+/******************************************************************************
+    INTERNAL CONSTANTS
+ ******************************************************************************/
+ 
+ 
+//default atlas page size
+#define _DEFAULT_ATLAS_PAGE_SIZE 1024
+
+
+//default padding around atlas bitmaps
+#define _DEFAULT_ATLAS_PADDING   1
+
+
+//config section of the atlas settings
+#define _ATLAS_SECTION           "atlas"
+
+
+//extensions of bitmap files
+static const char *_bitmap_extensions[] = {".png", ".bmp", ".jpg", ".jpeg", ".tga", ".pcx", NULL};
+
+
 /******************************************************************************
     INTERNAL FUNCTIONS
  ******************************************************************************/
@@ -283,6 +305,13 @@ static ALLEGRO_BITMAP *_load_bitmap(ALGUI_SKIN *skin, const char *filename) {
     //empty filepath
     if (!filepath) return NULL;
     
+    //the bitmap may already be loaded, either standalone or in the atlas
+    bmp = (ALLEGRO_BITMAP *)algui_acquire_resource(al_cstr(filepath));
+    if (bmp) {
+        al_ustr_free(filepath);
+        return bmp;
+    }
+    
     //load the bitmap
     bmp = al_load_bitmap(al_cstr(filepath));
     
@@ -300,8 +329,111 @@ static ALLEGRO_BITMAP *_load_bitmap(ALGUI_SKIN *skin, const char *filename) {
     }
     
     //success
+    al_ustr_free(filepath);
     return bmp;
 }
+
+
+//compares two ASCII strings, ignoring case
+static int _compare_nocase(const char *s1, const char *s2) {
+    for(; *s1 && tolower((unsigned char)*s1) == tolower((unsigned char)*s2); ++s1, ++s2);
+    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+
+
+//checks if a config value is the filename of a bitmap
+static int _is_bitmap_filename(const char *value) {
+    size_t len, ext_len;
+    int i;
+    
+    if (!value) return 0;
+    len = strlen(value);
+    
+    for(i = 0; _bitmap_extensions[i]; ++i) {
+        ext_len = strlen(_bitmap_extensions[i]);
+        if (len > ext_len && _compare_nocase(value + len - ext_len, _bitmap_extensions[i]) == 0) return 1;
+    }
+    
+    return 0;
+}
+
+
+//packs the bitmaps referenced by the config of a skin into the atlas of the skin
+static void _build_atlas(ALGUI_SKIN *skin) {
+    ALLEGRO_CONFIG_SECTION *section_iter;
+    ALLEGRO_CONFIG_ENTRY *entry_iter;
+    const char *section, *entry, *value;
+    ALLEGRO_BITMAP **bitmaps = NULL;
+    ALLEGRO_USTR **filepaths = NULL;
+    const char **names = NULL;
+    int count = 0, size = 0, i;
+    ALLEGRO_USTR *filepath;
+    ALLEGRO_BITMAP *bmp;
+    int page_width, page_height, padding;
+    
+    //the atlas settings
+    page_width = algui_get_skin_int(skin, _ATLAS_SECTION, "page_width", _DEFAULT_ATLAS_PAGE_SIZE);
+    page_height = algui_get_skin_int(skin, _ATLAS_SECTION, "page_height", page_width);
+    padding = algui_get_skin_int(skin, _ATLAS_SECTION, "padding", _DEFAULT_ATLAS_PADDING);
+    if (page_width <= 0 || page_height <= 0) return;
+    if (padding < 0) padding = 0;
+    skin->atlas = algui_create_atlas(page_width, page_height, padding);
+    
+    //load the bitmaps of all the sections; the global section has a section name of ""
+    for(section = al_get_first_config_section(skin->config, &section_iter); section; section = al_get_next_config_section(&section_iter)) {
+        for(entry = al_get_first_config_entry(skin->config, section, &entry_iter); entry; entry = al_get_next_config_entry(&entry_iter)) {
+            value = al_get_config_value(skin->config, section, entry);
+            if (!_is_bitmap_filename(value)) continue;
+            
+            //skip bitmaps already loaded
+            filepath = _get_resource_filepath(skin->filename, value);
+            bmp = (ALLEGRO_BITMAP *)algui_acquire_resource(al_cstr(filepath));
+            if (bmp) {
+                algui_release_resource(bmp);
+                al_ustr_free(filepath);
+                continue;
+            }
+            for(i = 0; i < count; ++i) {
+                if (al_ustr_equal(filepaths[i], filepath)) break;
+            }
+            if (i < count) {
+                al_ustr_free(filepath);
+                continue;
+            }
+            
+            //load the bitmap
+            bmp = al_load_bitmap(al_cstr(filepath));
+            if (!bmp) {
+                al_ustr_free(filepath);
+                continue;
+            }
+            
+            //add it to the bitmaps to pack
+            if (count == size) {
+                size = size ? size * 2 : 16;
+                bitmaps = (ALLEGRO_BITMAP **)al_realloc(bitmaps, size * sizeof(ALLEGRO_BITMAP *));
+                filepaths = (ALLEGRO_USTR **)al_realloc(filepaths, size * sizeof(ALLEGRO_USTR *));
+                names = (const char **)al_realloc(names, size * sizeof(const char *));
+                assert(bitmaps && filepaths && names);
+            }
+            bitmaps[count] = bmp;
+            filepaths[count] = filepath;
+            names[count] = al_cstr(filepath);
+            ++count;
+        }
+    }
+    
+    //pack the bitmaps
+    algui_add_atlas_bitmaps(skin->atlas, bitmaps, names, count);
+    
+    //free the temporary arrays
+    for(i = 0; i < count; ++i) {
+        al_ustr_free(filepaths[i]);
+    }
+    al_free(bitmaps);
+    al_free(filepaths);
+    al_free(names);
+}
  
  
 //loads a font from a file
@@ -364,6 +496,16 @@ ALLEGRO_CONFIG *algui_get_skin_config(ALGUI_SKIN *skin) {
 }
 
 
+/** returns the texture atlas of a skin.
+    @param skin skin to get the atlas of.
+    @return the atlas of the skin, or null if the skin has no atlas.
+ */
+ALGUI_ATLAS *algui_get_skin_atlas(ALGUI_SKIN *skin) {
+    assert(skin);
+    return skin->atlas;
+}
+
+
 /** returns an integer value from a skin.
     @param skin skin to get the value from.
     @param wgt widget name (UTF-8 string).
@@ -496,6 +638,7 @@ ALLEGRO_COLOR algui_get_skin_color(ALGUI_SKIN *skin, const char *wgt, const char
  */
 ALLEGRO_BITMAP *algui_get_skin_bitmap(ALGUI_SKIN *skin, const char *wgt, const char *res, ALLEGRO_BITMAP *def) {
     const char *valstr;
+    ALLEGRO_BITMAP *bmp;
     
     assert(skin);
     assert(skin->config);
@@ -503,8 +646,9 @@ ALLEGRO_BITMAP *algui_get_skin_bitmap(ALGUI_SKIN *skin, const char *wgt, const c
     //get the config value
     valstr = al_get_config_value(skin->config, wgt, res);
 
-    //load the bitmap    
-    return _load_bitmap(skin, valstr);
+    //load the bitmap; if it cannot be loaded, return the default
+    bmp = _load_bitmap(skin, valstr);
+    return bmp ? bmp : def;
 }
 
 
@@ -559,19 +703,22 @@ void algui_init_skin(ALGUI_SKIN *skin) {
     assert(skin);
     skin->filename = al_ustr_new("");
     skin->config = al_create_config();
+    skin->atlas = NULL;
 }
 
 
 /** cleans up a skin structure.
-    Destroys the allegro config.
+    Destroys the allegro config and the atlas.
     @param skin skin structure to cleanup.
  */
 void algui_cleanup_skin(ALGUI_SKIN *skin) {
     assert(skin);
     al_ustr_free(skin->filename);
     al_destroy_config(skin->config);
+    if (skin->atlas) algui_destroy_atlas(skin->atlas);
     skin->filename = NULL;
     skin->config = NULL;
+    skin->atlas = NULL;
 }
 
 
@@ -619,6 +766,10 @@ ALGUI_SKIN *algui_load_skin(const char *filename) {
     //set the config
     skin->config = config;
     
+    //pack the bitmaps of the skin
+    skin->atlas = NULL;
+    _build_atlas(skin);
+    
     return skin;
 }
 
@@ -0,0 +1,562 @@
+#include "algui_text.h"
+#include <assert.h>
+#include <string.h>
+#include "algui_list.h"
+#include "algui_resource_manager.h"
+
+
+/******************************************************************************
+    INTERNAL CONSTANTS
+ ******************************************************************************/
+ 
+ 
+//default memory budget of the text cache
+#define _DEFAULT_BUDGET        (4 * 1024 * 1024)
+
+
+//bytes per pixel of text images, used in computing the memory used by them
+#define _IMAGE_PIXEL_SIZE      4
+
+
+//initial number of hash buckets
+#define _MIN_BUCKETS           64
+
+
+//flags of measurement entries; drawing flags are never negative
+#define _MEASURE_FLAGS         -1
+
+
+//alignment flags
+#define _ALIGN_MASK            (ALLEGRO_ALIGN_CENTRE | ALLEGRO_ALIGN_RIGHT)
+ 
+ 
+/******************************************************************************
+    INTERNAL TYPES
+ ******************************************************************************/
+ 
+ 
+//cached text
+typedef struct _TEXT_ENTRY {
+    //node in the list of entries, from the most recently to the least recently used
+    ALGUI_LIST_NODE node;
+    
+    //node in the list of entries of the font
+    ALGUI_LIST_NODE font_node;
+    
+    //next entry in the same hash bucket
+    struct _TEXT_ENTRY *next;
+    
+    //key
+    unsigned long hash;
+    ALLEGRO_FONT *font;
+    ALLEGRO_USTR *text;
+    ALLEGRO_COLOR color;
+    int flags;
+    
+    //text width and font line height
+    int width;
+    int height;
+    
+    //rendered image and its offset from the text position; null for measurement entries
+    ALLEGRO_BITMAP *bitmap;
+    int bitmap_x;
+    int bitmap_y;
+    
+    //memory used by the entry
+    size_t size;
+} _TEXT_ENTRY;
+
+
+//entries of a font; only fonts with entries are kept
+typedef struct _TEXT_FONT {
+    ALLEGRO_FONT *font;
+    ALGUI_LIST entries;
+} _TEXT_FONT;
+ 
+ 
+/******************************************************************************
+    INTERNAL VARIABLES
+ ******************************************************************************/
+ 
+ 
+//hash table of entries
+static _TEXT_ENTRY **_buckets = NULL;
+static unsigned long _bucket_count = 0;
+static unsigned long _entry_count = 0;
+
+
+//entries, from the most recently to the least recently used
+static ALGUI_LIST _entries = ALGUI_LIST_INITIALIZER;
+
+
+//fonts with entries; there are few of them, so they are searched linearly
+static _TEXT_FONT *_fonts = NULL;
+static int _font_count = 0;
+static int _font_size = 0;
+
+
+//memory budget and memory used
+static size_t _budget = _DEFAULT_BUDGET;
+static size_t _size = 0;
+
+
+//statistics
+static unsigned long _hit_count = 0;
+static unsigned long _miss_count = 0;
+static unsigned long _eviction_count = 0;
+
+
+//if set, drawn texts are rendered to images
+static int _rendering = 0;
+ 
+ 
+/******************************************************************************
+    INTERNAL FUNCTIONS
+ ******************************************************************************/
+ 
+ 
+//hashes a key
+static unsigned long _hash(ALLEGRO_FONT *font, const char *text, ALLEGRO_COLOR color, int flags) {
+    unsigned long h = 2166136261UL;
+    const unsigned char *p;
+    
+    for(p = (const unsigned char *)text; *p; ++p) {
+        h = (h ^ *p) * 16777619UL;
+    }
+    h ^= (unsigned long)(size_t)font >> 4;
+    h = h * 31 + (unsigned long)flags;
+    h = h * 31 + (unsigned long)(color.r * 255) + ((unsigned long)(color.g * 255) << 8);
+    h = h * 31 + (unsigned long)(color.b * 255) + ((unsigned long)(color.a * 255) << 8);
+    return h;
+}
+
+
+//checks if an entry has the given key
+static int _is_key(_TEXT_ENTRY *entry, unsigned long hash, ALLEGRO_FONT *font, const char *text, ALLEGRO_COLOR color, int flags) {
+    return entry->hash == hash && 
+           entry->font == font && 
+           entry->flags == flags &&
+           entry->color.r == color.r && entry->color.g == color.g && entry->color.b == color.b && entry->color.a == color.a &&
+           strcmp(al_cstr(entry->text), text) == 0;
+}
+
+
+//returns the index of the entries of a font, or -1 if the font has no entries
+static int _find_font(ALLEGRO_FONT *font) {
+    int i;
+    for(i = 0; i < _font_count; ++i) {
+        if (_fonts[i].font == font) return i;
+    }
+    return -1;
+}
+
+
+//returns the index of the entries of a font, adding them if the font has no entries
+static int _add_font(ALLEGRO_FONT *font) {
+    int i = _find_font(font);
+    if (i >= 0) return i;
+    if (_font_count == _font_size) {
+        _font_size = _font_size ? _font_size * 2 : 4;
+        _fonts = (_TEXT_FONT *)al_realloc(_fonts, _font_size * sizeof(_TEXT_FONT));
+        assert(_fonts);
+    }
+    _fonts[_font_count].font = font;
+    algui_init_list(&_fonts[_font_count].entries);
+    return _font_count++;
+}
+
+
+//changes the number of buckets, placing the existing entries again
+static void _resize_buckets(unsigned long count) {
+    _TEXT_ENTRY **buckets = _buckets, *entry, *next;
+    unsigned long i, old_count = _bucket_count;
+    
+    _buckets = (_TEXT_ENTRY **)al_malloc(count * sizeof(_TEXT_ENTRY *));
+    assert(_buckets);
+    memset(_buckets, 0, count * sizeof(_TEXT_ENTRY *));
+    _bucket_count = count;
+    
+    for(i = 0; i < old_count; ++i) {
+        for(entry = buckets[i]; entry; entry = next) {
+            next = entry->next;
+            entry->next = _buckets[entry->hash & (count - 1)];
+            _buckets[entry->hash & (count - 1)] = entry;
+        }
+    }
+    
+    al_free(buckets);
+}
+
+
+//finds an entry; a found entry becomes the most recently used
+static _TEXT_ENTRY *_find_entry(ALLEGRO_FONT *font, const char *text, ALLEGRO_COLOR color, int flags, unsigned long hash) {
+    _TEXT_ENTRY *entry;
+    
+    if (!_buckets) return NULL;
+    
+    for(entry = _buckets[hash & (_bucket_count - 1)]; entry; entry = entry->next) {
+        if (_is_key(entry, hash, font, text, color, flags)) {
+            algui_remove_list_node(&_entries, &entry->node);
+            algui_prepend_list_node(&_entries, &entry->node);
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+
+//removes an entry and frees it
+static void _remove_entry(_TEXT_ENTRY *entry) {
+    _TEXT_ENTRY **prev;
+    int i;
+    
+    //unlink it from its bucket
+    for(prev = &_buckets[entry->hash & (_bucket_count - 1)]; *prev != entry; prev = &(*prev)->next);
+    *prev = entry->next;
+    
+    //unlink it from its font; a font without entries is dropped
+    i = _find_font(entry->font);
+    assert(i >= 0);
+    algui_remove_list_node(&_fonts[i].entries, &entry->font_node);
+    if (algui_get_list_length(&_fonts[i].entries) == 0) _fonts[i] = _fonts[--_font_count];
+    
+    algui_remove_list_node(&_entries, &entry->node);
+    --_entry_count;
+    _size -= entry->size;
+    
+    if (entry->bitmap) al_destroy_bitmap(entry->bitmap);
+    al_ustr_free(entry->text);
+    al_free(entry);
+}
+
+
+//removes least recently used entries until the memory used fits in the budget
+static void _evict_entries() {
+    ALGUI_LIST_NODE *node;
+    
+    while (_size > _budget && (node = algui_get_last_list_node(&_entries))) {
+        _remove_entry((_TEXT_ENTRY *)algui_get_list_node_data(node));
+        ++_eviction_count;
+    }
+}
+
+
+//creates an entry and adds it as the most recently used; its memory is counted by _fit_entry
+static _TEXT_ENTRY *_add_entry(ALLEGRO_FONT *font, const char *text, ALLEGRO_COLOR color, int flags, unsigned long hash) {
+    _TEXT_ENTRY *entry;
+    unsigned long index;
+    int font_index;
+    
+    if (_entry_count >= _bucket_count) _resize_buckets(_bucket_count ? _bucket_count * 2 : _MIN_BUCKETS);
+    
+    entry = (_TEXT_ENTRY *)al_malloc(sizeof(_TEXT_ENTRY));
+    assert(entry);
+    algui_init_list_node(&entry->node, entry);
+    algui_init_list_node(&entry->font_node, entry);
+    entry->hash = hash;
+    entry->font = font;
+    entry->text = al_ustr_new(text);
+    entry->color = color;
+    entry->flags = flags;
+    entry->width = al_get_text_width(font, text);
+    entry->height = al_get_font_line_height(font);
+    entry->bitmap = NULL;
+    entry->bitmap_x = 0;
+    entry->bitmap_y = 0;
+    entry->size = sizeof(_TEXT_ENTRY) + strlen(text) + 1;
+    
+    index = hash & (_bucket_count - 1);
+    entry->next = _buckets[index];
+    _buckets[index] = entry;
+    algui_prepend_list_node(&_entries, &entry->node);
+    font_index = _add_font(font);
+    algui_append_list_node(&_fonts[font_index].entries, &entry->font_node);
+    ++_entry_count;
+    return entry;
+}
+
+
+//counts the memory of a new entry, removing least recently used entries to fit it in the budget;
+//returns the entry, or null if it is larger than the budget and was removed
+static _TEXT_ENTRY *_fit_entry(_TEXT_ENTRY *entry) {
+    _size += entry->size;
+    if (entry->size > _budget) {
+        _remove_entry(entry);
+        return NULL;
+    }
+    _evict_entries();
+    return entry;
+}
+
+
+//renders the image of an entry; returns zero if the image could not be created
+static int _render_entry(_TEXT_ENTRY *entry) {
+    int bbx, bby, bbw, bbh;
+    ALLEGRO_BITMAP *target;
+    ALLEGRO_TRANSFORM transform, identity;
+    int held;
+    
+    al_get_text_dimensions(entry->font, al_cstr(entry->text), &bbx, &bby, &bbw, &bbh);
+    if (bbw <= 0 || bbh <= 0) return 0;
+    
+    entry->bitmap = al_create_bitmap(bbw, bbh);
+    if (!entry->bitmap) return 0;
+    entry->bitmap_x = bbx;
+    entry->bitmap_y = bby;
+    
+    //held drawing goes to the target it was made on
+    held = al_is_bitmap_drawing_held();
+    if (held) al_hold_bitmap_drawing(0);
+    target = al_get_target_bitmap();
+    al_copy_transform(&transform, al_get_current_transform());
+    
+    //render the text left-aligned, with its bounding box at the origin
+    al_set_target_bitmap(entry->bitmap);
+    al_identity_transform(&identity);
+    al_use_transform(&identity);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    al_draw_text(entry->font, entry->color, -bbx, -bby, entry->flags & ~_ALIGN_MASK, al_cstr(entry->text));
+    
+    al_set_target_bitmap(target);
+    al_use_transform(&transform);
+    if (held) al_hold_bitmap_drawing(1);
+    return 1;
+}
+
+
+//removes the texts of a font resource when it is destroyed
+static void _resource_destroyed(void *res) {
+    algui_remove_text_cache_font((ALLEGRO_FONT *)res);
+}
+
+
+//initializes the text cache; invoked from algui_init
+int _algui_init_text() {
+    return algui_add_resource_destroy_hook(_resource_destroyed);
+}
+
+
+//cleans up the text cache; invoked from algui_cleanup
+void _algui_cleanup_text() {
+    algui_clear_text_cache();
+    algui_remove_resource_destroy_hook(_resource_destroyed);
+    al_free(_buckets);
+    _buckets = NULL;
+    _bucket_count = 0;
+    al_free(_fonts);
+    _fonts = NULL;
+    _font_size = 0;
+}
+ 
+ 
+/******************************************************************************
+    PUBLIC FUNCTIONS
+ ******************************************************************************/
+ 
+ 
+/** returns the width and the line height of a text, from the text cache.
+    The result is measured once and kept in the text cache, keyed by font and text.
+    @param font font of the text.
+    @param text text to measure (UTF-8 string).
+    @param width pointer to variable to receive the width of the text; can be null.
+    @param height pointer to variable to receive the line height of the font; can be null.
+ */
+void algui_get_cached_text_size(ALLEGRO_FONT *font, const char *text, int *width, int *height) {
+    ALLEGRO_COLOR color = {0, 0, 0, 0};
+    unsigned long hash;
+    _TEXT_ENTRY *entry;
+    
+    assert(font);
+    assert(text);
+    
+    hash = _hash(font, text, color, _MEASURE_FLAGS);
+    entry = _find_entry(font, text, color, _MEASURE_FLAGS, hash);
+    
+    if (entry) {
+        ++_hit_count;
+    }
+    else {
+        ++_miss_count;
+        entry = _fit_entry(_add_entry(font, text, color, _MEASURE_FLAGS, hash));
+    }
+    
+    if (width) *width = entry ? entry->width : al_get_text_width(font, text);
+    if (height) *height = entry ? entry->height : al_get_font_line_height(font);
+}
+
+
+/** returns the width of a text, from the text cache.
+    @param font font of the text.
+    @param text text to measure (UTF-8 string).
+    @return the width of the text.
+ */
+int algui_get_cached_text_width(ALLEGRO_FONT *font, const char *text) {
+    int width;
+    algui_get_cached_text_size(font, text, &width, NULL);
+    return width;
+}
+
+
+/** returns the memory budget of the text cache.
+    @return the budget, in bytes.
+ */
+size_t algui_get_text_cache_budget() {
+    return _budget;
+}
+
+
+/** returns the memory used by the text cache.
+    @return the memory used, in bytes.
+ */
+size_t algui_get_text_cache_size() {
+    return _size;
+}
+
+
+/** returns the number of times a text was found in the text cache.
+    @return the number of text cache hits.
+ */
+unsigned long algui_get_text_cache_hit_count() {
+    return _hit_count;
+}
+
+
+/** returns the number of times a text had to be measured or rendered.
+    @return the number of text cache misses.
+ */
+unsigned long algui_get_text_cache_miss_count() {
+    return _miss_count;
+}
+
+
+/** returns the number of texts removed from the text cache to keep within the memory budget.
+    @return the number of text cache evictions.
+ */
+unsigned long algui_get_text_cache_eviction_count() {
+    return _eviction_count;
+}
+
+
+/** checks if the text cache keeps rendered images of drawn texts.
+    @return non-zero if texts are rendered to images, zero otherwise.
+ */
+int algui_is_text_cache_rendering() {
+    return _rendering;
+}
+
+
+/** draws a text through the text cache.
+    It is a replacement for al_draw_text; if the text cache keeps rendered images,
+    the image of the text is drawn, otherwise the text is drawn with al_draw_text.
+    Images are keyed by font, text, color and flags.
+    @param font font of the text.
+    @param color color of the text.
+    @param x horizontal position.
+    @param y vertical position.
+    @param flags alignment flags, as in al_draw_text.
+    @param text text to draw (UTF-8 string).
+ */
+void algui_draw_cached_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, const char *text) {
+    unsigned long hash;
+    _TEXT_ENTRY *entry;
+    
+    assert(font);
+    assert(text);
+    assert(flags >= 0);
+    
+    //without images, there is nothing to cache
+    if (!_rendering) {
+        al_draw_text(font, color, x, y, flags, text);
+        return;
+    }
+    
+    hash = _hash(font, text, color, flags);
+    entry = _find_entry(font, text, color, flags, hash);
+    
+    if (entry) {
+        ++_hit_count;
+    }
+    
+    //render the text; texts without pixels, or with images that do not fit in the budget, are drawn directly
+    else {
+        ++_miss_count;
+        entry = _add_entry(font, text, color, flags, hash);
+        if (_render_entry(entry)) {
+            entry->size += (size_t)al_get_bitmap_width(entry->bitmap) * al_get_bitmap_height(entry->bitmap) * _IMAGE_PIXEL_SIZE;
+        }
+        entry = _fit_entry(entry);
+        if (!entry) {
+            al_draw_text(font, color, x, y, flags, text);
+            return;
+        }
+    }
+    
+    if (!entry->bitmap) return;
+    
+    //apply the alignment
+    if (flags & ALLEGRO_ALIGN_RIGHT) x -= entry->width;
+    else if (flags & ALLEGRO_ALIGN_CENTRE) x -= entry->width / 2.0f;
+    
+    al_draw_bitmap(entry->bitmap, x + entry->bitmap_x, y + entry->bitmap_y, 0);
+}
+
+
+/** sets the memory budget of the text cache.
+    If the text cache uses more memory, the least recently used texts are removed.
+    @param size budget, in bytes.
+ */
+void algui_set_text_cache_budget(size_t size) {
+    _budget = size;
+    _evict_entries();
+}
+
+
+/** sets the text cache to keep rendered images of drawn texts.
+    It is off by default; images are drawn faster than texts, but use video memory.
+    @param rendering non-zero to keep images of texts, zero to draw texts directly.
+ */
+void algui_set_text_cache_rendering(int rendering) {
+    ALGUI_LIST_NODE *node, *next;
+    _TEXT_ENTRY *entry;
+    
+    _rendering = rendering ? 1 : 0;
+    if (_rendering) return;
+    
+    //images are no longer needed
+    for(node = algui_get_first_list_node(&_entries); node; node = next) {
+        next = algui_get_next_list_node(node);
+        entry = (_TEXT_ENTRY *)algui_get_list_node_data(node);
+        if (entry->flags != _MEASURE_FLAGS) _remove_entry(entry);
+    }
+}
+
+
+/** removes the texts of a font from the text cache.
+    It must be invoked before destroying a font that is not a resource of the resource manager;
+    the texts of font resources are removed automatically when the resource is destroyed.
+    @param font font to remove the texts of.
+ */
+void algui_remove_text_cache_font(ALLEGRO_FONT *font) {
+    unsigned long count;
+    int i = _find_font(font);
+    
+    //most destroyed resources are not fonts with texts
+    if (i < 0) return;
+    
+    //the entries of the font are dropped along with the last entry
+    for(count = algui_get_list_length(&_fonts[i].entries); count > 0; --count) {
+        _remove_entry((_TEXT_ENTRY *)algui_get_list_node_data(algui_get_first_list_node(&_fonts[i].entries)));
+    }
+}
+
+
+/** removes all texts from the text cache.
+ */
+void algui_clear_text_cache() {
+    ALGUI_LIST_NODE *node;
+    
+    while ((node = algui_get_first_list_node(&_entries))) {
+        _remove_entry((_TEXT_ENTRY *)algui_get_list_node_data(node));
+    }
+}
@@ -0,0 +1,196 @@
+#include "algui_timer_wheel.h"
+#include <assert.h>
+
+
+/******************************************************************************
+    PRIVATE    
+ ******************************************************************************/
+
+
+//slot index mask
+#define _SLOT_MASK           (ALGUI_TIMER_WHEEL_SLOTS - 1)
+
+
+//number of ticks covered by the whole wheel
+#define _WHEEL_RANGE         ((int64_t)1 << (ALGUI_TIMER_WHEEL_LEVELS * ALGUI_TIMER_WHEEL_SLOT_BITS))
+
+
+//places an entry in the slot of its expiration tick; 
+//entries that have expired are placed in the slot of the current tick
+static void _place(ALGUI_TIMER_WHEEL *wheel, ALGUI_TIMER_WHEEL_ENTRY *entry) {
+    int64_t expires = entry->expires, delta = expires - wheel->now;
+    int level;
+    
+    //entries beyond the range of the wheel wait in the last level; they are placed again when it turns
+    if (delta >= _WHEEL_RANGE) {
+        expires = wheel->now + _WHEEL_RANGE - 1;
+        delta = _WHEEL_RANGE - 1;
+    }
+    
+    if (delta < 0) expires = wheel->now;
+    
+    //find the lowest level that reaches the expiration tick
+    for(level = 0; level < ALGUI_TIMER_WHEEL_LEVELS - 1 && delta >= ((int64_t)1 << ((level + 1) * ALGUI_TIMER_WHEEL_SLOT_BITS)); ++level);
+    
+    entry->slot = &wheel->slots[level][(expires >> (level * ALGUI_TIMER_WHEEL_SLOT_BITS)) & _SLOT_MASK];
+    algui_append_list_node(entry->slot, &entry->node);
+}
+
+
+//moves the entries of a slot of a higher level to the lower levels
+static void _cascade(ALGUI_TIMER_WHEEL *wheel, int level) {
+    ALGUI_LIST *slot = &wheel->slots[level][(wheel->now >> (level * ALGUI_TIMER_WHEEL_SLOT_BITS)) & _SLOT_MASK];
+    ALGUI_LIST_NODE *node;
+    
+    while ((node = algui_get_first_list_node(slot))) {
+        algui_remove_list_node(slot, node);
+        _place(wheel, (ALGUI_TIMER_WHEEL_ENTRY *)node);
+    }
+}
+
+
+/******************************************************************************
+    PUBLIC
+ ******************************************************************************/
+
+
+/** returns the current tick of a timer wheel.
+    @param wheel timer wheel to get the current tick of.
+    @return the current tick.
+ */
+int64_t algui_get_timer_wheel_time(ALGUI_TIMER_WHEEL *wheel) {
+    assert(wheel);
+    return wheel->now;
+}
+
+
+/** returns the number of entries scheduled in a timer wheel.
+    @param wheel timer wheel to get the number of entries of.
+    @return the number of scheduled entries.
+ */
+unsigned long algui_get_timer_wheel_count(ALGUI_TIMER_WHEEL *wheel) {
+    assert(wheel);
+    return wheel->count;
+}
+
+
+/** checks if an entry is scheduled.
+    @param entry entry to check.
+    @return non-zero if the entry is scheduled, zero otherwise.
+ */
+int algui_is_timer_wheel_entry_scheduled(ALGUI_TIMER_WHEEL_ENTRY *entry) {
+    assert(entry);
+    return entry->slot != NULL;
+}
+
+
+/** initializes a timer wheel.
+    @param wheel timer wheel to initialize.
+    @param now initial tick.
+ */
+void algui_init_timer_wheel(ALGUI_TIMER_WHEEL *wheel, int64_t now) {
+    int level, slot;
+    assert(wheel);
+    for(level = 0; level < ALGUI_TIMER_WHEEL_LEVELS; ++level) {
+        for(slot = 0; slot < ALGUI_TIMER_WHEEL_SLOTS; ++slot) {
+            algui_init_list(&wheel->slots[level][slot]);
+        }
+    }
+    wheel->now = now;
+    wheel->count = 0;
+}
+
+
+/** initializes a timer wheel entry.
+    @param entry entry to initialize.
+    @param data entry data.
+ */
+void algui_init_timer_wheel_entry(ALGUI_TIMER_WHEEL_ENTRY *entry, void *data) {
+    assert(entry);
+    algui_init_list_node(&entry->node, data);
+    entry->slot = NULL;
+    entry->expires = 0;
+}
+
+
+/** schedules an entry.
+    If the entry is already scheduled, it is rescheduled.
+    The expiration tick may be delayed by up to the given tolerance,
+    so as that entries with near expiration ticks expire together.
+    @param wheel timer wheel to schedule the entry in.
+    @param entry entry to schedule.
+    @param expires expiration tick; if it is not after the current tick, the entry expires at the next tick.
+    @param tolerance number of ticks the expiration may be delayed.
+ */
+void algui_schedule_timer_wheel_entry(ALGUI_TIMER_WHEEL *wheel, ALGUI_TIMER_WHEEL_ENTRY *entry, int64_t expires, int64_t tolerance) {
+    int64_t granularity;
+    
+    assert(wheel);
+    assert(entry);
+    assert(tolerance >= 0);
+    
+    algui_cancel_timer_wheel_entry(wheel, entry);
+    
+    if (expires <= wheel->now) expires = wheel->now + 1;
+    
+    //round the expiration up to the largest power of 2 that fits in the tolerance;
+    //entries with near expiration ticks end up in the same slot
+    for(granularity = 1; granularity * 2 <= tolerance + 1; granularity *= 2);
+    expires = (expires + granularity - 1) / granularity * granularity;
+    
+    entry->expires = expires;
+    _place(wheel, entry);
+    ++wheel->count;
+}
+
+
+/** cancels a scheduled entry.
+    Nothing happens if the entry is not scheduled.
+    @param wheel timer wheel the entry is scheduled in.
+    @param entry entry to cancel.
+ */
+void algui_cancel_timer_wheel_entry(ALGUI_TIMER_WHEEL *wheel, ALGUI_TIMER_WHEEL_ENTRY *entry) {
+    assert(wheel);
+    assert(entry);
+    if (!entry->slot) return;
+    algui_remove_list_node(entry->slot, &entry->node);
+    entry->slot = NULL;
+    --wheel->count;
+}
+
+
+/** advances a timer wheel up to the given tick.
+    Each entry that expires is unscheduled and then passed to the given callback;
+    the callback may schedule and cancel entries.
+    @param wheel timer wheel to advance.
+    @param now tick to advance to.
+    @param expired callback for expired entries.
+    @param context pointer passed to the callback.
+ */
+void algui_advance_timer_wheel(ALGUI_TIMER_WHEEL *wheel, int64_t now, void (*expired)(ALGUI_TIMER_WHEEL_ENTRY *entry, void *context), void *context) {
+    ALGUI_TIMER_WHEEL_ENTRY *entry;
+    ALGUI_LIST *slot;
+    int level;
+    
+    assert(wheel);
+    assert(expired);
+    
+    while (wheel->now < now) {
+        ++wheel->now;
+        
+        //when a level completes a turn, the next slot of the level above it is spread to the lower levels
+        for(level = 1; level < ALGUI_TIMER_WHEEL_LEVELS && !(wheel->now & (((int64_t)1 << (level * ALGUI_TIMER_WHEEL_SLOT_BITS)) - 1)); ++level);
+        for(--level; level > 0; --level) {
+            _cascade(wheel, level);
+        }
+        
+        //expire the entries of the current slot; entries scheduled by the callback go to other slots
+        slot = &wheel->slots[0][wheel->now & _SLOT_MASK];
+        while ((entry = (ALGUI_TIMER_WHEEL_ENTRY *)algui_get_first_list_node(slot))) {
+            algui_remove_list_node(slot, &entry->node);
+            entry->slot = NULL;
+            --wheel->count;
+            expired(entry, context);
+        }
+    }
+}
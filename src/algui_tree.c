@@ -199,6 +199,53 @@ void algui_clear_tree(ALGUI_TREE *tree) {
 }
 
 
+/** moves a range of consecutive children of a node to another node, or to another position in the same node.
+    The nodes are relinked in constant time; the parent of each moved node is then set.
+    @param parent destination parent tree node.
+    @param next next sibling tree node in the destination; it may be null; it must not be in the range.
+    @param first first child of the range.
+    @param last last child of the range; it must be the first child or a sibling after it.
+    @return the number of nodes moved, or zero if the operation failed.
+ */
+unsigned long algui_splice_tree(ALGUI_TREE *parent, ALGUI_TREE *next, ALGUI_TREE *first, ALGUI_TREE *last) {
+    ALGUI_TREE *src, *node, *ancestor;
+    unsigned long count = 1;
+    
+    assert(parent);
+    assert(first);
+    assert(last);
+    
+    src = first->parent;
+    if (!src || last->parent != src) return 0;
+    if (next && next->parent != parent) return 0;
+    
+    //count the nodes of the range; the next node must not be in it
+    for(node = first; node != last; node = algui_get_next_sibling_tree(node)) {
+        if (!node || node == next) return 0;
+        ++count;
+    }
+    if (last == next) return 0;
+    
+    //the destination must not be in the range or below it
+    for(ancestor = parent; ancestor && ancestor->parent != src; ancestor = ancestor->parent);
+    if (ancestor) {
+        for(node = first; ; node = algui_get_next_sibling_tree(node)) {
+            if (node == ancestor) return 0;
+            if (node == last) break;
+        }
+    }
+    
+    //move the nodes
+    algui_splice_list(&parent->children, next ? &next->node : NULL, &src->children, &first->node, &last->node, count);
+    for(node = first; ; node = algui_get_next_sibling_tree(node)) {
+        node->parent = parent;
+        if (node == last) break;
+    }
+    
+    return count;
+}
+
+
 /** sets the data of a tree node.
     @param tree tree node to set the data of.
     @param data data of the tree node.
@@ -1,5 +1,11 @@
 #include "algui_widget.h"
+#include "algui_map.h"
+#include "algui_timer_wheel.h"
 #include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_primitives.h>
 
@@ -15,33 +21,1067 @@
 #define _MIDDLE_BUTTON       3 
 
 
+//maximum number of nested captures in a widget tree
+#define _MAX_CAPTURES        127
+
+
+//maximum number of separate damaged rects in a widget tree; more rects are merged with their neighbours
+#define _MAX_DAMAGE_RECTS    16
+
+
+//distance between the z-keys of consecutive siblings
+#define _Z_KEY_SPACING       1024
+
+
+//average number of children per spatial index cell
+#define _GRID_ITEMS_PER_CELL 4
+
+
+//default memory budget of render caches, in bytes
+#define _DEFAULT_RENDER_CACHE_BUDGET (32 * 1024 * 1024)
+
+
+//bytes per pixel of render cache images, for accounting
+#define _RENDER_CACHE_PIXEL_SIZE     4
+
+
+//posted messages are placed in the ring buffer in multiples of this size; it holds the header of a posted message
+#define _POSTED_MESSAGE_ALIGNMENT    32
+
+
+//initial size of the ring buffer of posted messages
+#define _POSTED_MESSAGE_BUFFER_SIZE  4096
+
+
+//posted messages up to this size are copied on the stack before they are sent
+#define _POSTED_MESSAGE_COPY_SIZE    256
+
+
+//maximum number of events taken from an event queue at once, after merging
+#define _EVENT_BATCH_SIZE    64
+
+
+//seconds after which a deferred timer event is dispatched, even if the time budget of the scheduler is spent
+#define _MAX_TIMER_EVENT_WAIT 0.1
+
+
+//occlusion states of a widget, found before drawing
+#define _CULL_NONE           0
+#define _CULL_SELF           1
+#define _CULL_TREE           2
+
+
+#ifndef MIN
+#define MIN(A, B)  ((A) < (B) ? (A) : (B))
+#endif
+
+
+#ifndef MAX
+#define MAX(A, B)  ((A) > (B) ? (A) : (B))
+#endif
+
+
+//messages the default widget procedure handles; they are in the message mask of every widget,
+//so as that broadcasts deliver them to every widget proc
+#define _DEFAULT_MESSAGE_MASK (ALGUI_MESSAGE_BIT(ALGUI_MSG_CLEANUP) | ALGUI_MESSAGE_BIT(ALGUI_MSG_SET_SKIN))
+
+
+/******************************************************************************
+    INTERNAL TYPES
+ ******************************************************************************/
+
+
+//offscreen image of a widget tree
+typedef struct ALGUI_WIDGET_CACHE {
+    //node in the list of render caches with images
+    ALGUI_LIST_NODE node;
+    
+    //the image; null if it was never rendered or it was evicted
+    ALLEGRO_BITMAP *bitmap;
+    
+    //accounted size of the image, in bytes
+    size_t size;
+    
+    //the image shows the current state of the tree
+    int valid;
+    
+    //the image is the target bitmap
+    int rendering;
+} ALGUI_WIDGET_CACHE;
+
+
+//drawing target to restore after rendering a render cache
+typedef struct ALGUI_DRAW_TARGET {
+    ALLEGRO_BITMAP *bitmap;
+    ALLEGRO_TRANSFORM transform;
+    int origin_x;
+    int origin_y;
+} ALGUI_DRAW_TARGET;
+
+
+//widgets processed by a layout flush, bucketed by their depth in the tree;
+//the widgets of each depth are linked in the order they were added, from 'first' to 'last' through 'next'
+typedef struct ALGUI_LAYOUT_WORK {
+    ALGUI_WIDGET **widgets;
+    int *next;
+    int count;
+    int size;
+    int *first;
+    int *last;
+    int depth_count;
+} ALGUI_LAYOUT_WORK;
+
+
+//state of a widget tree; only root widgets have one
+typedef struct ALGUI_WIDGET_ROOT {
+    //the widget that has the input focus
+    ALGUI_WIDGET *focus;
+
+    //stack of widgets that have captured events; the last one has the current capture
+    ALGUI_WIDGET *captures[_MAX_CAPTURES];
+    int capture_count;
+
+    //the widget that has the mouse
+    ALGUI_WIDGET *mouse;
+
+    //the data source of the drag-and-drop session in progress, if there is one
+    ALGUI_WIDGET *drag_source;
+
+    //result of the last hit test: the path from the root to the widget found,
+    //the widget the test started from and the screen area in which the result stays the same
+    ALGUI_WIDGET **hover_path;
+    int hover_path_length;
+    int hover_path_size;
+    ALGUI_WIDGET *hover_from;
+    ALGUI_RECT hover_rect;
+    unsigned long hover_generation;
+    int hover_valid;
+
+    //number of hit tests requested and number of them answered from the hover path
+    unsigned long hit_test_count;
+    unsigned long skipped_hit_test_count;
+
+    //number of events dispatched from event queues, and number of events merged with others before that
+    unsigned long dispatched_event_count;
+    unsigned long coalesced_mouse_event_count;
+    unsigned long coalesced_key_event_count;
+
+    //timer events deferred by the scheduler, from the first to the count, oldest first
+    ALLEGRO_EVENT *deferred_timer_events;
+    int deferred_timer_event_first;
+    int deferred_timer_event_count;
+    int deferred_timer_event_size;
+    
+    //number of events dispatched from event queues per class and time waited in the queue
+    unsigned long queue_wait_histogram[ALGUI_EVENT_CLASS_COUNT][ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE];
+
+    //damaged screen area that must be drawn again
+    ALGUI_REGION damage;
+    
+    //widgets and pixels not painted during the last draw because they were covered
+    unsigned long culled_widget_count;
+    unsigned long culled_pixel_count;
+    
+    //drawing submitted and clipping changes made or avoided during the last draw
+    unsigned long draw_batch_count;
+    unsigned long clip_change_count;
+    unsigned long skipped_clip_change_count;
+    
+    //the widgets of the tree in pre-order, and the index past the subtree of each widget;
+    //the array is up to date if it was built at the current structure generation
+    ALGUI_WIDGET **order;
+    int *order_ends;
+    int order_length;
+    int order_size;
+    unsigned long order_generation;
+    
+    //bounding rect of the damage collected during an update, if there is any
+    ALGUI_RECT update_damage;
+    int update_damaged;
+    
+    //buckets of layout flushes, kept between flushes so as that they are allocated once
+    ALGUI_LAYOUT_WORK layout_work;
+} ALGUI_WIDGET_ROOT;
+
+
+//a growable array of widgets
+typedef struct ALGUI_WIDGET_ARRAY {
+    ALGUI_WIDGET **widgets;
+    int length;
+    int size;
+} ALGUI_WIDGET_ARRAY;
+
+
+//traversal of the widgets of a subtree in pre-order, without recursion;
+//it walks the pre-order array of the tree while the structure of the trees does not change, 
+//or else it follows the links of the tree; the widgets entered, i.e. whose children are visited, 
+//are kept in a stack, along with a rect for each
+typedef struct ALGUI_TRAVERSAL {
+    ALGUI_WIDGET *top;
+    ALGUI_WIDGET *wgt;
+    int reverse;
+    
+    //the state with the pre-order array, the structure generation it was built at, 
+    //the index of the current widget and the end of the subtree
+    ALGUI_WIDGET_ROOT *state;
+    unsigned long generation;
+    int index;
+    int end;
+    
+    //the entered widgets
+    ALGUI_WIDGET **path;
+    ALGUI_RECT *rects;
+    int depth;
+    int size;
+} ALGUI_TRAVERSAL;
+
+
+//header of a message in the ring buffer of posted messages; the message follows it;
+//the position of each message in the buffer is counted from the first message ever posted, so as that it does not change
+//when the buffer grows; padding and messages already sent or dropped have no widget
+typedef struct ALGUI_POSTED_MESSAGE {
+    ALGUI_WIDGET *widget;
+    uint32_t size;
+    uint32_t message_size;
+    
+    //position of the next message posted to the same widget
+    uint64_t next;
+} ALGUI_POSTED_MESSAGE;
+
+
+//a widget being searched by a hit test, the point relative to it, and the children left to search
+typedef struct ALGUI_HIT_TEST_FRAME {
+    ALGUI_WIDGET *wgt;
+    int x;
+    int y;
+    void **items;
+    int count;
+    ALGUI_WIDGET *child;
+} ALGUI_HIT_TEST_FRAME;
+
+
+//a timer of a widget; its node is placed in the timer list of the widget, with the allegro timer as data
+typedef struct ALGUI_WIDGET_TIMER {
+    ALGUI_LIST_NODE node;
+    ALGUI_WIDGET *widget;
+} ALGUI_WIDGET_TIMER;
+
+
+//a timer of a widget driven by the timer wheel
+struct ALGUI_TIMER {
+    //entry in the timer wheel; while the timer is paused, its node is in the paused timers list
+    ALGUI_TIMER_WHEEL_ENTRY entry;
+    
+    //node in the wheel timer list of the widget
+    ALGUI_LIST_NODE node;
+    
+    ALGUI_WIDGET *widget;
+    
+    //period and tolerance, in ticks
+    int64_t period;
+    int64_t tolerance;
+    
+    //the tick the timer is due at, before the tolerance is applied
+    int64_t deadline;
+    
+    int one_shot;
+    int paused;
+};
+
+
+/******************************************************************************
+    INTERNAL VARIABLES
+ ******************************************************************************/
+
+
+//changes each time the geometry or the visibility of widgets changes; it invalidates hover paths
+static unsigned long _tree_generation = 0;
+
+
+//changes each time widgets are inserted, removed, moved to other parents or destroyed, or a tree state is destroyed;
+//pre-order arrays built at another generation are out of date
+static unsigned long _structure_generation = 1;
+
+
+//number of children above which widgets index their children automatically
+static int _spatial_index_threshold = 256;
+
+
+//widget timers by allegro timer
+static ALGUI_MAP _timers = ALGUI_MAP_INITIALIZER;
+
+
+//the timer wheel, the allegro timer that drives it and its resolution;
+//the wheel is valid when zero-initialized
+static ALGUI_TIMER_WHEEL _wheel;
+static ALLEGRO_TIMER *_wheel_tick_timer = NULL;
+static double _wheel_resolution = 0;
+
+
+//the wheel tick when the tick timer was started; the count of the tick timer is added to it
+static int64_t _wheel_tick_base = 0;
+
+
+//wheel timers of hidden widgets
+static ALGUI_LIST _paused_timers = ALGUI_LIST_INITIALIZER;
+
+
+//records of destroyed widget timers and wheel timers, reused by the timers created next;
+//the number of records allocated from the heap
+static ALGUI_LIST _free_timers = ALGUI_LIST_INITIALIZER;
+static ALGUI_LIST _free_wheel_timers = ALGUI_LIST_INITIALIZER;
+static unsigned long _timer_allocation_count = 0;
+
+
+//ring buffer of posted messages; its size is a power of two; 
+//the positions of the oldest message and of the end of the newest one
+static char *_posted_messages = NULL;
+static uint64_t _posted_messages_size = 0;
+static uint64_t _posted_head = 0;
+static uint64_t _posted_tail = 0;
+
+
+//number of messages waiting in the ring buffer, and number of messages merged with waiting ones
+static unsigned long _posted_message_count = 0;
+static unsigned long _coalesced_message_count = 0;
+
+
+//render caches with images, from the most recently to the least recently used
+static ALGUI_LIST _render_caches = ALGUI_LIST_INITIALIZER;
+
+
+//memory budget of render caches and memory used by their images, in bytes
+static size_t _render_cache_budget = _DEFAULT_RENDER_CACHE_BUDGET;
+static size_t _render_cache_size = 0;
+
+
+//render cache statistics
+static unsigned long _render_cache_hit_count = 0;
+static unsigned long _render_cache_miss_count = 0;
+static unsigned long _render_cache_eviction_count = 0;
+
+
+//if set, bitmap drawing is held while drawing widgets
+static int _batched_drawing = 0;
+
+
+//something was drawn since bitmap drawing was last held
+static int _batch_pending = 0;
+
+
+//screen position of the origin of the target bitmap; it is not zero while rendering a render cache
+static int _draw_origin_x = 0;
+static int _draw_origin_y = 0;
+
+
+//widgets marked as needing layout, of all trees; they are processed by algui_flush_layout
+static ALGUI_WIDGET_ARRAY _layout_queue = {NULL, 0, 0};
+
+
+//changes on each layout flush; the layout depths of widgets calculated at another generation are out of date
+static unsigned long _layout_generation = 0;
+
+
+//changes on each flush of postponed flags; the marks of widgets calculated at another generation are out of date
+static unsigned long _flags_generation = 0;
+
+
+//nesting level of algui_begin_update calls
+static int _update_depth = 0;
+
+
+//work postponed until the end of the update in progress: widgets whose descendants need their flags updated,
+//widgets whose spatial index needs to be updated, roots of trees with collected damage, and the resuming of wheel timers
+static ALGUI_WIDGET_ARRAY _flags_queue = {NULL, 0, 0};
+static ALGUI_WIDGET_ARRAY _index_queue = {NULL, 0, 0};
+static ALGUI_WIDGET_ARRAY _damage_queue = {NULL, 0, 0};
+static int _timers_pending = 0;
+
+
 /******************************************************************************
     INTERNAL FUNCTIONS
  ******************************************************************************/
  
  
-//calculates the screen rectangle of a widget
-static void _calc_screen_rect(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *parent, *child;
+//appends a widget to an array of widgets
+static void _add_widget_to_array(ALGUI_WIDGET_ARRAY *array, ALGUI_WIDGET *wgt) {
+    if (array->length == array->size) {
+        array->size = array->size ? array->size * 2 : 64;
+        array->widgets = (ALGUI_WIDGET **)al_realloc(array->widgets, array->size * sizeof(ALGUI_WIDGET *));
+        assert(array->widgets);
+    }
+    array->widgets[array->length++] = wgt;
+}
+
+
+//removes a widget from an array of widgets; the most recently added widgets are searched first
+static void _remove_widget_from_array(ALGUI_WIDGET_ARRAY *array, ALGUI_WIDGET *wgt) {
+    int i;
+    for(i = array->length - 1; i >= 0; --i) {
+        if (array->widgets[i] == wgt) {
+            memmove(array->widgets + i, array->widgets + i + 1, (array->length - i - 1) * sizeof(ALGUI_WIDGET *));
+            --array->length;
+            return;
+        }
+    }
+}
+
+
+//frees the buckets of layout flushes
+static void _free_layout_work(ALGUI_LAYOUT_WORK *work) {
+    al_free(work->widgets);
+    al_free(work->next);
+    al_free(work->first);
+    al_free(work->last);
+    memset(work, 0, sizeof(ALGUI_LAYOUT_WORK));
+}
+
+
+//returns the state of the tree the widget belongs to, or null if the tree has none yet
+static ALGUI_WIDGET_ROOT *_find_root_state(ALGUI_WIDGET *wgt) {
+    return algui_get_root_widget(wgt)->root_state;
+}
+
+
+//resets the statistics of the last draw of a tree
+static void _reset_draw_statistics(ALGUI_WIDGET_ROOT *state) {
+    state->culled_widget_count = 0;
+    state->culled_pixel_count = 0;
+    state->draw_batch_count = 0;
+    state->clip_change_count = 0;
+    state->skipped_clip_change_count = 0;
+}
+
+
+//returns the state of the tree the widget belongs to; it is created if it does not exist
+static ALGUI_WIDGET_ROOT *_get_root_state(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+
+    wgt = algui_get_root_widget(wgt);
+    if (wgt->root_state) return wgt->root_state;
+
+    state = (ALGUI_WIDGET_ROOT *)al_malloc(sizeof(ALGUI_WIDGET_ROOT));
+    assert(state);
+    state->focus = NULL;
+    state->capture_count = 0;
+    state->mouse = NULL;
+    state->drag_source = NULL;
+    state->hover_path = NULL;
+    state->hover_path_length = 0;
+    state->hover_path_size = 0;
+    state->hover_from = NULL;
+    state->hover_valid = 0;
+    state->hit_test_count = 0;
+    state->skipped_hit_test_count = 0;
+    state->dispatched_event_count = 0;
+    state->coalesced_mouse_event_count = 0;
+    state->coalesced_key_event_count = 0;
+    state->deferred_timer_events = NULL;
+    state->deferred_timer_event_first = 0;
+    state->deferred_timer_event_count = 0;
+    state->deferred_timer_event_size = 0;
+    memset(state->queue_wait_histogram, 0, sizeof(state->queue_wait_histogram));
+    algui_init_region(&state->damage);
+    _reset_draw_statistics(state);
+    state->order = NULL;
+    state->order_ends = NULL;
+    state->order_length = 0;
+    state->order_size = 0;
+    state->order_generation = 0;
+    state->update_damaged = 0;
+    memset(&state->layout_work, 0, sizeof(state->layout_work));
+
+    wgt->root_state = state;
+    return state;
+}
+
+
+//destroys the tree state of a root widget
+static void _destroy_root_state(ALGUI_WIDGET *wgt) {
+    if (wgt->root_state->update_damaged) _remove_widget_from_array(&_damage_queue, wgt);
+    ++_structure_generation;
+    _free_layout_work(&wgt->root_state->layout_work);
+    al_free(wgt->root_state->order);
+    al_free(wgt->root_state->order_ends);
+    al_free(wgt->root_state->hover_path);
+    al_free(wgt->root_state->deferred_timer_events);
+    algui_cleanup_region(&wgt->root_state->damage);
+    al_free(wgt->root_state);
+    wgt->root_state = NULL;
+}
+
+
+//returns the widget that follows a widget in the pre-order of the subtree of the given top widget, or null;
+//the descendants of the widget are skipped unless requested; in reverse, children are visited from highest to lowest
+static ALGUI_WIDGET *_get_next_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET *top, int descend, int reverse) {
+    ALGUI_WIDGET *next;
+    
+    if (descend) {
+        next = reverse ? algui_get_highest_child_widget(wgt) : algui_get_lowest_child_widget(wgt);
+        if (next) return next;
+    }
+    
+    for(; wgt && wgt != top; wgt = algui_get_parent_widget(wgt)) {
+        next = reverse ? algui_get_lower_sibling_widget(wgt) : algui_get_higher_sibling_widget(wgt);
+        if (next) return next;
+    }
+    
+    return NULL;
+}
+
+
+//rebuilds the pre-order array of a tree, if the structure of the trees changed since it was built
+static void _update_order(ALGUI_WIDGET_ROOT *state, ALGUI_WIDGET *root) {
+    ALGUI_WIDGET *wgt, *next;
+    
+    if (state->order_generation == _structure_generation) return;
+    
+    state->order_length = 0;
+    for(wgt = root; wgt; wgt = next) {
+        if (state->order_length == state->order_size) {
+            state->order_size = state->order_size ? state->order_size * 2 : 64;
+            state->order = (ALGUI_WIDGET **)al_realloc(state->order, state->order_size * sizeof(ALGUI_WIDGET *));
+            state->order_ends = (int *)al_realloc(state->order_ends, state->order_size * sizeof(int));
+            assert(state->order && state->order_ends);
+        }
+        wgt->order_index = state->order_length;
+        state->order[state->order_length++] = wgt;
+        
+        next = algui_get_lowest_child_widget(wgt);
+        if (next) continue;
+        
+        //the widget is a leaf; its subtree ends here, along with the subtrees of the ancestors it is the last widget of
+        for(;;) {
+            state->order_ends[wgt->order_index] = state->order_length;
+            if (wgt == root) {
+                next = NULL;
+                break;
+            }
+            next = algui_get_higher_sibling_widget(wgt);
+            if (next) break;
+            wgt = algui_get_parent_widget(wgt);
+        }
+    }
+    
+    state->order_generation = _structure_generation;
+}
+
+
+//starts a traversal of the subtree of a widget; returns the widget;
+//the pre-order array is only used forwards, and it is rebuilt only for traversals of whole trees,
+//since rebuilding it costs as much as traversing the tree
+static ALGUI_WIDGET *_begin_traversal(ALGUI_TRAVERSAL *trv, ALGUI_WIDGET *top, int reverse) {
+    ALGUI_WIDGET *root = algui_get_root_widget(top);
+    
+    trv->top = top;
+    trv->wgt = top;
+    trv->reverse = reverse;
+    trv->path = NULL;
+    trv->rects = NULL;
+    trv->depth = 0;
+    trv->size = 0;
+    
+    trv->state = reverse ? NULL : root->root_state;
+    if (!trv->state) return top;
+    if (top == root) _update_order(trv->state, root);
+    if (trv->state->order_generation != _structure_generation) {
+        trv->state = NULL;
+        return top;
+    }
+    trv->generation = _structure_generation;
+    trv->index = top->order_index;
+    trv->end = trv->state->order_ends[trv->index];
+    return top;
+}
+
+
+//advances a traversal to the next widget, visiting the children of the current widget if requested;
+//returns null at the end of the traversal
+static ALGUI_WIDGET *_next_traversal(ALGUI_TRAVERSAL *trv, int descend) {
+    if (trv->state && trv->generation == _structure_generation) {
+        trv->index = descend ? trv->index + 1 : trv->state->order_ends[trv->index];
+        trv->wgt = trv->index < trv->end ? trv->state->order[trv->index] : NULL;
+    }
+    else {
+        trv->state = NULL;
+        trv->wgt = _get_next_widget(trv->wgt, trv->top, descend, trv->reverse);
+    }
+    return trv->wgt;
+}
+
+
+//pushes the current widget of a traversal on the stack of entered widgets, along with a rect
+static void _enter_traversal(ALGUI_TRAVERSAL *trv, ALGUI_RECT *rect) {
+    if (trv->depth == trv->size) {
+        trv->size = trv->size ? trv->size * 2 : 64;
+        trv->path = (ALGUI_WIDGET **)al_realloc(trv->path, trv->size * sizeof(ALGUI_WIDGET *));
+        trv->rects = (ALGUI_RECT *)al_realloc(trv->rects, trv->size * sizeof(ALGUI_RECT));
+        assert(trv->path && trv->rects);
+    }
+    trv->path[trv->depth] = trv->wgt;
+    if (rect) trv->rects[trv->depth] = *rect;
+    ++trv->depth;
+}
+
+
+//pops the innermost entered widget, unless the given widget, which is visited next, is one of its descendants;
+//returns the popped widget, or null; the rect of the popped widget is returned in the given pointer, if there is one
+static ALGUI_WIDGET *_leave_traversal(ALGUI_TRAVERSAL *trv, ALGUI_WIDGET *next, ALGUI_RECT **rect) {
+    if (!trv->depth) return NULL;
+    if (next) {
+        //on the array, the subtree of the widget is the range up to its end index
+        if (trv->state) {
+            if (trv->index < trv->state->order_ends[trv->path[trv->depth - 1]->order_index]) return NULL;
+        }
+        else if (algui_get_parent_widget(next) == trv->path[trv->depth - 1]) {
+            return NULL;
+        }
+    }
+    --trv->depth;
+    if (rect) *rect = &trv->rects[trv->depth];
+    return trv->path[trv->depth];
+}
+
+
+//returns the rect of the innermost entered widget of a traversal, or the given rect if there is none
+static ALGUI_RECT *_get_traversal_rect(ALGUI_TRAVERSAL *trv, ALGUI_RECT *rect) {
+    return trv->depth ? &trv->rects[trv->depth - 1] : rect;
+}
+
+
+//frees the stack of a traversal
+static void _end_traversal(ALGUI_TRAVERSAL *trv) {
+    al_free(trv->path);
+    al_free(trv->rects);
+}
+
+
+//checks if a widget is the given widget or one of its descendants
+static int _is_in_tree(ALGUI_WIDGET *tree, ALGUI_WIDGET *wgt) {
+    return wgt == tree || algui_is_ancestor_tree(&tree->tree, &wgt->tree);
+}
+
+
+//pushes a widget on the capture stack of a tree
+static int _push_capture(ALGUI_WIDGET_ROOT *state, ALGUI_WIDGET *wgt) {
+    if (state->capture_count == _MAX_CAPTURES) return 0;
+    state->captures[state->capture_count++] = wgt;
+    wgt->capture = state->capture_count;
+    return 1;
+}
+
+
+//removes the capture stack entry at the given index
+static void _remove_capture(ALGUI_WIDGET_ROOT *state, int index) {
+    state->captures[index]->capture = 0;
+    --state->capture_count;
+    memmove(state->captures + index, state->captures + index + 1, (state->capture_count - index) * sizeof(ALGUI_WIDGET *));
+}
+
+
+//merges the state of a tree that was inserted into another tree into the state of the other tree;
+//a widget of the inserted tree that loses the focus or the mouse to the other tree is notified,
+//with a lost-focus message and a mouse-leave message without an event
+static void _merge_root_state(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state = wgt->root_state, *root_state;
+    ALGUI_WIDGET *lost_focus = NULL, *lost_mouse = NULL;
+    ALGUI_LOST_FOCUS_MESSAGE lost_focus_msg;
+    ALGUI_MOUSE_LEAVE_MESSAGE leave_msg;
+    int i;
+
+    if (!state) return;
+
+    root_state = _get_root_state(wgt);
+
+    //keep the focus of the inserted tree only if the other tree has no focus
+    if (state->focus && state->focus->focus) {
+        if (!root_state->focus) {
+            root_state->focus = state->focus;
+        }
+        else {
+            lost_focus = state->focus;
+            lost_focus->focus = 0;
+        }
+    }
+
+    //the same for the mouse
+    if (state->mouse && state->mouse->mouse) {
+        if (!root_state->mouse) {
+            root_state->mouse = state->mouse;
+        }
+        else {
+            lost_mouse = state->mouse;
+            lost_mouse->mouse = 0;
+        }
+    }
+
+    //only one drag-and-drop session per tree
+    if (state->drag_source && state->drag_source->data_source) {
+        if (!root_state->drag_source) root_state->drag_source = state->drag_source; else state->drag_source->data_source = 0;
+    }
+
+    //the captures of the inserted tree are placed above the captures of the other tree
+    for(i = 0; i < state->capture_count; ++i) {
+        if (!_push_capture(root_state, state->captures[i])) state->captures[i]->capture = 0;
+    }
+
+    _destroy_root_state(wgt);
+
+    //the widget cannot keep the focus, so it is not asked with a lose-focus message
+    if (lost_focus) {
+        lost_focus_msg.message.id = ALGUI_MSG_LOST_FOCUS;
+        algui_send_message(lost_focus, &lost_focus_msg.message);
+    }
+    if (lost_mouse && lost_mouse->enabled_tree) {
+        memset(&leave_msg, 0, sizeof(leave_msg));
+        leave_msg.message.id = ALGUI_MSG_MOUSE_LEAVE;
+        algui_send_message(lost_mouse, &leave_msg.message);
+    }
+}
+
+
+//removes the references of a tree state to the widgets of a subtree that was removed from it
+static void _split_root_state(ALGUI_WIDGET *parent, ALGUI_WIDGET *child) {
+    ALGUI_WIDGET_ROOT *state = _find_root_state(parent);
+    int i;
+
+    if (!state) return;
+
+    if (state->focus && _is_in_tree(child, state->focus)) {
+        state->focus->focus = 0;
+        state->focus = NULL;
+    }
+    if (state->mouse && _is_in_tree(child, state->mouse)) {
+        state->mouse->mouse = 0;
+        state->mouse = NULL;
+    }
+
+    //removing the data source cancels the drag-and-drop session
+    if (state->drag_source && _is_in_tree(child, state->drag_source)) {
+        state->drag_source->data_source = 0;
+        state->drag_source = NULL;
+    }
+
+    //the removed widgets lose their captures
+    for(i = state->capture_count - 1; i >= 0; --i) {
+        if (_is_in_tree(child, state->captures[i])) _remove_capture(state, i);
+    }
+}
+
+
+//destroys the image of a render cache
+static void _release_cache_bitmap(ALGUI_WIDGET_CACHE *cache) {
+    if (!cache->bitmap) return;
+    al_destroy_bitmap(cache->bitmap);
+    cache->bitmap = NULL;
+    cache->valid = 0;
+    algui_remove_list_node(&_render_caches, &cache->node);
+    _render_cache_size -= cache->size;
+    cache->size = 0;
+}
+
+
+//destroys the least recently used images until the given number of bytes fits in the budget;
+//images being rendered are the most recently used ones, and they are not destroyed
+static int _evict_render_caches(size_t size) {
+    ALGUI_LIST_NODE *node;
+    ALGUI_WIDGET_CACHE *cache;
+    while (_render_cache_size + size > _render_cache_budget) {
+        node = algui_get_last_list_node(&_render_caches);
+        if (!node) break;
+        cache = (ALGUI_WIDGET_CACHE *)algui_get_list_node_data(node);
+        if (cache->rendering) break;
+        _release_cache_bitmap(cache);
+        ++_render_cache_eviction_count;
+    }
+    return _render_cache_size + size <= _render_cache_budget;
+}
+
+
+//returns the generation the screen rect of a widget is stamped with, i.e. the geometry generation of its parent;
+//the screen rect of a root depends only on its rect, so it is stamped with the first generation
+static unsigned long _get_parent_geometry_generation(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *parent = algui_get_parent_widget(wgt);
+    return parent ? parent->geometry_generation : 1;
+}
+
+
+//checks if the screen rect of a widget was calculated from the current screen position of its parent;
+//moved widgets and widgets given another parent have a zero stamp, which no generation matches
+static int _is_screen_rect_current(ALGUI_WIDGET *wgt) {
+    return wgt->screen_generation == _get_parent_geometry_generation(wgt);
+}
+
+
+//calculates the screen rect of a widget from the screen position of its parent;
+//the geometry generation of the widget changes only if its screen position changed, since the children depend only on it
+static void _set_screen_rect(ALGUI_WIDGET *wgt, int x, int y) {
+    int left = wgt->screen_rect.left, top = wgt->screen_rect.top;
+    
+    wgt->screen_rect = wgt->rect;
+    algui_offset_rect(&wgt->screen_rect, x, y);
+    if (wgt->screen_rect.left != left || wgt->screen_rect.top != top) ++wgt->geometry_generation;
+}
+
+
+//returns the screen rectangle of a widget; 
+//the out of date screen rects of the widget and of its ancestors are calculated again, from the highest one down
+static ALGUI_RECT *_get_screen_rect(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *top = NULL, *ancestor, *parent;
+    int x = 0, y = 0;
+    
+    //find the highest widget on the path with an out of date screen rect
+    for(ancestor = wgt; ancestor; ancestor = algui_get_parent_widget(ancestor)) {
+        if (!_is_screen_rect_current(ancestor)) top = ancestor;
+    }
+    if (!top) return &wgt->screen_rect;
+    
+    //the screen position of the parent of the widget is the sum of the positions of the ancestors up to the highest one,
+    //plus the screen position of the parent of that one, which is up to date
+    parent = algui_get_parent_widget(top);
+    for(ancestor = algui_get_parent_widget(wgt); ancestor != parent; ancestor = algui_get_parent_widget(ancestor)) {
+        x += ancestor->rect.left;
+        y += ancestor->rect.top;
+    }
+    if (parent) {
+        x += parent->screen_rect.left;
+        y += parent->screen_rect.top;
+    }
+    
+    //calculate the screen rects going up, taking off the position of each ancestor from the sum
+    for(ancestor = wgt; ; ancestor = parent) {
+        _set_screen_rect(ancestor, x, y);
+        if (ancestor == top) break;
+        parent = algui_get_parent_widget(ancestor);
+        x -= parent->rect.left;
+        y -= parent->rect.top;
+    }
+    
+    //stamp them once the generations of their parents are final
+    for(ancestor = wgt; ; ancestor = algui_get_parent_widget(ancestor)) {
+        ancestor->screen_generation = _get_parent_geometry_generation(ancestor);
+        if (ancestor == top) break;
+    }
+    
+    return &wgt->screen_rect;
+}
+
+
+//returns the screen rectangle of a widget whose parent has an up to date screen rect; 
+//used by traversals, which visit parents before their children, so as that each widget costs a single check
+static ALGUI_RECT *_get_child_screen_rect(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *parent;
+    
+    if (_is_screen_rect_current(wgt)) return &wgt->screen_rect;
+    
+    parent = algui_get_parent_widget(wgt);
+    if (parent) _set_screen_rect(wgt, parent->screen_rect.left, parent->screen_rect.top); else _set_screen_rect(wgt, 0, 0);
+    wgt->screen_generation = _get_parent_geometry_generation(wgt);
+    
+    return &wgt->screen_rect;
+}
+
+
+//invalidates the render caches of a widget and of its ancestors that a screen rect intersects
+static void _invalidate_render_caches(ALGUI_WIDGET *wgt, ALGUI_RECT *rect) {
+    int current = 0;
+    
+    for(; wgt; wgt = algui_get_parent_widget(wgt)) {
+        if (!wgt->cache) continue;
+        
+        //once the screen rect of a widget is up to date, so are the ones of its ancestors
+        if (algui_rect_intersects_rect(current ? &wgt->screen_rect : _get_screen_rect(wgt), rect)) wgt->cache->valid = 0;
+        current = 1;
+    }
+}
+
+
+//adds a screen rect to the damaged area of the tree of a widget
+static void _add_damage(ALGUI_WIDGET *wgt, ALGUI_RECT *rect) {
+    ALGUI_WIDGET_ROOT *state;
+    ALGUI_RECT r;
+    
+    //what the widget and its ancestors have cached is no longer valid there
+    _invalidate_render_caches(wgt, rect);
+    
+    //during an update, the damage of a tree is collected in a single rect, which is added at the end of the update
+    if (_update_depth) {
+        state = _get_root_state(wgt);
+        if (state->update_damaged) {
+            algui_get_rect_union(&state->update_damage, rect, &state->update_damage);
+        }
+        else {
+            state->update_damage = *rect;
+            state->update_damaged = 1;
+            _add_widget_to_array(&_damage_queue, algui_get_root_widget(wgt));
+        }
+        return;
+    }
     
-    parent = algui_get_parent_widget(wgt);
+    //only the part inside the root can be drawn
+    wgt = algui_get_root_widget(wgt);
+    algui_get_rect_intersection(rect, _get_screen_rect(wgt), &r);
+    if (!algui_is_rect_normalized(&r)) return;
     
-    //for child
-    if (parent) {
-        wgt->screen_rect = wgt->rect;
-        algui_offset_rect(&wgt->screen_rect, parent->screen_rect.left, parent->screen_rect.top);
+    state = _get_root_state(wgt);
+    
+    //the region keeps the rects from overlapping, so as that no area is drawn twice
+    algui_add_region_rect(&state->damage, &r);
+    
+    //if there are too many rects, merge the nearby ones; each rect costs a pass over the tree
+    if (state->damage.count > _MAX_DAMAGE_RECTS) {
+        algui_simplify_region(&state->damage, _MAX_DAMAGE_RECTS);
+    }
+}
+
+
+//compares the z-keys of two sibling widgets; lower widgets are placed first,
+//so as that a child added on top of its siblings is appended to the cells of the spatial index
+static int _compare_z_keys(void *item1, void *item2) {
+    int z1 = ((ALGUI_WIDGET *)item1)->z_key;
+    int z2 = ((ALGUI_WIDGET *)item2)->z_key;
+    return z1 < z2 ? -1 : z1 > z2 ? 1 : 0;
+}
+
+
+//renumbers the z-keys of the children of a widget
+static void _respace_z_keys(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *child;
+    int z_key = 0;
+    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+        child->z_key = z_key;
+        z_key += _Z_KEY_SPACING;
     }
+}
 
-    //for root    
+
+//sets the z-keys of a range of consecutive widgets that were just placed between their siblings;
+//the keys are spread evenly between the keys of the siblings;
+//if there is no room between them, the keys of all the siblings are renumbered
+static void _set_z_keys(ALGUI_WIDGET *first, ALGUI_WIDGET *last, unsigned long count) {
+    ALGUI_WIDGET *lower, *higher, *wgt;
+    long long key, step;
+    
+    lower = algui_get_lower_sibling_widget(first);
+    higher = algui_get_higher_sibling_widget(last);
+    
+    if (lower && higher) {
+        key = lower->z_key;
+        step = ((long long)higher->z_key - lower->z_key) / (long long)(count + 1);
+    }
+    else if (lower) {
+        key = lower->z_key;
+        step = _Z_KEY_SPACING;
+    }
+    else if (higher) {
+        step = _Z_KEY_SPACING;
+        key = higher->z_key - step * (long long)(count + 1);
+    }
     else {
-        wgt->screen_rect = wgt->rect;
+        step = _Z_KEY_SPACING;
+        key = -step;
+    }
+    
+    if (step < 1 || key + step < INT_MIN || key + step * (long long)count > INT_MAX) {
+        _respace_z_keys(algui_get_parent_widget(first));
+        return;
+    }
+    
+    for(wgt = first; ; wgt = algui_get_higher_sibling_widget(wgt)) {
+        key += step;
+        wgt->z_key = (int)key;
+        if (wgt == last) break;
+    }
+}
+
+
+//checks if the children of a widget should be indexed
+static int _wants_spatial_index(ALGUI_WIDGET *wgt) {
+    unsigned long count;
+    
+    switch (wgt->spatial_index) {
+        case ALGUI_SPATIAL_INDEX_ALWAYS: return 1;
+        case ALGUI_SPATIAL_INDEX_NEVER : return 0;
     }
     
-    //calculate children
+    //an existing index is kept until the children drop to half the threshold,
+    //so as that adding and removing children around the threshold does not rebuild it each time
+    count = algui_get_widget_child_count(wgt);
+    return wgt->grid ? count >= (unsigned long)_spatial_index_threshold / 2 : count > (unsigned long)_spatial_index_threshold;
+}
+
+
+//destroys the spatial index of a widget
+static void _destroy_spatial_index(ALGUI_WIDGET *wgt) {
+    if (!wgt->grid) return;
+    algui_destroy_grid(wgt->grid);
+    wgt->grid = NULL;
+}
+
+
+//builds the spatial index of the children of a widget; the index covers the widget's area
+static void _build_spatial_index(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *child;
+    ALGUI_RECT rect;
+    int width, height, cells, columns, rows;
+    
+    _destroy_spatial_index(wgt);
+    
+    //a widget without area has nothing to index; the index is built when the widget is resized
+    width = algui_get_widget_width(wgt);
+    height = algui_get_widget_height(wgt);
+    if (width <= 0 || height <= 0) return;
+    
+    //cells as square as possible, a few children per cell
+    cells = MAX(1, (int)(algui_get_widget_child_count(wgt) / _GRID_ITEMS_PER_CELL));
+    columns = MIN(width, MAX(1, (int)sqrt((double)cells * width / height)));
+    rows = MIN(height, MAX(1, cells / columns));
+    
+    algui_set_rect(&rect, 0, 0, width - 1, height - 1);
+    wgt->grid = algui_create_grid(&rect, columns, rows, _compare_z_keys);
     for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _calc_screen_rect(child);
+        algui_insert_grid_item(wgt->grid, &child->rect, child);
     }
-} 
+}
+
+
+//creates, rebuilds or destroys the spatial index of a widget after its children or its size changed
+static void _update_spatial_index(ALGUI_WIDGET *wgt) {
+    int width, height, cells;
+    
+    //during an update, the index is updated once, at the end of the update
+    if (_update_depth) {
+        if (!wgt->index_queued) {
+            _add_widget_to_array(&_index_queue, wgt);
+            wgt->index_queued = 1;
+        }
+        return;
+    }
+    
+    if (!_wants_spatial_index(wgt)) {
+        _destroy_spatial_index(wgt);
+        return;
+    }
+    
+    if (!wgt->grid) {
+        _build_spatial_index(wgt);
+        return;
+    }
+    
+    //the index must cover the widget's area
+    width = algui_get_widget_width(wgt);
+    height = algui_get_widget_height(wgt);
+    if (algui_get_rect_width(&wgt->grid->rect) != width || algui_get_rect_height(&wgt->grid->rect) != height) {
+        _build_spatial_index(wgt);
+        return;
+    }
+    
+    //rebuild the index with more cells when its cells become crowded
+    cells = algui_get_grid_cell_count(wgt->grid);
+    if (algui_get_grid_item_count(wgt->grid) > 4 * _GRID_ITEMS_PER_CELL * (unsigned long)cells && cells < width * height) {
+        _build_spatial_index(wgt);
+    }
+}
 
 
 //checks if a widget is being managed
@@ -56,50 +1096,62 @@ static int _manages_layout(ALGUI_WIDGET *wgt) {
 //sets the preferred size to a widget, children first
 static void _set_preferred_size(ALGUI_WIDGET *wgt) {
     ALGUI_SET_PREFERRED_RECT_MESSAGE msg;
-    ALGUI_WIDGET *child;
-    
-    //avoid hidden widgets
-    if (!wgt->visible_tree) return;
+    ALGUI_TRAVERSAL trv;
+    ALGUI_WIDGET *left;
+    int descend;
     
-    //begin layout management
-    wgt->layout = 1;
+    msg.message.id = ALGUI_MSG_SET_PREFERRED_RECT;
     
-    //notify children
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _set_preferred_size(child);
+    for(wgt = _begin_traversal(&trv, wgt, 0); ; wgt = _next_traversal(&trv, descend)) {
+        //send the message to the widgets whose children are done, and end their layout management
+        while ((left = _leave_traversal(&trv, wgt, NULL))) {
+            algui_send_message(left, &msg.message);
+            left->layout = 0;
+        }
+        if (!wgt) break;
+        
+        wgt->needs_measure_tree = 0;
+        
+        //avoid hidden widgets
+        descend = wgt->visible_tree;
+        if (!descend) continue;
+        
+        //begin layout management
+        wgt->layout = 1;
+        _enter_traversal(&trv, NULL);
     }
     
-    //send message to widget
-    msg.message.id = ALGUI_MSG_SET_PREFERRED_RECT;
-    algui_send_message(wgt, &msg.message);
-    
-    //end layout management
-    wgt->layout = 0;
+    _end_traversal(&trv);
 }
  
  
 //do layout, parent first
 static void _do_layout(ALGUI_WIDGET *wgt) {
     ALGUI_DO_LAYOUT_MESSAGE msg;
-    ALGUI_WIDGET *child;
-    
-    //avoid hidden widgets
-    if (!wgt->visible_tree) return;
+    ALGUI_TRAVERSAL trv;
+    ALGUI_WIDGET *left;
+    int descend;
     
-    //begin layout management
-    wgt->layout = 1;
-    
-    //send message to widget
     msg.message.id = ALGUI_MSG_DO_LAYOUT;
-    algui_send_message(wgt, &msg.message);
     
-    //notify children
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _do_layout(child);
+    for(wgt = _begin_traversal(&trv, wgt, 0); ; wgt = _next_traversal(&trv, descend)) {
+        //end layout management of the widgets whose children are done
+        while ((left = _leave_traversal(&trv, wgt, NULL))) left->layout = 0;
+        if (!wgt) break;
+        
+        wgt->needs_arrange = 0;
+        
+        //avoid hidden widgets
+        descend = wgt->visible_tree;
+        if (!descend) continue;
+        
+        //begin layout management and send message to widget
+        wgt->layout = 1;
+        algui_send_message(wgt, &msg.message);
+        _enter_traversal(&trv, NULL);
     }
-
-    //end layout management
-    wgt->layout = 0;
+    
+    _end_traversal(&trv);
 }
  
  
@@ -107,104 +1159,664 @@ static void _do_layout(ALGUI_WIDGET *wgt) {
 static void _init_layout(ALGUI_WIDGET *wgt) {
     _set_preferred_size(wgt);
     _do_layout(wgt);    
-    _calc_screen_rect(wgt);
 }
 
 
-//updates the layout of a widget
-static void _update_layout(ALGUI_WIDGET *wgt) {
+//adds a widget to the layout queue, unless it is already there
+static void _queue_layout(ALGUI_WIDGET *wgt) {
+    if (wgt->layout_queued) return;
+    _add_widget_to_array(&_layout_queue, wgt);
+    wgt->layout_queued = 1;
+}
+
+
+//removes a widget from the layout queue
+static void _unqueue_layout(ALGUI_WIDGET *wgt) {
+    if (!wgt->layout_queued) return;
+    _remove_widget_from_array(&_layout_queue, wgt);
+    wgt->layout_queued = 0;
+    wgt->needs_measure_tree = 0;
+    wgt->needs_measure = 0;
+    wgt->needs_arrange = 0;
+}
+
+
+//marks a widget as needing its preferred rect recalculated; the change propagates to the ancestors
+static void _invalidate_measure(ALGUI_WIDGET *wgt) {
+    wgt->needs_measure = 1;
+    _queue_layout(wgt);
+}
+
+
+//marks a widget that was inserted in a tree as needing the preferred rects of its whole tree calculated
+static void _invalidate_measure_tree(ALGUI_WIDGET *wgt) {
+    wgt->needs_measure_tree = 1;
+    _queue_layout(wgt);
+}
+
+
+//returns the depth of a widget in the tree being laid out, or -1 if the widget is in another tree;
+//the depths are kept in the widgets on the way up to the first ancestor with a depth of the current layout generation,
+//so as that each widget is visited once per layout flush
+static int _get_layout_depth(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *ancestor;
+    int depth = 0, result;
+    
+    //count the levels up to the first ancestor with a known depth
+    for(ancestor = wgt; ancestor && ancestor->layout_generation != _layout_generation; ancestor = algui_get_parent_widget(ancestor)) ++depth;
+    result = depth = ancestor && ancestor->layout_depth >= 0 ? ancestor->layout_depth + depth : -1;
+    
+    //keep the depths of the widgets on the way
+    for(; wgt != ancestor; wgt = algui_get_parent_widget(wgt)) {
+        wgt->layout_generation = _layout_generation;
+        wgt->layout_depth = depth;
+        if (depth > 0) --depth;
+    }
+    
+    return result;
+}
+
+
+//adds a widget to the widgets processed by a layout flush, after the widgets of the same depth
+static void _add_layout_work(ALGUI_LAYOUT_WORK *work, ALGUI_WIDGET *wgt, int depth) {
+    int i;
+    if (work->count == work->size) {
+        work->size = work->size ? work->size * 2 : 64;
+        work->widgets = (ALGUI_WIDGET **)al_realloc(work->widgets, work->size * sizeof(ALGUI_WIDGET *));
+        work->next = (int *)al_realloc(work->next, work->size * sizeof(int));
+        assert(work->widgets && work->next);
+    }
+    if (depth >= work->depth_count) {
+        i = work->depth_count;
+        work->depth_count = MAX(work->depth_count * 2, depth + 1);
+        work->first = (int *)al_realloc(work->first, work->depth_count * sizeof(int));
+        work->last = (int *)al_realloc(work->last, work->depth_count * sizeof(int));
+        assert(work->first && work->last);
+        for(; i < work->depth_count; ++i) work->first[i] = work->last[i] = -1;
+    }
+    work->widgets[work->count] = wgt;
+    work->next[work->count] = -1;
+    if (work->last[depth] >= 0) work->next[work->last[depth]] = work->count; else work->first[depth] = work->count;
+    work->last[depth] = work->count;
+    ++work->count;
+    wgt->layout_queued = 1;
+}
+
+
+//marks the parent of a widget as needing its preferred rect recalculated during a layout flush
+static void _propagate_measure(ALGUI_LAYOUT_WORK *work, ALGUI_WIDGET *wgt, int depth) {
+    ALGUI_WIDGET *parent = algui_get_parent_widget(wgt);
+    parent->needs_measure = 1;
+    if (!parent->layout_queued) _add_layout_work(work, parent, depth - 1);
+}
+
+
+//calculates the pending layout of a tree; the marked widgets are processed level by level,
+//so as that each widget is measured and arranged once:
+//new trees are measured top to bottom, changes of preferred rects propagate bottom to top,
+//then the widgets where the propagation stopped are arranged top to bottom
+static void _flush_layout(ALGUI_WIDGET *root) {
     ALGUI_SET_PREFERRED_RECT_MESSAGE msg;
-    ALGUI_WIDGET *last;
+    ALGUI_LAYOUT_WORK work;
+    ALGUI_WIDGET_ROOT *state;
+    ALGUI_WIDGET *wgt;
+    int i, j, depth, max_depth = 0;
     ALGUI_RECT prev_rect;
     
-    do {    
-        last = wgt;
+    //during an update, the layout is calculated at the end of the update
+    if (!_layout_queue.length || _update_depth) return;
+    root = algui_get_root_widget(root);
+    
+    //the buckets of the tree are taken out of its state while in use, 
+    //since widgets may flush the layout again, or move the tree, while they are laid out
+    state = _get_root_state(root);
+    work = state->layout_work;
+    memset(&state->layout_work, 0, sizeof(ALGUI_LAYOUT_WORK));
+    
+    ++_layout_generation;
+    root->layout_generation = _layout_generation;
+    root->layout_depth = 0;
+    
+    //take the widgets of the tree out of the queue; they stay marked as queued while processed;
+    //widgets that were removed from their trees are dropped, since they are laid out when drawn again
+    for(i = 0, j = 0; i < _layout_queue.length; ++i) {
+        wgt = _layout_queue.widgets[i];
+        if (!wgt->drawn) {
+            wgt->layout_queued = 0;
+            wgt->needs_measure_tree = 0;
+            wgt->needs_measure = 0;
+            wgt->needs_arrange = 0;
+        }
+        else if ((depth = _get_layout_depth(wgt)) >= 0) {
+            max_depth = MAX(max_depth, depth);
+            _add_layout_work(&work, wgt, depth);
+        }
+        else {
+            _layout_queue.widgets[j++] = wgt;
+        }
+    }
+    _layout_queue.length = j;
+    if (!work.count) {
+        state->layout_work = work;
+        return;
+    }
+    
+    //measure new trees; measuring a tree clears the marks of the trees in it
+    for(depth = 0; depth <= max_depth; ++depth) {
+        for(i = work.first[depth]; i >= 0; i = work.next[i]) {
+            wgt = work.widgets[i];
+            if (!wgt->needs_measure_tree) continue;
+            if (!wgt->drawn) {
+                wgt->needs_measure_tree = 0;
+                continue;
+            }
+            _set_preferred_size(wgt);
+            if (depth > 0) _propagate_measure(&work, wgt, depth); else wgt->needs_arrange = 1;
+        }
+    }
+    
+    //propagate changes of preferred rects
+    for(depth = max_depth; depth >= 0; --depth) {
+        for(i = work.first[depth]; i >= 0; i = work.next[i]) {
+            wgt = work.widgets[i];
+            if (!wgt->needs_measure) continue;
+            wgt->needs_measure = 0;
+            if (!wgt->drawn) continue;
+            
+            //the area the widget covers must be drawn again, wherever the widget goes
+            _add_damage(wgt, _get_screen_rect(wgt));
+            
+            //the preferred rect of a boundary does not depend on its children
+            if (wgt->layout_boundary) {
+                wgt->needs_arrange = 1;
+                continue;
+            }
+            
+            //ask the widget to recalculate its preferred rect
+            prev_rect = wgt->rect;
+            wgt->layout = 1;
+            msg.message.id = ALGUI_MSG_SET_PREFERRED_RECT;
+            algui_send_message(wgt, &msg.message);
+            wgt->layout = 0;
+            
+            //if the rect didn't change, there is no need to propagate the calculation further
+            if (depth == 0 || algui_is_rect_equal_to_rect(&prev_rect, &wgt->rect)) {
+                wgt->needs_arrange = 1;
+                continue;
+            }
+            
+            _propagate_measure(&work, wgt, depth);
+        }
+    }
+    
+    //arrange the widgets where the propagation stopped; arranging a widget clears the marks of the widgets in its tree
+    for(depth = 0; depth <= max_depth; ++depth) {
+        for(i = work.first[depth]; i >= 0; i = work.next[i]) {
+            wgt = work.widgets[i];
+            if (!wgt->needs_arrange) continue;
+            wgt->needs_arrange = 0;
+            if (!wgt->drawn) continue;
+            _do_layout(wgt);
+            _add_damage(wgt, _get_screen_rect(wgt));
+        }
+    }
+    
+    for(i = 0; i < work.count; ++i) {
+        work.widgets[i]->layout_queued = 0;
+    }
+    
+    //empty the buckets and give them back to the tree, unless it got others meanwhile
+    work.count = 0;
+    for(depth = 0; depth <= max_depth && depth < work.depth_count; ++depth) {
+        work.first[depth] = work.last[depth] = -1;
+    }
+    state = _find_root_state(root);
+    if (state && !state->layout_work.size && !state->layout_work.depth_count) state->layout_work = work; else _free_layout_work(&work);
+}
+
+
+//updates the flags of a widget from the flags of its parent
+static void _set_flags(ALGUI_WIDGET *wgt, int drawn) {
+    ALGUI_WIDGET *parent;
+    ++_tree_generation;
+    parent = algui_get_parent_widget(wgt);
+    wgt->drawn = drawn;
+    wgt->visible_tree = wgt->visible && (!parent || parent->visible_tree);
+    wgt->enabled_tree = wgt->enabled && (!parent || parent->enabled_tree);
+    if (!drawn) {
+        wgt->focus = 0;
+        wgt->mouse = 0;
+        wgt->data_source = 0;
+    }        
+}
+
+
+//updates the widgets' flags
+static void _update_flags(ALGUI_WIDGET *wgt, int drawn) {
+    ALGUI_TRAVERSAL trv;
+    for(wgt = _begin_traversal(&trv, wgt, 0); wgt; wgt = _next_traversal(&trv, 1)) {
+        _set_flags(wgt, drawn);
+    }
+    _end_traversal(&trv);
+}
+
+
+//updates the flags of a widget and its descendants;
+//during an update, the descendants are updated at the end of the update
+static void _update_tree_flags(ALGUI_WIDGET *wgt, int drawn) {
+    if (!_update_depth) {
+        _update_flags(wgt, drawn);
+        return;
+    }
+    _set_flags(wgt, drawn);
+    if (!wgt->flags_queued) {
+        _add_widget_to_array(&_flags_queue, wgt);
+        wgt->flags_queued = 1;
+    }
+}
+
+
+//checks if a widget or an ancestor of it is waiting for the flags of its descendants to be updated;
+//the result is marked in the widgets on the way up to the first queued widget or widget marked at the current generation,
+//so as that each widget is visited once per flush
+static int _is_flags_queued_tree(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *ancestor;
+    int covered;
+    
+    for(ancestor = wgt; ancestor && !ancestor->flags_queued && ancestor->flags_generation != _flags_generation; ancestor = algui_get_parent_widget(ancestor));
+    covered = ancestor && (ancestor->flags_queued || ancestor->flags_covered);
+    
+    for(; wgt != ancestor; wgt = algui_get_parent_widget(wgt)) {
+        wgt->flags_generation = _flags_generation;
+        wgt->flags_covered = covered;
+    }
+    
+    return covered;
+}
+
+
+//updates the flags postponed during an update; the input focus of the affected trees
+//is dropped if it ended up in a hidden or disabled widget
+static void _flush_flags() {
+    ALGUI_WIDGET *wgt, *parent;
+    ALGUI_WIDGET_ROOT *state;
+    int i, j;
+    
+    //the widgets below other queued widgets are updated along with them
+    ++_flags_generation;
+    for(i = 0, j = 0; i < _flags_queue.length; ++i) {
+        wgt = _flags_queue.widgets[i];
+        if (_is_flags_queued_tree(algui_get_parent_widget(wgt))) wgt->flags_queued = 0; else _flags_queue.widgets[j++] = wgt;
+    }
+    _flags_queue.length = j;
+    
+    while (_flags_queue.length) {
+        wgt = _flags_queue.widgets[--_flags_queue.length];
+        wgt->flags_queued = 0;
+        parent = algui_get_parent_widget(wgt);
+        _update_flags(wgt, parent ? parent->drawn : wgt->drawn);
+        
+        state = _find_root_state(wgt);
+        if (state && state->focus && (!state->focus->visible_tree || !state->focus->enabled_tree)) {
+            state->focus->focus = 0;
+            state->focus = NULL;
+        }
+    }
+}
+
+
+
+//adds message bits to the tree masks of a widget and its ancestors
+static void _add_tree_message_mask(ALGUI_WIDGET *wgt, ALGUI_MESSAGE_MASK mask) {
+    for(; wgt && (wgt->tree_message_mask | mask) != wgt->tree_message_mask; wgt = algui_get_parent_widget(wgt)) {
+        wgt->tree_message_mask |= mask;
+    }
+}
+
+
+//calculates again the tree masks of a widget and its ancestors, until a mask does not change
+static void _update_tree_message_mask(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *child;
+    ALGUI_MESSAGE_MASK mask;
+    for(; wgt; wgt = algui_get_parent_widget(wgt)) {
+        mask = wgt->message_mask;
+        for(child = algui_get_lowest_child_widget(wgt); child && mask != ALGUI_MESSAGE_MASK_ALL; child = algui_get_higher_sibling_widget(child)) {
+            mask |= child->tree_message_mask;
+        }
+        if (mask == wgt->tree_message_mask) break;
+        wgt->tree_message_mask = mask;
+    }
+}
+ 
+ 
+//counts the widgets of a covered tree as culled; the screen rect of the top widget must be up to date
+static void _count_culled(ALGUI_WIDGET *wgt, ALGUI_RECT *rect, ALGUI_WIDGET_ROOT *state) {
+    ALGUI_TRAVERSAL trv;
+    ALGUI_RECT r;
+    int descend;
+    
+    for(wgt = _begin_traversal(&trv, wgt, 0); wgt; wgt = _next_traversal(&trv, descend)) {
+        while (_leave_traversal(&trv, wgt, NULL));
+        
+        descend = 0;
+        if (!wgt->visible_tree) continue;
+        algui_get_rect_intersection(_get_child_screen_rect(wgt), _get_traversal_rect(&trv, rect), &r);
+        if (!algui_is_rect_normalized(&r)) continue;
+        
+        ++state->culled_widget_count;
+        state->culled_pixel_count += (unsigned long)algui_get_rect_width(&r) * algui_get_rect_height(&r);
+        
+        _enter_traversal(&trv, &r);
+        descend = 1;
+    }
+    
+    _end_traversal(&trv);
+}
+
+
+//finds the widgets that opaque widgets in front of them cover, before drawing;
+//widgets are visited front to back, i.e. in the reverse drawing order, 
+//and the covered area accumulates the area of the opaque widgets visited so far
+static void _cull(ALGUI_WIDGET *wgt, ALGUI_RECT *rect, ALGUI_REGION *covered, ALGUI_WIDGET_ROOT *state) {
+    ALGUI_TRAVERSAL trv;
+    ALGUI_WIDGET *left;
+    ALGUI_RECT r, *clip;
+    int descend;
+    
+    //the screen rects of the other widgets are calculated from the ones of their parents, which are visited first
+    _get_screen_rect(wgt);
+    
+    //children are visited from highest to lowest
+    for(wgt = _begin_traversal(&trv, wgt, 1); ; wgt = _next_traversal(&trv, descend)) {
+        //the children, along with the widgets in front, may cover the widgets whose children are done
+        while ((left = _leave_traversal(&trv, wgt, &clip))) {
+            if (algui_region_contains_rect(covered, clip)) {
+                left->culled = _CULL_SELF;
+                ++state->culled_widget_count;
+                state->culled_pixel_count += (unsigned long)algui_get_rect_width(clip) * algui_get_rect_height(clip);
+            }
+            
+            //else the widget covers the widgets behind it, if it is opaque
+            else if (left->opaque) {
+                algui_add_region_rect(covered, clip);
+            }
+        }
+        if (!wgt) break;
+        
+        descend = 0;
+        
+        //if the widget is not drawn yet, then initialize the widgets
+        if (!wgt->drawn) {
+            _update_flags(wgt, 1);
+            _init_layout(wgt);
+        }
+        
+        wgt->culled = _CULL_NONE;
+        
+        //avoid invisible widgets and widgets outside of the clip area; they are not drawn anyway
+        if (!wgt->visible_tree) continue;
+        clip = _get_traversal_rect(&trv, rect);
+        algui_get_rect_intersection(_get_child_screen_rect(wgt), clip, &r);
+        if (!algui_is_rect_normalized(&r)) continue;
+        
+        //if the widget is covered, then its children are also covered, since they are clipped to it
+        if (algui_region_contains_rect(covered, &r)) {
+            wgt->culled = _CULL_TREE;
+            _count_culled(wgt, clip, state);
+            continue;
+        }
+        
+        _enter_traversal(&trv, &r);
+        descend = 1;
+    }
+    
+    _end_traversal(&trv);
+}
+
+
+//starts a batch of bitmap drawing, in batched mode
+static void _hold_drawing(void) {
+    if (_batched_drawing) al_hold_bitmap_drawing(1);
+}
+
+
+//submits the current batch of bitmap drawing, in batched mode
+static void _release_drawing(ALGUI_WIDGET_ROOT *state) {
+    if (!_batched_drawing) return;
+    al_hold_bitmap_drawing(0);
+    if (_batch_pending) {
+        ++state->draw_batch_count;
+        _batch_pending = 0;
+    }
+}
+
+
+//counts drawing; in batched mode, it is submitted along with the current batch
+static void _count_drawing(ALGUI_WIDGET_ROOT *state) {
+    if (_batched_drawing) _batch_pending = 1; else ++state->draw_batch_count;
+}
+
+
+//sets the clipping rectangle of the target bitmap from a screen rect;
+//in batched mode, the current batch is submitted first, since the clip applies to it when submitted
+static void _set_clip(ALGUI_RECT *rect, ALGUI_WIDGET_ROOT *state) {
+    int x = rect->left - _draw_origin_x, y = rect->top - _draw_origin_y, w = algui_get_rect_width(rect), h = algui_get_rect_height(rect);
+    int cx, cy, cw, ch;
+    
+    //nothing to do if the clip does not change, for example for consecutive siblings in the same damaged rect
+    al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
+    if (cx == x && cy == y && cw == w && ch == h) {
+        ++state->skipped_clip_change_count;
+        return;
+    }
+    
+    _release_drawing(state);
+    al_set_clipping_rectangle(x, y, w, h);
+    ++state->clip_change_count;
+    _hold_drawing();
+}
+
+
+//culls a widget tree from a rect
+static void _cull_tree(ALGUI_WIDGET *wgt, ALGUI_RECT *rect, ALGUI_WIDGET_ROOT *state) {
+    ALGUI_REGION covered;
+    algui_init_region(&covered);
+    _cull(wgt, rect, &covered, state);
+    algui_cleanup_region(&covered);
+}
+
+
+//checks if the image of a render cache can be drawn instead of its widget tree
+static int _is_render_cache_valid(ALGUI_WIDGET *wgt) {
+    return 
+        wgt->cache->valid && 
+        al_get_bitmap_width(wgt->cache->bitmap) == algui_get_rect_width(_get_child_screen_rect(wgt)) &&
+        al_get_bitmap_height(wgt->cache->bitmap) == algui_get_rect_height(_get_child_screen_rect(wgt));
+}
+
+
+//makes the image of a render cache the target bitmap, creating it if needed;
+//the previous target is kept in the given struct; returns zero if there is no memory for the image
+static int _begin_render_cache(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ROOT *state, ALGUI_DRAW_TARGET *prev) {
+    ALGUI_WIDGET_CACHE *cache = wgt->cache;
+    ALLEGRO_TRANSFORM transform;
+    ALGUI_RECT *screen_rect = _get_child_screen_rect(wgt);
+    int w = algui_get_rect_width(screen_rect);
+    int h = algui_get_rect_height(screen_rect);
+    size_t size = (size_t)w * h * _RENDER_CACHE_PIXEL_SIZE;
+    
+    //an image of the wrong size is created again
+    if (cache->bitmap && (al_get_bitmap_width(cache->bitmap) != w || al_get_bitmap_height(cache->bitmap) != h)) {
+        _release_cache_bitmap(cache);
+    }
+    
+    //create the image within the budget
+    if (!cache->bitmap) {
+        if (!_evict_render_caches(size)) return 0;
+        cache->bitmap = al_create_bitmap(w, h);
+        if (!cache->bitmap) return 0;
+        cache->size = size;
+        _render_cache_size += size;
+    }
+    else {
+        algui_remove_list_node(&_render_caches, &cache->node);
+    }
+    algui_prepend_list_node(&_render_caches, &cache->node);
+    
+    //keep the current target; held drawing goes to the target it was made on
+    _release_drawing(state);
+    prev->bitmap = al_get_target_bitmap();
+    al_copy_transform(&prev->transform, al_get_current_transform());
+    prev->origin_x = _draw_origin_x;
+    prev->origin_y = _draw_origin_y;
+    
+    //target the image; the origin of the image is at the screen position of the widget
+    al_set_target_bitmap(cache->bitmap);
+    al_identity_transform(&transform);
+    al_translate_transform(&transform, -screen_rect->left, -screen_rect->top);
+    al_use_transform(&transform);
+    _draw_origin_x = screen_rect->left;
+    _draw_origin_y = screen_rect->top;
+    al_set_clipping_rectangle(0, 0, w, h);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    _hold_drawing();
+    
+    //the whole tree is rendered, so it is culled again without the widgets in front of it
+    _cull_tree(wgt, screen_rect, state);
+    cache->rendering = 1;
+    return 1;
+}
+
+
+//restores the target bitmap after rendering a render cache
+static void _end_render_cache(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ROOT *state, ALGUI_DRAW_TARGET *prev) {
+    _release_drawing(state);
+    al_set_target_bitmap(prev->bitmap);
+    al_use_transform(&prev->transform);
+    _draw_origin_x = prev->origin_x;
+    _draw_origin_y = prev->origin_y;
+    _hold_drawing();
+    wgt->cache->rendering = 0;
+    wgt->cache->valid = 1;
+}
+
+
+//draws widgets, parents first; the widgets must have been culled with the same rect
+static void _draw(ALGUI_WIDGET *wgt, ALGUI_RECT *rect, ALGUI_WIDGET_ROOT *state) {
+    ALGUI_PAINT_MESSAGE msg;
+    ALGUI_TRAVERSAL trv;
+    ALGUI_DRAW_TARGET prev;
+    ALGUI_RECT *clip;
+    int descend;
+    
+    //the screen rects of the other widgets are calculated from the ones of their parents, which are visited first
+    _get_screen_rect(wgt);
+    
+    for(wgt = _begin_traversal(&trv, wgt, 0); wgt; wgt = _next_traversal(&trv, descend)) {
+        while (_leave_traversal(&trv, wgt, NULL));
         
-        //keep the rect of the widget
-        prev_rect = wgt->rect;
+        descend = 0;
+        
+        //avoid invisible and covered widgets
+        if (!wgt->visible_tree || wgt->culled == _CULL_TREE) continue;
 
-        //ask the widget to recalculate its preferred rect
-        msg.message.id = ALGUI_MSG_SET_PREFERRED_RECT;
-        algui_send_message(wgt, &msg.message);
+        //calculate the actual clip between the widget rect and the clip of the parent
+        clip = _get_traversal_rect(&trv, rect);
+        algui_get_rect_intersection(_get_child_screen_rect(wgt), clip, &msg.paint_rect);
+        
+        //if the widget lies beyond the clip area, then don't draw anything else
+        if (!algui_is_rect_normalized(&msg.paint_rect)) continue;
+        
+        //a cached widget is drawn from its image, which is rendered again if the tree changed;
+        //if there is no memory for the image, the widget is drawn normally
+        if (wgt->cache && !wgt->cache->rendering) {
+            if (wgt->cache->bitmap && _is_render_cache_valid(wgt)) {
+                ++_render_cache_hit_count;
+                algui_remove_list_node(&_render_caches, &wgt->cache->node);
+                algui_prepend_list_node(&_render_caches, &wgt->cache->node);
+            }
+            else {
+                ++_render_cache_miss_count;
+                if (_begin_render_cache(wgt, state, &prev)) {
+                    _draw(wgt, _get_child_screen_rect(wgt), state);
+                    _end_render_cache(wgt, state, &prev);
+                }
+            }
+            if (wgt->cache->bitmap && wgt->cache->valid) {
+                _set_clip(&msg.paint_rect, state);
+                _count_drawing(state);
+                al_draw_bitmap_region(wgt->cache->bitmap, 
+                    msg.paint_rect.left - _get_child_screen_rect(wgt)->left, 
+                    msg.paint_rect.top - _get_child_screen_rect(wgt)->top, 
+                    algui_get_rect_width(&msg.paint_rect), 
+                    algui_get_rect_height(&msg.paint_rect), 
+                    msg.paint_rect.left, 
+                    msg.paint_rect.top, 
+                    0);
+                continue;
+            }
+        }
         
-        //if the rect didn't change, there is no need to propagate the calculation further
-        if (algui_is_rect_equal_to_rect(&prev_rect, &wgt->rect)) break;
+        //paint the widget, unless its children cover it
+        if (wgt->culled == _CULL_NONE) {
+            //prepare the paint message
+            msg.message.id = ALGUI_MSG_PAINT;
+            msg.widget_rect = *_get_child_screen_rect(wgt);
+            
+            //clip the screen as needed, so as that each widget doesn't draw outside its area;
+            //in batched mode, widgets are trusted to draw inside their rect, and therefore siblings share the clipping of their parent
+            _set_clip(_batched_drawing ? clip : &msg.paint_rect, state);
+            
+            //send the paint message to the widget
+            algui_send_message(wgt, &msg.message);
+            _count_drawing(state);
+        }
         
-        //propagate the calculation to the parent
-        wgt = algui_get_parent_widget(wgt);
-    } while (wgt);    
+        //paint children from lowest to highest, clipped to the widget
+        _enter_traversal(&trv, &msg.paint_rect);
+        descend = 1;
+    }
     
-    //recalculate the layout from the last widget (where the propagation stopped)
-    _do_layout(last);
-    _calc_screen_rect(last);
+    _end_traversal(&trv);
 }
-
-
-//updates the widgets' flags
-static void _update_flags(ALGUI_WIDGET *wgt, int drawn) {
-    ALGUI_WIDGET *parent, *child;    
-    parent = algui_get_parent_widget(wgt);
-    wgt->drawn = drawn;
-    wgt->visible_tree = wgt->visible && (!parent || parent->visible_tree);
-    wgt->enabled_tree = wgt->enabled && (!parent || parent->enabled_tree);
-    if (!drawn) {
-        wgt->focus = 0;
-        wgt->mouse = 0;
-        wgt->data_source = 0;
-    }        
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _update_flags(child, drawn);
-    }
-} 
  
  
-//recursively draw widgets
-static void _draw(ALGUI_WIDGET *wgt, ALGUI_RECT *rect) {
-    ALGUI_PAINT_MESSAGE msg;
+//culls and then draws a widget tree
+static void _draw_tree(ALGUI_WIDGET *wgt, ALGUI_RECT *rect, ALGUI_WIDGET_ROOT *state) {
+    _cull_tree(wgt, rect, state);
+    _hold_drawing();
+    _draw(wgt, rect, state);
+    _release_drawing(state);
+}
+
+
+//returns the widget of a subtree that is destroyed first, i.e. the highest child of the highest child and so on
+static ALGUI_WIDGET *_get_highest_descendant(ALGUI_WIDGET *wgt) {
     ALGUI_WIDGET *child;
-    
-    //if the widget is not drawn yet, then initialize the widgets
-    if (!wgt->drawn) {
-        _update_flags(wgt, 1);
-        _init_layout(wgt);
-    }
+    while ((child = algui_get_highest_child_widget(wgt))) wgt = child;
+    return wgt;
+}
 
-    //avoid invisible widgets
-    if (!wgt->visible_tree) return;
 
-    //calculate the actual clip between the widget rect and the given rect
-    algui_get_rect_intersection(&wgt->screen_rect, rect, &msg.paint_rect);
-    
-    //if the widget lies beyond the clip area, then don't draw anything else
-    if (!algui_is_rect_normalized(&msg.paint_rect)) return;
-    
-    //prepare the paint message
-    msg.message.id = ALGUI_MSG_PAINT;
-    msg.widget_rect = wgt->screen_rect;
-    
-    //clip the screen as needed, so as that each widget doesn't draw outside its area
-    al_set_clipping_rectangle(msg.paint_rect.left, msg.paint_rect.top, algui_get_rect_width(&msg.paint_rect), algui_get_rect_height(&msg.paint_rect));
-    
-    //send the paint message to the widget
-    algui_send_message(wgt, &msg.message);
-    
-    //paint children from lowest to highest
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _draw(child, &msg.paint_rect);
-    }
+//frees a widget, unless it was allocated from the given arena
+static void _free_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ARENA *arena) {
+    if (!arena || !algui_widget_arena_contains(arena, wgt)) al_free(wgt);
 }
- 
- 
-//recursively destroys a bunch of widgets
-static void _destroy(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *child, *next;
-    for(child = algui_get_highest_child_widget(wgt); child; ) {
-        next = algui_get_lower_sibling_widget(child);
-        _destroy(child);
-        child = next;
+
+
+//destroys a bunch of widgets, children first; they must have been cleaned up already;
+//the links of each widget are followed before it is freed, and its parent is freed after all its children;
+//the widgets allocated from the given arena, if there is one, are left to it
+static void _destroy(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ARENA *arena) {
+    ALGUI_WIDGET *top = wgt, *next;
+    
+    for(wgt = _get_highest_descendant(top); wgt != top; wgt = next) {
+        next = algui_get_lower_sibling_widget(wgt);
+        next = next ? _get_highest_descendant(next) : algui_get_parent_widget(wgt);
+        _free_widget(wgt, arena);
     }
-    algui_cleanup_widget(wgt);
-    al_free(wgt);
+    
+    _free_widget(top, arena);
 }
 
 
@@ -212,7 +1824,8 @@ static void _destroy(ALGUI_WIDGET *wgt) {
 static int _remove_focus(ALGUI_WIDGET *wgt) {
     ALGUI_LOSE_FOCUS_MESSAGE lose_focus_msg;
     ALGUI_LOST_FOCUS_MESSAGE lost_focus_msg;
-    
+    ALGUI_WIDGET_ROOT *state;
+
     //ask widget if it accepts losing the focus
     lose_focus_msg.message.id = ALGUI_MSG_LOSE_FOCUS;
     lose_focus_msg.ok = 0;
@@ -221,6 +1834,8 @@ static int _remove_focus(ALGUI_WIDGET *wgt) {
 
     //notify the widget that it has lost the input focus
     wgt->focus = 0;
+    state = _find_root_state(wgt);
+    if (state && state->focus == wgt) state->focus = NULL;
     lost_focus_msg.message.id = ALGUI_MSG_LOST_FOCUS;
     algui_send_message(wgt, &lost_focus_msg.message);
     
@@ -235,56 +1850,231 @@ static int _send_message_to_enabled(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
 }
     
     
-//dispatches a message to a widget tree
+//checks if a broadcast message with the given bit must reach a widget or its descendants
+static int _is_tree_broadcast_target(ALGUI_WIDGET *wgt, ALGUI_MESSAGE_MASK bit) {
+    return !bit || (bit & wgt->tree_message_mask);
+}
+
+
+//sends a broadcast message with the given bit to a widget, if the widget proc handles the message
+static int _send_broadcast_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, ALGUI_MESSAGE_MASK bit) {
+    return !bit || (bit & wgt->message_mask) ? algui_send_message(wgt, msg) : 0;
+}
+
+
+//dispatches a message to a widget tree, parents first; the children of disabled widgets are disabled too;
+//subtrees that do not handle the message are skipped
 static int _broadcast_message_to_enabled(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
-    ALGUI_WIDGET *child;
+    ALGUI_MESSAGE_MASK bit = ALGUI_MESSAGE_BIT(msg->id);
+    ALGUI_TRAVERSAL trv;
+    int descend, r = 0;
+    
+    for(wgt = _begin_traversal(&trv, wgt, 0); wgt; wgt = _next_traversal(&trv, descend)) {
+        descend = wgt->enabled_tree && _is_tree_broadcast_target(wgt, bit);
+        if (descend && _send_broadcast_message(wgt, msg, bit)) {
+            r = 1;
+            break;
+        }
+    }
+    
+    _end_traversal(&trv);
+    return r;
+}
+
+
+//returns the widget with the current capture
+static ALGUI_WIDGET *_get_capture_widget(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    int i;
+    
+    state = _find_root_state(wgt);
+    if (!state) return wgt;
+    
+    //the topmost capture inside the given tree; normally, it is the top of the stack
+    for(i = state->capture_count - 1; i >= 0; --i) {
+        if (_is_in_tree(wgt, state->captures[i])) return state->captures[i];
+    }
+    
+    return wgt;
+} 
+
+
+//stores the path to the widget found by a hit test and calculates the screen area
+//in which a new hit test from the same widget is certain to find the same widget
+static void _cache_hover_path(ALGUI_WIDGET_ROOT *state, ALGUI_WIDGET *from, ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET *node, *sibling, *child;
+    ALGUI_RECT rect;
+    int length, i;
+    
+    //store the path from the root to the widget
+    for(length = 0, node = wgt; node; node = algui_get_parent_widget(node)) ++length;
+    if (length > state->hover_path_size) {
+        al_free(state->hover_path);
+        state->hover_path = (ALGUI_WIDGET **)al_malloc(length * sizeof(ALGUI_WIDGET *));
+        assert(state->hover_path);
+        state->hover_path_size = length;
+    }
+    for(i = length - 1, node = wgt; node; node = algui_get_parent_widget(node), --i) state->hover_path[i] = node;
+    state->hover_path_length = length;
+    state->hover_from = from;
+    state->hover_generation = _tree_generation;
+    state->hover_valid = 0;
+    
+    //the area is the part of the widget that is inside all its ancestors up to the widget the test started from;
+    //once the screen rect of the widget is up to date, so are the ones of its ancestors
+    rect = *_get_screen_rect(wgt);
+    for(i = length - 1; state->hover_path[i] != from; --i) {
+        algui_get_rect_intersection(&rect, &state->hover_path[i - 1]->screen_rect, &rect);
+    }
+    if (!algui_is_rect_normalized(&rect)) return;
     
-    //try the widget
-    if (_send_message_to_enabled(wgt, msg)) return 1;
+    //no higher sibling on the path may overlap the area
+    for(i = length - 1; state->hover_path[i] != from; --i) {
+        for(sibling = algui_get_higher_sibling_widget(state->hover_path[i]); sibling; sibling = algui_get_higher_sibling_widget(sibling)) {
+            if (sibling->visible_tree && algui_rect_intersects_rect(_get_child_screen_rect(sibling), &rect)) return;
+        }
+    }
     
-    //try the children
+    //no child of the widget may overlap the area
     for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        if (_broadcast_message_to_enabled(child, msg)) return 1;
+        if (child->visible_tree && algui_rect_intersects_rect(_get_child_screen_rect(child), &rect)) return;
     }
     
-    //message not processed
-    return 0;
+    state->hover_rect = rect;
+    state->hover_valid = 1;
 }
 
 
-//helper function
-static void _get_capture_widget_helper(ALGUI_WIDGET *wgt, ALGUI_WIDGET **result) {
-    ALGUI_WIDGET *child;
+//checks if a widget is visible and the given point, relative to the widget, lies within the widget's rect
+static int _contains_point(ALGUI_WIDGET *wgt, int x, int y) {
+    return 
+        wgt->visible_tree && 
+        x >= 0 && 
+        x < algui_get_widget_width(wgt) && 
+        y >= 0 && 
+        y < algui_get_widget_height(wgt);
+}
+
+
+//returns the widget that is under the given point, relative to the given widget;
+//the widgets being searched are kept in a stack, each with the children not searched yet
+static ALGUI_WIDGET *_get_widget_from_point(ALGUI_WIDGET *wgt, int x, int y) {
+    ALGUI_HIT_TEST_FRAME *frames = NULL, *frame;
+    ALGUI_WIDGET *child, *result = NULL;
+    ALGUI_HIT_TEST_MESSAGE msg;
+    int depth = 0, size = 0;
+
+    assert(wgt);
     
-    //set the result from this widget
-    if (wgt->capture > (*result)->capture) {
-        *result = wgt;
+    //if the widget is not visible, or if the coordinates lie beyond the widget's rect, then do nothing
+    if (!_contains_point(wgt, x, y)) return NULL;
+    
+    for(child = wgt; ; ) {
+        //search a widget that contains the point
+        if (child) {
+            if (depth == size) {
+                size = size ? size * 2 : 64;
+                frames = (ALGUI_HIT_TEST_FRAME *)al_realloc(frames, size * sizeof(ALGUI_HIT_TEST_FRAME));
+                assert(frames);
+            }
+            frame = &frames[depth++];
+            frame->wgt = child;
+            frame->x = x;
+            frame->y = y;
+            
+            //search the children, from higher to lower; with a spatial index, only the children in the cell of the point
+            frame->items = NULL;
+            frame->count = 0;
+            frame->child = NULL;
+            if (child->grid) frame->items = algui_get_grid_items(child->grid, x, y, &frame->count);
+            else frame->child = algui_get_highest_child_widget(child);
+        }
+        
+        //pick the next child of the innermost widget that contains the point
+        frame = &frames[depth - 1];
+        if (frame->count) {
+            child = (ALGUI_WIDGET *)frame->items[--frame->count];
+        }
+        else if (frame->child) {
+            child = frame->child;
+            frame->child = algui_get_lower_sibling_widget(child);
+        }
+        else {
+            child = NULL;
+        }
+        
+        if (child) {
+            x = frame->x - child->rect.left;
+            y = frame->y - child->rect.top;
+            if (!_contains_point(child, x, y)) child = NULL;
+            continue;
+        }
+        
+        //no child has the point; ask the widget
+        msg.message.id = ALGUI_MSG_HIT_TEST;
+        msg.x = frame->x;
+        msg.y = frame->y;
+        msg.ok = 0;
+        algui_send_message(frame->wgt, &msg.message);
+        if (msg.ok) {
+            result = frame->wgt;
+            break;
+        }
+        
+        //resume the search in the parent
+        if (!--depth) break;
     }
     
-    //find the capture amongst children
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        _get_capture_widget_helper(child, result);        
+    al_free(frames);
+    return result;
+}
+
+
+//returns the widget under the given screen point, searching from the given widget;
+//if the point is still in the area of the last hit test, only the widget found last time is tested
+static ALGUI_WIDGET *_get_widget_from_screen_point(ALGUI_WIDGET *from, int x, int y) {
+    ALGUI_WIDGET_ROOT *state;
+    ALGUI_WIDGET *result;
+    ALGUI_HIT_TEST_MESSAGE msg;
+    
+    state = _get_root_state(from);
+    ++state->hit_test_count;
+    
+    //try the cached widget
+    if (state->hover_valid && 
+        state->hover_from == from && 
+        state->hover_generation == _tree_generation && 
+        algui_rect_intersects_point(&state->hover_rect, x, y))
+    {
+        result = state->hover_path[state->hover_path_length - 1];
+        msg.message.id = ALGUI_MSG_HIT_TEST;
+        msg.x = x - _get_screen_rect(result)->left;
+        msg.y = y - _get_screen_rect(result)->top;
+        msg.ok = 0;
+        algui_send_message(result, &msg.message);
+        if (msg.ok) {
+            ++state->skipped_hit_test_count;
+            return result;
+        }
     }
-} 
- 
- 
-//returns the widget with the current capture
-static ALGUI_WIDGET *_get_capture_widget(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *result = wgt;
-    _get_capture_widget_helper(wgt, &result);
+    
+    //full hit test
+    result = _get_widget_from_point(from, x - _get_screen_rect(from)->left, y - _get_screen_rect(from)->top);
+    if (result) _cache_hover_path(state, from, result); else state->hover_valid = 0;
     return result;
-} 
+}
 
 
-//returns the widget that has the mouse
-static ALGUI_WIDGET *_get_mouse_widget(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *child, *result;
-    if (wgt->mouse) return wgt;
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        result = _get_mouse_widget(child);
-        if (result) return result;
+//sets the widget that has the mouse
+static void _set_mouse_widget(ALGUI_WIDGET *old_mouse, ALGUI_WIDGET *new_mouse) {
+    if (old_mouse) {
+        old_mouse->mouse = 0;
+        _get_root_state(old_mouse)->mouse = NULL;
+    }
+    if (new_mouse) {
+        new_mouse->mouse = 1;
+        _get_root_state(new_mouse)->mouse = new_mouse;
     }
-    return 0;
 }
 
 
@@ -306,28 +2096,11 @@ static void _set_mouse_message(ALGUI_WIDGET *wgt, ALGUI_MOUSE_MESSAGE *msg, int
     msg->z = ev->mouse.z;
     msg->w = ev->mouse.w;
     msg->button = ev->mouse.button;
-    msg->x = ev->mouse.x - wgt->screen_rect.left;
-    msg->y = ev->mouse.y - wgt->screen_rect.top;
+    msg->x = ev->mouse.x - _get_screen_rect(wgt)->left;
+    msg->y = ev->mouse.y - _get_screen_rect(wgt)->top;
 }
 
 
-//returns the widget with the data source
-static ALGUI_WIDGET *_get_data_source(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *child, *result;
-    
-    //check widget
-    if (wgt->data_source) return wgt;
-    
-    //check children
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        result = _get_data_source(child);
-        if (result) return result;
-    }
-    
-    return NULL;
-}
- 
- 
 //sets a drag message structure from an event
 static void _set_drag_message(ALGUI_WIDGET *wgt, ALGUI_DRAG_AND_DROP_MOUSE_MESSAGE *msg, int id, ALLEGRO_EVENT *ev, ALGUI_WIDGET *source) {
     msg->message.id = id;
@@ -335,29 +2108,146 @@ static void _set_drag_message(ALGUI_WIDGET *wgt, ALGUI_DRAG_AND_DROP_MOUSE_MESSA
     msg->z = ev->mouse.z;
     msg->w = ev->mouse.w;
     msg->button = ev->mouse.button;
-    msg->x = ev->mouse.x - wgt->screen_rect.left;
-    msg->y = ev->mouse.y - wgt->screen_rect.top;
+    msg->x = ev->mouse.x - _get_screen_rect(wgt)->left;
+    msg->y = ev->mouse.y - _get_screen_rect(wgt)->top;
     msg->source = source;
 }
 
 
-//locates the node of a timer
-static ALGUI_LIST_NODE *_find_timer(ALGUI_LIST *timers, ALLEGRO_TIMER *timer) {
-    ALGUI_LIST_NODE *node;    
-    for(node = algui_get_first_list_node(timers); node; node = algui_get_next_list_node(node)) {
-        if (node->data == timer) return node;
+//locates the widget timer of an allegro timer
+static ALGUI_WIDGET_TIMER *_find_timer(ALLEGRO_TIMER *timer) {
+    return (ALGUI_WIDGET_TIMER *)algui_get_map_value(&_timers, timer);
+}
+
+
+//returns a widget timer record from the free list, or a new one if the list is empty
+static ALGUI_WIDGET_TIMER *_allocate_timer() {
+    ALGUI_LIST_NODE *node = algui_get_first_list_node(&_free_timers);
+    ALGUI_WIDGET_TIMER *wgt_timer;
+    if (node) {
+        algui_remove_list_node(&_free_timers, node);
+        return (ALGUI_WIDGET_TIMER *)algui_get_list_node_data(node);
+    }
+    wgt_timer = (ALGUI_WIDGET_TIMER *)al_malloc(sizeof(ALGUI_WIDGET_TIMER));
+    assert(wgt_timer);
+    ++_timer_allocation_count;
+    return wgt_timer;
+}
+
+
+//removes the deferred events of an allegro timer from the tree state of its widget;
+//they must not reach a timer created later at the same address
+static void _remove_deferred_timer_events(ALGUI_WIDGET *wgt, ALLEGRO_TIMER *timer) {
+    ALGUI_WIDGET_ROOT *state = _find_root_state(wgt);
+    int i, count;
+    
+    if (!state) return;
+    
+    for(i = count = state->deferred_timer_event_first; i < state->deferred_timer_event_count; ++i) {
+        if (state->deferred_timer_events[i].timer.source == timer) continue;
+        state->deferred_timer_events[count++] = state->deferred_timer_events[i];
+    }
+    state->deferred_timer_event_count = count;
+    if (state->deferred_timer_event_first == count) {
+        state->deferred_timer_event_first = 0;
+        state->deferred_timer_event_count = 0;
     }
-    return NULL;
 }
 
 
-//removes a timer node from a timer list, stops and destroys the timer,
-//and then free the node
-static void _destroy_timer(ALGUI_LIST *timers, ALGUI_LIST_NODE *node) {
-    ALLEGRO_TIMER *timer = (ALLEGRO_TIMER *)algui_get_list_node_data(node);
+//removes a widget timer from its widget's timer list, stops and destroys the allegro timer,
+//and then puts the widget timer in the free list; its deferred events are dropped
+static void _destroy_timer(ALGUI_WIDGET_TIMER *wgt_timer) {
+    ALLEGRO_TIMER *timer = (ALLEGRO_TIMER *)algui_get_list_node_data(&wgt_timer->node);
+    _remove_deferred_timer_events(wgt_timer->widget, timer);
+    algui_remove_map_value(&_timers, timer);
     al_destroy_timer(timer);
-    algui_remove_list_node(timers, node);
-    al_free(node);
+    algui_remove_list_node(&wgt_timer->widget->timers, &wgt_timer->node);
+    algui_init_list_node(&wgt_timer->node, wgt_timer);
+    algui_append_list_node(&_free_timers, &wgt_timer->node);
+}
+
+
+//delivers an expired wheel timer to its widget
+static void _expire_wheel_timer(ALGUI_TIMER_WHEEL_ENTRY *entry, void *context) {
+    ALGUI_TIMER *timer = (ALGUI_TIMER *)algui_get_list_node_data(&entry->node);
+    ALGUI_TIMER_MESSAGE msg;
+    
+    //the timers of hidden widgets are paused until the widgets are shown
+    if (!timer->widget->visible_tree) {
+        timer->paused = 1;
+        algui_append_list_node(&_paused_timers, &timer->entry.node);
+        return;
+    }
+    
+    //periodic timers are scheduled again before the message, so as that the widget can destroy them;
+    //the next deadline is counted from the previous one, so as that the tolerance does not add up,
+    //but the periods that were missed are skipped
+    if (!timer->one_shot) {
+        timer->deadline += timer->period;
+        if (timer->deadline <= algui_get_timer_wheel_time(&_wheel)) timer->deadline = algui_get_timer_wheel_time(&_wheel) + timer->period;
+        algui_schedule_timer_wheel_entry(&_wheel, &timer->entry, timer->deadline, timer->tolerance);
+    }
+    
+    //prepare the message
+    msg.message.id = ALGUI_MSG_TIMER;
+    msg.event = (ALLEGRO_EVENT *)context;
+    msg.timer = _wheel_tick_timer;
+    msg.wheel_timer = timer;
+    
+    //send the message
+    _send_message_to_enabled(timer->widget, &msg.message);
+}
+
+
+//schedules again the paused wheel timers of widgets that have become visible
+static void _resume_wheel_timers() {
+    ALGUI_LIST_NODE *node, *next;
+    ALGUI_TIMER *timer;
+    
+    //during an update, the timers are resumed at the end of the update
+    if (_update_depth) {
+        _timers_pending = 1;
+        return;
+    }
+    
+    for(node = algui_get_first_list_node(&_paused_timers); node; node = next) {
+        next = algui_get_next_list_node(node);
+        timer = (ALGUI_TIMER *)algui_get_list_node_data(node);
+        if (!timer->widget->visible_tree) continue;
+        algui_remove_list_node(&_paused_timers, node);
+        timer->paused = 0;
+        timer->deadline = algui_get_timer_wheel_time(&_wheel) + timer->period;
+        algui_schedule_timer_wheel_entry(&_wheel, &timer->entry, timer->deadline, timer->tolerance);
+    }
+}
+
+
+//returns a wheel timer record from the free list, or a new one if the list is empty
+static ALGUI_TIMER *_allocate_wheel_timer() {
+    ALGUI_LIST_NODE *node = algui_get_first_list_node(&_free_wheel_timers);
+    ALGUI_TIMER *timer;
+    if (node) {
+        algui_remove_list_node(&_free_wheel_timers, node);
+        return (ALGUI_TIMER *)algui_get_list_node_data(node);
+    }
+    timer = (ALGUI_TIMER *)al_malloc(sizeof(ALGUI_TIMER));
+    assert(timer);
+    ++_timer_allocation_count;
+    return timer;
+}
+
+
+//cancels a wheel timer and puts it in the free list
+static void _destroy_wheel_timer(ALGUI_TIMER *timer) {
+    if (timer->paused) {
+        algui_remove_list_node(&_paused_timers, &timer->entry.node);
+    }
+    else {
+        algui_cancel_timer_wheel_entry(&_wheel, &timer->entry);
+    }
+    algui_remove_list_node(&timer->widget->wheel_timers, &timer->node);
+    algui_append_list_node(&_free_wheel_timers, &timer->node);
 }
 
 
@@ -387,18 +2277,90 @@ static int _manage_focus_via_keyboard(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
 }
 
 
-//returns the child widget with a lower tab order than the given one
-static ALGUI_WIDGET *_get_lower_tab_child(ALGUI_WIDGET *wgt, ALGUI_WIDGET *tab_child) {
-    ALGUI_WIDGET *result = NULL, *child;    
-    int min_tab_order = INT_MIN;
-    int max_tab_order = tab_child ? tab_child->tab_order : INT_MAX;
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        if (child->tab_order < max_tab_order && child->tab_order > min_tab_order) {            
-            result = child;
-            min_tab_order = child->tab_order;
-        }
+//compares the tab orders of two widgets for qsort; widgets with the same tab order are compared by z-key
+static int _compare_tab_keys(const void *a, const void *b) {
+    const ALGUI_WIDGET *wgt1 = *(ALGUI_WIDGET * const *)a, *wgt2 = *(ALGUI_WIDGET * const *)b;
+    if (wgt1->tab_order != wgt2->tab_order) return wgt1->tab_order < wgt2->tab_order ? -1 : 1;
+    return wgt1->z_key < wgt2->z_key ? -1 : wgt1->z_key > wgt2->z_key;
+}
+
+
+//returns the position of the first child in the tab index of a widget whose tab order and z-key 
+//are not lower than the given ones
+static int _find_tab_index_position(ALGUI_WIDGET_ARRAY *index, int tab_order, int z_key) {
+    int lo = 0, hi = index->length, mid;
+    ALGUI_WIDGET *child;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        child = index->widgets[mid];
+        if (child->tab_order < tab_order || (child->tab_order == tab_order && child->z_key < z_key)) lo = mid + 1; else hi = mid;
     }
-    return result;
+    return lo;
+}
+
+
+//returns the tab index of a widget: its children sorted by tab order, and then by z-order;
+//it is created on demand, and then kept up to date, until the children are spliced
+static ALGUI_WIDGET_ARRAY *_get_tab_index(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ARRAY *index;
+    ALGUI_WIDGET *child;
+    
+    if (wgt->tab_index) return wgt->tab_index;
+    
+    index = (ALGUI_WIDGET_ARRAY *)al_malloc(sizeof(ALGUI_WIDGET_ARRAY));
+    assert(index);
+    index->widgets = NULL;
+    index->length = 0;
+    index->size = 0;
+    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+        _add_widget_to_array(index, child);
+    }
+    if (index->length > 1) qsort(index->widgets, index->length, sizeof(ALGUI_WIDGET *), _compare_tab_keys);
+    
+    wgt->tab_index = index;
+    return index;
+}
+
+
+//destroys the tab index of a widget, if it has one
+static void _destroy_tab_index(ALGUI_WIDGET *wgt) {
+    if (!wgt->tab_index) return;
+    al_free(wgt->tab_index->widgets);
+    al_free(wgt->tab_index);
+    wgt->tab_index = NULL;
+}
+
+
+//inserts a child in the tab index of a widget, if the widget has one
+static void _insert_tab_index_child(ALGUI_WIDGET *wgt, ALGUI_WIDGET *child) {
+    ALGUI_WIDGET_ARRAY *index = wgt->tab_index;
+    int i;
+    if (!index) return;
+    i = _find_tab_index_position(index, child->tab_order, child->z_key);
+    _add_widget_to_array(index, child);
+    memmove(index->widgets + i + 1, index->widgets + i, (index->length - i - 1) * sizeof(ALGUI_WIDGET *));
+    index->widgets[i] = child;
+}
+
+
+//removes a child from the tab index of a widget, if the widget has one
+static void _remove_tab_index_child(ALGUI_WIDGET *wgt, ALGUI_WIDGET *child) {
+    ALGUI_WIDGET_ARRAY *index = wgt->tab_index;
+    int i;
+    if (!index) return;
+    i = _find_tab_index_position(index, child->tab_order, child->z_key);
+    assert(i < index->length && index->widgets[i] == child);
+    memmove(index->widgets + i, index->widgets + i + 1, (index->length - i - 1) * sizeof(ALGUI_WIDGET *));
+    --index->length;
+}
+
+
+//returns the child widget with a lower tab order than the given one;
+//of the children with the same tab order, the highest one in z-order is returned
+static ALGUI_WIDGET *_get_lower_tab_child(ALGUI_WIDGET *wgt, ALGUI_WIDGET *tab_child) {
+    ALGUI_WIDGET_ARRAY *index = _get_tab_index(wgt);
+    int i = _find_tab_index_position(index, tab_child ? tab_child->tab_order : INT_MAX, INT_MIN);
+    return i ? index->widgets[i - 1] : NULL;
 }
 
 
@@ -413,18 +2375,15 @@ static int _move_focus_backward_in_children(ALGUI_WIDGET *wgt, ALGUI_WIDGET *foc
 }
 
 
-//returns the child widget with a higher tab order than the given one
+//returns the child widget with a higher tab order than the given one, or the first child with a non-negative tab order;
+//of the children with the same tab order, the lowest one in z-order is returned;
+//like when moving back, children with the tab order INT_MAX are not returned, and so there is none higher than them
 static ALGUI_WIDGET *_get_higher_tab_child(ALGUI_WIDGET *wgt, ALGUI_WIDGET *tab_child) {
-    ALGUI_WIDGET *result = NULL, *child;    
-    int max_tab_order = INT_MAX;
-    int min_tab_order = tab_child ? tab_child->tab_order : -1;
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        if (child->tab_order > min_tab_order && child->tab_order < max_tab_order) {            
-            result = child;
-            max_tab_order = child->tab_order;
-        }
-    }
-    return result;
+    ALGUI_WIDGET_ARRAY *index = _get_tab_index(wgt);
+    int i;
+    if (tab_child && tab_child->tab_order == INT_MAX) return NULL;
+    i = _find_tab_index_position(index, tab_child ? tab_child->tab_order + 1 : 0, INT_MIN);
+    return i < index->length && index->widgets[i]->tab_order < INT_MAX ? index->widgets[i] : NULL;
 }
 
 
@@ -439,6 +2398,143 @@ static int _move_focus_forward_in_children(ALGUI_WIDGET *wgt, ALGUI_WIDGET *focu
 }
 
 
+//returns the posted message at the given position of the ring buffer
+static ALGUI_POSTED_MESSAGE *_get_posted_message(uint64_t pos) {
+    return (ALGUI_POSTED_MESSAGE *)(_posted_messages + (pos & (_posted_messages_size - 1)));
+}
+
+
+//doubles the size of the ring buffer until the given number of bytes fits in it;
+//the messages keep their positions, since the old size divides the new one
+static void _grow_posted_messages(uint64_t size) {
+    uint64_t new_size = _posted_messages_size ? _posted_messages_size : _POSTED_MESSAGE_BUFFER_SIZE;
+    char *buffer;
+    uint64_t pos;
+    ALGUI_POSTED_MESSAGE *entry;
+    
+    while (new_size < size) new_size *= 2;
+    if (new_size == _posted_messages_size) new_size *= 2;
+    
+    buffer = (char *)al_malloc((size_t)new_size);
+    assert(buffer);
+    for(pos = _posted_head; pos < _posted_tail; pos += entry->size) {
+        entry = _get_posted_message(pos);
+        memcpy(buffer + (pos & (new_size - 1)), entry, entry->size);
+    }
+    al_free(_posted_messages);
+    _posted_messages = buffer;
+    _posted_messages_size = new_size;
+}
+
+
+//appends a message for a widget to the ring buffer; a message that does not fit before the end of the buffer
+//is placed at the start, after padding
+static void _push_posted_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size) {
+    uint64_t entry_size = (sizeof(ALGUI_POSTED_MESSAGE) + size + _POSTED_MESSAGE_ALIGNMENT - 1) & ~(uint64_t)(_POSTED_MESSAGE_ALIGNMENT - 1);
+    uint64_t padding;
+    ALGUI_POSTED_MESSAGE *entry;
+    
+    for(;;) {
+        padding = _posted_messages_size ? (_posted_messages_size - (_posted_tail & (_posted_messages_size - 1))) & (_posted_messages_size - 1) : 0;
+        if (padding >= entry_size) padding = 0;
+        if (_posted_messages_size && _posted_tail - _posted_head + padding + entry_size <= _posted_messages_size) break;
+        _grow_posted_messages(_posted_tail - _posted_head + entry_size);
+    }
+    
+    if (padding) {
+        entry = _get_posted_message(_posted_tail);
+        entry->widget = NULL;
+        entry->size = (uint32_t)padding;
+        _posted_tail += padding;
+    }
+    
+    entry = _get_posted_message(_posted_tail);
+    entry->widget = wgt;
+    entry->size = (uint32_t)entry_size;
+    entry->message_size = (uint32_t)size;
+    memcpy(entry + 1, msg, size);
+    
+    //link the message to the messages of the widget
+    if (wgt->posted_count) _get_posted_message(wgt->posted_last)->next = _posted_tail; else wgt->posted_first = _posted_tail;
+    wgt->posted_last = _posted_tail;
+    ++wgt->posted_count;
+    ++_posted_message_count;
+    _posted_tail += entry_size;
+}
+
+
+//removes the messages without widget from the start of the ring buffer
+static void _pop_posted_messages() {
+    while (_posted_head < _posted_tail && !_get_posted_message(_posted_head)->widget) {
+        _posted_head += _get_posted_message(_posted_head)->size;
+    }
+}
+
+
+//unlinks a posted message from the messages of its widget and drops it; it need not be the oldest message of the widget
+static void _unlink_posted_message(uint64_t pos) {
+    ALGUI_POSTED_MESSAGE *entry = _get_posted_message(pos), *prev = NULL;
+    ALGUI_WIDGET *wgt = entry->widget;
+    uint64_t cur, prev_pos = 0;
+    
+    for(cur = wgt->posted_first; cur != pos; cur = prev->next) {
+        prev = _get_posted_message(cur);
+        prev_pos = cur;
+    }
+    if (prev) prev->next = entry->next; else wgt->posted_first = entry->next;
+    if (wgt->posted_last == pos) wgt->posted_last = prev_pos;
+    --wgt->posted_count;
+    --_posted_message_count;
+    entry->widget = NULL;
+    _pop_posted_messages();
+}
+
+
+//drops the posted messages of a widget; they stay in the ring buffer without widget until they reach its start
+static void _drop_posted_messages(ALGUI_WIDGET *wgt) {
+    ALGUI_POSTED_MESSAGE *entry;
+    uint64_t pos = wgt->posted_first;
+    
+    //the buffer is freed by algui_cleanup
+    if (!_posted_messages) {
+        wgt->posted_count = 0;
+        return;
+    }
+    
+    for(; wgt->posted_count; --wgt->posted_count, --_posted_message_count) {
+        entry = _get_posted_message(pos);
+        entry->widget = NULL;
+        pos = entry->next;
+    }
+    _pop_posted_messages();
+}
+
+
+//replaces a message of a widget that waits in the ring buffer with the given message, if they have the same id;
+//a waiting message of another size is dropped instead; returns non-zero if the message was replaced
+static int _coalesce_posted_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size) {
+    ALGUI_POSTED_MESSAGE *entry;
+    uint64_t pos = wgt->posted_first;
+    unsigned long i;
+    
+    for(i = 0; i < wgt->posted_count; ++i, pos = entry->next) {
+        entry = _get_posted_message(pos);
+        if (((ALGUI_MESSAGE *)(entry + 1))->id != msg->id) continue;
+        
+        if (entry->message_size == size) {
+            memcpy(entry + 1, msg, size);
+            ++_coalesced_message_count;
+            return 1;
+        }
+        
+        _unlink_posted_message(pos);
+        return 0;
+    }
+    
+    return 0;
+}
+
+
 /******************************************************************************
     INTERNAL MESSAGE HANDLERS
  ******************************************************************************/
@@ -446,7 +2542,30 @@ static int _move_focus_forward_in_children(ALGUI_WIDGET *wgt, ALGUI_WIDGET *focu
 
 //cleanup widget
 static int _msg_cleanup(ALGUI_WIDGET *wgt, ALGUI_CLEANUP_MESSAGE *msg) {
+    ALGUI_WIDGET_ROOT *state;
     algui_destroy_widget_timers(wgt);
+    algui_destroy_widget_wheel_timers(wgt);
+    if (wgt->capture) algui_release_events(wgt);
+    if (wgt->focus) {
+        state = _find_root_state(wgt);
+        if (state && state->focus == wgt) state->focus = NULL;
+    }
+    if (wgt->mouse) {
+        state = _find_root_state(wgt);
+        if (state && state->mouse == wgt) state->mouse = NULL;
+    }
+    if (wgt->data_source) {
+        state = _find_root_state(wgt);
+        if (state && state->drag_source == wgt) state->drag_source = NULL;
+    }
+    if (wgt->root_state) _destroy_root_state(wgt);
+    if (wgt->posted_count) _drop_posted_messages(wgt);
+    _unqueue_layout(wgt);
+    if (wgt->flags_queued) _remove_widget_from_array(&_flags_queue, wgt);
+    if (wgt->index_queued) _remove_widget_from_array(&_index_queue, wgt);
+    _destroy_spatial_index(wgt);
+    _destroy_tab_index(wgt);
+    algui_set_widget_cacheable(wgt, 0);
     return 1;
 } 
 
@@ -459,10 +2578,19 @@ static int _msg_insert_widget(ALGUI_WIDGET *wgt, ALGUI_INSERT_WIDGET_MESSAGE *ms
     msg->ok = algui_insert_tree(&wgt->tree, &msg->child->tree, msg->next ? &msg->next->tree : NULL);
     if (msg->ok) {
         msg->child->tab_order = algui_get_tree_child_count(&wgt->tree);
-        _update_flags(msg->child, wgt->drawn);
+        msg->child->screen_generation = 0;
+        ++_structure_generation;
+        _set_z_keys(msg->child, msg->child, 1);
+        _insert_tab_index_child(wgt, msg->child);
+        if (wgt->grid) algui_insert_grid_item(wgt->grid, &msg->child->rect, msg->child);
+        _update_spatial_index(wgt);
+        _update_tree_flags(msg->child, wgt->drawn);
+        _add_tree_message_mask(wgt, msg->child->tree_message_mask);
+        _merge_root_state(msg->child);
+        _resume_wheel_timers();
         if (wgt->drawn) {
-            _init_layout(msg->child);
-            _update_layout(wgt);
+            _invalidate_measure_tree(msg->child);
+            _invalidate_measure(wgt);
         }
     }        
     return 1;
@@ -476,22 +2604,107 @@ static int _msg_remove_widget(ALGUI_WIDGET *wgt, ALGUI_REMOVE_WIDGET_MESSAGE *ms
     assert(msg->child);
     msg->ok = algui_remove_tree(&wgt->tree, &msg->child->tree);
     if (msg->ok) {
+        _remove_tab_index_child(wgt, msg->child);
+        msg->child->screen_generation = 0;
+        ++_structure_generation;
+        if (wgt->grid) algui_remove_grid_item(wgt->grid, &msg->child->rect, msg->child);
+        _update_spatial_index(wgt);
+        _split_root_state(wgt, msg->child);
         _update_flags(msg->child, 0);
         if (wgt->drawn) {
-            _update_layout(wgt);
+            _invalidate_measure(wgt);
         }
     }        
     return 1;
 } 
 
 
+//splice widgets
+static int _msg_splice_widgets(ALGUI_WIDGET *wgt, ALGUI_SPLICE_WIDGETS_MESSAGE *msg) {
+    ALGUI_WIDGET *src, *child;
+    unsigned long count, child_count;
+    int other_tree, src_drawn, i;
+    
+    assert(wgt);
+    assert(msg);
+    assert(msg->first);
+    assert(msg->last);
+    
+    msg->ok = 0;
+    src = algui_get_parent_widget(msg->first);
+    if (!src) return 1;
+    other_tree = algui_get_root_widget(src) != algui_get_root_widget(wgt);
+    src_drawn = src->drawn;
+    child_count = algui_get_widget_child_count(wgt);
+    
+    count = algui_splice_tree(&wgt->tree, msg->next ? &msg->next->tree : NULL, &msg->first->tree, &msg->last->tree);
+    if (!count) return 1;
+    msg->ok = 1;
+    
+    //the widgets leave the index and the tree state of their old parent; their z-keys are still the old ones
+    for(child = msg->first; ; child = algui_get_higher_sibling_widget(child)) {
+        if (src->grid) algui_remove_grid_item(src->grid, &child->rect, child);
+        if (other_tree) _split_root_state(src, child);
+        if (child == msg->last) break;
+    }
+    
+    ++_structure_generation;
+    _set_z_keys(msg->first, msg->last, count);
+    
+    //the tab indexes are created again when they are used next, since the z-order of the children changed
+    _destroy_tab_index(src);
+    _destroy_tab_index(wgt);
+    
+    for(child = msg->first, i = 1; ; child = algui_get_higher_sibling_widget(child), ++i) {
+        if (wgt != src) {
+            child->tab_order = (int)child_count + i;
+            child->screen_generation = 0;
+            _update_tree_flags(child, wgt->drawn);
+        }
+        if (wgt->grid) algui_insert_grid_item(wgt->grid, &child->rect, child);
+        if (wgt != src) _add_tree_message_mask(wgt, child->tree_message_mask);
+        if (wgt->drawn && !src_drawn) _invalidate_measure_tree(child);
+        if (child == msg->last) break;
+    }
+    
+    ++_tree_generation;
+    if (wgt != src) _update_spatial_index(src);
+    _update_spatial_index(wgt);
+    _resume_wheel_timers();
+    if (src_drawn && wgt != src) _invalidate_measure(src);
+    if (wgt->drawn) _invalidate_measure(wgt);
+    return 1;
+}
+
+
 //set rect
 static int _msg_set_rect(ALGUI_WIDGET *wgt, ALGUI_SET_RECT_MESSAGE *msg) {
+    ALGUI_WIDGET *parent;
+    int update, resized;
     assert(wgt);
     assert(msg);
     if (algui_is_rect_equal_to_rect(&wgt->rect, &msg->rect)) return 1;
+    
+    //a widget changed outside of layout management must be drawn again at its old place
+    update = wgt->drawn && !_manages_layout(wgt);
+    if (update) _add_damage(wgt, _get_screen_rect(wgt));
+    resized = algui_get_rect_width(&wgt->rect) != algui_get_rect_width(&msg->rect) || 
+        algui_get_rect_height(&wgt->rect) != algui_get_rect_height(&msg->rect);
+    
+    parent = algui_get_parent_widget(wgt);
+    if (parent && parent->grid) algui_remove_grid_item(parent->grid, &wgt->rect, wgt);
     wgt->rect = msg->rect;
-    if (wgt->drawn && !_manages_layout(wgt)) _update_layout(wgt);
+    if (parent && parent->grid) algui_insert_grid_item(parent->grid, &wgt->rect, wgt);
+    _update_spatial_index(wgt);
+    ++_tree_generation;
+    
+    //the screen rect of the widget is calculated again when it is used next, and then the ones of its descendants
+    wgt->screen_generation = 0;
+    
+    //a widget that was only moved keeps its layout, since the rects of its children are relative to it
+    if (update) {
+        if (resized) _invalidate_measure(wgt); else _add_damage(wgt, _get_screen_rect(wgt));
+    }
     return 1;
 } 
 
@@ -515,14 +2728,16 @@ static int _msg_set_visible(ALGUI_WIDGET *wgt, ALGUI_SET_VISIBLE_MESSAGE *msg) {
     }
     
     wgt->visible = msg->visible;
-    _update_flags(wgt, wgt->drawn);
+    _update_tree_flags(wgt, wgt->drawn);
+    if (msg->visible) _resume_wheel_timers();
+    if (wgt->drawn) _add_damage(wgt, _get_screen_rect(wgt));
     
     msg->ok = 1;
     
     //if the widget has a parent, then update the layout of the parent
     if (wgt->drawn) {
         parent = algui_get_parent_widget(wgt);
-        if (parent) _update_layout(parent);
+        if (parent) _invalidate_measure(parent);
     }
     
     return 1;
@@ -548,7 +2763,8 @@ static int _msg_set_enabled(ALGUI_WIDGET *wgt, ALGUI_SET_ENABLED_MESSAGE *msg) {
     }
     
     wgt->enabled = msg->enabled;
-    _update_flags(wgt, wgt->drawn);
+    _update_tree_flags(wgt, wgt->drawn);
+    if (wgt->drawn) _add_damage(wgt, _get_screen_rect(wgt));
     msg->ok = 1;
     
     return 1;
@@ -593,6 +2809,21 @@ static int _msg_hit_test(ALGUI_WIDGET *wgt, ALGUI_HIT_TEST_MESSAGE *msg) {
 } 
 
 
+//set skin message
+static int _msg_set_skin(ALGUI_WIDGET *wgt, ALGUI_SET_SKIN_MESSAGE *msg) {
+    assert(wgt);
+    assert(msg);
+    
+    //the widget may look different
+    if (wgt->drawn) _add_damage(wgt, _get_screen_rect(wgt));
+    
+    //the skin can declare widgets opaque
+    algui_set_widget_opaque(wgt, algui_get_skin_int(msg->skin, algui_get_widget_id(wgt), "opaque", wgt->opaque));
+    
+    return 1;
+} 
+
+
 /******************************************************************************
     INTERNAL EVENT HANDLERS
  ******************************************************************************/
@@ -715,26 +2946,23 @@ static int _event_mouse_move(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
     
     //get the old widget under mouse (from the root, not from the capture,
     //because the old mouse may be outside of the capture tree)
-    old_mouse = _get_mouse_widget(wgt);
+    old_mouse = algui_get_mouse_widget(wgt);
     
     //get the new widget under mouse
-    new_mouse = algui_get_widget_from_point(
-        capture, 
-        ev->mouse.x - capture->screen_rect.left, 
-        ev->mouse.y - capture->screen_rect.top);
+    new_mouse = _get_widget_from_screen_point(capture, ev->mouse.x, ev->mouse.y);
     
     //if the mouse changed widgets
     if (new_mouse != old_mouse) {        
+        _set_mouse_widget(old_mouse, new_mouse);
+        
         //send a mouse leave to the old mouse
         if (old_mouse) {
-            old_mouse->mouse = 0;
             _set_mouse_message(old_mouse, &leave_msg, ALGUI_MSG_MOUSE_LEAVE, ev);
             processed |= _send_message_to_enabled(old_mouse, &leave_msg.message);
         }
         
         //send a mouse enter to the new nouse
         if (new_mouse) {
-            new_mouse->mouse = 1;
             _set_mouse_message(new_mouse, &enter_msg, ALGUI_MSG_MOUSE_ENTER, ev);
             processed |= _send_message_to_enabled(new_mouse, &enter_msg.message);        
         }
@@ -779,10 +3007,7 @@ static int _event_button_down(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
     capture = _get_capture_widget(wgt);    
     
     //dispatch the event to the widget under the mouse coordinates
-    mouse = algui_get_widget_from_point(
-        capture, 
-        ev->mouse.x - capture->screen_rect.left, 
-        ev->mouse.y - capture->screen_rect.top);
+    mouse = _get_widget_from_screen_point(capture, ev->mouse.x, ev->mouse.y);
         
     //if the event is outside of the capture, send it to the capture
     if (!mouse) mouse = capture;
@@ -824,10 +3049,7 @@ static int _event_button_up(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
     capture = _get_capture_widget(wgt);    
     
     //dispatch the event to the widget under the mouse coordinates
-    mouse = algui_get_widget_from_point(
-        capture, 
-        ev->mouse.x - capture->screen_rect.left, 
-        ev->mouse.y - capture->screen_rect.top);
+    mouse = _get_widget_from_screen_point(capture, ev->mouse.x, ev->mouse.y);
         
     //if the event is outside of the capture, send it to the capture
     if (!mouse) mouse = capture;
@@ -862,9 +3084,8 @@ static int _event_button_up(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
 //dispatches the relevant events
 static int _event_expose(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
     ALGUI_RECT rct;
-    wgt = algui_get_root_widget(wgt);
     algui_move_and_resize_rect(&rct, ev->display.x, ev->display.y, ev->display.width, ev->display.height);
-    algui_draw_widget_rect(wgt, &rct);
+    _add_damage(wgt, &rct);
     return 1;
 }
 
@@ -894,7 +3115,7 @@ static int _event_drag_key_down(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDG
     capture = _get_capture_widget(wgt);
     
     //dispatch event to the mouse widget 
-    mouse = _get_mouse_widget(capture);
+    mouse = algui_get_mouse_widget(capture);
     
     //if there is no mouse widget, dispatch it to the capture
     if (!mouse) mouse = capture;
@@ -919,7 +3140,7 @@ static int _event_drag_key_up(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDGET
     capture = _get_capture_widget(wgt);
     
     //dispatch event to the mouse widget 
-    mouse = _get_mouse_widget(capture);
+    mouse = algui_get_mouse_widget(capture);
     
     //if there is no mouse widget, dispatch it to the capture
     if (!mouse) mouse = capture;
@@ -944,7 +3165,7 @@ static int _event_drag_key_char(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDG
     capture = _get_capture_widget(wgt);
     
     //dispatch event to the mouse widget 
-    mouse = _get_mouse_widget(capture);
+    mouse = algui_get_mouse_widget(capture);
     
     //if there is no mouse widget, dispatch it to the capture
     if (!mouse) mouse = capture;
@@ -975,26 +3196,23 @@ static int _event_drag_move(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDGET *
     capture = _get_capture_widget(wgt);    
     
     //get the old widget under mouse
-    old_mouse = _get_mouse_widget(capture);
+    old_mouse = algui_get_mouse_widget(capture);
     
     //get the new widget under mouse
-    new_mouse = algui_get_widget_from_point(
-        capture, 
-        ev->mouse.x - capture->screen_rect.left, 
-        ev->mouse.y - capture->screen_rect.top);
+    new_mouse = _get_widget_from_screen_point(capture, ev->mouse.x, ev->mouse.y);
     
     //if the mouse changed widgets
     if (new_mouse != old_mouse) {        
+        _set_mouse_widget(old_mouse, new_mouse);
+        
         //send a mouse leave to the old mouse
         if (old_mouse) {
-            old_mouse->mouse = 0;
             _set_drag_message(old_mouse, &leave_msg, ALGUI_MSG_DRAG_LEAVE, ev, source);
             processed |= _send_message_to_enabled(old_mouse, &leave_msg.message);
         }
         
         //send a mouse enter to the new nouse
         if (new_mouse) {
-            new_mouse->mouse = 1;
             _set_drag_message(new_mouse, &enter_msg, ALGUI_MSG_DRAG_ENTER, ev, source);
             processed |= _send_message_to_enabled(new_mouse, &enter_msg.message);        
         }
@@ -1033,16 +3251,13 @@ static int _event_drag_wheel(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDGET
 static int _event_drop(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDGET *source) {
     ALGUI_LEFT_DROP_MESSAGE drop_msg;
     ALGUI_WIDGET *capture, *mouse;
-    int id, processed;
+    int id, processed = 0;
 
     //dispatch events to the current capture
     capture = _get_capture_widget(wgt);    
     
     //dispatch the event to the widget under the mouse coordinates
-    mouse = algui_get_widget_from_point(
-        capture, 
-        ev->mouse.x - capture->screen_rect.left, 
-        ev->mouse.y - capture->screen_rect.top);
+    mouse = _get_widget_from_screen_point(capture, ev->mouse.x, ev->mouse.y);
         
     //if the event is outside of the capture, send it to the capture
     if (!mouse) mouse = capture;
@@ -1081,34 +3296,32 @@ static int _event_drop(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALGUI_WIDGET *sourc
 
 //timer event
 static int  _event_timer(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
-    ALGUI_LIST_NODE *node;
+    ALGUI_WIDGET_TIMER *wgt_timer;
     ALGUI_TIMER_MESSAGE msg;
-    ALGUI_WIDGET *child;
     
-    //find the node that corresponds to the timer
-    node = _find_timer(&wgt->timers, ev->timer.source);
-    
-    //if found, dispatch the event to the widget
-    if (node) {
-        //prepare the message
-        msg.message.id = ALGUI_MSG_TIMER;
-        msg.event = ev;
-        msg.timer = ev->timer.source;
-        
-        //send the message
-        _send_message_to_enabled(wgt, &msg.message);
-        
-        //timer event processed
+    //the tick of the timer wheel; the wheel is advanced once, even if the event is dispatched to many trees
+    if (_wheel_tick_timer && ev->timer.source == _wheel_tick_timer) {
+        algui_advance_timer_wheel(&_wheel, _wheel_tick_base + ev->timer.count, _expire_wheel_timer, ev);
         return 1;
     }
     
-    //try the children
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        if (_event_timer(child, ev)) return 1;
-    }
+    //find the widget timer that corresponds to the timer
+    wgt_timer = _find_timer(ev->timer.source);
     
-    //timer event not processed
-    return 0;
+    //the timer must belong to a widget of the given tree
+    if (!wgt_timer || !_is_in_tree(wgt, wgt_timer->widget)) return 0;
+    
+    //prepare the message
+    msg.message.id = ALGUI_MSG_TIMER;
+    msg.event = ev;
+    msg.timer = ev->timer.source;
+    msg.wheel_timer = NULL;
+    
+    //send the message
+    _send_message_to_enabled(wgt_timer->widget, &msg.message);
+    
+    //timer event processed
+    return 1;
 }
 
 
@@ -1231,6 +3444,195 @@ static int _event_dispatch_drag_and_drop(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, A
     return _event_dispatch_default(wgt, ev);            
 }
 
+
+//returns the class of an event that is taken from an event queue by algui_dispatch_queue or algui_schedule_queue:
+//the input events, the display events that concern only the widgets, and the events of the timers of the tree are;
+//for the rest, it returns -1, and they are left to the application
+static int _get_queued_event_class(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
+    ALGUI_WIDGET_TIMER *wgt_timer;
+
+    switch (ev->type) {
+        case ALLEGRO_EVENT_KEY_DOWN:
+        case ALLEGRO_EVENT_KEY_UP:
+        case ALLEGRO_EVENT_KEY_CHAR:
+        case ALLEGRO_EVENT_MOUSE_AXES:
+        case ALLEGRO_EVENT_MOUSE_WARPED:
+        case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+        case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+            return ALGUI_EVENT_CLASS_INPUT;
+            
+        case ALLEGRO_EVENT_DISPLAY_EXPOSE:
+        case ALLEGRO_EVENT_DISPLAY_SWITCH_OUT:
+        case ALLEGRO_EVENT_DISPLAY_SWITCH_IN:
+            return ALGUI_EVENT_CLASS_DISPLAY;
+            
+        case ALLEGRO_EVENT_TIMER:
+            if (_wheel_tick_timer && ev->timer.source == _wheel_tick_timer) return ALGUI_EVENT_CLASS_TIMER;
+            wgt_timer = _find_timer(ev->timer.source);
+            return wgt_timer && _is_in_tree(wgt, wgt_timer->widget) ? ALGUI_EVENT_CLASS_TIMER : -1;
+    }
+    
+    return -1;
+}
+
+
+//merges a mouse axes event into the mouse axes event before it; 
+//the position is the latest one, and the movement is the sum of both movements;
+//returns non-zero if the events were merged
+static int _merge_mouse_axes_event(ALLEGRO_EVENT *prev, ALLEGRO_EVENT *ev) {
+    if (prev->type != ALLEGRO_EVENT_MOUSE_AXES || ev->type != ALLEGRO_EVENT_MOUSE_AXES) return 0;
+    if (prev->any.source != ev->any.source || prev->mouse.display != ev->mouse.display) return 0;
+    prev->any.timestamp = ev->any.timestamp;
+    prev->mouse.x = ev->mouse.x;
+    prev->mouse.y = ev->mouse.y;
+    prev->mouse.z = ev->mouse.z;
+    prev->mouse.w = ev->mouse.w;
+    prev->mouse.dx += ev->mouse.dx;
+    prev->mouse.dy += ev->mouse.dy;
+    prev->mouse.dz += ev->mouse.dz;
+    prev->mouse.dw += ev->mouse.dw;
+    prev->mouse.pressure = ev->mouse.pressure;
+    return 1;
+}
+
+
+//checks if a key char event is a repeat that the next event repeats again, 
+//and the focus widget wants only the last of such repeats
+static int _is_redundant_key_repeat(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, ALLEGRO_EVENT *next) {
+    ALGUI_WIDGET *focus;
+    if (ev->type != ALLEGRO_EVENT_KEY_CHAR || next->type != ALLEGRO_EVENT_KEY_CHAR) return 0;
+    if (!ev->keyboard.repeat || !next->keyboard.repeat) return 0;
+    if (ev->keyboard.keycode != next->keyboard.keycode || ev->keyboard.unichar != next->keyboard.unichar) return 0;
+    if (ev->keyboard.modifiers != next->keyboard.modifiers || ev->keyboard.display != next->keyboard.display) return 0;
+    focus = algui_get_focus_widget(_get_capture_widget(wgt));
+    return focus && focus->coalesce_key_repeats;
+}
+
+
+//dispatches an event to a widget tree
+static int _dispatch_event(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
+    ALGUI_WIDGET_ROOT *state;
+    _flush_layout(wgt);
+    state = _find_root_state(wgt);
+    if (!state || !state->drag_source) return _event_dispatch(wgt, ev);
+    return _event_dispatch_drag_and_drop(wgt, ev, state->drag_source);
+}
+
+
+//dispatches an event taken from an event queue, and counts the time it waited in the queue
+static void _dispatch_queued_event(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev, int cls) {
+    ALGUI_WIDGET_ROOT *state = _get_root_state(wgt);
+    double wait = al_get_time() - ev->any.timestamp, limit = ALGUI_QUEUE_WAIT_HISTOGRAM_RESOLUTION;
+    int i;
+    
+    assert(cls >= 0);
+    
+    for(i = 0; i < ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE - 1 && wait >= limit; ++i) {
+        limit *= 2;
+    }
+    ++state->queue_wait_histogram[cls][i];
+    ++state->dispatched_event_count;
+    _dispatch_event(wgt, ev);
+}
+
+
+//dispatches the events of a batch taken from an event queue, or only the ones of a class, if it is not negative;
+//consecutive mouse axes events are merged, and the redundant key repeats are skipped;
+//each event is held until the next one shows if it is merged or skipped, and the array is not modified;
+//the focus is checked for each repeat, since the previous events may have moved it;
+//returns the number of events dispatched
+static int _dispatch_queued_events(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *events, int count, int cls) {
+    ALLEGRO_EVENT held;
+    int i, held_cls = -1, next_cls, dispatched = 0;
+    
+    for(i = 0; i < count; ++i) {
+        next_cls = _get_queued_event_class(wgt, &events[i]);
+        if (cls >= 0 && next_cls != cls) continue;
+        if (held_cls >= 0) {
+            if (_merge_mouse_axes_event(&held, &events[i])) {
+                ++_get_root_state(wgt)->coalesced_mouse_event_count;
+                continue;
+            }
+            if (_is_redundant_key_repeat(wgt, &held, &events[i])) {
+                ++_get_root_state(wgt)->coalesced_key_event_count;
+            }
+            else {
+                _dispatch_queued_event(wgt, &held, held_cls);
+                ++dispatched;
+            }
+        }
+        held = events[i];
+        held_cls = next_cls;
+    }
+    
+    if (held_cls >= 0) {
+        _dispatch_queued_event(wgt, &held, held_cls);
+        ++dispatched;
+    }
+    
+    return dispatched;
+}
+
+
+//appends a timer event to the deferred timer events of a tree
+static void _defer_timer_event(ALGUI_WIDGET_ROOT *state, ALLEGRO_EVENT *ev) {
+    //make room at the end, by moving the events to the start of the array or by growing it
+    if (state->deferred_timer_event_count == state->deferred_timer_event_size) {
+        if (state->deferred_timer_event_first) {
+            state->deferred_timer_event_count -= state->deferred_timer_event_first;
+            memmove(state->deferred_timer_events, state->deferred_timer_events + state->deferred_timer_event_first, state->deferred_timer_event_count * sizeof(ALLEGRO_EVENT));
+            state->deferred_timer_event_first = 0;
+        }
+        else {
+            state->deferred_timer_event_size = state->deferred_timer_event_size ? state->deferred_timer_event_size * 2 : _EVENT_BATCH_SIZE;
+            state->deferred_timer_events = (ALLEGRO_EVENT *)al_realloc(state->deferred_timer_events, state->deferred_timer_event_size * sizeof(ALLEGRO_EVENT));
+            assert(state->deferred_timer_events);
+        }
+    }
+    
+    state->deferred_timer_events[state->deferred_timer_event_count++] = *ev;
+}
+
+
+//returns the oldest deferred timer event of a tree, or NULL if there is none
+static ALLEGRO_EVENT *_get_deferred_timer_event(ALGUI_WIDGET_ROOT *state) {
+    if (state->deferred_timer_event_first == state->deferred_timer_event_count) return NULL;
+    return &state->deferred_timer_events[state->deferred_timer_event_first];
+}
+
+
+//removes the oldest deferred timer event of a tree
+static void _remove_deferred_timer_event(ALGUI_WIDGET_ROOT *state) {
+    if (++state->deferred_timer_event_first < state->deferred_timer_event_count) return;
+    state->deferred_timer_event_first = 0;
+    state->deferred_timer_event_count = 0;
+}
+
+    
+//frees the ring buffer of posted messages; invoked from algui_cleanup
+void _algui_cleanup_posted_messages() {
+    al_free(_posted_messages);
+    _posted_messages = NULL;
+    _posted_messages_size = 0;
+    _posted_head = _posted_tail;
+    _posted_message_count = 0;
+}
+
+
+//frees the records in the timer free lists and the timer table; invoked from algui_cleanup
+void _algui_cleanup_timers() {
+    ALGUI_LIST_NODE *node;
+    algui_cleanup_map(&_timers);
+    while ((node = algui_get_first_list_node(&_free_timers))) {
+        algui_remove_list_node(&_free_timers, node);
+        al_free(algui_get_list_node_data(node));
+    }
+    while ((node = algui_get_first_list_node(&_free_wheel_timers))) {
+        algui_remove_list_node(&_free_wheel_timers, node);
+        al_free(algui_get_list_node_data(node));
+    }
+}
+
     
 /******************************************************************************
     PUBLIC
@@ -1248,12 +3650,14 @@ int algui_widget_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
         case ALGUI_MSG_CLEANUP      : return _msg_cleanup(wgt, (ALGUI_CLEANUP_MESSAGE *)msg);
         case ALGUI_MSG_INSERT_WIDGET: return _msg_insert_widget(wgt, (ALGUI_INSERT_WIDGET_MESSAGE *)msg);
         case ALGUI_MSG_REMOVE_WIDGET: return _msg_remove_widget(wgt, (ALGUI_REMOVE_WIDGET_MESSAGE *)msg);
+        case ALGUI_MSG_SPLICE_WIDGETS: return _msg_splice_widgets(wgt, (ALGUI_SPLICE_WIDGETS_MESSAGE *)msg);
         case ALGUI_MSG_SET_RECT     : return _msg_set_rect(wgt, (ALGUI_SET_RECT_MESSAGE *)msg);
         case ALGUI_MSG_SET_VISIBLE  : return _msg_set_visible(wgt, (ALGUI_SET_VISIBLE_MESSAGE *)msg);
         case ALGUI_MSG_SET_ENABLED  : return _msg_set_enabled(wgt, (ALGUI_SET_ENABLED_MESSAGE *)msg);
         case ALGUI_MSG_GET_FOCUS    : return _msg_get_focus(wgt, (ALGUI_GET_FOCUS_MESSAGE *)msg);
         case ALGUI_MSG_LOSE_FOCUS   : return _msg_lose_focus(wgt, (ALGUI_LOSE_FOCUS_MESSAGE *)msg);
         case ALGUI_MSG_HIT_TEST     : return _msg_hit_test(wgt, (ALGUI_HIT_TEST_MESSAGE *)msg);
+        case ALGUI_MSG_SET_SKIN     : return _msg_set_skin(wgt, (ALGUI_SET_SKIN_MESSAGE *)msg);
     }
     return 0;
 }
@@ -1279,16 +3683,111 @@ int algui_send_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
     @return non-zero if the message was processed by any widget, zero otherwise.
  */
 int algui_broadcast_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
-    ALGUI_WIDGET *child;
-    int r = 0;
+    ALGUI_MESSAGE_MASK bit;
+    ALGUI_TRAVERSAL trv;
+    int descend, r = 0;
     assert(wgt);
-    r |= algui_send_message(wgt, msg);
-    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
-        r |= algui_broadcast_message(child, msg);
+    assert(msg);
+    bit = ALGUI_MESSAGE_BIT(msg->id);
+    for(wgt = _begin_traversal(&trv, wgt, 0); wgt; wgt = _next_traversal(&trv, descend)) {
+        descend = _is_tree_broadcast_target(wgt, bit);
+        if (descend) r |= _send_broadcast_message(wgt, msg, bit);
     }
+    _end_traversal(&trv);
     return r;
 }
 
+/** posts a message to a widget.
+    The message is copied to a queue, and it is sent to the widget later, by algui_process_posted_messages.
+    If the widget is destroyed before that, the message is dropped.
+    @param wgt target widget.
+    @param msg message to post.
+    @param size size of the message struct, in bytes.
+ */
+void algui_post_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size) {
+    assert(wgt);
+    assert(msg);
+    assert(size >= sizeof(ALGUI_MESSAGE));
+    _push_posted_message(wgt, msg, size);
+}
+
+
+/** posts a message to a widget, merging it with a message with the same id that waits for the same widget.
+    The waiting message is overwritten with the given one and keeps its place in the queue;
+    if it has another size, it is dropped, and the given message is posted at the end of the queue.
+    @param wgt target widget.
+    @param msg message to post.
+    @param size size of the message struct, in bytes.
+    @return non-zero if the message was merged with a waiting message, zero if it was posted.
+ */
+int algui_post_coalesced_message(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg, size_t size) {
+    assert(wgt);
+    assert(msg);
+    assert(size >= sizeof(ALGUI_MESSAGE));
+    if (wgt->posted_count && _coalesce_posted_message(wgt, msg, size)) return 1;
+    _push_posted_message(wgt, msg, size);
+    return 0;
+}
+
+
+/** sends the posted messages, in the order they were posted.
+    The messages posted while the function runs wait for the next call.
+    @param root root of the widget tree to send the messages of; if NULL, the messages of all trees are sent.
+    @param budget seconds after which the function returns, even if messages are left; 
+        at least one message is sent; if zero or less, there is no time limit.
+    @return the number of messages sent.
+ */
+int algui_process_posted_messages(ALGUI_WIDGET *root, double budget) {
+    union {
+        ALGUI_MESSAGE message;
+        char data[_POSTED_MESSAGE_COPY_SIZE];
+    } buffer;
+    ALGUI_POSTED_MESSAGE *entry;
+    ALGUI_MESSAGE *msg;
+    ALGUI_WIDGET *wgt;
+    uint64_t pos, next, end = _posted_tail;
+    double start = budget > 0 ? al_get_time() : 0;
+    int count = 0;
+    
+    for(pos = _posted_head; pos < end; pos = MAX(next, _posted_head)) {
+        entry = _get_posted_message(pos);
+        next = pos + entry->size;
+        wgt = entry->widget;
+        if (!wgt || (root && algui_get_root_widget(wgt) != root)) continue;
+        
+        //the message is removed from the queue before it is sent, since the widget may post messages; 
+        //it may not be the oldest message of the widget, if the widget was moved into the tree by an earlier message
+        msg = entry->message_size <= sizeof(buffer) ? &buffer.message : (ALGUI_MESSAGE *)al_malloc(entry->message_size);
+        assert(msg);
+        memcpy(msg, entry + 1, entry->message_size);
+        _unlink_posted_message(pos);
+        
+        algui_send_message(wgt, msg);
+        if (msg != &buffer.message) al_free(msg);
+        ++count;
+        
+        if (budget > 0 && al_get_time() - start >= budget) break;
+    }
+    
+    return count;
+}
+
+
+/** returns the number of posted messages that wait to be sent.
+    @return the number of posted messages.
+ */
+unsigned long algui_get_posted_message_count() {
+    return _posted_message_count;
+}
+
+
+/** returns the number of posted messages that were merged with messages that waited to be sent.
+    @return the number of coalesced messages.
+ */
+unsigned long algui_get_coalesced_message_count() {
+    return _coalesced_message_count;
+}
+
 
 /** returns a widget's procedure.
     @param wgt widget to get the procedure of.
@@ -1300,6 +3799,27 @@ ALGUI_WIDGET_PROC algui_get_widget_proc(ALGUI_WIDGET *wgt) {
 }
 
 
+/** returns the message mask of a widget.
+    @param wgt widget to get the message mask of.
+    @return the message mask.
+ */
+ALGUI_MESSAGE_MASK algui_get_widget_message_mask(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->message_mask;
+}
+
+
+/** returns the union of the message masks of a widget and its descendants.
+    It may have extra messages after widgets are removed, until the mask of the widget is set again.
+    @param wgt widget to get the mask of.
+    @return the message mask of the widget tree.
+ */
+ALGUI_MESSAGE_MASK algui_get_widget_tree_message_mask(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->tree_message_mask;
+}
+
+
 /** returns the parent widget.
     @param wgt widget to get the parent of.
     @return the parent widget; it may be null.
@@ -1442,7 +3962,7 @@ int algui_get_widget_height(ALGUI_WIDGET *wgt) {
  */
 ALGUI_RECT algui_get_widget_screen_rect(ALGUI_WIDGET *wgt) {
     assert(wgt);
-    return wgt->screen_rect;
+    return *_get_screen_rect(wgt);
 }
 
 
@@ -1477,6 +3997,146 @@ int algui_is_widget_tree_enabled(ALGUI_WIDGET *wgt) {
 }
 
 
+/** returns a widget's opaque status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_opaque(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->opaque;
+}
+
+
+/** returns a widget's layout boundary status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_layout_boundary(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->layout_boundary;
+}
+
+
+/** returns a widget's key repeat coalescing status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_coalescing_key_repeats(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->coalesce_key_repeats;
+}
+
+
+/** returns the number of batches of drawing submitted during the last draw of a widget tree.
+    In batched mode, a batch is submitted each time the clipping or the target bitmap changes;
+    Allegro may split a batch further, when the texture changes.
+    Otherwise, each widget painted and each render cache image drawn count as a batch.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of batches.
+ */
+unsigned long algui_get_draw_batch_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->draw_batch_count : 0;
+}
+
+
+/** returns the number of times the clipping changed during the last draw of a widget tree.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of clipping changes.
+ */
+unsigned long algui_get_clip_change_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->clip_change_count : 0;
+}
+
+
+/** returns the number of clipping changes avoided during the last draw of a widget tree,
+    because the clipping was already the one needed.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of skipped clipping changes.
+ */
+unsigned long algui_get_skipped_clip_change_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->skipped_clip_change_count : 0;
+}
+
+
+/** checks if widgets are drawn in batched mode.
+    @return non-zero if widgets are drawn in batched mode.
+ */
+int algui_is_drawing_batched() {
+    return _batched_drawing;
+}
+
+
+/** returns a widget's cacheable status.
+    @param wgt widget to get the status of.
+    @return the widget status.
+ */
+int algui_is_widget_cacheable(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->cache != NULL;
+}
+
+
+/** returns the memory budget of the render caches.
+    @return the budget, in bytes.
+ */
+size_t algui_get_render_cache_budget() {
+    return _render_cache_budget;
+}
+
+
+/** returns the memory used by the images of the render caches.
+    @return the memory used, in bytes.
+ */
+size_t algui_get_render_cache_size() {
+    return _render_cache_size;
+}
+
+
+/** returns the number of times a cacheable widget was drawn from its image.
+    @return the number of render cache hits.
+ */
+unsigned long algui_get_render_cache_hit_count() {
+    return _render_cache_hit_count;
+}
+
+
+/** returns the number of times the image of a cacheable widget had to be rendered.
+    @return the number of render cache misses.
+ */
+unsigned long algui_get_render_cache_miss_count() {
+    return _render_cache_miss_count;
+}
+
+
+/** returns the number of images of cacheable widgets destroyed to keep within the memory budget.
+    @return the number of render cache evictions.
+ */
+unsigned long algui_get_render_cache_eviction_count() {
+    return _render_cache_eviction_count;
+}
+
+
+/** returns the number of heap allocations made for widget timers and wheel timers.
+    It counts the timer records and the growth of the table that maps allegro timers to widgets.
+    The records of destroyed timers and the table are kept and reused by the timers created next,
+    so as that creating and destroying timers does not allocate memory once enough records exist;
+    only the allegro timers of widget timers are created and destroyed each time, by allegro.
+    @return the number of allocations.
+ */
+unsigned long algui_get_timer_allocation_count() {
+    return _timer_allocation_count;
+}
+
+
 /** returns true if the given widget has the input focus.
     @param wgt widget to get the focus status of.
     @return non-zero if the widget has the focus, zero otherwise.
@@ -1492,14 +4152,11 @@ int algui_widget_has_focus(ALGUI_WIDGET *wgt) {
     @return the widget that has the focus or NULL if no widget has the focus.
  */
 ALGUI_WIDGET *algui_get_focus_widget(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *child, *result;
+    ALGUI_WIDGET_ROOT *state;
     assert(wgt);
-    if (wgt->focus) return wgt;
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        result = algui_get_focus_widget(child);
-        if (result) return result;
-    }
-    return NULL;
+    state = _find_root_state(wgt);
+    if (!state || !state->focus) return NULL;
+    return _is_in_tree(wgt, state->focus) ? state->focus : NULL;
 }
 
 
@@ -1518,14 +4175,11 @@ int algui_widget_has_mouse(ALGUI_WIDGET *wgt) {
     @return the widget that has the mouse or NULL if no widget has the mouse.
  */
 ALGUI_WIDGET *algui_get_mouse_widget(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *child, *result;
+    ALGUI_WIDGET_ROOT *state;
     assert(wgt);
-    if (wgt->mouse) return wgt;
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        result = algui_get_mouse_widget(child);
-        if (result) return result;
-    }
-    return NULL;
+    state = _find_root_state(wgt);
+    if (!state || !state->mouse) return NULL;
+    return _is_in_tree(wgt, state->mouse) ? state->mouse : NULL;
 }
 
 
@@ -1537,36 +4191,62 @@ ALGUI_WIDGET *algui_get_mouse_widget(ALGUI_WIDGET *wgt) {
     @param y vertical coordinate, relative to the given widget.
     @return the widget under the given coordinates, or NULL if there is one.
  */
-ALGUI_WIDGET *algui_get_widget_from_point(ALGUI_WIDGET *wgt, int x, int y) {
-    ALGUI_WIDGET *child, *result;
-    ALGUI_HIT_TEST_MESSAGE msg;
+ALGUI_WIDGET *algui_get_widget_from_point(ALGUI_WIDGET *wgt, int x, int y) {
+    assert(wgt);
+    _flush_layout(wgt);
+    return _get_widget_from_point(wgt, x, y);
+}
+
+
+/** returns the number of hit tests done for mouse events in a widget tree.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of hit tests.
+ */
+unsigned long algui_get_hit_test_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->hit_test_count : 0;
+}
+
+
+/** returns the number of hit tests done for mouse events in a widget tree
+    that did not have to search the tree, because the mouse was still over the widget found last.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of skipped hit tests.
+ */
+unsigned long algui_get_skipped_hit_test_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->skipped_hit_test_count : 0;
+}
+
+
+/** returns the number of widgets of a widget tree that were not painted during the last draw,
+    because opaque widgets in front of them covered them.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of culled widgets.
+ */
+unsigned long algui_get_culled_widget_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->culled_widget_count : 0;
+}
 
+
+/** returns the number of pixels of a widget tree that were not painted during the last draw,
+    because opaque widgets in front of them covered them.
+    The pixels of a widget are counted once for the widget and once for each culled child that covers them.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of culled pixels.
+ */
+unsigned long algui_get_culled_pixel_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
     assert(wgt);
-    
-    //if the widget is not visible, or if the coordinates lie beyond the widget's rect, then do nothing
-    if (!wgt->visible_tree || 
-        x < 0 || 
-        x >= algui_get_widget_width(wgt) || 
-        y < 0 || 
-        y >= algui_get_widget_height(wgt))
-    {        
-        return NULL;
-    }        
-    
-    //search the children, from higher to lower
-    for(child = algui_get_highest_child_widget(wgt); child; child = algui_get_lower_sibling_widget(child)) {
-        result = algui_get_widget_from_point(child, x - child->rect.left, y - child->rect.top);
-        if (result) return result;
-    }
-    
-    //ask the widget
-    msg.message.id = ALGUI_MSG_HIT_TEST;
-    msg.x = x;
-    msg.y = y;
-    msg.ok = 0;
-    algui_send_message(wgt, &msg.message);
-    
-    return msg.ok ? wgt : NULL;
+    state = _find_root_state(wgt);
+    return state ? state->culled_pixel_count : 0;
 }
 
 
@@ -1602,6 +4282,24 @@ int algui_get_widget_z_order(ALGUI_WIDGET *wgt) {
 }
 
 
+/** returns the spatial index mode of a widget.
+    @param wgt widget to get the spatial index mode of.
+    @return one of the ALGUI_SPATIAL_INDEX values.
+ */
+int algui_get_widget_spatial_index(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    return wgt->spatial_index;
+}
+
+
+/** returns the number of children above which widgets in automatic spatial index mode index their children.
+    @return the number of children.
+ */
+int algui_get_spatial_index_threshold() {
+    return _spatial_index_threshold;
+}
+
+
 /** initializes a widget structure.
     @param wgt widget to initialize.
     @param proc widget proc.
@@ -1615,12 +4313,41 @@ void algui_init_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET_PROC proc, const char *id
     assert(proc);
     wgt->proc = proc;
     algui_init_tree(&wgt->tree, wgt);
+    wgt->root_state = NULL;
+    wgt->cache = NULL;
+    wgt->grid = NULL;
+    wgt->tab_index = NULL;
     algui_set_rect(&wgt->rect, 0, 0, 0, 0);
     algui_set_rect(&wgt->screen_rect, 0, 0, 0, 0);
+    wgt->screen_generation = 0;
+    wgt->geometry_generation = 1;
+    wgt->layout_generation = 0;
+    wgt->layout_depth = 0;
+    wgt->flags_generation = 0;
+    wgt->order_index = 0;
     algui_init_list(&wgt->timers);
+    algui_init_list(&wgt->wheel_timers);
     wgt->id = id;
+    wgt->posted_count = 0;
+    wgt->posted_first = 0;
+    wgt->posted_last = 0;
+    wgt->message_mask = ALGUI_MESSAGE_MASK_ALL;
+    wgt->tree_message_mask = ALGUI_MESSAGE_MASK_ALL;
     wgt->capture = 0;
     wgt->tab_order = 0;
+    wgt->z_key = 0;
+    wgt->spatial_index = ALGUI_SPATIAL_INDEX_AUTO;
+    wgt->opaque = 0;
+    wgt->culled = 0;
+    wgt->layout_boundary = 0;
+    wgt->coalesce_key_repeats = 0;
+    wgt->layout_queued = 0;
+    wgt->needs_measure_tree = 0;
+    wgt->needs_measure = 0;
+    wgt->needs_arrange = 0;
+    wgt->flags_queued = 0;
+    wgt->flags_covered = 0;
+    wgt->index_queued = 0;
     wgt->visible = 1;
     wgt->visible_tree = 1;
     wgt->enabled = 1;
@@ -1646,11 +4373,34 @@ void algui_cleanup_widget(ALGUI_WIDGET *wgt) {
 
 /** cleans up a widget and its children, and then frees the memory it occupies.
     Every widget in the tree is cleaned up, and then widgets are freed using the al_free function.
+    Widgets allocated from a widget arena cannot be told apart from other widgets here, so a tree
+    with such widgets must be destroyed with algui_destroy_arena_widget instead.
     @param wgt widget to cleanup.
  */
 void algui_destroy_widget(ALGUI_WIDGET *wgt) {
     algui_cleanup_widget(wgt);
-    _destroy(wgt);
+    ++_structure_generation;
+    _destroy(wgt, NULL);
+}
+
+
+/** cleans up a widget tree allocated from a widget arena, and then frees the memory of the arena at once.
+    Every widget in the tree is cleaned up; the widgets of the tree that were not allocated from the arena
+    are freed using the al_free function, and then the arena is reset.
+    An arena holds the widgets of a single tree, which is released as a whole: a subtree cannot be released on its own,
+    so every widget allocated from the arena must belong to the tree, or else it must have been cleaned up already.
+    The widget must not have a parent.
+    @param wgt root of the tree to destroy.
+    @param arena arena the widgets of the tree were allocated from.
+ */
+void algui_destroy_arena_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET_ARENA *arena) {
+    assert(wgt);
+    assert(arena);
+    assert(!algui_get_parent_widget(wgt));
+    algui_cleanup_widget(wgt);
+    ++_structure_generation;
+    _destroy(wgt, arena);
+    algui_reset_widget_arena(arena);
 }
 
 
@@ -1668,14 +4418,14 @@ void algui_translate_point(ALGUI_WIDGET *src, int src_x, int src_y, ALGUI_WIDGET
     
     //translate coordinates from source to screen    
     if (src) {
-        src_x += src->screen_rect.left;
-        src_y += src->screen_rect.top;
+        src_x += _get_screen_rect(src)->left;
+        src_y += _get_screen_rect(src)->top;
     }
     
     //translate coordinates from screen to destination
     if (dst) {
-        src_x -= dst->screen_rect.left;
-        src_y -= dst->screen_rect.top;
+        src_x -= _get_screen_rect(dst)->left;
+        src_y -= _get_screen_rect(dst)->top;
     }
     
     *dst_x = src_x;
@@ -1699,12 +4449,12 @@ void algui_translate_rect(ALGUI_WIDGET *src, ALGUI_RECT *src_rct, ALGUI_WIDGET *
 
     //translate coordinates from source to screen    
     if (src) {
-        algui_offset_rect(&tmp, src->screen_rect.left, src->screen_rect.top);
+        algui_offset_rect(&tmp, _get_screen_rect(src)->left, _get_screen_rect(src)->top);
     }
     
     //translate coordinates from screen to destination
     if (dst) {
-        algui_offset_rect(&tmp, -dst->screen_rect.left, -dst->screen_rect.top);
+        algui_offset_rect(&tmp, -_get_screen_rect(dst)->left, -_get_screen_rect(dst)->top);
     }
     
     *dst_rct = tmp;
@@ -1712,16 +4462,21 @@ void algui_translate_rect(ALGUI_WIDGET *src, ALGUI_RECT *src_rct, ALGUI_WIDGET *
 
 
 /** draws a part of a widget.
-    Every widget in the tree gets the paint message.
+    Every widget in the tree gets the paint message, 
+    except for the widgets that are covered by opaque widgets in front of them.
     @param wgt widget to draw; its children are also drawn.
     @param rct local rectangle of widget to draw.
  */
 void algui_draw_widget_rect(ALGUI_WIDGET *wgt, ALGUI_RECT *rct) {
+    ALGUI_WIDGET_ROOT *state;
     ALGUI_RECT screen_rect;
     int cx, cy, cw, ch;
     assert(wgt);
     assert(rct);
     
+    //calculate the pending layout
+    _flush_layout(wgt);
+    
     //translate coordinates from widget to screen
     algui_translate_rect(wgt, rct, NULL, &screen_rect);
     
@@ -1729,7 +4484,9 @@ void algui_draw_widget_rect(ALGUI_WIDGET *wgt, ALGUI_RECT *rct) {
     al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
     
     //draw every widget in the tree
-    _draw(wgt, &screen_rect);
+    state = _get_root_state(algui_get_root_widget(wgt));
+    _reset_draw_statistics(state);
+    _draw_tree(wgt, &screen_rect, state);
     
     //restore the clipping
     al_set_clipping_rectangle(cx, cy, cw, ch);
@@ -1747,6 +4504,82 @@ void algui_draw_widget(ALGUI_WIDGET *wgt) {
 }
 
 
+/** marks a widget as needing to be drawn again.
+    The screen area of the widget is added to the damaged area of its tree,
+    which is drawn by algui_draw_invalidated.
+    @param wgt widget to invalidate.
+ */
+void algui_invalidate_widget(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    if (!wgt->drawn || !wgt->visible_tree) return;
+    _add_damage(wgt, _get_screen_rect(wgt));
+}
+
+
+/** marks a part of a widget as needing to be drawn again.
+    The rect is added to the damaged area of the widget's tree,
+    which is drawn by algui_draw_invalidated.
+    @param wgt widget to invalidate.
+    @param rct local rectangle of widget to invalidate.
+ */
+void algui_invalidate_widget_rect(ALGUI_WIDGET *wgt, ALGUI_RECT *rct) {
+    ALGUI_RECT screen_rect, r;
+    assert(wgt);
+    assert(rct);
+    if (!wgt->drawn || !wgt->visible_tree) return;
+    algui_translate_rect(wgt, rct, NULL, &screen_rect);
+    algui_get_rect_intersection(&screen_rect, _get_screen_rect(wgt), &r);
+    _add_damage(wgt, &r);
+}
+
+
+/** draws the damaged area of a widget tree.
+    Only the widgets that intersect the damaged area receive the paint message,
+    clipped to the damaged area; the damaged area is then cleared.
+    A tree that has never been drawn is drawn entirely.
+    The target bitmap must keep its contents between calls (for example, a display with a single buffer).
+    @param wgt widget of the tree to draw.
+    @return non-zero if anything was drawn, zero if there was no damage.
+ */
+int algui_draw_invalidated(ALGUI_WIDGET *wgt) {
+    ALGUI_REGION damage;
+    ALGUI_WIDGET_ROOT *state;
+    int i, cx, cy, cw, ch;
+    
+    assert(wgt);
+    
+    wgt = algui_get_root_widget(wgt);
+    
+    //the first time, everything is drawn
+    if (!wgt->drawn) {
+        algui_draw_widget(wgt);
+        state = _find_root_state(wgt);
+        if (state) algui_clear_region(&state->damage);
+        return 1;
+    }
+    
+    //the pending layout adds its damage
+    _flush_layout(wgt);
+    
+    state = _find_root_state(wgt);
+    if (!state || algui_is_region_empty(&state->damage)) return 0;
+    
+    //the damage is taken before drawing, so as that widgets can invalidate themselves while painting
+    damage = state->damage;
+    algui_init_region(&state->damage);
+    
+    _reset_draw_statistics(state);
+    al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
+    for(i = 0; i < damage.count; ++i) {
+        _draw_tree(wgt, &damage.rects[i], state);
+    }
+    al_set_clipping_rectangle(cx, cy, cw, ch);
+    
+    algui_cleanup_region(&damage);
+    return 1;
+}
+
+
 /** inserts a widget in another widget as a child.
     @param parent parent; it receives the insert-widget message.
     @param child child.
@@ -1798,6 +4631,28 @@ void algui_detach_widget(ALGUI_WIDGET *child) {
 }
 
 
+/** moves a range of consecutive children of a widget to another widget,
+    or to another position in the same widget.
+    The children are relinked in constant time, regardless of how many they are;
+    the rest of the work is proportional to the number of children moved.
+    @param parent new parent; it receives the splice-widgets message.
+    @param first lowest child to move.
+    @param last highest child to move; it is the first child or a higher sibling of it.
+    @param next next sibling in the new parent; it can be null; it must not be one of the moved children.
+    @return non-zero if the operation succeeded, zero otherwise.
+ */
+int algui_splice_widgets(ALGUI_WIDGET *parent, ALGUI_WIDGET *first, ALGUI_WIDGET *last, ALGUI_WIDGET *next) {
+    ALGUI_SPLICE_WIDGETS_MESSAGE msg;
+    msg.message.id = ALGUI_MSG_SPLICE_WIDGETS;
+    msg.first = first;
+    msg.last = last;
+    msg.next = next;
+    msg.ok = 0;
+    algui_send_message(parent, &msg.message);
+    return msg.ok;
+}
+
+
 /** sets the local rectangle of a widget.
     The widget receives the set-rect message.
     @param wgt widget to set.
@@ -1862,7 +4717,75 @@ void algui_resize_widget(ALGUI_WIDGET *wgt, int w, int h) {
  */
 void algui_pack_widget(ALGUI_WIDGET *wgt) {
     assert(wgt);
-    if (wgt->drawn) _update_layout(wgt);
+    if (!wgt->drawn) return;
+    _invalidate_measure(wgt);
+    _flush_layout(wgt);
+}
+
+
+/** calculates the pending layout of a widget tree.
+    Inserting, removing, resizing, showing and hiding widgets does not calculate the layout immediately;
+    the affected widgets are marked, and their layout is calculated once, by this function,
+    which is invoked automatically before drawing a tree, dispatching an event to it or hit-testing it.
+    It may be invoked explicitly in order to get the updated rects of widgets.
+    @param wgt widget of the tree to calculate the layout of.
+ */
+void algui_flush_layout(ALGUI_WIDGET *wgt) {
+    assert(wgt);
+    _flush_layout(wgt);
+}
+
+
+/** begins a bulk update of widget trees.
+    Until the matching call to algui_end_update, the work that follows each change of the trees is postponed:
+    the flags of the descendants of inserted, moved, shown, hidden, enabled and disabled widgets,
+    the validation of the input focus, the spatial indexes, the resuming of wheel timers,
+    the layout and the damaged areas.
+    The postponed work is then done once, for all the changes.
+    Calls may be nested; the work is done at the end of the outermost update.
+    While an update is in progress, the rects of widgets and the flags of the descendants of changed widgets may be out of date.
+ */
+void algui_begin_update() {
+    ++_update_depth;
+}
+
+
+/** ends a bulk update of widget trees started by algui_begin_update.
+    At the end of the outermost update, the postponed work is done,
+    including the pending layout of all trees.
+ */
+void algui_end_update() {
+    ALGUI_WIDGET *wgt;
+    ALGUI_WIDGET_ROOT *state;
+    
+    assert(_update_depth > 0);
+    if (--_update_depth) return;
+    
+    _flush_flags();
+    
+    if (_timers_pending) {
+        _timers_pending = 0;
+        _resume_wheel_timers();
+    }
+    
+    //each flush takes the queued widgets of one tree
+    while (_layout_queue.length) {
+        _flush_layout(_layout_queue.widgets[0]);
+    }
+    
+    //the indexes are built after the layout, for the final sizes of the widgets
+    while (_index_queue.length) {
+        wgt = _index_queue.widgets[--_index_queue.length];
+        wgt->index_queued = 0;
+        _update_spatial_index(wgt);
+    }
+    
+    while (_damage_queue.length) {
+        wgt = _damage_queue.widgets[--_damage_queue.length];
+        state = wgt->root_state;
+        state->update_damaged = 0;
+        _add_damage(wgt, &state->update_damage);
+    }
 }
 
 
@@ -1949,6 +4872,23 @@ void algui_set_widget_proc(ALGUI_WIDGET *wgt, ALGUI_WIDGET_PROC proc) {
 }
 
 
+/** sets the messages the proc of a widget handles beyond the ones the default widget procedure handles.
+    Broadcasts call the proc of a widget only for the messages in its mask, and they skip subtrees
+    that do not handle the message at all; the other messages are still sent directly.
+    Messages without a bit in the mask, such as the user messages, are always broadcast.
+    The messages the default widget procedure handles, such as the cleanup and set-skin messages,
+    are always added to the mask, so as that the widget proc gets them too.
+    The mask of new widgets is ALGUI_MESSAGE_MASK_ALL.
+    @param wgt widget to set the message mask of.
+    @param mask set of the message bits the widget proc handles, made with ALGUI_MESSAGE_BIT.
+ */
+void algui_set_widget_message_mask(ALGUI_WIDGET *wgt, ALGUI_MESSAGE_MASK mask) {
+    assert(wgt);
+    wgt->message_mask = mask | _DEFAULT_MESSAGE_MASK;
+    _update_tree_message_mask(wgt);
+}
+
+
 /** sets the input focus to the given widget.
     The given widget receives a get-focus message;
     if the widget accepts the focus, then the previous focus widget, if there is one,
@@ -1980,6 +4920,7 @@ int algui_set_focus_widget(ALGUI_WIDGET *wgt) {
     
     //notify the widget that it has the input focus
     wgt->focus = 1;
+    _get_root_state(wgt)->focus = wgt;
     got_focus_msg.message.id = ALGUI_MSG_GOT_FOCUS;
     algui_send_message(wgt, &got_focus_msg.message);
         
@@ -1996,10 +4937,210 @@ int algui_set_focus_widget(ALGUI_WIDGET *wgt) {
     @return non-zero if the event was processed, zero otherwise.
  */
 int algui_dispatch_event(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
-    ALGUI_WIDGET *drag_and_drop_source;    
-    drag_and_drop_source = algui_get_drag_and_drop_source(wgt);
-    if (!drag_and_drop_source) return _event_dispatch(wgt, ev);
-    return _event_dispatch_drag_and_drop(wgt, ev, drag_and_drop_source);
+    return _dispatch_event(wgt, ev);
+}
+
+
+/** dispatches an array of Allegro events to a widget tree, in one batch.
+    Consecutive mouse axes events are merged into one, with the sum of their movements;
+    consecutive repeats of the same key char are dispatched as one, 
+    if the focus widget coalesces key repeats. Other events keep their order.
+    The events must be input events, or events of timers of the tree.
+    @param wgt root of widget tree to dispatch the events to.
+    @param events events to dispatch.
+    @param count number of events.
+    @return the number of events dispatched, after merging.
+ */
+int algui_dispatch_events(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *events, int count) {
+    assert(wgt);
+    assert(events || !count);
+    return _dispatch_queued_events(wgt, events, count, -1);
+}
+
+
+/** dispatches the events of an Allegro event queue to a widget tree, in one batch.
+    The events are taken from the queue until it is empty, or until the next event is not 
+    an input event or an event of a timer of the tree; that event is left in the queue for the application.
+    The events are then merged and dispatched like with algui_dispatch_events.
+    At most a few dozen events are taken at once; the events that arrive 
+    while the batch is dispatched are left for the next call.
+    @param wgt root of widget tree to dispatch the events to.
+    @param queue event queue to take the events from.
+    @return the number of events dispatched, after merging.
+ */
+int algui_dispatch_queue(ALGUI_WIDGET *wgt, ALLEGRO_EVENT_QUEUE *queue) {
+    ALLEGRO_EVENT events[_EVENT_BATCH_SIZE];
+    int count = 0, cls;
+    
+    assert(wgt);
+    assert(queue);
+    
+    //take the events
+    while (count < _EVENT_BATCH_SIZE && al_peek_next_event(queue, &events[count])) {
+        cls = _get_queued_event_class(wgt, &events[count]);
+        if (cls != ALGUI_EVENT_CLASS_INPUT && cls != ALGUI_EVENT_CLASS_TIMER) break;
+        al_drop_next_event(queue);
+        ++count;
+    }
+    
+    return algui_dispatch_events(wgt, events, count);
+}
+
+
+/** dispatches an array of Allegro events to a widget tree, by priority.
+    The input events are dispatched first, merged like with algui_dispatch_events, then the display events, 
+    and then the timer events, after the ones deferred by previous invocations.
+    Timer events are dispatched, oldest first, while the time spent since the function was invoked
+    is within the budget; the rest are deferred to the next invocations.
+    To avoid starvation, the oldest deferred timer event is dispatched in every invocation,
+    and so is every timer event that has waited longer than a tenth of a second.
+    The time that each event waited since its timestamp is counted in the histogram of its class.
+    The events must be input events, expose and switch events of displays, or events of timers of the tree.
+    @param wgt root of widget tree to dispatch the events to.
+    @param events events to dispatch.
+    @param count number of events; it can be zero, to dispatch the deferred timer events only.
+    @param timer_budget seconds in which timer events can be dispatched; if zero or less, there is no limit.
+    @return the number of events dispatched, after merging.
+ */
+int algui_schedule_events(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *events, int count, double timer_budget) {
+    ALLEGRO_EVENT ev, *deferred;
+    ALGUI_WIDGET_ROOT *state;
+    int dispatched, timer_count = 0, i;
+    double start = al_get_time();
+    
+    assert(wgt);
+    assert(events || !count);
+    
+    //the timer events wait behind the ones deferred before
+    state = _get_root_state(wgt);
+    for(i = 0; i < count; ++i) {
+        if (_get_queued_event_class(wgt, &events[i]) == ALGUI_EVENT_CLASS_TIMER) _defer_timer_event(state, &events[i]);
+    }
+    
+    //input events first, then display events
+    dispatched = _dispatch_queued_events(wgt, events, count, ALGUI_EVENT_CLASS_INPUT);
+    dispatched += _dispatch_queued_events(wgt, events, count, ALGUI_EVENT_CLASS_DISPLAY);
+    
+    //timer events within the budget, or waiting for too long; 
+    //the state is looked up again for each event, since a timer may move or destroy the tree
+    while ((state = _find_root_state(wgt)) && (deferred = _get_deferred_timer_event(state))) {
+        if (timer_count && timer_budget > 0 && al_get_time() - start >= timer_budget && al_get_time() - deferred->any.timestamp < _MAX_TIMER_EVENT_WAIT) break;
+        ev = *deferred;
+        _remove_deferred_timer_event(state);
+        _dispatch_queued_event(wgt, &ev, ALGUI_EVENT_CLASS_TIMER);
+        ++timer_count;
+    }
+    
+    return dispatched + timer_count;
+}
+
+
+/** dispatches the events of an Allegro event queue to a widget tree, by priority.
+    The events are taken from the queue like with algui_dispatch_queue, along with the expose and 
+    switch events of displays; the first event that is not taken is left in the queue for the application.
+    The events are then dispatched like with algui_schedule_events; 
+    the deferred timer events are dispatched even if no event is taken.
+    @param wgt root of widget tree to dispatch the events to.
+    @param queue event queue to take the events from.
+    @param timer_budget seconds in which timer events can be dispatched; if zero or less, there is no limit.
+    @return the number of events dispatched, after merging.
+ */
+int algui_schedule_queue(ALGUI_WIDGET *wgt, ALLEGRO_EVENT_QUEUE *queue, double timer_budget) {
+    ALLEGRO_EVENT events[_EVENT_BATCH_SIZE];
+    int count = 0;
+    
+    assert(wgt);
+    assert(queue);
+    
+    //take the events
+    while (count < _EVENT_BATCH_SIZE && al_peek_next_event(queue, &events[count])) {
+        if (_get_queued_event_class(wgt, &events[count]) < 0) break;
+        al_drop_next_event(queue);
+        ++count;
+    }
+    
+    return algui_schedule_events(wgt, events, count, timer_budget);
+}
+
+
+/** returns the number of timer events of a widget tree that algui_schedule_queue has deferred.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of deferred timer events.
+ */
+int algui_get_deferred_timer_event_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->deferred_timer_event_count - state->deferred_timer_event_first : 0;
+}
+
+
+/** returns the number of events of a class dispatched to a widget tree from event queues, 
+    that waited in the queue for a range of time.
+    Range 0 holds the events that waited less than ALGUI_QUEUE_WAIT_HISTOGRAM_RESOLUTION seconds;
+    each next range ends at twice the time of the previous one,
+    and the last range holds all events that waited longer than the previous ranges.
+    @param wgt widget of the tree to get the counter of.
+    @param cls class of events.
+    @param range index of range, from 0 to ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE - 1.
+    @return the number of events.
+ */
+unsigned long algui_get_queue_wait_count(ALGUI_WIDGET *wgt, ALGUI_EVENT_CLASS cls, int range) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    assert(cls >= 0 && cls < ALGUI_EVENT_CLASS_COUNT);
+    assert(range >= 0 && range < ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE);
+    state = _find_root_state(wgt);
+    return state ? state->queue_wait_histogram[cls][range] : 0;
+}
+
+
+/** resets the queue wait histograms of a widget tree.
+    @param wgt widget of the tree to reset the histograms of.
+ */
+void algui_reset_queue_wait_histograms(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    if (state) memset(state->queue_wait_histogram, 0, sizeof(state->queue_wait_histogram));
+}
+
+
+/** returns the number of events dispatched to a widget tree from event queues.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of events dispatched by algui_dispatch_queue and algui_schedule_queue.
+ */
+unsigned long algui_get_dispatched_event_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->dispatched_event_count : 0;
+}
+
+
+/** returns the number of mouse axes events merged with the events before them 
+    by algui_dispatch_queue and algui_schedule_queue.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of coalesced mouse events.
+ */
+unsigned long algui_get_coalesced_mouse_event_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->coalesced_mouse_event_count : 0;
+}
+
+
+/** returns the number of key char repeats skipped by algui_dispatch_queue and algui_schedule_queue,
+    because the focus widget coalesces key repeats.
+    @param wgt widget of the tree to get the counter of.
+    @return the number of coalesced key events.
+ */
+unsigned long algui_get_coalesced_key_event_count(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->coalesced_key_event_count : 0;
 }
 
 
@@ -2013,23 +5154,13 @@ int algui_dispatch_event(ALGUI_WIDGET *wgt, ALLEGRO_EVENT *ev) {
         failure to remove the focus if the focus lies outside of the capture tree.
  */
 int algui_capture_events(ALGUI_WIDGET *wgt) {
-    ALGUI_WIDGET *root;
-
     assert(wgt);
     
-    root = algui_get_root_widget(wgt);
-        
-    //set the widget's capture value from the value of the current capture widget
-    wgt->capture = _get_capture_widget(root)->capture + 1;
-    
-    //if the value rolled below zero, then we have too many captures
-    if (wgt->capture < 0) {
-        wgt->capture = 0;
-        return 0;
-    }
+    //a widget that has already captured events is moved to the top of the stack
+    if (wgt->capture) algui_release_events(wgt);
     
-    //success
-    return 1;
+    //push the widget on the capture stack; it fails if there are too many captures
+    return _push_capture(_get_root_state(wgt), wgt);
 }
 
 
@@ -2041,9 +5172,17 @@ int algui_capture_events(ALGUI_WIDGET *wgt) {
     @return non-zero if the operation succeeded, zero if it failed due to the widget not having captured the events.
  */
 int algui_release_events(ALGUI_WIDGET *wgt) {
+    ALGUI_WIDGET_ROOT *state;
+    int i;
     assert(wgt);
     if (!wgt->capture) return 0;
-    wgt->capture = 0;
+    state = _find_root_state(wgt);
+    assert(state);
+    for(i = state->capture_count - 1; i >= 0; --i) {
+        if (state->captures[i] == wgt) break;
+    }
+    assert(i >= 0);
+    _remove_capture(state, i);
     return 1;
 }
 
@@ -2079,6 +5218,7 @@ int algui_begin_drag_and_drop(ALGUI_WIDGET *source) {
     
     //set up the flag
     source->data_source = 1;
+    _get_root_state(source)->drag_source = source;
     
     //success
     return 1;
@@ -2094,6 +5234,7 @@ int algui_begin_drag_and_drop(ALGUI_WIDGET *source) {
  */
 int algui_end_drag_and_drop(ALGUI_WIDGET *source) {    
     ALGUI_DRAG_AND_DROP_ENDED_MESSAGE msg;
+    ALGUI_WIDGET_ROOT *state;
     
     assert(source);
     assert(source->data_source != 0);
@@ -2109,6 +5250,8 @@ int algui_end_drag_and_drop(ALGUI_WIDGET *source) {
     
     //no more drag and drop
     source->data_source = 0;
+    state = _find_root_state(source);
+    if (state && state->drag_source == source) state->drag_source = NULL;
     
     //success
     return 1;
@@ -2121,7 +5264,10 @@ int algui_end_drag_and_drop(ALGUI_WIDGET *source) {
     @return the data soruce widget.
  */
 ALGUI_WIDGET *algui_get_drag_and_drop_source(ALGUI_WIDGET *wgt) {
-    return _get_data_source(algui_get_root_widget(wgt));
+    ALGUI_WIDGET_ROOT *state;
+    assert(wgt);
+    state = _find_root_state(wgt);
+    return state ? state->drag_source : NULL;
 }
 
 
@@ -2173,17 +5319,20 @@ void *algui_get_dragged_data(ALGUI_WIDGET *source, const char *format, ALGUI_DRA
     @return the allegro timer or NULL if the timer could not be created.
  */
 ALLEGRO_TIMER *algui_create_widget_timer(ALGUI_WIDGET *wgt, double secs, ALLEGRO_EVENT_QUEUE *queue) {
-    ALGUI_LIST_NODE *node;
+    ALGUI_WIDGET_TIMER *wgt_timer;
     ALLEGRO_TIMER *timer;
+    unsigned long size = _timers.size;
     assert(wgt);
     assert(secs > 0);
     assert(queue);
     timer = al_create_timer(secs);
     if (!timer) return NULL;
-    node = (ALGUI_LIST_NODE *)al_malloc(sizeof(ALGUI_LIST_NODE));
-    assert(node);
-    algui_init_list_node(node, timer);
-    algui_append_list_node(&wgt->timers, node);
+    wgt_timer = _allocate_timer();
+    algui_init_list_node(&wgt_timer->node, timer);
+    wgt_timer->widget = wgt;
+    algui_append_list_node(&wgt->timers, &wgt_timer->node);
+    algui_set_map_value(&_timers, timer, wgt_timer);
+    if (_timers.size != size) ++_timer_allocation_count;
     al_register_event_source(queue, al_get_timer_event_source(timer));
     al_start_timer(timer);
     return timer;
@@ -2196,11 +5345,11 @@ ALLEGRO_TIMER *algui_create_widget_timer(ALGUI_WIDGET *wgt, double secs, ALLEGRO
     @return non-zero if the operation is successful, zero otherwise.
  */
 int algui_destroy_widget_timer(ALGUI_WIDGET *wgt, ALLEGRO_TIMER *timer) {
-    ALGUI_LIST_NODE *node;
+    ALGUI_WIDGET_TIMER *wgt_timer;
     assert(wgt);
-    node = _find_timer(&wgt->timers, timer);
-    if (!node) return 0;
-    _destroy_timer(&wgt->timers, node);
+    wgt_timer = _find_timer(timer);
+    if (!wgt_timer || wgt_timer->widget != wgt) return 0;
+    _destroy_timer(wgt_timer);
     return 1;
 }
 
@@ -2214,12 +5363,107 @@ void algui_destroy_widget_timers(ALGUI_WIDGET *wgt) {
     assert(wgt);    
     for(node = algui_get_first_list_node(&wgt->timers); node;) {
         next = algui_get_next_list_node(node);
-        _destroy_timer(&wgt->timers, node);
+        _destroy_timer((ALGUI_WIDGET_TIMER *)node);
         node = next;
     }
 }
 
 
+/** starts the timer wheel.
+    Widget timers created with algui_create_widget_wheel_timer are driven by the timer wheel,
+    which is driven by a single allegro timer; the events of that timer must be dispatched
+    to the widget trees with algui_dispatch_event.
+    There is one timer wheel for all the widget trees: a tick event dispatched to any tree
+    expires the due wheel timers of every tree, each timer sending its message to its own widget.
+    Dispatching the same tick event to more trees does not advance the wheel again,
+    so the tick events need to be dispatched to one tree only.
+    @param queue event queue to register the tick timer with.
+    @param resolution seconds per tick; it should stay the same if the wheel is stopped and started again.
+    @return non-zero if the wheel was started, zero if the tick timer could not be created.
+ */
+int algui_start_timer_wheel(ALLEGRO_EVENT_QUEUE *queue, double resolution) {
+    assert(queue);
+    assert(resolution > 0);
+    assert(!_wheel_tick_timer);
+    _wheel_tick_timer = al_create_timer(resolution);
+    if (!_wheel_tick_timer) return 0;
+    _wheel_resolution = resolution;
+    _wheel_tick_base = algui_get_timer_wheel_time(&_wheel);
+    al_register_event_source(queue, al_get_timer_event_source(_wheel_tick_timer));
+    al_start_timer(_wheel_tick_timer);
+    return 1;
+}
+
+
+/** stops the timer wheel and destroys its allegro timer.
+    Wheel timers are kept; they do not expire until the wheel is started again.
+ */
+void algui_stop_timer_wheel() {
+    if (!_wheel_tick_timer) return;
+    al_destroy_timer(_wheel_tick_timer);
+    _wheel_tick_timer = NULL;
+}
+
+
+/** creates a timer for a widget on the timer wheel.
+    The widget receives timer messages with the timer in the 'wheel_timer' field.
+    The timer does not expire while the widget is hidden; 
+    it starts again one period after the widget is shown.
+    The timer wheel must have been started.
+    @param wgt widget to add the timer to.
+    @param secs seconds, in timeout; it is rounded to the resolution of the timer wheel.
+    @param tolerance seconds the timer may be delayed so as that it expires together with other timers.
+    @param one_shot if non-zero, the timer expires once; it is kept until it is destroyed.
+    @return the timer.
+ */
+ALGUI_TIMER *algui_create_widget_wheel_timer(ALGUI_WIDGET *wgt, double secs, double tolerance, int one_shot) {
+    ALGUI_TIMER *timer;
+    assert(wgt);
+    assert(secs > 0);
+    assert(tolerance >= 0);
+    assert(_wheel_resolution > 0);
+    timer = _allocate_wheel_timer();
+    algui_init_timer_wheel_entry(&timer->entry, timer);
+    algui_init_list_node(&timer->node, timer);
+    algui_append_list_node(&wgt->wheel_timers, &timer->node);
+    timer->widget = wgt;
+    timer->period = MAX(1, (int64_t)(secs / _wheel_resolution + 0.5));
+    timer->tolerance = (int64_t)(tolerance / _wheel_resolution);
+    timer->one_shot = one_shot;
+    timer->paused = 0;
+    timer->deadline = algui_get_timer_wheel_time(&_wheel) + timer->period;
+    algui_schedule_timer_wheel_entry(&_wheel, &timer->entry, timer->deadline, timer->tolerance);
+    return timer;
+}
+
+
+/** removes and destroys a wheel timer of a widget.
+    @param wgt widget to remove the timer from.
+    @param timer timer to destroy.
+    @return non-zero if the operation is successful, zero if the timer does not belong to the widget.
+ */
+int algui_destroy_widget_wheel_timer(ALGUI_WIDGET *wgt, ALGUI_TIMER *timer) {
+    assert(wgt);
+    assert(timer);
+    if (timer->widget != wgt) return 0;
+    _destroy_wheel_timer(timer);
+    return 1;
+}
+
+
+/** removes and destroys all wheel timers of a widget.
+    This function is called automatically from the default cleanup message handler.
+    @param wgt widget to remove the timers from.
+ */
+void algui_destroy_widget_wheel_timers(ALGUI_WIDGET *wgt) {
+    ALGUI_LIST_NODE *node;
+    assert(wgt);    
+    while ((node = algui_get_first_list_node(&wgt->wheel_timers))) {
+        _destroy_wheel_timer((ALGUI_TIMER *)algui_get_list_node_data(node));
+    }
+}
+
+
 /** allows the widgets in the tree to set themselves up from the given skin.
     Widgets receive a set-skin message.
     @param wgt root of tree to skin.
@@ -2262,8 +5506,136 @@ void algui_set_translation(ALGUI_WIDGET *wgt, ALLEGRO_CONFIG *config) {
     @param tbo the widget's tab order.
  */
 void algui_set_widget_tab_order(ALGUI_WIDGET *wgt, int tbo) {
+    ALGUI_WIDGET *parent;
     assert(wgt);
+    parent = algui_get_parent_widget(wgt);
+    if (parent) _remove_tab_index_child(parent, wgt);
     wgt->tab_order = tbo;
+    if (parent) _insert_tab_index_child(parent, wgt);
+}
+
+
+/** sets the spatial index mode of a widget.
+    A widget with a spatial index finds the child under a point
+    without sending a hit-test message to each one of its children;
+    it is useful for widgets with thousands of children.
+    @param wgt widget to set the spatial index mode of.
+    @param mode one of the ALGUI_SPATIAL_INDEX values.
+ */
+void algui_set_widget_spatial_index(ALGUI_WIDGET *wgt, int mode) {
+    assert(wgt);
+    assert(mode == ALGUI_SPATIAL_INDEX_AUTO || mode == ALGUI_SPATIAL_INDEX_ALWAYS || mode == ALGUI_SPATIAL_INDEX_NEVER);
+    wgt->spatial_index = mode;
+    _update_spatial_index(wgt);
+}
+
+
+/** sets the number of children above which widgets in automatic spatial index mode index their children.
+    The new threshold is applied to a widget the next time its children change.
+    @param count number of children.
+ */
+void algui_set_spatial_index_threshold(int count) {
+    assert(count >= 0);
+    _spatial_index_threshold = count;
+}
+
+
+/** sets the opaque status of a widget.
+    An opaque widget paints every pixel of its area, and therefore the widgets behind it
+    are not painted where it covers them. 
+    Widgets also get the opaque status from the 'opaque' value of the skin.
+    @param wgt widget to set the opaque status of.
+    @param opaque non-zero if the widget is opaque.
+ */
+void algui_set_widget_opaque(ALGUI_WIDGET *wgt, int opaque) {
+    assert(wgt);
+    opaque = opaque != 0;
+    if (wgt->opaque == opaque) return;
+    wgt->opaque = opaque;
+    
+    //the widgets behind are drawn again, in case they are no longer covered
+    if (wgt->drawn) _add_damage(wgt, _get_screen_rect(wgt));
+}
+
+
+/** sets the layout boundary status of a widget.
+    The size of a layout boundary does not depend on its children, like a container of fixed size;
+    when its children change, only the boundary is laid out again, not its ancestors.
+    @param wgt widget to set the layout boundary status of.
+    @param boundary non-zero if the widget is a layout boundary.
+ */
+void algui_set_widget_layout_boundary(ALGUI_WIDGET *wgt, int boundary) {
+    assert(wgt);
+    wgt->layout_boundary = boundary != 0;
+}
+
+
+/** sets the key repeat coalescing status of a widget.
+    When the widget has the focus, algui_dispatch_queue dispatches only the last of consecutive repeats 
+    of the same key char, which suits widgets that only need to catch up, like scrolling lists.
+    @param wgt widget to set the key repeat coalescing status of.
+    @param coalesce non-zero if the widget coalesces key repeats.
+ */
+void algui_set_widget_coalescing_key_repeats(ALGUI_WIDGET *wgt, int coalesce) {
+    assert(wgt);
+    wgt->coalesce_key_repeats = coalesce != 0;
+}
+
+
+/** sets the cacheable status of a widget.
+    A cacheable widget is drawn once, along with its children, into an offscreen bitmap;
+    the bitmap is then drawn instead of the widgets, until something changes in the area of the widget:
+    its rect, its skin, the visibility or the rects of its children, or an explicit invalidation.
+    The images of cacheable widgets share a memory budget; the least recently used images are destroyed 
+    to make room for new ones.
+    A cacheable widget should be opaque, or at least not blend its pixels, 
+    since its image is blended once more when drawn.
+    @param wgt widget to set the cacheable status of.
+    @param cacheable non-zero if the widget is cacheable.
+ */
+void algui_set_widget_cacheable(ALGUI_WIDGET *wgt, int cacheable) {
+    assert(wgt);
+    if (cacheable) {
+        if (wgt->cache) return;
+        wgt->cache = (ALGUI_WIDGET_CACHE *)al_malloc(sizeof(ALGUI_WIDGET_CACHE));
+        assert(wgt->cache);
+        algui_init_list_node(&wgt->cache->node, wgt->cache);
+        wgt->cache->bitmap = NULL;
+        wgt->cache->size = 0;
+        wgt->cache->valid = 0;
+        wgt->cache->rendering = 0;
+    }
+    else {
+        if (!wgt->cache) return;
+        _release_cache_bitmap(wgt->cache);
+        al_free(wgt->cache);
+        wgt->cache = NULL;
+    }
+}
+
+
+/** sets the memory budget of the render caches.
+    If the images of the render caches use more memory, the least recently used ones are destroyed.
+    @param size budget, in bytes.
+ */
+void algui_set_render_cache_budget(size_t size) {
+    _render_cache_budget = size;
+    _evict_render_caches(0);
+}
+
+
+/** sets the batched drawing mode.
+    In batched mode, bitmap drawing is held while widgets are painted, 
+    so as that consecutive bitmaps and text are submitted together; 
+    the batch is submitted when the clipping or the target bitmap changes.
+    Widgets are clipped to the visible area of their parent, instead of their own area,
+    so as that siblings share the clipping; therefore, widgets must not draw outside of their rect.
+    Widgets that draw anything other than bitmaps and text must release the hold while doing so
+    (see al_is_bitmap_drawing_held and al_hold_bitmap_drawing).
+    @param batched non-zero to enable batched drawing.
+ */
+void algui_set_batched_drawing(int batched) {
+    _batched_drawing = batched != 0;
 }
 
 
@@ -0,0 +1,259 @@
+#include "algui_widget_arena.h"
+#include <assert.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+
+
+/******************************************************************************
+    PRIVATE
+ ******************************************************************************/
+
+
+//alignment of the allocated structs
+#define _ALIGNMENT            16
+
+
+//rounds a size up to the alignment
+#define _ALIGN(S)             (((S) + _ALIGNMENT - 1) & ~(size_t)(_ALIGNMENT - 1))
+
+
+//returns the index of the first slab whose memory is above the given pointer
+static int _find_slab_position(ALGUI_WIDGET_ARENA *arena, const char *ptr) {
+    int lo = 0, hi = arena->slab_count, mid;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (arena->slabs[mid].memory <= ptr) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+
+//allocates a slab and inserts it in the slab array, in address order; returns the memory of the slab
+static char *_add_slab(ALGUI_WIDGET_ARENA *arena, size_t size) {
+    char *memory;
+    int i;
+
+    //grow the array
+    if (arena->slab_count == arena->slab_array_size) {
+        arena->slab_array_size = arena->slab_array_size ? arena->slab_array_size * 2 : 16;
+        arena->slabs = (ALGUI_WIDGET_ARENA_SLAB *)al_realloc(arena->slabs, arena->slab_array_size * sizeof(ALGUI_WIDGET_ARENA_SLAB));
+        assert(arena->slabs);
+    }
+
+    memory = (char *)al_malloc(size);
+    assert(memory);
+
+    i = _find_slab_position(arena, memory);
+    memmove(arena->slabs + i + 1, arena->slabs + i, (arena->slab_count - i) * sizeof(ALGUI_WIDGET_ARENA_SLAB));
+    arena->slabs[i].memory = memory;
+    arena->slabs[i].size = size;
+    ++arena->slab_count;
+    arena->reserved_size += size;
+    return memory;
+}
+
+
+/******************************************************************************
+    PUBLIC
+ ******************************************************************************/
+
+
+/** returns the number of bytes allocated from a widget arena.
+    @param arena arena to get the number of bytes of.
+    @return the number of bytes allocated, including alignment.
+ */
+size_t algui_get_widget_arena_used_size(ALGUI_WIDGET_ARENA *arena) {
+    assert(arena);
+    return arena->used_size;
+}
+
+
+/** returns the number of bytes a widget arena has reserved in slabs.
+    @param arena arena to get the number of bytes of.
+    @return the number of bytes reserved.
+ */
+size_t algui_get_widget_arena_reserved_size(ALGUI_WIDGET_ARENA *arena) {
+    assert(arena);
+    return arena->reserved_size;
+}
+
+
+/** returns the capacity of a widget arena.
+    @param arena arena to get the capacity of.
+    @return the capacity in bytes, or zero if the arena is growable.
+ */
+size_t algui_get_widget_arena_capacity(ALGUI_WIDGET_ARENA *arena) {
+    assert(arena);
+    return arena->capacity;
+}
+
+
+/** checks if a pointer points to memory allocated from a widget arena.
+    @param arena arena to check.
+    @param ptr pointer to check.
+    @return non-zero if the pointer belongs to the arena, zero otherwise.
+ */
+int algui_widget_arena_contains(ALGUI_WIDGET_ARENA *arena, const void *ptr) {
+    ALGUI_WIDGET_ARENA_SLAB *slab;
+    int i;
+    assert(arena);
+    i = _find_slab_position(arena, (const char *)ptr);
+    if (!i) return 0;
+    slab = &arena->slabs[i - 1];
+    return (const char *)ptr < slab->memory + slab->size;
+}
+
+
+/** initializes a widget arena.
+    @param arena arena to initialize.
+    @param slab_size size of the slabs; if zero, ALGUI_WIDGET_ARENA_SLAB_SIZE is used.
+    @param capacity if non-zero, the arena has fixed capacity:
+        it reserves the given number of bytes at once, and allocations fail when they are exhausted;
+        if zero, the arena grows as needed.
+ */
+void algui_init_widget_arena(ALGUI_WIDGET_ARENA *arena, size_t slab_size, size_t capacity) {
+    assert(arena);
+    arena->slabs = NULL;
+    arena->slab_count = 0;
+    arena->slab_array_size = 0;
+    arena->slab_size = _ALIGN(slab_size ? slab_size : ALGUI_WIDGET_ARENA_SLAB_SIZE);
+    arena->capacity = _ALIGN(capacity);
+    arena->next = NULL;
+    arena->limit = NULL;
+    arena->used_size = 0;
+    arena->reserved_size = 0;
+
+    //a fixed-capacity arena has a single slab
+    if (arena->capacity) {
+        arena->next = _add_slab(arena, arena->capacity);
+        arena->limit = arena->next + arena->capacity;
+    }
+}
+
+
+/** cleans up a widget arena.
+    All the memory of the arena is freed; the widgets allocated from it must have been cleaned up already.
+    @param arena arena to cleanup.
+ */
+void algui_cleanup_widget_arena(ALGUI_WIDGET_ARENA *arena) {
+    int i;
+    assert(arena);
+    for(i = 0; i < arena->slab_count; ++i) {
+        al_free(arena->slabs[i].memory);
+    }
+    al_free(arena->slabs);
+    arena->slabs = NULL;
+    arena->slab_count = 0;
+    arena->slab_array_size = 0;
+    arena->next = NULL;
+    arena->limit = NULL;
+    arena->used_size = 0;
+    arena->reserved_size = 0;
+}
+
+
+/** allocates and initializes a widget arena.
+    @param slab_size size of the slabs; if zero, ALGUI_WIDGET_ARENA_SLAB_SIZE is used.
+    @param capacity fixed capacity in bytes, or zero for a growable arena.
+    @return the new arena.
+ */
+ALGUI_WIDGET_ARENA *algui_create_widget_arena(size_t slab_size, size_t capacity) {
+    ALGUI_WIDGET_ARENA *arena = (ALGUI_WIDGET_ARENA *)al_malloc(sizeof(ALGUI_WIDGET_ARENA));
+    assert(arena);
+    algui_init_widget_arena(arena, slab_size, capacity);
+    return arena;
+}
+
+
+/** cleans up and frees a widget arena.
+    @param arena arena to destroy.
+ */
+void algui_destroy_widget_arena(ALGUI_WIDGET_ARENA *arena) {
+    assert(arena);
+    algui_cleanup_widget_arena(arena);
+    al_free(arena);
+}
+
+
+/** allocates memory for a widget struct from a widget arena.
+    The memory is not initialized; it is suitably aligned for any struct.
+    Structs larger than a slab get a slab of their own.
+    @param arena arena to allocate the memory from.
+    @param size size of the struct.
+    @return pointer to the memory, or NULL if a fixed-capacity arena is exhausted.
+ */
+void *algui_allocate_widget_arena_memory(ALGUI_WIDGET_ARENA *arena, size_t size) {
+    char *memory;
+
+    assert(arena);
+
+    size = size ? _ALIGN(size) : _ALIGNMENT;
+
+    //take the memory from the current slab, if it fits
+    if (size <= (size_t)(arena->limit - arena->next)) {
+        memory = arena->next;
+        arena->next += size;
+        arena->used_size += size;
+        return memory;
+    }
+
+    //a fixed-capacity arena does not grow
+    if (arena->capacity) return NULL;
+
+    //a large struct gets a slab of its own; the current slab stays current
+    if (size > arena->slab_size) {
+        memory = _add_slab(arena, size);
+    }
+
+    //else a new slab becomes current; the rest of the previous one is left unused
+    else {
+        memory = _add_slab(arena, arena->slab_size);
+        arena->next = memory + size;
+        arena->limit = memory + arena->slab_size;
+    }
+
+    arena->used_size += size;
+    return memory;
+}
+
+
+/** frees all the memory allocated from a widget arena at once.
+    A growable arena keeps one slab for the next allocations and frees the rest;
+    a fixed-capacity arena keeps all its memory.
+    The widgets allocated from the arena must have been cleaned up already.
+    @param arena arena to reset.
+ */
+void algui_reset_widget_arena(ALGUI_WIDGET_ARENA *arena) {
+    int i, kept = -1;
+
+    assert(arena);
+
+    //a growable arena keeps its first slab of regular size
+    if (!arena->capacity) {
+        for(i = 0; i < arena->slab_count; ++i) {
+            if (kept < 0 && arena->slabs[i].size == arena->slab_size) {
+                kept = i;
+                continue;
+            }
+            al_free(arena->slabs[i].memory);
+        }
+        if (kept >= 0) {
+            arena->slabs[0] = arena->slabs[kept];
+            arena->slab_count = 1;
+        }
+        else {
+            arena->slab_count = 0;
+        }
+        arena->reserved_size = arena->slab_count ? arena->slab_size : 0;
+    }
+
+    if (arena->slab_count) {
+        arena->next = arena->slabs[0].memory;
+        arena->limit = arena->next + arena->slabs[0].size;
+    }
+    else {
+        arena->next = NULL;
+        arena->limit = NULL;
+    }
+    arena->used_size = 0;
+}
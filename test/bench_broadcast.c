@@ -0,0 +1,102 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of containers under the root, and of leaves in each container
+#define CONTAINER_COUNT 100
+#define LEAF_COUNT 1000
+
+
+//number of broadcasts timed
+#define BROADCAST_COUNT 100
+
+
+//the widgets
+static ALGUI_WIDGET root, containers[CONTAINER_COUNT], leaves[CONTAINER_COUNT][LEAF_COUNT];
+
+
+//number of calls to the widget procs, per message
+static long key_calls = 0;
+static long cleanup_calls = 0;
+
+
+//a widget that ignores unused keys
+static int counting_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    switch (msg->id) {
+        case ALGUI_MSG_UNUSED_KEY_DOWN:
+            ++key_calls;
+            break;
+        case ALGUI_MSG_CLEANUP:
+            ++cleanup_calls;
+            break;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//sets the message mask of every widget
+static void set_masks(ALGUI_MESSAGE_MASK mask) {
+    int i, j;
+    algui_set_widget_message_mask(&root, mask);
+    for(i = 0; i < CONTAINER_COUNT; ++i) {
+        algui_set_widget_message_mask(&containers[i], mask);
+        for(j = 0; j < LEAF_COUNT; ++j) {
+            algui_set_widget_message_mask(&leaves[i][j], mask);
+        }
+    }
+}
+
+
+//broadcasts an unused key repeatedly and reports the time per broadcast
+static void bench_broadcast(const char *name) {
+    ALGUI_UNUSED_KEY_DOWN_MESSAGE msg;
+    double start;
+    int i;
+    msg.message.id = ALGUI_MSG_UNUSED_KEY_DOWN;
+    msg.event = NULL;
+    msg.keycode = 0;
+    key_calls = 0;
+    start = al_get_time();
+    for(i = 0; i < BROADCAST_COUNT; ++i) {
+        algui_broadcast_message(&root, &msg.message);
+    }
+    test_report(name, al_get_time() - start, BROADCAST_COUNT);
+    printf("%s: %ld proc calls per broadcast\n", name, key_calls / BROADCAST_COUNT);
+}
+
+
+int main() {
+    int i, j;
+    
+    al_init();
+    algui_init_widget(&root, counting_proc, "root");
+    for(i = 0; i < CONTAINER_COUNT; ++i) {
+        algui_init_widget(&containers[i], counting_proc, "container");
+        algui_add_widget(&root, &containers[i]);
+        for(j = 0; j < LEAF_COUNT; ++j) {
+            algui_init_widget(&leaves[i][j], counting_proc, "leaf");
+            algui_add_widget(&containers[i], &leaves[i][j]);
+        }
+    }
+    
+    //every widget proc gets the message
+    bench_broadcast("bench_broadcast: all widgets");
+    TEST_CHECK(key_calls == BROADCAST_COUNT * (1 + CONTAINER_COUNT + CONTAINER_COUNT * LEAF_COUNT));
+    
+    //no widget handles unused keys; the broadcast stops at the root
+    set_masks(0);
+    bench_broadcast("bench_broadcast: no widget");
+    TEST_CHECK(key_calls == 0);
+    
+    //one leaf handles unused keys; only the path to it is visited
+    algui_set_widget_message_mask(&leaves[CONTAINER_COUNT / 2][LEAF_COUNT / 2], ALGUI_MESSAGE_BIT(ALGUI_MSG_UNUSED_KEY_DOWN));
+    bench_broadcast("bench_broadcast: one widget");
+    TEST_CHECK(key_calls == BROADCAST_COUNT);
+    
+    //the messages of the default widget procedure reach every widget proc, whatever the masks
+    algui_cleanup_widget(&root);
+    TEST_CHECK(cleanup_calls == 1 + CONTAINER_COUNT + CONTAINER_COUNT * LEAF_COUNT);
+    
+    return test_result("bench_broadcast");
+}
@@ -0,0 +1,99 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of panels in the container, and of items in each panel
+#define PANEL_COUNT 100
+#define ITEM_COUNT 100
+
+
+//number of steps of each drag
+#define STEP_COUNT 1000
+
+
+//the widgets
+static ALGUI_WIDGET root, container, panels[PANEL_COUNT], items[PANEL_COUNT][ITEM_COUNT];
+
+
+//a widget that keeps its size and draws nothing
+static int static_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    switch (msg->id) {
+        case ALGUI_MSG_SET_PREFERRED_RECT:
+        case ALGUI_MSG_DO_LAYOUT:
+        case ALGUI_MSG_PAINT:
+            return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//initializes a widget at the given place
+static void init_widget(ALGUI_WIDGET *wgt, ALGUI_WIDGET *parent, int x, int y, int w, int h) {
+    algui_init_widget(wgt, static_proc, "widget");
+    algui_move_and_resize_widget(wgt, x, y, w, h);
+    if (parent) algui_add_widget(parent, wgt);
+}
+
+
+int main() {
+    int i, j;
+    double start;
+    ALGUI_WIDGET *hit;
+    ALGUI_RECT rect;
+    ALLEGRO_BITMAP *target;
+    
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(4000, 4000);
+    al_set_target_bitmap(target);
+    
+    //a container of 10k descendants
+    init_widget(&root, NULL, 0, 0, 4000, 4000);
+    init_widget(&container, &root, 0, 0, 1000, 1000);
+    for(i = 0; i < PANEL_COUNT; ++i) {
+        init_widget(&panels[i], &container, (i % 10) * 100, (i / 10) * 100, 100, 100);
+        for(j = 0; j < ITEM_COUNT; ++j) {
+            init_widget(&items[i][j], &panels[i], (j % 10) * 10, (j / 10) * 10, 10, 10);
+        }
+    }
+    algui_draw_widget(&root);
+    
+    //moving the container only invalidates the screen rects; the ones used are recalculated
+    start = al_get_time();
+    for(i = 0; i < STEP_COUNT; ++i) {
+        algui_move_widget(&container, i % 500, i % 300);
+    }
+    test_report("bench_drag: move", al_get_time() - start, STEP_COUNT);
+    
+    start = al_get_time();
+    for(i = 0; i < STEP_COUNT; ++i) {
+        algui_move_widget(&container, i % 500, i % 300);
+        hit = algui_get_widget_from_point(&root, 600, 400);
+        rect = algui_get_widget_screen_rect(hit);
+        TEST_CHECK(algui_rect_intersects_point(&rect, 600, 400));
+    }
+    test_report("bench_drag: move and hit test", al_get_time() - start, STEP_COUNT);
+    
+    start = al_get_time();
+    for(i = 0; i < STEP_COUNT / 10; ++i) {
+        algui_move_widget(&container, i % 500, i % 300);
+        algui_draw_invalidated(&root);
+    }
+    test_report("bench_drag: move and draw", al_get_time() - start, STEP_COUNT / 10);
+    
+    for(i = PANEL_COUNT - 1; i >= 0; --i) {
+        for(j = ITEM_COUNT - 1; j >= 0; --j) {
+            algui_detach_widget(&items[i][j]);
+            algui_cleanup_widget(&items[i][j]);
+        }
+        algui_detach_widget(&panels[i]);
+        algui_cleanup_widget(&panels[i]);
+    }
+    algui_detach_widget(&container);
+    algui_cleanup_widget(&container);
+    algui_cleanup_widget(&root);
+    al_destroy_bitmap(target);
+    
+    return test_result("bench_drag");
+}
@@ -0,0 +1,113 @@
+#include <allegro5/allegro.h>
+#include "algui_rect.h"
+#include "test.h"
+
+
+//number of rectangles in each operand region
+#define RECT_COUNT 64
+
+
+//number of times each operation is repeated
+#define ITERATION_COUNT 20000
+
+
+//the rectangles of the operand regions
+static ALGUI_RECT rects1[RECT_COUNT], rects2[RECT_COUNT];
+
+
+//fills an array with random rectangles within a 1024 x 768 area
+static void make_random_rects(ALGUI_RECT *rects) {
+    int i, x, y;
+    for(i = 0; i < RECT_COUNT; ++i) {
+        x = test_random(1024 - 64);
+        y = test_random(768 - 64);
+        algui_set_rect(&rects[i], x, y, x + 8 + test_random(56), y + 8 + test_random(56));
+    }
+}
+
+
+//sets a region to the union of an array of rectangles
+static void make_region(ALGUI_REGION *rgn, ALGUI_RECT *rects) {
+    int i;
+    algui_clear_region(rgn);
+    for(i = 0; i < RECT_COUNT; ++i) {
+        algui_add_region_rect(rgn, &rects[i]);
+    }
+}
+
+
+//runs a region operation repeatedly and reports its time;
+//checks that the destination keeps its storage after the first run
+static void bench_operation(const char *name, void (*op)(ALGUI_REGION *, ALGUI_REGION *, ALGUI_REGION *), ALGUI_REGION *r1, ALGUI_REGION *r2, ALGUI_REGION *r) {
+    int i;
+    ALGUI_RECT *rects;
+    double start;
+    op(r1, r2, r);
+    rects = r->rects;
+    start = al_get_time();
+    for(i = 0; i < ITERATION_COUNT; ++i) {
+        op(r1, r2, r);
+    }
+    test_report(name, al_get_time() - start, ITERATION_COUNT);
+    TEST_CHECK(r->rects == rects);
+}
+
+
+int main() {
+    int i, j;
+    double start;
+    ALGUI_REGION r1, r2, r;
+    ALGUI_RECT clip;
+    
+    al_init();
+    algui_init_region(&r1);
+    algui_init_region(&r2);
+    algui_init_region(&r);
+    make_random_rects(rects1);
+    make_random_rects(rects2);
+    make_region(&r1, rects1);
+    make_region(&r2, rects2);
+    printf("bench_regions: %d and %d rectangles\n", r1.count, r2.count);
+    
+    bench_operation("bench_regions: union", algui_get_region_union, &r1, &r2, &r);
+    for(i = 0; i < RECT_COUNT; ++i) {
+        TEST_CHECK(algui_region_contains_rect(&r, &rects1[i]));
+        TEST_CHECK(algui_region_contains_rect(&r, &rects2[i]));
+    }
+    bench_operation("bench_regions: intersection", algui_get_region_intersection, &r1, &r2, &r);
+    bench_operation("bench_regions: difference", algui_get_region_difference, &r1, &r2, &r);
+    for(i = 0; i < RECT_COUNT; ++i) {
+        TEST_CHECK(!algui_region_intersects_rect(&r, &rects2[i]));
+    }
+    
+    //accumulation of dirty rectangles, as in the invalidation of widgets
+    start = al_get_time();
+    for(i = 0; i < ITERATION_COUNT / RECT_COUNT; ++i) {
+        make_region(&r, rects1);
+    }
+    test_report("bench_regions: add rectangle", al_get_time() - start, ITERATION_COUNT / RECT_COUNT * RECT_COUNT);
+    
+    start = al_get_time();
+    for(i = 0; i < ITERATION_COUNT / RECT_COUNT; ++i) {
+        algui_copy_region(&r, &r1);
+        make_random_rects(rects2);
+        for(j = 0; j < RECT_COUNT; ++j) {
+            algui_subtract_region_rect(&r, &rects2[j]);
+        }
+    }
+    test_report("bench_regions: subtract rectangle", al_get_time() - start, ITERATION_COUNT / RECT_COUNT * RECT_COUNT);
+    
+    algui_set_rect(&clip, 256, 192, 767, 575);
+    start = al_get_time();
+    for(i = 0; i < ITERATION_COUNT; ++i) {
+        algui_copy_region(&r, &r1);
+        algui_clip_region(&r, &clip);
+    }
+    test_report("bench_regions: clip", al_get_time() - start, ITERATION_COUNT);
+    
+    algui_cleanup_region(&r);
+    algui_cleanup_region(&r2);
+    algui_cleanup_region(&r1);
+    
+    return test_result("bench_regions");
+}
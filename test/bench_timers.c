@@ -0,0 +1,107 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of widgets, each with one timer
+#define WIDGET_COUNT 10000
+
+
+//seconds per timer period
+#define TIMER_PERIOD 0.1
+
+
+//seconds per tick of the timer wheel
+#define WHEEL_RESOLUTION 0.01
+
+
+//seconds each kind of timer runs for
+#define RUN_TIME 1.0
+
+
+//the widgets; the first one is the root
+static ALGUI_WIDGET widgets[WIDGET_COUNT + 1];
+
+
+//number of timer messages received
+static long timer_messages = 0;
+
+
+//counts the timer messages
+static int timer_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    if (msg->id == ALGUI_MSG_TIMER) ++timer_messages;
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//dispatches the events of the queue for the given time; returns the time spent in dispatching them
+static double run_queue(ALLEGRO_EVENT_QUEUE *queue, long *events) {
+    ALLEGRO_EVENT ev;
+    double end = al_get_time() + RUN_TIME, start, result = 0;
+    *events = 0;
+    while (al_get_time() < end) {
+        if (!al_wait_for_event_timed(queue, &ev, 0.01)) continue;
+        start = al_get_time();
+        algui_dispatch_event(&widgets[0], &ev);
+        result += al_get_time() - start;
+        ++*events;
+    }
+    return result;
+}
+
+
+int main() {
+    int i;
+    long events, messages;
+    double start, secs;
+    ALLEGRO_EVENT_QUEUE *queue;
+    
+    al_init();
+    queue = al_create_event_queue();
+    
+    algui_init_widget(&widgets[0], algui_widget_proc, "root");
+    for(i = 1; i <= WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], timer_proc, "widget");
+        algui_add_widget(&widgets[0], &widgets[i]);
+    }
+    
+    //one allegro timer per widget
+    start = al_get_time();
+    for(i = 1; i <= WIDGET_COUNT; ++i) {
+        TEST_CHECK(algui_create_widget_timer(&widgets[i], TIMER_PERIOD, queue) != NULL);
+    }
+    test_report("bench_timers: create allegro timers", al_get_time() - start, WIDGET_COUNT);
+    timer_messages = 0;
+    secs = run_queue(queue, &events);
+    messages = timer_messages;
+    printf("bench_timers: allegro timers: %ld events, %ld messages\n", events, messages);
+    test_report("bench_timers: dispatch allegro timer events", secs, messages);
+    TEST_CHECK(messages > 0);
+    for(i = 1; i <= WIDGET_COUNT; ++i) {
+        algui_destroy_widget_timers(&widgets[i]);
+    }
+    al_flush_event_queue(queue);
+    
+    //one wheel timer per widget
+    TEST_CHECK(algui_start_timer_wheel(queue, WHEEL_RESOLUTION));
+    start = al_get_time();
+    for(i = 1; i <= WIDGET_COUNT; ++i) {
+        TEST_CHECK(algui_create_widget_wheel_timer(&widgets[i], TIMER_PERIOD, 0, 0) != NULL);
+    }
+    test_report("bench_timers: create wheel timers", al_get_time() - start, WIDGET_COUNT);
+    timer_messages = 0;
+    secs = run_queue(queue, &events);
+    messages = timer_messages;
+    printf("bench_timers: wheel timers: %ld events, %ld messages\n", events, messages);
+    test_report("bench_timers: dispatch wheel timer events", secs, messages);
+    TEST_CHECK(messages > 0);
+    algui_stop_timer_wheel();
+    
+    for(i = WIDGET_COUNT; i >= 0; --i) {
+        algui_detach_widget(&widgets[i]);
+        algui_cleanup_widget(&widgets[i]);
+    }
+    al_destroy_event_queue(queue);
+    
+    return test_result("bench_timers");
+}
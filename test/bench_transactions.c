@@ -0,0 +1,145 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of rows in the list
+#define ROW_COUNT 50000
+
+
+//height of a row
+#define ROW_HEIGHT 10
+
+
+//the widgets
+static ALGUI_WIDGET root, list, hold, rows[ROW_COUNT];
+
+
+//stacks the visible children of a widget vertically
+static int stack_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_WIDGET *child;
+    int h = 0;
+    switch (msg->id) {
+        case ALGUI_MSG_SET_PREFERRED_RECT:
+            for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+                if (algui_is_widget_visible(child)) h += algui_get_widget_height(child);
+            }
+            algui_resize_widget(wgt, 100, h ? h : 1);
+            return 1;
+        case ALGUI_MSG_DO_LAYOUT:
+            for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+                if (!algui_is_widget_visible(child)) continue;
+                algui_move_widget(child, 0, h);
+                h += algui_get_widget_height(child);
+            }
+            return 1;
+        case ALGUI_MSG_PAINT:
+            return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//a row; it keeps its size and draws nothing
+static int row_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    switch (msg->id) {
+        case ALGUI_MSG_SET_PREFERRED_RECT:
+        case ALGUI_MSG_DO_LAYOUT:
+        case ALGUI_MSG_PAINT:
+            return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//starts a timed step; in a transaction, the step is a bulk update
+static double begin_step(int transaction) {
+    if (transaction) algui_begin_update();
+    return al_get_time();
+}
+
+
+//ends a timed step, after the pending work is done and the damage is drawn
+static void end_step(int transaction, const char *name, double start, long count) {
+    if (transaction) algui_end_update();
+    algui_draw_invalidated(&root);
+    test_report(name, al_get_time() - start, count);
+}
+
+
+//fills the list, filters it and refills it, with a call per row; if 'transaction' is set, each step is a bulk update
+static void run(int transaction) {
+    int i;
+    double start;
+    
+    algui_init_widget(&root, stack_proc, "root");
+    algui_init_widget(&list, stack_proc, "list");
+    algui_init_widget(&hold, stack_proc, "hold");
+    algui_resize_widget(&root, 100, 100);
+    algui_add_widget(&root, &list);
+    for(i = 0; i < ROW_COUNT; ++i) {
+        algui_init_widget(&rows[i], row_proc, "row");
+        algui_resize_widget(&rows[i], 100, ROW_HEIGHT);
+    }
+    algui_draw_widget(&root);
+    
+    start = begin_step(transaction);
+    for(i = 0; i < ROW_COUNT; ++i) {
+        algui_add_widget(&list, &rows[i]);
+    }
+    end_step(transaction, transaction ? "bench_transactions: bulk add" : "bench_transactions: add", start, ROW_COUNT);
+    TEST_CHECK(algui_get_widget_height(&list) == ROW_COUNT * ROW_HEIGHT);
+    
+    start = begin_step(transaction);
+    for(i = 0; i < ROW_COUNT; i += 2) {
+        algui_hide_widget(&rows[i]);
+    }
+    end_step(transaction, transaction ? "bench_transactions: bulk filter" : "bench_transactions: filter", start, ROW_COUNT / 2);
+    TEST_CHECK(algui_get_widget_height(&list) == ROW_COUNT / 2 * ROW_HEIGHT);
+    
+    start = begin_step(transaction);
+    for(i = 0; i < ROW_COUNT; ++i) {
+        algui_remove_widget(&list, &rows[i]);
+    }
+    for(i = 0; i < ROW_COUNT; ++i) {
+        algui_add_widget(&list, &rows[i]);
+    }
+    end_step(transaction, transaction ? "bench_transactions: bulk remove and add" : "bench_transactions: remove and add", start, ROW_COUNT * 2);
+    TEST_CHECK(algui_get_widget_child_count(&list) == ROW_COUNT);
+    
+    //the splicing of the whole range takes constant time, plus the work on the moved widgets
+    if (!transaction) {
+        start = al_get_time();
+        algui_splice_widgets(&hold, &rows[0], &rows[ROW_COUNT - 1], NULL);
+        algui_splice_widgets(&list, &rows[0], &rows[ROW_COUNT - 1], NULL);
+        algui_draw_invalidated(&root);
+        test_report("bench_transactions: splice out and in", al_get_time() - start, ROW_COUNT * 2);
+        TEST_CHECK(algui_get_widget_child_count(&list) == ROW_COUNT);
+        TEST_CHECK(algui_get_widget_child_count(&hold) == 0);
+    }
+    
+    for(i = ROW_COUNT - 1; i >= 0; --i) {
+        algui_detach_widget(&rows[i]);
+        algui_cleanup_widget(&rows[i]);
+    }
+    algui_detach_widget(&list);
+    algui_cleanup_widget(&list);
+    algui_cleanup_widget(&hold);
+    algui_cleanup_widget(&root);
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(100, 100);
+    al_set_target_bitmap(target);
+    
+    run(0);
+    run(1);
+    
+    al_destroy_bitmap(target);
+    return test_result("bench_transactions");
+}
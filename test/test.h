@@ -0,0 +1,44 @@
+#ifndef ALGUI_TEST_H
+#define ALGUI_TEST_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <allegro5/allegro.h>
+
+
+//number of failed checks
+static int _test_failures = 0;
+
+
+//checks a condition; a failed check is reported, and the test goes on
+#define TEST_CHECK(COND) do {\
+    if (!(COND)) {\
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND);\
+        ++_test_failures;\
+    }\
+} while (0)
+
+
+//returns the exit status of a test, after reporting its result
+static int test_result(const char *name) {
+    printf("%s: %s\n", name, _test_failures ? "FAILED" : "ok");
+    return _test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+//reports the time taken by a benchmark, in total and per operation
+static inline void test_report(const char *name, double secs, long count) {
+    printf("%s: %.3f ms, %.1f ns per operation\n", name, secs * 1000.0, count > 0 ? secs * 1e9 / count : 0.0);
+}
+
+
+//returns a pseudo-random number from 0 to n - 1; the sequence is the same on every run
+static inline int test_random(int n) {
+    static unsigned long seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    return (int)((seed >> 16) % (unsigned long)n);
+}
+
+
+#endif //ALGUI_TEST_H
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui.h"
+#include "algui_atlas.h"
+#include "algui_resource_manager.h"
+#include "test.h"
+
+
+//size of the pages
+#define PAGE_SIZE 64
+
+
+//empty space around packed bitmaps
+#define PADDING 1
+
+
+//number of bitmaps; the first half is added one by one, the second half at once
+#define BITMAP_COUNT 60
+#define SINGLE_COUNT (BITMAP_COUNT / 2)
+
+
+//maximum number of pages
+#define MAX_PAGES BITMAP_COUNT
+
+
+//index of a bitmap that is rejected for its name after it is copied into a page
+#define REJECTED BITMAP_COUNT
+
+
+//the resources of the bitmaps, their names and sizes
+static ALLEGRO_BITMAP *bitmaps[BITMAP_COUNT];
+static char names[BITMAP_COUNT][16];
+static int widths[BITMAP_COUNT + 1];
+static int heights[BITMAP_COUNT + 1];
+
+
+//the page each bitmap is expected in; -1 for oversized bitmaps
+static int pages[BITMAP_COUNT + 1];
+
+
+//the expected shelves of the pages
+static int shelf_x[MAX_PAGES];
+static int shelf_y[MAX_PAGES];
+static int shelf_height[MAX_PAGES];
+static int page_count;
+
+
+//the expected area of the pages used by bitmaps; the room of the rejected bitmap stays taken, but it is not used
+static long used_area;
+
+
+//the destroyed resources
+static void *destroyed[BITMAP_COUNT + MAX_PAGES];
+static int destroyed_count;
+
+
+//the acquired bitmaps
+static int acquired[BITMAP_COUNT];
+
+
+//records the destroyed resources
+static void destroy_hook(void *res) {
+    TEST_CHECK(destroyed_count < BITMAP_COUNT + MAX_PAGES);
+    destroyed[destroyed_count++] = res;
+}
+
+
+//checks if a resource was destroyed
+static int is_destroyed(void *res) {
+    int i;
+    for(i = 0; i < destroyed_count; ++i) {
+        if (destroyed[i] == res) return 1;
+    }
+    return 0;
+}
+
+
+//creates a bitmap of the given size, filled with the color of the given index
+static ALLEGRO_BITMAP *create_bitmap(int i, int w, int h) {
+    ALLEGRO_BITMAP *target = al_get_target_bitmap();
+    ALLEGRO_BITMAP *bmp = al_create_bitmap(w, h);
+    al_set_target_bitmap(bmp);
+    al_clear_to_color(al_map_rgb(i + 1, 0, 0));
+    al_set_target_bitmap(target);
+    return bmp;
+}
+
+
+//returns the index of the bitmap of a pixel; -1 for empty pixels
+static int pixel_index(ALLEGRO_BITMAP *bmp, int x, int y) {
+    ALLEGRO_COLOR c = al_get_pixel(bmp, x, y);
+    return (int)(c.r * 255 + 0.5f) - 1;
+}
+
+
+//places a bitmap in the shelves of the pages, like the atlas does:
+//in the current shelf of the first page with room, or in a new shelf below it, or in a new page
+static void place(int i) {
+    int w = widths[i], h = heights[i], p;
+
+    if (w + PADDING * 2 > PAGE_SIZE || h + PADDING * 2 > PAGE_SIZE) {
+        pages[i] = -1;
+        return;
+    }
+
+    for(p = 0; ; ++p) {
+        if (p == page_count) {
+            TEST_CHECK(page_count < MAX_PAGES);
+            shelf_x[p] = shelf_y[p] = PADDING;
+            shelf_height[p] = 0;
+            ++page_count;
+        }
+        if (shelf_x[p] + w + PADDING <= PAGE_SIZE && shelf_y[p] + h + PADDING <= PAGE_SIZE && (h <= shelf_height[p] || shelf_x[p] == PADDING)) {
+            shelf_x[p] += w + PADDING;
+            if (h > shelf_height[p]) shelf_height[p] = h;
+            break;
+        }
+        if (shelf_height[p] > 0 && shelf_y[p] + shelf_height[p] + PADDING + h + PADDING <= PAGE_SIZE) {
+            shelf_y[p] += shelf_height[p] + PADDING;
+            shelf_x[p] = PADDING + w + PADDING;
+            shelf_height[p] = h;
+            break;
+        }
+    }
+    pages[i] = p;
+    if (i != REJECTED) used_area += (long)w * h;
+}
+
+
+//checks the pages and the bitmaps of an atlas against the expected ones
+static void check_atlas(ALGUI_ATLAS *atlas, int count) {
+    ALLEGRO_BITMAP *page;
+    int pixels[BITMAP_COUNT + 1];
+    int i, p, x, y, a, b;
+
+    TEST_CHECK(algui_get_atlas_page_count(atlas) == page_count);
+    TEST_CHECK(page_count > 0);
+    TEST_CHECK(algui_get_atlas_occupancy(atlas) == used_area / ((double)PAGE_SIZE * PAGE_SIZE * page_count));
+
+    for(i = 0; i < count; ++i) {
+        TEST_CHECK(bitmaps[i] != NULL);
+        TEST_CHECK(al_get_bitmap_width(bitmaps[i]) == widths[i]);
+        TEST_CHECK(al_get_bitmap_height(bitmaps[i]) == heights[i]);
+
+        //oversized bitmaps stay standalone
+        if (pages[i] < 0) {
+            TEST_CHECK(al_get_parent_bitmap(bitmaps[i]) == NULL);
+            TEST_CHECK(pixel_index(bitmaps[i], 0, 0) == i);
+            continue;
+        }
+
+        //packed bitmaps are sub-bitmaps of their pages, with their own pixels
+        TEST_CHECK(al_get_parent_bitmap(bitmaps[i]) == algui_get_atlas_page(atlas, pages[i]));
+        for(y = 0; y < heights[i]; ++y) {
+            for(x = 0; x < widths[i]; ++x) {
+                TEST_CHECK(pixel_index(bitmaps[i], x, y) == i);
+            }
+        }
+    }
+
+    //each bitmap is copied into its page once, without overlapping the others, and the padding keeps them apart
+    for(p = 0; p < page_count; ++p) {
+        page = algui_get_atlas_page(atlas, p);
+        memset(pixels, 0, sizeof(pixels));
+        for(y = 0; y < PAGE_SIZE; ++y) {
+            for(x = 0; x < PAGE_SIZE; ++x) {
+                a = pixel_index(page, x, y);
+                if (a < 0) continue;
+                TEST_CHECK((a < count || a == REJECTED) && pages[a] == p);
+                ++pixels[a];
+                TEST_CHECK(x >= PADDING && y >= PADDING && x < PAGE_SIZE - PADDING && y < PAGE_SIZE - PADDING);
+                b = x + 1 < PAGE_SIZE ? pixel_index(page, x + 1, y) : -1;
+                TEST_CHECK(b < 0 || b == a);
+                b = y + 1 < PAGE_SIZE ? pixel_index(page, x, y + 1) : -1;
+                TEST_CHECK(b < 0 || b == a);
+            }
+        }
+        for(i = 0; i <= REJECTED; ++i) {
+            if ((i < count || i == REJECTED) && pages[i] == p) TEST_CHECK(pixels[i] == widths[i] * heights[i]);
+        }
+    }
+}
+
+
+//checks that a page is destroyed exactly when none of its bitmaps is acquired
+static void check_pages_destroyed(ALLEGRO_BITMAP **page_bitmaps) {
+    int p, i, used;
+    for(p = 0; p < page_count; ++p) {
+        used = 0;
+        for(i = 0; i < BITMAP_COUNT; ++i) {
+            if (acquired[i] && pages[i] == p) used = 1;
+        }
+        TEST_CHECK(is_destroyed(page_bitmaps[p]) == !used);
+    }
+}
+
+
+int main() {
+    ALGUI_ATLAS *atlas;
+    ALLEGRO_BITMAP *target, *batch[BITMAP_COUNT - SINGLE_COUNT], *page_bitmaps[MAX_PAGES];
+    const char *batch_names[BITMAP_COUNT - SINGLE_COUNT];
+    int i, j, k, n, order[BITMAP_COUNT - SINGLE_COUNT], released[BITMAP_COUNT];
+
+    al_init();
+    algui_init();
+    algui_add_resource_destroy_hook(destroy_hook);
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(1, 1);
+    al_set_target_bitmap(target);
+
+    atlas = algui_create_atlas(PAGE_SIZE, PAGE_SIZE, PADDING);
+    TEST_CHECK(algui_get_atlas_occupancy(atlas) == 0);
+
+    //bitmaps of random sizes, some of them too large for a page, added one by one
+    for(i = 0; i < SINGLE_COUNT; ++i) {
+        sprintf(names[i], "bitmap %d", i);
+        widths[i] = 1 + test_random(30);
+        heights[i] = 1 + test_random(30);
+        if (test_random(8) == 0) widths[i] = PAGE_SIZE - PADDING * 2 + 1 + test_random(20);
+        place(i);
+        bitmaps[i] = algui_add_atlas_bitmap(atlas, create_bitmap(i, widths[i], heights[i]), names[i]);
+        TEST_CHECK(bitmaps[i] != NULL);
+    }
+    check_atlas(atlas, SINGLE_COUNT);
+
+    //a bitmap with the name of an existing resource is not added, and its area is not counted
+    widths[REJECTED] = heights[REJECTED] = 8;
+    place(REJECTED);
+    TEST_CHECK(algui_add_atlas_bitmap(atlas, create_bitmap(REJECTED, 8, 8), names[0]) == NULL);
+    TEST_CHECK(algui_add_atlas_bitmap(atlas, create_bitmap(REJECTED, PAGE_SIZE * 2, 8), names[1]) == NULL);
+    check_atlas(atlas, SINGLE_COUNT);
+
+    //bitmaps of different heights added at once are packed tallest first
+    for(i = 0; i < BITMAP_COUNT - SINGLE_COUNT; ++i) {
+        order[i] = i;
+    }
+    for(i = BITMAP_COUNT - SINGLE_COUNT - 1; i > 0; --i) {
+        j = test_random(i + 1);
+        k = order[i];
+        order[i] = order[j];
+        order[j] = k;
+    }
+    for(i = 0; i < BITMAP_COUNT - SINGLE_COUNT; ++i) {
+        n = SINGLE_COUNT + i;
+        sprintf(names[n], "bitmap %d", n);
+        widths[n] = 1 + test_random(30);
+        heights[n] = 1 + order[i];
+        batch[i] = create_bitmap(n, widths[n], heights[n]);
+        batch_names[i] = names[n];
+    }
+    for(k = BITMAP_COUNT - SINGLE_COUNT; k > 0; --k) {
+        for(i = 0; heights[SINGLE_COUNT + i] != k; ++i);
+        place(SINGLE_COUNT + i);
+    }
+    TEST_CHECK(algui_add_atlas_bitmaps(atlas, batch, batch_names, BITMAP_COUNT - SINGLE_COUNT) == BITMAP_COUNT - SINGLE_COUNT);
+    for(i = SINGLE_COUNT; i < BITMAP_COUNT; ++i) {
+        bitmaps[i] = (ALLEGRO_BITMAP *)algui_acquire_resource(names[i]);
+        algui_release_resource(bitmaps[i]);
+    }
+    check_atlas(atlas, BITMAP_COUNT);
+    TEST_CHECK(page_count > 1);
+
+    //a few bitmaps are acquired, and they outlive the atlas along with their pages
+    for(i = 0; i < page_count; ++i) {
+        page_bitmaps[i] = algui_get_atlas_page(atlas, i);
+    }
+    for(i = 0; i < BITMAP_COUNT; ++i) {
+        acquired[i] = test_random(4) == 0;
+        if (acquired[i]) TEST_CHECK(algui_acquire_resource(names[i]) == bitmaps[i]);
+    }
+    TEST_CHECK(destroyed_count == 0);
+    algui_destroy_atlas(atlas);
+    for(i = 0; i < BITMAP_COUNT; ++i) {
+        TEST_CHECK(is_destroyed(bitmaps[i]) == !acquired[i]);
+        if (acquired[i]) TEST_CHECK(pixel_index(bitmaps[i], widths[i] - 1, heights[i] - 1) == i);
+    }
+    check_pages_destroyed(page_bitmaps);
+
+    //releasing the last bitmap of a page destroys the page; the bitmaps are released in random order
+    for(n = 0, i = 0; i < BITMAP_COUNT; ++i) {
+        if (acquired[i]) released[n++] = i;
+    }
+    for(i = n - 1; i > 0; --i) {
+        j = test_random(i + 1);
+        k = released[i];
+        released[i] = released[j];
+        released[j] = k;
+    }
+    for(i = 0; i < n; ++i) {
+        acquired[released[i]] = 0;
+        algui_release_resource(bitmaps[released[i]]);
+        TEST_CHECK(is_destroyed(bitmaps[released[i]]));
+        check_pages_destroyed(page_bitmaps);
+    }
+    TEST_CHECK(destroyed_count == BITMAP_COUNT + page_count);
+
+    algui_remove_resource_destroy_hook(destroy_hook);
+    al_destroy_bitmap(target);
+
+    return test_result("test_atlas");
+}
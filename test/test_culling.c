@@ -0,0 +1,206 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the root widget
+#define SIZE 100
+
+
+//number of widgets; the first one is the root
+#define WIDGET_COUNT 40
+
+
+//number of widgets that contain the others, including the root
+#define CONTAINER_COUNT 6
+
+
+//number of rounds of changes and drawing
+#define ROUND_COUNT 500
+
+
+//the widgets
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+
+
+//the widgets in drawing order, i.e. parents first and children from lowest to highest
+static ALGUI_WIDGET *order[WIDGET_COUNT];
+static int order_count;
+
+
+//the visible part of each widget on the screen, i.e. its screen rect clipped by its ancestors
+static ALGUI_RECT clips[WIDGET_COUNT];
+static int clipped[WIDGET_COUNT];
+
+
+//the pixels covered by the opaque widgets visited so far
+static char covered[SIZE][SIZE];
+
+
+//the widgets that received the paint message
+static char painted[WIDGET_COUNT];
+
+
+//records the painted widgets
+static int paint_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    if (msg->id == ALGUI_MSG_PAINT) {
+        painted[wgt - widgets] = 1;
+        return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//puts the visible widgets of a tree in drawing order, and calculates their visible parts
+static void add_to_order(ALGUI_WIDGET *wgt, ALGUI_RECT *parent_clip) {
+    ALGUI_RECT screen_rect = algui_get_widget_screen_rect(wgt);
+    ALGUI_WIDGET *child;
+    int i = (int)(wgt - widgets);
+
+    if (!algui_is_widget_visible(wgt)) return;
+    algui_get_rect_intersection(&screen_rect, parent_clip, &clips[i]);
+    clipped[i] = algui_is_rect_normalized(&clips[i]);
+    order[order_count++] = wgt;
+
+    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+        add_to_order(child, &clips[i]);
+    }
+}
+
+
+//checks if the pixels of a rect are covered
+static int is_covered(ALGUI_RECT *rect) {
+    int x, y;
+    for(y = rect->top; y <= rect->bottom; ++y) {
+        for(x = rect->left; x <= rect->right; ++x) {
+            if (!covered[y][x]) return 0;
+        }
+    }
+    return 1;
+}
+
+
+//covers the pixels of a rect
+static void cover(ALGUI_RECT *rect) {
+    int x, y;
+    for(y = rect->top; y <= rect->bottom; ++y) {
+        for(x = rect->left; x <= rect->right; ++x) {
+            covered[y][x] = 1;
+        }
+    }
+}
+
+
+//moves and resizes a widget at random; containers are larger
+static void move_random_widget(int i) {
+    if (i < CONTAINER_COUNT) {
+        algui_move_and_resize_widget(&widgets[i], test_random(40) - 5, test_random(40) - 5, 30 + test_random(70), 30 + test_random(70));
+    }
+    else {
+        algui_move_and_resize_widget(&widgets[i], test_random(60) - 10, test_random(60) - 10, 1 + test_random(50), 1 + test_random(50));
+    }
+}
+
+
+//draws the tree and checks that exactly the widgets covered by opaque widgets drawn after them were culled
+static void check_draw() {
+    ALGUI_RECT root_rect;
+    unsigned long culled_widgets = 0, culled_pixels = 0;
+    int n, i, culled;
+
+    memset(painted, 0, sizeof(painted));
+    algui_draw_widget(&widgets[0]);
+
+    memset(clipped, 0, sizeof(clipped));
+    order_count = 0;
+    algui_move_and_resize_rect(&root_rect, 0, 0, SIZE, SIZE);
+    add_to_order(&widgets[0], &root_rect);
+
+    //visit the widgets front to back
+    memset(covered, 0, sizeof(covered));
+    for(n = order_count - 1; n >= 0; --n) {
+        i = (int)(order[n] - widgets);
+        if (!clipped[i]) continue;
+        culled = is_covered(&clips[i]);
+        if (culled) {
+            ++culled_widgets;
+            culled_pixels += (unsigned long)algui_get_rect_width(&clips[i]) * algui_get_rect_height(&clips[i]);
+        }
+        else if (algui_is_widget_opaque(order[n])) {
+            cover(&clips[i]);
+        }
+        TEST_CHECK(painted[i] == !culled);
+        painted[i] = 0;
+    }
+
+    //the widgets that are not visible on the screen are not painted
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        TEST_CHECK(!painted[i]);
+    }
+
+    TEST_CHECK(algui_get_culled_widget_count(&widgets[0]) == culled_widgets);
+    TEST_CHECK(algui_get_culled_pixel_count(&widgets[0]) == culled_pixels);
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALGUI_WIDGET *parent;
+    unsigned long total = 0;
+    int i, round;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+
+    //a random tree of overlapping widgets in a few large containers, 
+    //some of them opaque and some of them partly outside their parents
+    algui_init_widget(&widgets[0], paint_proc, "root");
+    algui_move_and_resize_widget(&widgets[0], 0, 0, SIZE, SIZE);
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], paint_proc, "widget");
+        algui_add_widget(&widgets[i < CONTAINER_COUNT ? 0 : test_random(CONTAINER_COUNT)], &widgets[i]);
+        move_random_widget(i);
+        algui_set_widget_opaque(&widgets[i], test_random(2));
+    }
+
+    check_draw();
+
+    for(round = 0; round < ROUND_COUNT; ++round) {
+        i = 1 + test_random(WIDGET_COUNT - 1);
+        switch (test_random(5)) {
+            case 0:
+                move_random_widget(i);
+                break;
+            case 1:
+                algui_set_widget_opaque(&widgets[i], !algui_is_widget_opaque(&widgets[i]));
+                break;
+            case 2:
+                algui_set_widget_visible(&widgets[i], !algui_is_widget_visible(&widgets[i]));
+                break;
+            case 3:
+                //bring the widget in front of its siblings
+                parent = algui_get_parent_widget(&widgets[i]);
+                algui_detach_widget(&widgets[i]);
+                algui_add_widget(parent, &widgets[i]);
+                break;
+            case 4:
+                //cover the parent, so as that the parent is culled without its children
+                algui_move_and_resize_widget(&widgets[i], -5, -5, SIZE + 10, SIZE + 10);
+                algui_set_widget_opaque(&widgets[i], 1);
+                break;
+        }
+        check_draw();
+        total += algui_get_culled_widget_count(&widgets[0]);
+    }
+
+    //the rounds are expected to cull widgets
+    TEST_CHECK(total > 0);
+
+    algui_cleanup_widget(&widgets[0]);
+    al_destroy_bitmap(target);
+
+    return test_result("test_culling");
+}
@@ -0,0 +1,92 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//depth of the chain
+#define CHAIN_DEPTH 1000000
+
+
+//message broadcast through the chain
+#define MSG_PING (ALGUI_MSG_USER + 1)
+
+
+//number of messages received, per kind
+static long measure_count = 0;
+static long layout_count = 0;
+static long paint_count = 0;
+static long ping_count = 0;
+
+
+//a widget of the chain; it keeps its size and counts the messages it receives
+static int chain_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    switch (msg->id) {
+        case ALGUI_MSG_SET_PREFERRED_RECT:
+            ++measure_count;
+            return 1;
+        case ALGUI_MSG_DO_LAYOUT:
+            ++layout_count;
+            return 1;
+        case ALGUI_MSG_PAINT:
+            ++paint_count;
+            return 1;
+        case MSG_PING:
+            ++ping_count;
+            return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//allocates a widget of the chain
+static ALGUI_WIDGET *create_widget() {
+    ALGUI_WIDGET *wgt = (ALGUI_WIDGET *)al_malloc(sizeof(ALGUI_WIDGET));
+    algui_init_widget(wgt, chain_proc, "chain");
+    algui_move_and_resize_widget(wgt, 0, 0, 100, 100);
+    return wgt;
+}
+
+
+int main() {
+    int i, depth;
+    ALGUI_WIDGET *root, *leaf, *parent, *wgt;
+    ALGUI_MESSAGE msg;
+    ALLEGRO_BITMAP *target;
+    
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(100, 100);
+    al_set_target_bitmap(target);
+    
+    //build the chain from the leaf up
+    leaf = root = create_widget();
+    algui_begin_update();
+    for(i = 1; i < CHAIN_DEPTH; ++i) {
+        parent = create_widget();
+        algui_add_widget(parent, root);
+        root = parent;
+    }
+    algui_end_update();
+    
+    //the first draw lays out and paints every widget once
+    algui_draw_widget(root);
+    TEST_CHECK(measure_count == CHAIN_DEPTH);
+    TEST_CHECK(layout_count == CHAIN_DEPTH);
+    TEST_CHECK(paint_count == CHAIN_DEPTH);
+    
+    //hit testing goes down to the leaf
+    wgt = algui_get_widget_from_point(root, 50, 50);
+    TEST_CHECK(wgt == leaf);
+    for(depth = 0; wgt; wgt = algui_get_parent_widget(wgt)) ++depth;
+    TEST_CHECK(depth == CHAIN_DEPTH);
+    
+    //broadcasting reaches every widget
+    msg.id = MSG_PING;
+    algui_broadcast_message(root, &msg);
+    TEST_CHECK(ping_count == CHAIN_DEPTH);
+    
+    algui_destroy_widget(root);
+    al_destroy_bitmap(target);
+    
+    return test_result("test_deep_chain");
+}
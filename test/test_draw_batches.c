@@ -0,0 +1,164 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the root widget
+#define SIZE 200
+
+
+//number of widgets; the first one is the root
+#define WIDGET_COUNT 60
+
+
+//number of containers, including the root; the other widgets are placed in them
+#define CONTAINER_COUNT 5
+
+
+//number of rounds of changes and drawing
+#define ROUND_COUNT 1000
+
+
+//the widgets
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+
+
+//the clipping rect of the target bitmap when each paint message was received, in drawing order
+static ALGUI_RECT clips[WIDGET_COUNT];
+static int paint_count;
+
+
+//if set, the clipping is expected to be the area of the parent, else the area of the widget
+static int batched;
+
+
+//the rect being drawn
+static ALGUI_RECT draw_rect;
+
+
+//records the clipping of each paint message, and checks that it matches the drawing mode
+static int paint_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_PAINT_MESSAGE *paint_msg = (ALGUI_PAINT_MESSAGE *)msg;
+    ALGUI_WIDGET *ancestor;
+    ALGUI_RECT *clip, ancestor_rect, parent_clip = draw_rect;
+    int x, y, w, h;
+
+    if (msg->id != ALGUI_MSG_PAINT) return algui_widget_proc(wgt, msg);
+
+    TEST_CHECK(paint_count < WIDGET_COUNT);
+    clip = &clips[paint_count++];
+    al_get_clipping_rectangle(&x, &y, &w, &h);
+    algui_move_and_resize_rect(clip, x, y, w, h);
+
+    //in batched mode, siblings share the clipping of their parent, i.e. the visible part of the parent, 
+    //and bitmap drawing is held
+    TEST_CHECK(!al_is_bitmap_drawing_held() == !batched);
+    if (!batched) {
+        TEST_CHECK(algui_is_rect_equal_to_rect(clip, &paint_msg->paint_rect));
+    }
+    else {
+        for(ancestor = algui_get_parent_widget(wgt); ancestor; ancestor = algui_get_parent_widget(ancestor)) {
+            ancestor_rect = algui_get_widget_screen_rect(ancestor);
+            algui_get_rect_intersection(&ancestor_rect, &parent_clip, &parent_clip);
+        }
+        TEST_CHECK(algui_is_rect_equal_to_rect(clip, &parent_clip));
+    }
+    return 1;
+}
+
+
+//moves and resizes a widget at random; containers are larger
+static void move_random_widget(int i) {
+    if (i < CONTAINER_COUNT) {
+        algui_move_and_resize_widget(&widgets[i], test_random(SIZE / 2), test_random(SIZE / 2), 40 + test_random(SIZE / 2), 40 + test_random(SIZE / 2));
+    }
+    else {
+        algui_move_and_resize_widget(&widgets[i], test_random(80) - 10, test_random(80) - 10, 1 + test_random(40), 1 + test_random(40));
+    }
+}
+
+
+//draws a rect of the tree, and checks the counters against the clipping of the paint messages:
+//the clipping changes whenever it differs from the previous one, and each run of the same clipping is one batch in batched mode
+static void check_draw(ALGUI_RECT *rect) {
+    ALGUI_RECT prev;
+    unsigned long changes = 0, skipped = 0, batches = 0;
+    int i, x, y, w, h;
+
+    al_get_clipping_rectangle(&x, &y, &w, &h);
+    algui_move_and_resize_rect(&prev, x, y, w, h);
+
+    paint_count = 0;
+    draw_rect = *rect;
+    algui_draw_widget_rect(&widgets[0], rect);
+
+    for(i = 0; i < paint_count; ++i) {
+        if (algui_is_rect_equal_to_rect(&clips[i], &prev)) {
+            ++skipped;
+            if (i == 0) ++batches;
+        }
+        else {
+            ++changes;
+            ++batches;
+        }
+        prev = clips[i];
+    }
+    if (!batched) batches = paint_count;
+
+    TEST_CHECK(algui_get_clip_change_count(&widgets[0]) == changes);
+    TEST_CHECK(algui_get_skipped_clip_change_count(&widgets[0]) == skipped);
+    TEST_CHECK(algui_get_draw_batch_count(&widgets[0]) == batches);
+
+    //the batch is submitted and the clipping restored at the end
+    TEST_CHECK(!al_is_bitmap_drawing_held());
+    al_get_clipping_rectangle(&x, &y, &w, &h);
+    TEST_CHECK(x == 0 && y == 0 && w == SIZE && h == SIZE);
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALGUI_RECT rect;
+    unsigned long batched_skips = 0;
+    int i, round;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+    al_set_clipping_rectangle(0, 0, SIZE, SIZE);
+
+    algui_init_widget(&widgets[0], paint_proc, "root");
+    algui_move_and_resize_widget(&widgets[0], 0, 0, SIZE, SIZE);
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], paint_proc, "widget");
+        algui_add_widget(&widgets[i < CONTAINER_COUNT ? 0 : test_random(CONTAINER_COUNT)], &widgets[i]);
+        move_random_widget(i);
+    }
+
+    for(round = 0; round < ROUND_COUNT; ++round) {
+        batched = test_random(2);
+        algui_set_batched_drawing(batched);
+        TEST_CHECK(algui_is_drawing_batched() == batched);
+
+        move_random_widget(1 + test_random(WIDGET_COUNT - 1));
+
+        if (test_random(2)) {
+            algui_move_and_resize_rect(&rect, 0, 0, SIZE, SIZE);
+        }
+        else {
+            algui_move_and_resize_rect(&rect, test_random(SIZE), test_random(SIZE), 1 + test_random(SIZE), 1 + test_random(SIZE));
+        }
+        check_draw(&rect);
+        if (batched) batched_skips += algui_get_skipped_clip_change_count(&widgets[0]);
+    }
+
+    //siblings share the clipping in batched mode
+    TEST_CHECK(batched_skips > 0);
+
+    algui_cleanup_widget(&widgets[0]);
+    al_destroy_bitmap(target);
+
+    return test_result("test_draw_batches");
+}
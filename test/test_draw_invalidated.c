@@ -0,0 +1,239 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the root widget
+#define SIZE 100
+
+
+//number of widgets; the first one is the root
+#define WIDGET_COUNT 30
+
+
+//number of rounds of damage and drawing
+#define ROUND_COUNT 300
+
+
+//the widgets
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+
+
+//the parent of each widget; -1 for the root
+static int parents[WIDGET_COUNT];
+
+
+//the visible part of each widget on the screen, i.e. its screen rect clipped by its ancestors
+static ALGUI_RECT clips[WIDGET_COUNT];
+static int clipped[WIDGET_COUNT];
+
+
+//the pixels of the root that are expected to be drawn again
+static char damaged[SIZE][SIZE];
+
+
+//the number of times each widget painted each pixel
+static unsigned char painted[WIDGET_COUNT][SIZE][SIZE];
+
+
+//number of paint messages
+static int paint_count;
+
+
+//records the pixels painted by a widget
+static int paint_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_PAINT_MESSAGE *paint_msg = (ALGUI_PAINT_MESSAGE *)msg;
+    int i = (int)(wgt - widgets), x, y;
+    if (msg->id == ALGUI_MSG_PAINT) {
+        TEST_CHECK(clipped[i]);
+        TEST_CHECK(clips[i].left <= paint_msg->paint_rect.left && clips[i].top <= paint_msg->paint_rect.top);
+        TEST_CHECK(clips[i].right >= paint_msg->paint_rect.right && clips[i].bottom >= paint_msg->paint_rect.bottom);
+        for(y = paint_msg->paint_rect.top; y <= paint_msg->paint_rect.bottom; ++y) {
+            for(x = paint_msg->paint_rect.left; x <= paint_msg->paint_rect.right; ++x) {
+                if (x >= 0 && y >= 0 && x < SIZE && y < SIZE) ++painted[i][y][x];
+            }
+        }
+        ++paint_count;
+        return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//calculates the visible part of each widget
+static void calculate_clips() {
+    ALGUI_RECT screen_rect;
+    int i;
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        clipped[i] = algui_is_widget_visible(&widgets[i]) && (i == 0 || clipped[parents[i]]);
+        if (!clipped[i]) continue;
+        screen_rect = algui_get_widget_screen_rect(&widgets[i]);
+        if (i) algui_get_rect_intersection(&screen_rect, &clips[parents[i]], &clips[i]);
+        else clips[i] = screen_rect;
+        clipped[i] = algui_is_rect_normalized(&clips[i]);
+    }
+}
+
+
+//adds a screen rect to the expected damage
+static void add_damage(ALGUI_RECT *rect) {
+    int x, y;
+    for(y = rect->top; y <= rect->bottom; ++y) {
+        for(x = rect->left; x <= rect->right; ++x) {
+            if (x >= 0 && y >= 0 && x < SIZE && y < SIZE) damaged[y][x] = 1;
+        }
+    }
+}
+
+
+//checks if a widget and its ancestors are visible
+static int is_shown(int i) {
+    for(; i >= 0; i = parents[i]) {
+        if (!algui_is_widget_visible(&widgets[i])) return 0;
+    }
+    return 1;
+}
+
+
+//invalidates a random part of a random widget
+static void invalidate_random_widget() {
+    int i = test_random(WIDGET_COUNT);
+    ALGUI_RECT rect, screen_rect = algui_get_widget_screen_rect(&widgets[i]), r;
+
+    //invisible widgets are not drawn, and therefore they add no damage
+    int visible = is_shown(i);
+
+    if (test_random(3) == 0) {
+        algui_invalidate_widget(&widgets[i]);
+        if (visible) add_damage(&screen_rect);
+    }
+    else {
+        algui_move_and_resize_rect(&rect, test_random(60) - 10, test_random(60) - 10, 1 + test_random(40), 1 + test_random(40));
+        algui_invalidate_widget_rect(&widgets[i], &rect);
+        algui_offset_rect(&rect, screen_rect.left, screen_rect.top);
+        algui_get_rect_intersection(&rect, &screen_rect, &r);
+        if (visible && algui_is_rect_normalized(&r)) add_damage(&r);
+    }
+}
+
+
+//moves or resizes a random shown widget without children; its old and new areas are damaged
+static void move_random_leaf() {
+    int i = 1 + test_random(WIDGET_COUNT - 1);
+    ALGUI_RECT screen_rect;
+    if (algui_get_lowest_child_widget(&widgets[i]) || !is_shown(i)) return;
+    screen_rect = algui_get_widget_screen_rect(&widgets[i]);
+    add_damage(&screen_rect);
+    if (test_random(2)) {
+        algui_move_widget(&widgets[i], test_random(60) - 10, test_random(60) - 10);
+    }
+    else {
+        algui_resize_widget(&widgets[i], 1 + test_random(50), 1 + test_random(50));
+    }
+    screen_rect = algui_get_widget_screen_rect(&widgets[i]);
+    add_damage(&screen_rect);
+}
+
+
+//hides or shows a random widget of a shown parent; its area is damaged, along with the area of the parent, which is laid out again
+static void toggle_random_widget() {
+    int i = 1 + test_random(WIDGET_COUNT - 1);
+    ALGUI_RECT screen_rect;
+    if (!is_shown(parents[i])) return;
+    screen_rect = algui_get_widget_screen_rect(&widgets[i]);
+    add_damage(&screen_rect);
+    screen_rect = algui_get_widget_screen_rect(&widgets[parents[i]]);
+    add_damage(&screen_rect);
+    algui_set_widget_visible(&widgets[i], !algui_is_widget_visible(&widgets[i]));
+}
+
+
+//draws the damage and checks that every damaged pixel of every visible widget was painted once,
+//and that nothing was painted outside the bounding rect of the damage
+static void check_draw(int first) {
+    ALGUI_RECT bounds;
+    int i, x, y, any = first;
+
+    algui_set_rect(&bounds, SIZE, SIZE, -1, -1);
+    for(y = 0; y < SIZE; ++y) {
+        for(x = 0; x < SIZE; ++x) {
+            if (!damaged[y][x] && !first) continue;
+            any = 1;
+            if (x < bounds.left) bounds.left = x;
+            if (y < bounds.top) bounds.top = y;
+            if (x > bounds.right) bounds.right = x;
+            if (y > bounds.bottom) bounds.bottom = y;
+        }
+    }
+
+    calculate_clips();
+    memset(painted, 0, sizeof(painted));
+    paint_count = 0;
+    TEST_CHECK(algui_draw_invalidated(&widgets[0]) == any);
+
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        for(y = 0; y < SIZE; ++y) {
+            for(x = 0; x < SIZE; ++x) {
+                TEST_CHECK(painted[i][y][x] <= 1);
+                if (painted[i][y][x]) TEST_CHECK(algui_rect_intersects_point(&bounds, x, y));
+                if ((damaged[y][x] || first) && clipped[i] && algui_rect_intersects_point(&clips[i], x, y)) TEST_CHECK(painted[i][y][x] == 1);
+            }
+        }
+    }
+    memset(damaged, 0, sizeof(damaged));
+
+    //the damage is cleared by drawing
+    paint_count = 0;
+    TEST_CHECK(algui_draw_invalidated(&widgets[0]) == 0);
+    TEST_CHECK(paint_count == 0);
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    int i, n, round;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+
+    //a random tree of overlapping widgets, some of them partly outside their parents
+    parents[0] = -1;
+    algui_init_widget(&widgets[0], paint_proc, "root");
+    algui_move_and_resize_widget(&widgets[0], 0, 0, SIZE, SIZE);
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], paint_proc, "widget");
+        parents[i] = test_random(i);
+        algui_add_widget(&widgets[parents[i]], &widgets[i]);
+        algui_move_and_resize_widget(&widgets[i], test_random(60) - 10, test_random(60) - 10, 1 + test_random(50), 1 + test_random(50));
+    }
+    calculate_clips();
+
+    //a tree that was never drawn is drawn entirely
+    check_draw(1);
+
+    for(round = 0; round < ROUND_COUNT; ++round) {
+        //up to 40 invalidations, so as that the damaged rects are sometimes merged
+        for(n = test_random(40); n > 0; --n) {
+            switch (test_random(6)) {
+                case 0:
+                    move_random_leaf();
+                    break;
+                case 1:
+                    toggle_random_widget();
+                    break;
+                default:
+                    invalidate_random_widget();
+                    break;
+            }
+        }
+        check_draw(0);
+    }
+
+    algui_cleanup_widget(&widgets[0]);
+    al_destroy_bitmap(target);
+
+    return test_result("test_draw_invalidated");
+}
@@ -0,0 +1,252 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the widget
+#define SIZE 100
+
+
+//number of random batches of events, and the maximum number of events in a batch
+#define BATCH_COUNT 3000
+#define MAX_BATCH_SIZE 40
+
+
+//the widget the events are dispatched to; it has the focus
+static ALGUI_WIDGET widget;
+
+
+//the events that reached the widget, in the order they were received
+static ALLEGRO_EVENT received[MAX_BATCH_SIZE];
+static int received_count;
+
+
+//the timestamp of the last event that reached the widget; one event may cause several messages,
+//and the events have distinct timestamps
+static double last_timestamp;
+
+
+//a second mouse; its events are not merged with the events of the first one
+static char other_source;
+
+
+//records the event of each input message
+static int input_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALLEGRO_EVENT *ev;
+
+    switch (msg->id) {
+        case ALGUI_MSG_GET_FOCUS:
+            ((ALGUI_GET_FOCUS_MESSAGE *)msg)->ok = 1;
+            return 1;
+
+        case ALGUI_MSG_MOUSE_ENTER:
+        case ALGUI_MSG_MOUSE_MOVE:
+        case ALGUI_MSG_MOUSE_WHEEL:
+        case ALGUI_MSG_LEFT_BUTTON_DOWN:
+        case ALGUI_MSG_LEFT_BUTTON_UP:
+            ev = ((ALGUI_MOUSE_MESSAGE *)msg)->event;
+            break;
+
+        case ALGUI_MSG_KEY_DOWN:
+            ev = ((ALGUI_KEY_DOWN_MESSAGE *)msg)->event;
+            break;
+
+        case ALGUI_MSG_KEY_UP:
+            ev = ((ALGUI_KEY_UP_MESSAGE *)msg)->event;
+            break;
+
+        case ALGUI_MSG_KEY_CHAR:
+            ev = ((ALGUI_KEY_CHAR_MESSAGE *)msg)->event;
+            break;
+
+        default:
+            return algui_widget_proc(wgt, msg);
+    }
+
+    if (ev->any.timestamp != last_timestamp) {
+        TEST_CHECK(received_count < MAX_BATCH_SIZE);
+        if (received_count < MAX_BATCH_SIZE) received[received_count++] = *ev;
+        last_timestamp = ev->any.timestamp;
+    }
+    return 1;
+}
+
+
+//returns a random event with the given timestamp; the mouse stays in the widget, and key repeats are of a few keys only
+static ALLEGRO_EVENT random_event(double timestamp) {
+    ALLEGRO_EVENT ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.any.timestamp = timestamp;
+    switch (test_random(10)) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            //at least one axis moves, or else the event causes no message
+            ev.type = ALLEGRO_EVENT_MOUSE_AXES;
+            if (test_random(8) == 0) ev.any.source = (ALLEGRO_EVENT_SOURCE *)&other_source;
+            ev.mouse.x = test_random(SIZE);
+            ev.mouse.y = test_random(SIZE);
+            ev.mouse.dx = test_random(7) - 3;
+            ev.mouse.dy = test_random(7) - 3;
+            ev.mouse.dz = test_random(3) - 1;
+            ev.mouse.dw = test_random(3) - 1;
+            if (!ev.mouse.dx && !ev.mouse.dy && !ev.mouse.dz && !ev.mouse.dw) ev.mouse.dz = 1;
+            ev.mouse.z = test_random(100);
+            ev.mouse.w = test_random(100);
+            break;
+
+        case 4:
+        case 5:
+        case 6:
+            ev.type = ALLEGRO_EVENT_KEY_CHAR;
+            ev.keyboard.keycode = 1 + test_random(2);
+            ev.keyboard.unichar = 'a' + ev.keyboard.keycode;
+            ev.keyboard.modifiers = test_random(4) ? 0 : ALLEGRO_KEYMOD_SHIFT;
+            ev.keyboard.repeat = test_random(4) > 0;
+            break;
+
+        case 7:
+            ev.type = test_random(2) ? ALLEGRO_EVENT_KEY_DOWN : ALLEGRO_EVENT_KEY_UP;
+            ev.keyboard.keycode = 1 + test_random(2);
+            break;
+
+        default:
+            ev.type = test_random(2) ? ALLEGRO_EVENT_MOUSE_BUTTON_DOWN : ALLEGRO_EVENT_MOUSE_BUTTON_UP;
+            ev.mouse.x = test_random(SIZE);
+            ev.mouse.y = test_random(SIZE);
+            ev.mouse.button = 1;
+            break;
+    }
+    return ev;
+}
+
+
+//checks if two mouse axes events are merged: they must come from the same mouse
+static int is_mergeable(ALLEGRO_EVENT *prev, ALLEGRO_EVENT *ev) {
+    return prev->type == ALLEGRO_EVENT_MOUSE_AXES && ev->type == ALLEGRO_EVENT_MOUSE_AXES && prev->any.source == ev->any.source;
+}
+
+
+//checks if a key char is skipped: it is a repeat that the next event repeats again, and the focus coalesces key repeats
+static int is_skipped(ALLEGRO_EVENT *ev, ALLEGRO_EVENT *next, int coalesce) {
+    return
+        coalesce &&
+        ev->type == ALLEGRO_EVENT_KEY_CHAR && next->type == ALLEGRO_EVENT_KEY_CHAR &&
+        ev->keyboard.repeat && next->keyboard.repeat &&
+        ev->keyboard.keycode == next->keyboard.keycode && ev->keyboard.modifiers == next->keyboard.modifiers;
+}
+
+
+//checks that an event was received as expected; the timestamps tell apart the events that are otherwise the same
+static void check_event(ALLEGRO_EVENT *actual, ALLEGRO_EVENT *expected) {
+    TEST_CHECK(actual->type == expected->type);
+    TEST_CHECK(actual->any.timestamp == expected->any.timestamp);
+    switch (expected->type) {
+        case ALLEGRO_EVENT_MOUSE_AXES:
+            TEST_CHECK(actual->any.source == expected->any.source);
+            TEST_CHECK(actual->mouse.x == expected->mouse.x && actual->mouse.y == expected->mouse.y);
+            TEST_CHECK(actual->mouse.z == expected->mouse.z && actual->mouse.w == expected->mouse.w);
+            TEST_CHECK(actual->mouse.dx == expected->mouse.dx && actual->mouse.dy == expected->mouse.dy);
+            TEST_CHECK(actual->mouse.dz == expected->mouse.dz && actual->mouse.dw == expected->mouse.dw);
+            break;
+
+        case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+        case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+            TEST_CHECK(actual->mouse.x == expected->mouse.x && actual->mouse.y == expected->mouse.y);
+            break;
+
+        default:
+            TEST_CHECK(actual->keyboard.keycode == expected->keyboard.keycode);
+            TEST_CHECK(actual->keyboard.modifiers == expected->keyboard.modifiers);
+            TEST_CHECK(actual->keyboard.repeat == expected->keyboard.repeat);
+            break;
+    }
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALLEGRO_EVENT events[MAX_BATCH_SIZE], expected[MAX_BATCH_SIZE];
+    unsigned long merged = 0, skipped = 0;
+    double now;
+    int batch, count, expected_count, dispatch_count, coalesce, i, n;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+
+    algui_init_widget(&widget, input_proc, "widget");
+    algui_move_and_resize_widget(&widget, 0, 0, SIZE, SIZE);
+    algui_draw_widget(&widget);
+    TEST_CHECK(algui_set_focus_widget(&widget));
+
+    for(batch = 0; batch < BATCH_COUNT; ++batch) {
+        coalesce = test_random(2);
+        algui_set_widget_coalescing_key_repeats(&widget, coalesce);
+
+        count = 1 + test_random(MAX_BATCH_SIZE);
+        now = al_get_time();
+        for(i = 0; i < count; ++i) {
+            events[i] = random_event(now - (count - i) * 0.0001);
+        }
+
+        //the model: mouse axes events are merged into the ones before them, with the sums of the movements
+        //and the latest position and time; key repeats are skipped if the next event repeats them
+        expected_count = 0;
+        for(i = 0; i < count; ++i) {
+            if (expected_count && is_mergeable(&expected[expected_count - 1], &events[i])) {
+                expected[expected_count - 1].any.timestamp = events[i].any.timestamp;
+                expected[expected_count - 1].mouse.x = events[i].mouse.x;
+                expected[expected_count - 1].mouse.y = events[i].mouse.y;
+                expected[expected_count - 1].mouse.z = events[i].mouse.z;
+                expected[expected_count - 1].mouse.w = events[i].mouse.w;
+                expected[expected_count - 1].mouse.dx += events[i].mouse.dx;
+                expected[expected_count - 1].mouse.dy += events[i].mouse.dy;
+                expected[expected_count - 1].mouse.dz += events[i].mouse.dz;
+                expected[expected_count - 1].mouse.dw += events[i].mouse.dw;
+                ++merged;
+            }
+            else {
+                expected[expected_count++] = events[i];
+            }
+        }
+        for(i = 0, n = 0; i < expected_count; ++i) {
+            if (i + 1 < expected_count && is_skipped(&expected[i], &expected[i + 1], coalesce)) {
+                ++skipped;
+                continue;
+            }
+            expected[n++] = expected[i];
+        }
+        dispatch_count = n;
+
+        //merged mouse events whose movements cancel out are dispatched, but cause no message
+        for(i = 0, n = 0; i < dispatch_count; ++i) {
+            if (expected[i].type == ALLEGRO_EVENT_MOUSE_AXES &&
+                !expected[i].mouse.dx && !expected[i].mouse.dy && !expected[i].mouse.dz && !expected[i].mouse.dw) continue;
+            expected[n++] = expected[i];
+        }
+        expected_count = n;
+
+        received_count = 0;
+        last_timestamp = -1;
+        TEST_CHECK(algui_dispatch_events(&widget, events, count) == dispatch_count);
+
+        //the other events keep their order
+        TEST_CHECK(received_count == expected_count);
+        for(i = 0; i < received_count && i < expected_count; ++i) {
+            check_event(&received[i], &expected[i]);
+        }
+        TEST_CHECK(algui_get_coalesced_mouse_event_count(&widget) == merged);
+        TEST_CHECK(algui_get_coalesced_key_event_count(&widget) == skipped);
+    }
+    TEST_CHECK(merged > 0 && skipped > 0);
+
+    algui_cleanup_widget(&widget);
+    al_destroy_bitmap(target);
+
+    return test_result("test_event_coalescing");
+}
@@ -0,0 +1,424 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the root widget
+#define SIZE 100
+
+
+//number of timers of the root widget, and of its child
+#define TIMER_COUNT 3
+
+
+//number of random batches of events, and the maximum number of events in a batch
+#define BATCH_COUNT 200
+#define MAX_BATCH_SIZE 40
+
+
+//number of timer events that take longer than the budget
+#define BUDGET_EVENT_COUNT 20
+
+
+//time that each timer message takes, and the budget of timer events, when testing the budget
+#define TIMER_MESSAGE_TIME 0.002
+#define TIMER_BUDGET 0.005
+
+
+//a budget that runs out with the first timer event
+#define TINY_BUDGET 1e-9
+
+
+//time after which timer events are dispatched regardless of the budget
+#define MAX_TIMER_EVENT_WAIT 0.1
+
+
+//a message that reached a widget
+typedef struct ENTRY {
+    int id;
+    double timestamp;
+    ALLEGRO_TIMER *timer;
+    unsigned long position;
+} ENTRY;
+
+
+//the root widget, which has the focus, and its child
+static ALGUI_WIDGET root;
+static ALGUI_WIDGET child;
+
+
+//the timers of the root widget and of its child
+static ALLEGRO_TIMER *timers[TIMER_COUNT];
+static ALLEGRO_TIMER *child_timers[TIMER_COUNT];
+
+
+//the messages that reached the widgets, in the order they were received
+static ENTRY received[MAX_BATCH_SIZE * 2];
+static int received_count;
+
+
+//the time that each timer message takes
+static double timer_message_time;
+
+
+//the time the events were scheduled, and the times the last timer message started and ended since then
+static double schedule_time;
+static double last_message_start;
+static double last_message_end;
+
+
+//records the key down and timer messages, along with the position of their event among the dispatched events
+static int log_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALLEGRO_EVENT *ev;
+    ALLEGRO_TIMER *timer = NULL;
+    double start;
+
+    switch (msg->id) {
+        case ALGUI_MSG_GET_FOCUS:
+            ((ALGUI_GET_FOCUS_MESSAGE *)msg)->ok = 1;
+            return 1;
+
+        case ALGUI_MSG_KEY_DOWN:
+            ev = ((ALGUI_KEY_DOWN_MESSAGE *)msg)->event;
+            break;
+
+        case ALGUI_MSG_TIMER:
+            ev = ((ALGUI_TIMER_MESSAGE *)msg)->event;
+            timer = ((ALGUI_TIMER_MESSAGE *)msg)->timer;
+            start = al_get_time();
+            while (al_get_time() - start < timer_message_time);
+            last_message_start = start - schedule_time;
+            last_message_end = al_get_time() - schedule_time;
+            break;
+
+        default:
+            return algui_widget_proc(wgt, msg);
+    }
+
+    TEST_CHECK(received_count < MAX_BATCH_SIZE * 2);
+    if (received_count < MAX_BATCH_SIZE * 2) {
+        received[received_count].id = msg->id;
+        received[received_count].timestamp = ev->any.timestamp;
+        received[received_count].timer = timer;
+        received[received_count].position = algui_get_dispatched_event_count(&root);
+        ++received_count;
+    }
+    return 1;
+}
+
+
+//returns an event of the given type and timestamp
+static ALLEGRO_EVENT make_event(int type, double timestamp) {
+    ALLEGRO_EVENT ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.any.timestamp = timestamp;
+    return ev;
+}
+
+
+//returns an event of a timer
+static ALLEGRO_EVENT make_timer_event(ALLEGRO_TIMER *timer, double timestamp) {
+    ALLEGRO_EVENT ev = make_event(ALLEGRO_EVENT_TIMER, timestamp);
+    ev.timer.source = timer;
+    ev.timer.count = 1;
+    return ev;
+}
+
+
+//returns the number of events of a class counted in all the ranges of its histogram
+static unsigned long get_class_count(int cls) {
+    unsigned long count = 0;
+    int range;
+    for(range = 0; range < ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE; ++range) {
+        count += algui_get_queue_wait_count(&root, cls, range);
+    }
+    return count;
+}
+
+
+//schedules the events with the given budget, and returns the number of events dispatched;
+//the log of received messages starts again
+static int schedule(ALLEGRO_EVENT *events, int count, double timer_budget) {
+    received_count = 0;
+    schedule_time = al_get_time();
+    last_message_start = last_message_end = 0;
+    return algui_schedule_events(&root, events, count, timer_budget);
+}
+
+
+//checks that a timer event was received
+static void check_timer_message(ENTRY *entry, ALLEGRO_EVENT *ev) {
+    TEST_CHECK(entry->id == ALGUI_MSG_TIMER);
+    TEST_CHECK(entry->timer == ev->timer.source);
+    TEST_CHECK(entry->timestamp == ev->any.timestamp);
+}
+
+
+//input events are dispatched first, then display events, and then timer events; each class keeps its order
+static void test_order() {
+    ALLEGRO_EVENT events[MAX_BATCH_SIZE];
+    int batch, count, inputs, displays, i, first_input, first_timer;
+    unsigned long start, display_count;
+    double now;
+
+    for(batch = 0; batch < BATCH_COUNT; ++batch) {
+        count = 1 + test_random(MAX_BATCH_SIZE);
+        now = al_get_time();
+        inputs = displays = 0;
+        for(i = 0; i < count; ++i) {
+            switch (test_random(3)) {
+                case 0:
+                    events[i] = make_event(ALLEGRO_EVENT_KEY_DOWN, now - (count - i) * 0.0001);
+                    events[i].keyboard.keycode = 1 + test_random(10);
+                    ++inputs;
+                    break;
+
+                case 1:
+                    events[i] = make_event(ALLEGRO_EVENT_DISPLAY_SWITCH_IN, now - (count - i) * 0.0001);
+                    ++displays;
+                    break;
+
+                default:
+                    events[i] = make_timer_event(timers[test_random(TIMER_COUNT)], now - (count - i) * 0.0001);
+                    break;
+            }
+        }
+
+        start = algui_get_dispatched_event_count(&root);
+        display_count = get_class_count(ALGUI_EVENT_CLASS_DISPLAY);
+        TEST_CHECK(schedule(events, count, 0) == count);
+        TEST_CHECK(algui_get_dispatched_event_count(&root) == start + count);
+        TEST_CHECK(algui_get_deferred_timer_event_count(&root) == 0);
+        TEST_CHECK(received_count == count - displays);
+
+        //the inputs take the first positions, the displays the positions after them, and the timers the rest
+        first_input = 0;
+        first_timer = inputs;
+        for(i = 0; i < count; ++i) {
+            if (events[i].type == ALLEGRO_EVENT_KEY_DOWN) {
+                TEST_CHECK(received[first_input].id == ALGUI_MSG_KEY_DOWN);
+                TEST_CHECK(received[first_input].timestamp == events[i].any.timestamp);
+                TEST_CHECK(received[first_input].position == start + first_input + 1);
+                ++first_input;
+            }
+            else if (events[i].type == ALLEGRO_EVENT_TIMER && first_timer < received_count) {
+                check_timer_message(&received[first_timer], &events[i]);
+                TEST_CHECK(received[first_timer].position == start + displays + first_timer + 1);
+                ++first_timer;
+            }
+        }
+        TEST_CHECK(first_timer == received_count);
+
+        //the display events are dispatched, even if they send no message
+        TEST_CHECK(get_class_count(ALGUI_EVENT_CLASS_DISPLAY) == display_count + displays);
+    }
+}
+
+
+//timer events are dispatched, oldest first, until the budget runs out; the rest wait for the next invocations
+static void test_budget() {
+    ALLEGRO_EVENT events[BUDGET_EVENT_COUNT];
+    int i, n, total = 0, calls = 0;
+    double now = al_get_time();
+
+    for(i = 0; i < BUDGET_EVENT_COUNT; ++i) {
+        events[i] = make_timer_event(timers[i % TIMER_COUNT], now - (BUDGET_EVENT_COUNT - i) * 0.000001);
+    }
+
+    timer_message_time = TIMER_MESSAGE_TIME;
+    for(n = schedule(events, BUDGET_EVENT_COUNT, TIMER_BUDGET); ; n = schedule(NULL, 0, TIMER_BUDGET)) {
+        ++calls;
+        TEST_CHECK(n == received_count);
+        for(i = 0; i < received_count; ++i) {
+            check_timer_message(&received[i], &events[total + i]);
+        }
+        total += n;
+        TEST_CHECK(algui_get_deferred_timer_event_count(&root) == BUDGET_EVENT_COUNT - total);
+        if (total == BUDGET_EVENT_COUNT) break;
+
+        //the events were left behind once the budget ran out, during the last message
+        TEST_CHECK(n > 0);
+        TEST_CHECK(last_message_start < TIMER_BUDGET);
+        TEST_CHECK(last_message_end >= TIMER_BUDGET);
+    }
+    TEST_CHECK(calls > 1);
+    timer_message_time = 0;
+}
+
+
+//the oldest deferred timer event is dispatched in every invocation, even if the budget is too small for it
+static void test_starvation() {
+    ALLEGRO_EVENT events[TIMER_COUNT * 2];
+    int i;
+    double now = al_get_time();
+
+    for(i = 0; i < TIMER_COUNT * 2; ++i) {
+        events[i] = make_timer_event(timers[i % TIMER_COUNT], now - (TIMER_COUNT * 2 - i) * 0.000001);
+    }
+
+    for(i = 0; i < TIMER_COUNT * 2; ++i) {
+        if (i == 0) TEST_CHECK(schedule(events, TIMER_COUNT * 2, TINY_BUDGET) == 1);
+        else TEST_CHECK(schedule(NULL, 0, TINY_BUDGET) == 1);
+        TEST_CHECK(received_count == 1);
+        check_timer_message(&received[0], &events[i]);
+        TEST_CHECK(algui_get_deferred_timer_event_count(&root) == TIMER_COUNT * 2 - i - 1);
+    }
+    TEST_CHECK(schedule(NULL, 0, TINY_BUDGET) == 0);
+}
+
+
+//timer events that have waited for too long are dispatched regardless of the budget
+static void test_overdue() {
+    ALLEGRO_EVENT events[TIMER_COUNT * 2];
+    int i;
+    double now = al_get_time();
+
+    for(i = 0; i < TIMER_COUNT; ++i) {
+        events[i] = make_timer_event(timers[i], now - MAX_TIMER_EVENT_WAIT * 2 + i * 0.000001);
+        events[TIMER_COUNT + i] = make_timer_event(timers[i], now + i * 0.000001);
+    }
+
+    TEST_CHECK(schedule(events, TIMER_COUNT * 2, TINY_BUDGET) == TIMER_COUNT);
+    for(i = 0; i < TIMER_COUNT; ++i) {
+        check_timer_message(&received[i], &events[i]);
+    }
+    TEST_CHECK(algui_get_deferred_timer_event_count(&root) == TIMER_COUNT);
+
+    TEST_CHECK(schedule(NULL, 0, 0) == TIMER_COUNT);
+    for(i = 0; i < TIMER_COUNT; ++i) {
+        check_timer_message(&received[i], &events[TIMER_COUNT + i]);
+    }
+}
+
+
+//the time that each event waited is counted in the range of the histogram of its class
+static void test_histograms() {
+    ALLEGRO_EVENT events[MAX_BATCH_SIZE];
+    unsigned long expected[ALGUI_EVENT_CLASS_COUNT][ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE];
+    double now, wait;
+    int batch, cls, range, i;
+
+    algui_reset_queue_wait_histograms(&root);
+    memset(expected, 0, sizeof(expected));
+
+    for(batch = 0; batch < BATCH_COUNT; ++batch) {
+        now = al_get_time();
+        for(i = 0; i < MAX_BATCH_SIZE; ++i) {
+            //the waits are just after the start of the ranges, so as that the time it takes to dispatch the events 
+            //does not move them to the next range; the ranges are at least two milliseconds long
+            range = 4 + test_random(ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE - 4);
+            wait = ALGUI_QUEUE_WAIT_HISTOGRAM_RESOLUTION * (1 << (range - 1)) * 1.01;
+            cls = test_random(ALGUI_EVENT_CLASS_COUNT);
+            switch (cls) {
+                case ALGUI_EVENT_CLASS_INPUT:
+                    events[i] = make_event(ALLEGRO_EVENT_KEY_DOWN, now - wait);
+                    break;
+
+                case ALGUI_EVENT_CLASS_DISPLAY:
+                    events[i] = make_event(ALLEGRO_EVENT_DISPLAY_SWITCH_IN, now - wait);
+                    break;
+
+                default:
+                    events[i] = make_timer_event(timers[test_random(TIMER_COUNT)], now - wait);
+                    break;
+            }
+            ++expected[cls][range];
+        }
+        TEST_CHECK(schedule(events, MAX_BATCH_SIZE, 0) == MAX_BATCH_SIZE);
+    }
+
+    for(cls = 0; cls < ALGUI_EVENT_CLASS_COUNT; ++cls) {
+        for(range = 0; range < ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE; ++range) {
+            TEST_CHECK(algui_get_queue_wait_count(&root, cls, range) == expected[cls][range]);
+        }
+    }
+
+    algui_reset_queue_wait_histograms(&root);
+    for(cls = 0; cls < ALGUI_EVENT_CLASS_COUNT; ++cls) {
+        for(range = 0; range < ALGUI_QUEUE_WAIT_HISTOGRAM_SIZE; ++range) {
+            TEST_CHECK(algui_get_queue_wait_count(&root, cls, range) == 0);
+        }
+    }
+}
+
+
+//the deferred events of a destroyed timer are dropped, while the events of the other timers wait as before
+static void test_destroyed_timers(ALLEGRO_EVENT_QUEUE *queue) {
+    ALLEGRO_EVENT events[TIMER_COUNT * 4];
+    int i, count = 0;
+    double now = al_get_time();
+
+    //a timer of the root widget, destroyed alone
+    for(i = 0; i < 4; ++i) {
+        events[count] = make_timer_event(timers[i % 2], now - (TIMER_COUNT * 4 - count) * 0.000001);
+        ++count;
+    }
+    TEST_CHECK(schedule(events, count, TINY_BUDGET) == 1);
+    check_timer_message(&received[0], &events[0]);
+    TEST_CHECK(algui_get_deferred_timer_event_count(&root) == 3);
+    TEST_CHECK(algui_destroy_widget_timer(&root, timers[0]));
+    TEST_CHECK(algui_get_deferred_timer_event_count(&root) == 2);
+    TEST_CHECK(schedule(NULL, 0, 0) == 2);
+    check_timer_message(&received[0], &events[1]);
+    check_timer_message(&received[1], &events[3]);
+    timers[0] = algui_create_widget_timer(&root, 1000, queue);
+    TEST_CHECK(timers[0] != NULL);
+
+    //the timers of the child, destroyed together
+    count = 0;
+    for(i = 0; i < TIMER_COUNT * 4; ++i) {
+        events[count] = make_timer_event(i % 3 ? child_timers[i % TIMER_COUNT] : timers[1], now - (TIMER_COUNT * 4 - count) * 0.000001);
+        ++count;
+    }
+    TEST_CHECK(schedule(events, count, TINY_BUDGET) == 1);
+    check_timer_message(&received[0], &events[0]);
+    algui_destroy_widget_timers(&child);
+    TEST_CHECK(algui_get_deferred_timer_event_count(&root) == TIMER_COUNT * 4 / 3 - 1);
+    TEST_CHECK(schedule(NULL, 0, 0) == TIMER_COUNT * 4 / 3 - 1);
+    for(i = 0; i < received_count; ++i) {
+        TEST_CHECK(received[i].timer == timers[1]);
+        TEST_CHECK(received[i].timestamp == events[(i + 1) * 3].any.timestamp);
+    }
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALLEGRO_EVENT_QUEUE *queue;
+    int i;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+    queue = al_create_event_queue();
+
+    algui_init_widget(&root, log_proc, "root");
+    algui_init_widget(&child, log_proc, "child");
+    algui_add_widget(&root, &child);
+    algui_move_and_resize_widget(&root, 0, 0, SIZE, SIZE);
+    algui_draw_widget(&root);
+    TEST_CHECK(algui_set_focus_widget(&root));
+
+    //the timers never expire by themselves; their events are made by the test
+    for(i = 0; i < TIMER_COUNT; ++i) {
+        timers[i] = algui_create_widget_timer(&root, 1000, queue);
+        child_timers[i] = algui_create_widget_timer(&child, 1000, queue);
+        TEST_CHECK(timers[i] != NULL && child_timers[i] != NULL);
+    }
+
+    test_order();
+    test_budget();
+    test_starvation();
+    test_overdue();
+    test_histograms();
+    test_destroyed_timers(queue);
+
+    algui_cleanup_widget(&root);
+    al_destroy_event_queue(queue);
+    al_destroy_bitmap(target);
+
+    return test_result("test_event_scheduler");
+}
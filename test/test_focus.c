@@ -0,0 +1,187 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of widgets
+#define WIDGET_COUNT 64
+
+
+//number of random operations
+#define OPERATION_COUNT 20000
+
+
+//the widgets; the first one is the root of the main tree
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+
+
+//number of lost-focus and mouse-leave messages received by a widget of the merge check
+static int lost_focus_count[4];
+static int mouse_leave_count[4];
+
+
+//the widgets of the merge check: two roots with a child each
+static ALGUI_WIDGET merge_widgets[4];
+
+
+//counts the lost-focus and mouse-leave messages of the merge check
+static int merge_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    int i = (int)(wgt - merge_widgets);
+    if (msg->id == ALGUI_MSG_LOST_FOCUS) ++lost_focus_count[i];
+    if (msg->id == ALGUI_MSG_MOUSE_LEAVE) ++mouse_leave_count[i];
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//finds the focus widget of a tree by scanning all its widgets; counts the widgets with the focus
+static ALGUI_WIDGET *scan_focus(ALGUI_WIDGET *wgt, int *count) {
+    ALGUI_WIDGET *result = wgt->focus ? wgt : NULL, *child, *found;
+    if (wgt->focus) ++*count;
+    for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+        found = scan_focus(child, count);
+        if (found) result = found;
+    }
+    return result;
+}
+
+
+//checks the focus widget of every tree against a scan of the tree
+static void check_trees() {
+    ALGUI_WIDGET *root;
+    int i, count;
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        root = &widgets[i];
+        if (algui_get_parent_widget(root)) continue;
+        count = 0;
+        TEST_CHECK(algui_get_focus_widget(root) == scan_focus(root, &count));
+        TEST_CHECK(count <= 1);
+    }
+}
+
+
+//inserts a random detached tree into a random widget outside of it
+static void insert_random_tree() {
+    ALGUI_WIDGET *child = &widgets[1 + test_random(WIDGET_COUNT - 1)];
+    ALGUI_WIDGET *parent = &widgets[test_random(WIDGET_COUNT)];
+    if (algui_get_parent_widget(child)) return;
+    if (parent == child || algui_is_ancestor_tree(&child->tree, &parent->tree)) return;
+    if (test_random(2)) algui_add_widget(parent, child);
+    else algui_insert_widget(parent, child, algui_get_lowest_child_widget(parent));
+}
+
+
+//moves a random range of siblings under a random widget outside of them
+static void splice_random_range() {
+    ALGUI_WIDGET *first = &widgets[1 + test_random(WIDGET_COUNT - 1)], *last = first, *wgt;
+    ALGUI_WIDGET *parent = &widgets[test_random(WIDGET_COUNT)];
+    int n = test_random(4);
+    if (!algui_get_parent_widget(first)) return;
+    while (n-- && algui_get_higher_sibling_widget(last)) last = algui_get_higher_sibling_widget(last);
+    for(wgt = first; ; wgt = algui_get_higher_sibling_widget(wgt)) {
+        if (parent == wgt || algui_is_ancestor_tree(&wgt->tree, &parent->tree)) return;
+        if (wgt == last) break;
+    }
+    algui_splice_widgets(parent, first, last, NULL);
+}
+
+
+//moves the mouse over a point of a tree
+static void move_mouse(ALGUI_WIDGET *root, int x, int y) {
+    ALLEGRO_EVENT ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = ALLEGRO_EVENT_MOUSE_AXES;
+    ev.mouse.x = x;
+    ev.mouse.y = y;
+    ev.mouse.dx = 1;
+    algui_dispatch_event(root, &ev);
+}
+
+
+//inserts a tree that has the focus and the mouse into another tree that has them too;
+//the child of the inserted tree is notified that it lost them
+static void check_merge() {
+    ALLEGRO_BITMAP *target;
+    ALGUI_RECT rect;
+    int i;
+    
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(100, 100);
+    al_set_target_bitmap(target);
+    
+    for(i = 0; i < 4; ++i) {
+        algui_init_widget(&merge_widgets[i], merge_proc, "merge");
+        algui_move_and_resize_rect(&rect, 0, 0, 100, 100);
+        algui_set_widget_rect(&merge_widgets[i], &rect);
+    }
+    algui_add_widget(&merge_widgets[0], &merge_widgets[1]);
+    algui_add_widget(&merge_widgets[2], &merge_widgets[3]);
+    algui_draw_widget(&merge_widgets[0]);
+    algui_draw_widget(&merge_widgets[2]);
+    
+    TEST_CHECK(algui_set_focus_widget(&merge_widgets[1]));
+    TEST_CHECK(algui_set_focus_widget(&merge_widgets[3]));
+    move_mouse(&merge_widgets[0], 10, 10);
+    move_mouse(&merge_widgets[2], 10, 10);
+    TEST_CHECK(algui_get_mouse_widget(&merge_widgets[0]) == &merge_widgets[1]);
+    TEST_CHECK(algui_get_mouse_widget(&merge_widgets[2]) == &merge_widgets[3]);
+    
+    algui_add_widget(&merge_widgets[1], &merge_widgets[2]);
+    TEST_CHECK(algui_get_focus_widget(&merge_widgets[0]) == &merge_widgets[1]);
+    TEST_CHECK(algui_get_mouse_widget(&merge_widgets[0]) == &merge_widgets[1]);
+    TEST_CHECK(!algui_widget_has_focus(&merge_widgets[3]));
+    TEST_CHECK(!algui_widget_has_mouse(&merge_widgets[3]));
+    TEST_CHECK(lost_focus_count[1] == 0 && lost_focus_count[3] == 1);
+    TEST_CHECK(mouse_leave_count[1] == 0 && mouse_leave_count[3] == 1);
+    
+    algui_cleanup_widget(&merge_widgets[0]);
+    al_destroy_bitmap(target);
+}
+
+
+int main() {
+    int i;
+    ALGUI_WIDGET *wgt;
+    
+    al_init();
+    
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], algui_widget_proc, "widget");
+    }
+    
+    for(i = 0; i < OPERATION_COUNT; ++i) {
+        wgt = &widgets[test_random(WIDGET_COUNT)];
+        switch (test_random(8)) {
+            case 0: 
+            case 1:
+                insert_random_tree();
+                break;
+            case 2:
+                algui_detach_widget(wgt);
+                break;
+            case 3:
+            case 4:
+                algui_set_focus_widget(wgt);
+                break;
+            case 5:
+                algui_set_widget_visible(wgt, test_random(2));
+                break;
+            case 6:
+                algui_set_widget_enabled(wgt, test_random(2));
+                break;
+            case 7:
+                splice_random_range();
+                break;
+        }
+        check_trees();
+    }
+    
+    for(i = WIDGET_COUNT - 1; i >= 0; --i) {
+        algui_detach_widget(&widgets[i]);
+        algui_cleanup_widget(&widgets[i]);
+    }
+    
+    check_merge();
+    
+    return test_result("test_focus");
+}
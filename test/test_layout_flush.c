@@ -0,0 +1,222 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of widgets; the first one is the root
+#define WIDGET_COUNT 40
+
+
+//number of random rounds of changes
+#define ROUND_COUNT 2000
+
+
+//height of every widget
+#define HEIGHT 10
+
+
+//width of layout boundaries, which does not depend on their children
+#define BOUNDARY_WIDTH 300
+
+
+//the widgets and the parent of each widget; -1 for the root
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+static int parents[WIDGET_COUNT];
+
+
+//the width of each widget besides its children; the children are placed after it, from left to right
+static int contents[WIDGET_COUNT];
+
+
+//the number of times each widget was measured and arranged since the last check
+static int measures[WIDGET_COUNT];
+static int arranges[WIDGET_COUNT];
+
+
+//the widgets that may be measured by the next flush
+static char allowed[WIDGET_COUNT];
+
+
+//measures a widget from the sizes of its children, and arranges its children from left to right
+static int layout_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_WIDGET *child;
+    int i = (int)(wgt - widgets), w;
+
+    switch (msg->id) {
+        case ALGUI_MSG_SET_PREFERRED_RECT:
+            ++measures[i];
+            w = contents[i];
+            if (!algui_is_widget_layout_boundary(wgt)) {
+                for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+                    if (algui_is_widget_visible(child)) w += algui_get_widget_width(child);
+                }
+            }
+            algui_resize_widget(wgt, w, HEIGHT);
+            return 1;
+
+        case ALGUI_MSG_DO_LAYOUT:
+            ++arranges[i];
+            w = contents[i];
+            for(child = algui_get_lowest_child_widget(wgt); child; child = algui_get_higher_sibling_widget(child)) {
+                if (!algui_is_widget_visible(child)) continue;
+                algui_move_widget(child, w, 0);
+                w += algui_get_widget_width(child);
+            }
+            return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//checks if a widget and its ancestors are visible
+static int is_shown(int i) {
+    for(; i >= 0; i = parents[i]) {
+        if (!algui_is_widget_visible(&widgets[i])) return 0;
+    }
+    return 1;
+}
+
+
+//returns the expected width of a widget, calculated from scratch
+static int expected_width(int i) {
+    int c, w = contents[i];
+    if (algui_is_widget_layout_boundary(&widgets[i])) return w;
+    for(c = i + 1; c < WIDGET_COUNT; ++c) {
+        if (parents[c] == i && algui_is_widget_visible(&widgets[c])) w += expected_width(c);
+    }
+    return w;
+}
+
+
+//returns the expected position of a widget in its parent, calculated from scratch
+static int expected_x(int i) {
+    ALGUI_WIDGET *sibling;
+    int x = contents[parents[i]];
+    for(sibling = algui_get_lowest_child_widget(&widgets[parents[i]]); sibling != &widgets[i]; sibling = algui_get_higher_sibling_widget(sibling)) {
+        if (algui_is_widget_visible(sibling)) x += expected_width((int)(sibling - widgets));
+    }
+    return x;
+}
+
+
+//marks a changed widget and its ancestors up to the first layout boundary as allowed to be measured
+static void allow(int i) {
+    for(; i >= 0 && !algui_is_widget_layout_boundary(&widgets[i]); i = parents[i]) {
+        allowed[i] = 1;
+    }
+}
+
+
+//checks the layout after a flush against a layout calculated from scratch;
+//only the allowed widgets are measured, and each widget is measured and arranged at most once
+static void check_layout() {
+    int i;
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        TEST_CHECK(measures[i] <= 1 && arranges[i] <= 1);
+        if (measures[i]) TEST_CHECK(allowed[i]);
+        TEST_CHECK(!widgets[i].layout_queued && !widgets[i].needs_measure && !widgets[i].needs_arrange && !widgets[i].needs_measure_tree);
+        TEST_CHECK(!widgets[i].visible_tree == !is_shown(i));
+        if (!is_shown(i)) continue;
+        TEST_CHECK(algui_get_widget_width(&widgets[i]) == expected_width(i));
+        TEST_CHECK(algui_get_widget_height(&widgets[i]) == HEIGHT);
+        if (i) TEST_CHECK(algui_get_widget_x(&widgets[i]) == expected_x(i) && algui_get_widget_y(&widgets[i]) == 0);
+    }
+    memset(measures, 0, sizeof(measures));
+    memset(arranges, 0, sizeof(arranges));
+    memset(allowed, 0, sizeof(allowed));
+}
+
+
+//changes the content of a random widget that is not a boundary, and packs it;
+//packing calculates the layout at once, unless an update is in progress
+static void pack_random_widget() {
+    int i = test_random(WIDGET_COUNT);
+    if (algui_is_widget_layout_boundary(&widgets[i])) return;
+    contents[i] = 1 + test_random(20);
+    allow(i);
+    algui_pack_widget(&widgets[i]);
+}
+
+
+//hides or shows a random widget; its parent is laid out again when the layout is flushed
+static void toggle_random_widget() {
+    int i = 1 + test_random(WIDGET_COUNT - 1);
+    allow(parents[i]);
+    algui_set_widget_visible(&widgets[i], !algui_is_widget_visible(&widgets[i]));
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    int i, n, round, boundaries = 0, skipped = 0;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(100, 100);
+    al_set_target_bitmap(target);
+
+    //a random tree; some of the widgets with children are layout boundaries
+    parents[0] = -1;
+    algui_init_widget(&widgets[0], layout_proc, "root");
+    contents[0] = 5;
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], layout_proc, "widget");
+        parents[i] = test_random(i);
+        algui_add_widget(&widgets[parents[i]], &widgets[i]);
+        contents[i] = 1 + test_random(20);
+    }
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        if (algui_get_lowest_child_widget(&widgets[i]) && test_random(3) == 0) {
+            algui_set_widget_layout_boundary(&widgets[i], 1);
+            contents[i] = BOUNDARY_WIDTH;
+            ++boundaries;
+        }
+    }
+    TEST_CHECK(boundaries > 0);
+
+    //the first draw measures and arranges every widget once
+    algui_draw_widget(&widgets[0]);
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        TEST_CHECK(measures[i] == 1 && arranges[i] == 1);
+        allowed[i] = 1;
+    }
+    check_layout();
+
+    for(round = 0; round < ROUND_COUNT; ++round) {
+        switch (test_random(3)) {
+            case 0:
+                pack_random_widget();
+                break;
+
+            case 1:
+                toggle_random_widget();
+                algui_flush_layout(&widgets[0]);
+                break;
+
+            case 2:
+                //changes within an update are laid out once, at its end
+                algui_begin_update();
+                for(n = 1 + test_random(10); n > 0; --n) {
+                    if (test_random(2)) pack_random_widget(); else toggle_random_widget();
+                }
+                for(i = 0; i < WIDGET_COUNT; ++i) {
+                    TEST_CHECK(measures[i] == 0 && arranges[i] == 0);
+                }
+                algui_end_update();
+                break;
+        }
+        for(i = 0; i < WIDGET_COUNT; ++i) {
+            if (allowed[i] && !measures[i]) ++skipped;
+        }
+        check_layout();
+    }
+
+    //the propagation of changes stops at widgets whose size does not change
+    TEST_CHECK(skipped > 0);
+
+    algui_cleanup_widget(&widgets[0]);
+    al_destroy_bitmap(target);
+
+    return test_result("test_layout_flush");
+}
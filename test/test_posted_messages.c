@@ -0,0 +1,101 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//messages posted by the test
+#define MSG_FIRST (ALGUI_MSG_USER + 1)
+#define MSG_SECOND (ALGUI_MSG_USER + 2)
+#define MSG_MOVE (ALGUI_MSG_USER + 3)
+
+
+//two trees; the mover is in the first tree, the target moves from the second tree to the first one
+static ALGUI_WIDGET root1, root2, mover, target;
+
+
+//messages received by the target
+static int first_count = 0;
+static int second_count = 0;
+static int cleaned_up = 0;
+static int late_count = 0;
+
+
+//counts the messages of the target; messages received after its cleanup are counted as late
+static int target_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    if (cleaned_up) ++late_count;
+    switch (msg->id) {
+        case MSG_FIRST:
+            ++first_count;
+            break;
+        case MSG_SECOND:
+            ++second_count;
+            break;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//moves the target into the tree of the mover
+static int mover_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    if (msg->id == MSG_MOVE) {
+        algui_detach_widget(&target);
+        algui_add_widget(&root1, &target);
+        return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//posts a message without data
+static void post(ALGUI_WIDGET *wgt, int id) {
+    ALGUI_MESSAGE msg;
+    msg.id = id;
+    algui_post_message(wgt, &msg, sizeof(msg));
+}
+
+
+int main() {
+    al_init();
+    algui_init_widget(&root1, algui_widget_proc, "root");
+    algui_init_widget(&root2, algui_widget_proc, "root");
+    algui_init_widget(&mover, mover_proc, "mover");
+    algui_init_widget(&target, target_proc, "target");
+    algui_add_widget(&root1, &mover);
+    algui_add_widget(&root2, &target);
+    
+    //the first message of the target is skipped, since the target is in the other tree;
+    //the second one is sent, since the target is moved into the tree before it is reached
+    post(&target, MSG_FIRST);
+    post(&mover, MSG_MOVE);
+    post(&target, MSG_SECOND);
+    TEST_CHECK(algui_process_posted_messages(&root1, 0) == 2);
+    TEST_CHECK(first_count == 0);
+    TEST_CHECK(second_count == 1);
+    TEST_CHECK(algui_get_posted_message_count() == 1);
+    
+    //the skipped message still belongs to the target
+    post(&target, MSG_SECOND);
+    TEST_CHECK(algui_process_posted_messages(&root1, 0) == 2);
+    TEST_CHECK(first_count == 1);
+    TEST_CHECK(second_count == 2);
+    TEST_CHECK(algui_get_posted_message_count() == 0);
+    
+    //the messages left when the target is cleaned up are dropped
+    algui_detach_widget(&target);
+    algui_add_widget(&root2, &target);
+    post(&target, MSG_FIRST);
+    post(&mover, MSG_MOVE);
+    post(&target, MSG_SECOND);
+    algui_process_posted_messages(&root1, 0);
+    algui_detach_widget(&target);
+    algui_cleanup_widget(&target);
+    cleaned_up = 1;
+    algui_process_posted_messages(NULL, 0);
+    TEST_CHECK(late_count == 0);
+    TEST_CHECK(algui_get_posted_message_count() == 0);
+    
+    algui_cleanup_widget(&root2);
+    algui_cleanup_widget(&root1);
+    
+    return test_result("test_posted_messages");
+}
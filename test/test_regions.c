@@ -0,0 +1,259 @@
+#include <string.h>
+#include "algui_rect.h"
+#include "test.h"
+
+
+//size of the area the rects are made in
+#define SIZE 64
+
+
+//the pixel bitmaps cover a margin around the area, for the pixels that regions are moved to
+#define MARGIN 32
+#define GRID_SIZE (SIZE + 2 * MARGIN)
+
+
+//number of regions
+#define REGION_COUNT 3
+
+
+//number of random operations
+#define OPERATION_COUNT 20000
+
+
+//the regions
+static ALGUI_REGION regions[REGION_COUNT];
+
+
+//the pixels of each region
+static char pixels[REGION_COUNT][GRID_SIZE][GRID_SIZE];
+
+
+//a pixel bitmap for temporary results
+static char temp[GRID_SIZE][GRID_SIZE];
+
+
+//the area regions are clipped to after they are moved, so as that they stay within the bitmaps
+static ALGUI_RECT limits = {-MARGIN, -MARGIN, SIZE + MARGIN - 1, SIZE + MARGIN - 1};
+
+
+//returns a random rect around the area, within the bitmaps; some of the rects are empty
+static ALGUI_RECT random_rect() {
+    ALGUI_RECT rect;
+    algui_move_and_resize_rect(&rect, test_random(SIZE + 16) - 8, test_random(SIZE + 16) - 8, test_random(24), test_random(24));
+    return rect;
+}
+
+
+//sets the pixels of a rect in a bitmap to the given value
+static void set_pixels(char bmp[GRID_SIZE][GRID_SIZE], ALGUI_RECT *rect, char value) {
+    int x, y;
+    for(y = rect->top; y <= rect->bottom; ++y) {
+        for(x = rect->left; x <= rect->right; ++x) {
+            if (algui_rect_intersects_point(&limits, x, y)) bmp[y + MARGIN][x + MARGIN] = value;
+        }
+    }
+}
+
+
+//checks the structure of a region, and that it covers exactly the pixels of the given bitmap
+static void check_region(ALGUI_REGION *rgn, char bmp[GRID_SIZE][GRID_SIZE]) {
+    ALGUI_RECT *r, *prev = NULL, bounds;
+    int i, k, x, y, end, band = -1, same;
+
+    TEST_CHECK(rgn->count >= 0 && rgn->count <= rgn->size);
+    TEST_CHECK(algui_is_region_empty(rgn) == (rgn->count == 0));
+
+    memset(temp, 0, sizeof(temp));
+    for(i = 0; i < rgn->count; ++i) {
+        r = &rgn->rects[i];
+        TEST_CHECK(algui_is_rect_normalized(r));
+        TEST_CHECK(algui_rect_intersects_point(&limits, r->left, r->top) && algui_rect_intersects_point(&limits, r->right, r->bottom));
+
+        //rects of the same band do not touch; bands go from top to bottom
+        if (prev && prev->top == r->top) {
+            TEST_CHECK(prev->bottom == r->bottom);
+            TEST_CHECK(prev->right + 1 < r->left);
+        }
+        else if (prev) {
+            TEST_CHECK(prev->bottom < r->top);
+        }
+        prev = r;
+
+        //the rects do not overlap
+        for(y = r->top; y <= r->bottom; ++y) {
+            for(x = r->left; x <= r->right; ++x) {
+                TEST_CHECK(!temp[y + MARGIN][x + MARGIN]);
+                temp[y + MARGIN][x + MARGIN] = 1;
+            }
+        }
+
+        if (i) algui_get_rect_union(&bounds, r, &bounds);
+        else bounds = *r;
+    }
+
+    //touching bands with the same spans are merged
+    for(i = 0; i < rgn->count; band = i, i = end) {
+        for(end = i + 1; end < rgn->count && rgn->rects[end].top == rgn->rects[i].top; ++end);
+        if (band < 0 || rgn->rects[band].bottom + 1 != rgn->rects[i].top || i - band != end - i) continue;
+        same = 1;
+        for(k = 0; k < end - i; ++k) {
+            if (rgn->rects[band + k].left != rgn->rects[i + k].left || rgn->rects[band + k].right != rgn->rects[i + k].right) same = 0;
+        }
+        TEST_CHECK(!same);
+    }
+
+    TEST_CHECK(memcmp(temp, bmp, sizeof(temp)) == 0);
+    if (rgn->count) TEST_CHECK(algui_is_rect_equal_to_rect(&bounds, &rgn->bounds));
+}
+
+
+//checks the queries of a region against its pixels
+static void check_queries(int i) {
+    ALGUI_RECT rect = random_rect();
+    int x, y, any = 0, all = 1, n;
+
+    for(n = 0; n < 10; ++n) {
+        x = test_random(SIZE + 16) - 8;
+        y = test_random(SIZE + 16) - 8;
+        TEST_CHECK(!algui_region_intersects_point(&regions[i], x, y) == !pixels[i][y + MARGIN][x + MARGIN]);
+    }
+
+    if (!algui_is_rect_normalized(&rect)) return;
+    for(y = rect.top; y <= rect.bottom; ++y) {
+        for(x = rect.left; x <= rect.right; ++x) {
+            if (pixels[i][y + MARGIN][x + MARGIN]) any = 1; else all = 0;
+        }
+    }
+    TEST_CHECK(!algui_region_intersects_rect(&regions[i], &rect) == !any);
+    TEST_CHECK(!algui_region_contains_rect(&regions[i], &rect) == !all);
+}
+
+
+//applies a binary operation to two regions, possibly in place, and to their pixels
+static void binary_operation(int op, int i, int j, int k) {
+    int x, y;
+    char a, b;
+
+    switch (op) {
+        case 0: algui_get_region_union(&regions[i], &regions[j], &regions[k]); break;
+        case 1: algui_get_region_intersection(&regions[i], &regions[j], &regions[k]); break;
+        case 2: algui_get_region_difference(&regions[i], &regions[j], &regions[k]); break;
+    }
+
+    for(y = 0; y < GRID_SIZE; ++y) {
+        for(x = 0; x < GRID_SIZE; ++x) {
+            a = pixels[i][y][x];
+            b = pixels[j][y][x];
+            temp[y][x] = op == 0 ? a || b : op == 1 ? a && b : a && !b;
+        }
+    }
+    memcpy(pixels[k], temp, sizeof(temp));
+}
+
+
+int main() {
+    ALGUI_RECT rect;
+    int i, j, n, dx, dy, x, y, max_rects;
+
+    for(i = 0; i < REGION_COUNT; ++i) {
+        algui_init_region(&regions[i]);
+    }
+
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        i = test_random(REGION_COUNT);
+        j = test_random(REGION_COUNT);
+        rect = random_rect();
+
+        switch (test_random(14)) {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                algui_add_region_rect(&regions[i], &rect);
+                if (algui_is_rect_normalized(&rect)) set_pixels(pixels[i], &rect, 1);
+                break;
+
+            case 4:
+            case 5:
+                algui_subtract_region_rect(&regions[i], &rect);
+                if (algui_is_rect_normalized(&rect)) set_pixels(pixels[i], &rect, 0);
+                break;
+
+            case 6:
+                algui_set_region_rect(&regions[i], &rect);
+                memset(pixels[i], 0, sizeof(pixels[i]));
+                if (algui_is_rect_normalized(&rect)) set_pixels(pixels[i], &rect, 1);
+                break;
+
+            case 7:
+                if (!algui_is_rect_normalized(&rect)) break;
+                algui_clip_region(&regions[i], &rect);
+                memset(temp, 0, sizeof(temp));
+                set_pixels(temp, &rect, 1);
+                for(y = 0; y < GRID_SIZE; ++y) {
+                    for(x = 0; x < GRID_SIZE; ++x) pixels[i][y][x] &= temp[y][x];
+                }
+                break;
+
+            case 8:
+                //the moved region is clipped, so as that it stays within the bitmap
+                dx = test_random(9) - 4;
+                dy = test_random(9) - 4;
+                algui_offset_region(&regions[i], dx, dy);
+                algui_clip_region(&regions[i], &limits);
+                memset(temp, 0, sizeof(temp));
+                for(y = 0; y < GRID_SIZE; ++y) {
+                    for(x = 0; x < GRID_SIZE; ++x) {
+                        if (x + dx >= 0 && y + dy >= 0 && x + dx < GRID_SIZE && y + dy < GRID_SIZE) temp[y + dy][x + dx] = pixels[i][y][x];
+                    }
+                }
+                memcpy(pixels[i], temp, sizeof(temp));
+                break;
+
+            case 9:
+                algui_copy_region(&regions[j], &regions[i]);
+                memcpy(pixels[j], pixels[i], sizeof(pixels[i]));
+                break;
+
+            case 10:
+            case 11:
+                //the result may be either operand
+                binary_operation(test_random(3), i, j, test_random(REGION_COUNT));
+                break;
+
+            case 12:
+                //the simplified region covers the old one with fewer rects
+                max_rects = 1 + test_random(8);
+                algui_simplify_region(&regions[i], max_rects);
+                TEST_CHECK(regions[i].count <= max_rects);
+                for(y = 0; y < GRID_SIZE; ++y) {
+                    for(x = 0; x < GRID_SIZE; ++x) {
+                        if (pixels[i][y][x]) TEST_CHECK(algui_region_intersects_point(&regions[i], x - MARGIN, y - MARGIN));
+                        pixels[i][y][x] = algui_region_intersects_point(&regions[i], x - MARGIN, y - MARGIN);
+                    }
+                }
+                break;
+
+            case 13:
+                if (test_random(4)) {
+                    algui_merge_region(&regions[i]);
+                }
+                else {
+                    algui_clear_region(&regions[i]);
+                    memset(pixels[i], 0, sizeof(pixels[i]));
+                }
+                break;
+        }
+
+        for(i = 0; i < REGION_COUNT; ++i) {
+            check_region(&regions[i], pixels[i]);
+            check_queries(i);
+        }
+    }
+
+    for(i = 0; i < REGION_COUNT; ++i) {
+        algui_cleanup_region(&regions[i]);
+    }
+
+    return test_result("test_regions");
+}
@@ -0,0 +1,241 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of cacheable panels
+#define PANEL_COUNT 6
+
+
+//number of children of each panel
+#define CHILD_COUNT 3
+
+
+//bytes per pixel of the images of the render caches
+#define PIXEL_SIZE 4
+
+
+//number of random operations
+#define OPERATION_COUNT 5000
+
+
+//the root, the panels and their children
+static ALGUI_WIDGET root;
+static ALGUI_WIDGET panels[PANEL_COUNT];
+static ALGUI_WIDGET children[PANEL_COUNT][CHILD_COUNT];
+
+
+//the expected state of the render cache of each panel
+static int has_image[PANEL_COUNT];
+static int valid[PANEL_COUNT];
+
+
+//the panels with images, from the most to the least recently used
+static int lru[PANEL_COUNT];
+static int lru_count;
+
+
+//the expected counters
+static unsigned long hits, misses, evictions;
+static size_t used, budget;
+
+
+//the number of times the children of each panel were painted
+static int child_paints[PANEL_COUNT];
+
+
+//counts the paint messages of the children
+static int paint_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    int i = (int)(wgt - &children[0][0]);
+    if (msg->id == ALGUI_MSG_PAINT) {
+        if (i >= 0 && i < PANEL_COUNT * CHILD_COUNT) ++child_paints[i / CHILD_COUNT];
+        return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//returns the size of the image of a panel
+static size_t image_size(int p) {
+    return (size_t)algui_get_widget_width(&panels[p]) * algui_get_widget_height(&panels[p]) * PIXEL_SIZE;
+}
+
+
+//removes a panel from the list of images
+static void remove_from_lru(int p) {
+    int i;
+    for(i = 0; i < lru_count && lru[i] != p; ++i);
+    if (i == lru_count) return;
+    memmove(lru + i, lru + i + 1, (lru_count - i - 1) * sizeof(int));
+    --lru_count;
+}
+
+
+//makes a panel the most recently used one
+static void touch(int p) {
+    remove_from_lru(p);
+    memmove(lru + 1, lru, lru_count * sizeof(int));
+    lru[0] = p;
+    ++lru_count;
+}
+
+
+//destroys the least recently used images until the given size fits in the budget
+static int evict(size_t size) {
+    int p;
+    while (used + size > budget && lru_count > 0) {
+        p = lru[--lru_count];
+        has_image[p] = 0;
+        valid[p] = 0;
+        used -= image_size(p);
+        ++evictions;
+    }
+    return used + size <= budget;
+}
+
+
+//checks the counters against the expected ones
+static void check_counters() {
+    TEST_CHECK(algui_get_render_cache_hit_count() == hits);
+    TEST_CHECK(algui_get_render_cache_miss_count() == misses);
+    TEST_CHECK(algui_get_render_cache_eviction_count() == evictions);
+    TEST_CHECK(algui_get_render_cache_size() == used);
+    TEST_CHECK(algui_get_render_cache_budget() == budget);
+}
+
+
+//draws a rect of the tree; the panels it touches are drawn from their images, or their images are rendered again
+static void draw_rect(ALGUI_RECT *rect) {
+    ALGUI_RECT panel_rect;
+    int p, missed[PANEL_COUNT], rendered[PANEL_COUNT];
+
+    //the panels are drawn from lowest to highest
+    for(p = 0; p < PANEL_COUNT; ++p) {
+        missed[p] = rendered[p] = 0;
+        panel_rect = algui_get_widget_screen_rect(&panels[p]);
+        if (!algui_rect_intersects_rect(&panel_rect, rect)) continue;
+        if (has_image[p] && valid[p]) {
+            ++hits;
+            touch(p);
+            continue;
+        }
+        ++misses;
+        missed[p] = 1;
+        if (!has_image[p]) {
+            if (!evict(image_size(p))) continue;
+            has_image[p] = 1;
+            used += image_size(p);
+        }
+        touch(p);
+        valid[p] = 1;
+        rendered[p] = 1;
+    }
+
+    memset(child_paints, 0, sizeof(child_paints));
+    algui_draw_widget_rect(&root, rect);
+
+    //the children of a panel are painted only when the image is rendered again, and then all of them are painted;
+    //without an image, the panel is drawn normally
+    for(p = 0; p < PANEL_COUNT; ++p) {
+        if (rendered[p]) TEST_CHECK(child_paints[p] == CHILD_COUNT);
+        else if (!missed[p]) TEST_CHECK(child_paints[p] == 0);
+    }
+    check_counters();
+}
+
+
+//draws the whole tree
+static void draw_all() {
+    ALGUI_RECT rect;
+    algui_move_and_resize_rect(&rect, 0, 0, algui_get_widget_width(&root), algui_get_widget_height(&root));
+    draw_rect(&rect);
+}
+
+
+//sets the budget to a random size, so as that a few images fit in it
+static void set_random_budget() {
+    budget = (size_t)test_random(4) * 30000;
+    evict(0);
+    algui_set_render_cache_budget(budget);
+    check_counters();
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALGUI_RECT rect;
+    int p, c, n, x, y;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(300, 200);
+    al_set_target_bitmap(target);
+
+    //panels of different sizes, side by side
+    algui_init_widget(&root, paint_proc, "root");
+    algui_move_and_resize_widget(&root, 0, 0, 300, 200);
+    for(p = 0; p < PANEL_COUNT; ++p) {
+        algui_init_widget(&panels[p], paint_proc, "panel");
+        algui_add_widget(&root, &panels[p]);
+        algui_move_and_resize_widget(&panels[p], (p % 3) * 100 + 5, (p / 3) * 100 + 5, 40 + 10 * p, 50);
+        algui_set_widget_cacheable(&panels[p], 1);
+        for(c = 0; c < CHILD_COUNT; ++c) {
+            algui_init_widget(&children[p][c], paint_proc, "child");
+            algui_add_widget(&panels[p], &children[p][c]);
+            algui_move_and_resize_widget(&children[p][c], 5 + 12 * c, 5, 10, 10);
+        }
+    }
+    budget = algui_get_render_cache_budget();
+
+    //the first draw renders every image, and the second one draws all of them
+    draw_all();
+    TEST_CHECK(misses == PANEL_COUNT && hits == 0);
+    draw_all();
+    TEST_CHECK(misses == PANEL_COUNT && hits == PANEL_COUNT);
+
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        p = test_random(PANEL_COUNT);
+        switch (test_random(8)) {
+            case 0:
+            case 1:
+                //a change in a child invalidates the image of its panel
+                algui_invalidate_widget(&children[p][test_random(CHILD_COUNT)]);
+                valid[p] = 0;
+                break;
+            case 2:
+                //moving a panel invalidates its image, but does not resize it
+                x = algui_get_widget_x(&panels[p]);
+                y = algui_get_widget_y(&panels[p]);
+                algui_move_widget(&panels[p], x + (x % 100 < 10 ? 1 : -1), y);
+                valid[p] = 0;
+                break;
+            case 3:
+                draw_all();
+                break;
+            case 4:
+            case 5:
+            case 6:
+                algui_move_and_resize_rect(&rect, test_random(300), test_random(200), 1 + test_random(100), 1 + test_random(100));
+                draw_rect(&rect);
+                break;
+            case 7:
+                set_random_budget();
+                break;
+        }
+    }
+    TEST_CHECK(evictions > 0);
+
+    //a panel that is no longer cacheable releases its image
+    for(p = 0; p < PANEL_COUNT; ++p) {
+        if (has_image[p]) used -= image_size(p);
+        algui_set_widget_cacheable(&panels[p], 0);
+    }
+    check_counters();
+    TEST_CHECK(used == 0);
+
+    algui_cleanup_widget(&root);
+    al_destroy_bitmap(target);
+
+    return test_result("test_render_cache");
+}
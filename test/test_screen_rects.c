@@ -0,0 +1,159 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of widgets; the first one is the root
+#define WIDGET_COUNT 30
+
+
+//number of random operations
+#define OPERATION_COUNT 20000
+
+
+//size of the root widget
+#define SIZE 400
+
+
+//the widgets
+static ALGUI_WIDGET widgets[WIDGET_COUNT];
+
+
+//the number of widgets painted by the last draw
+static int paint_count;
+
+
+//returns the expected screen rect of a widget, calculated from scratch from the rects of its ancestors
+static ALGUI_RECT expected_screen_rect(ALGUI_WIDGET *wgt) {
+    ALGUI_RECT rect = algui_get_widget_rect(wgt);
+    for(wgt = algui_get_parent_widget(wgt); wgt; wgt = algui_get_parent_widget(wgt)) {
+        algui_offset_rect(&rect, algui_get_widget_x(wgt), algui_get_widget_y(wgt));
+    }
+    return rect;
+}
+
+
+//checks that the rect of each painted widget is its screen rect
+static int paint_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_PAINT_MESSAGE *paint_msg = (ALGUI_PAINT_MESSAGE *)msg;
+    ALGUI_RECT rect;
+    if (msg->id != ALGUI_MSG_PAINT) return algui_widget_proc(wgt, msg);
+    rect = expected_screen_rect(wgt);
+    TEST_CHECK(algui_is_rect_equal_to_rect(&paint_msg->widget_rect, &rect));
+    ++paint_count;
+    return 1;
+}
+
+
+//checks if a widget is the given one or one of its descendants
+static int is_in_tree(ALGUI_WIDGET *wgt, ALGUI_WIDGET *top) {
+    for(; wgt; wgt = algui_get_parent_widget(wgt)) {
+        if (wgt == top) return 1;
+    }
+    return 0;
+}
+
+
+//moves a widget at random; sometimes it is resized as well, or moved back to where it was
+static void move_random_widget() {
+    ALGUI_WIDGET *wgt = &widgets[1 + test_random(WIDGET_COUNT - 1)];
+    int x = algui_get_widget_x(wgt), y = algui_get_widget_y(wgt);
+    switch (test_random(3)) {
+        case 0:
+            algui_move_and_resize_widget(wgt, test_random(60), test_random(60), 100 + test_random(100), 100 + test_random(100));
+            break;
+        case 1:
+            algui_move_widget(wgt, test_random(60), test_random(60));
+            break;
+        case 2:
+            algui_move_widget(wgt, x + 1, y);
+            algui_move_widget(wgt, x, y);
+            break;
+    }
+}
+
+
+//gives a random widget another parent, which is not in its tree;
+//a widget removed from its parent is placed on the screen by its own rect, until it is added to the other parent
+static void reparent_random_widget() {
+    ALGUI_WIDGET *wgt = &widgets[1 + test_random(WIDGET_COUNT - 1)];
+    ALGUI_WIDGET *parent = &widgets[test_random(WIDGET_COUNT)];
+    ALGUI_RECT rect, expected;
+    if (is_in_tree(parent, wgt)) return;
+    if (test_random(2)) {
+        TEST_CHECK(algui_remove_widget(algui_get_parent_widget(wgt), wgt));
+        rect = algui_get_widget_screen_rect(wgt);
+        expected = algui_get_widget_rect(wgt);
+        TEST_CHECK(algui_is_rect_equal_to_rect(&rect, &expected));
+        TEST_CHECK(algui_add_widget(parent, wgt));
+    }
+    else {
+        TEST_CHECK(algui_splice_widgets(parent, wgt, wgt, NULL));
+    }
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    ALGUI_RECT rect, expected;
+    int i, n, painted = 0;
+
+    al_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(SIZE, SIZE);
+    al_set_target_bitmap(target);
+
+    algui_init_widget(&widgets[0], paint_proc, "root");
+    algui_move_and_resize_widget(&widgets[0], 0, 0, SIZE, SIZE);
+    for(i = 1; i < WIDGET_COUNT; ++i) {
+        algui_init_widget(&widgets[i], paint_proc, "widget");
+        algui_add_widget(&widgets[test_random(i)], &widgets[i]);
+        algui_move_and_resize_widget(&widgets[i], test_random(60), test_random(60), 100 + test_random(100), 100 + test_random(100));
+    }
+
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        switch (test_random(6)) {
+            case 0:
+            case 1:
+                move_random_widget();
+                break;
+
+            case 2:
+                reparent_random_widget();
+                break;
+
+            case 3:
+                //moving the root moves every screen rect
+                algui_move_widget(&widgets[0], test_random(20), test_random(20));
+                break;
+
+            case 4:
+                //a screen rect queried alone brings the screen rects of its ancestors up to date
+                i = test_random(WIDGET_COUNT);
+                rect = algui_get_widget_screen_rect(&widgets[i]);
+                expected = expected_screen_rect(&widgets[i]);
+                TEST_CHECK(algui_is_rect_equal_to_rect(&rect, &expected));
+                break;
+
+            case 5:
+                //drawing calculates the screen rects from the parents down
+                paint_count = 0;
+                algui_draw_widget(&widgets[0]);
+                painted += paint_count;
+                break;
+        }
+    }
+
+    //every screen rect is up to date at the end
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        rect = algui_get_widget_screen_rect(&widgets[i]);
+        expected = expected_screen_rect(&widgets[i]);
+        TEST_CHECK(algui_is_rect_equal_to_rect(&rect, &expected));
+    }
+    TEST_CHECK(painted > 0);
+
+    algui_cleanup_widget(&widgets[0]);
+    al_destroy_bitmap(target);
+
+    return test_result("test_screen_rects");
+}
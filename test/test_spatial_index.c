@@ -0,0 +1,198 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of children of each container
+#define CHILD_COUNT 300
+
+
+//number of random operations
+#define OPERATION_COUNT 20000
+
+
+//number of points hit-tested after each operation
+#define POINT_COUNT 20
+
+
+//size of the containers
+#define SIZE 400
+
+
+//the containers: the first one indexes its children, the second one does not
+static ALGUI_WIDGET roots[2];
+
+
+//the children of each container; the same operations are applied to both
+static ALGUI_WIDGET children[2][CHILD_COUNT];
+
+
+//a widget that is not hit at some points, so as that the search goes on to the widgets below it
+static int hit_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_HIT_TEST_MESSAGE *hit_msg = (ALGUI_HIT_TEST_MESSAGE *)msg;
+    if (msg->id == ALGUI_MSG_HIT_TEST) {
+        hit_msg->ok = (hit_msg->x + hit_msg->y) % 7 != 0;
+        return 1;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//returns the index of a widget in the children of its tree, -1 for the container, -2 for none
+static int get_index(int tree, ALGUI_WIDGET *wgt) {
+    if (!wgt) return -2;
+    if (wgt == &roots[tree]) return -1;
+    return (int)(wgt - children[tree]);
+}
+
+
+//returns a random attached child, or -1 if no child is attached
+static int random_attached_child() {
+    int i = test_random(CHILD_COUNT), n;
+    for(n = 0; n < CHILD_COUNT; ++n, i = (i + 1) % CHILD_COUNT) {
+        if (algui_get_parent_widget(&children[0][i])) return i;
+    }
+    return -1;
+}
+
+
+//returns a random detached child, or -1 if every child is attached
+static int random_detached_child() {
+    int i = test_random(CHILD_COUNT), n;
+    for(n = 0; n < CHILD_COUNT; ++n, i = (i + 1) % CHILD_COUNT) {
+        if (!algui_get_parent_widget(&children[0][i])) return i;
+    }
+    return -1;
+}
+
+
+//inserts a detached child below the given attached child, or on top if there is none
+static void insert_child(int i, int next) {
+    int tree;
+    for(tree = 0; tree < 2; ++tree) {
+        algui_insert_widget(&roots[tree], &children[tree][i], next >= 0 ? &children[tree][next] : NULL);
+    }
+}
+
+
+//sets the rect of a child to a random one that may overlap others
+static void move_child(int i) {
+    ALGUI_RECT rect;
+    int tree;
+    algui_move_and_resize_rect(&rect, test_random(SIZE) - 20, test_random(SIZE) - 20, 1 + test_random(100), 1 + test_random(100));
+    for(tree = 0; tree < 2; ++tree) {
+        algui_set_widget_rect(&children[tree][i], &rect);
+    }
+}
+
+
+//inserts detached children one after the other below the same child,
+//so as that the z-keys between its lower sibling and it run out and the children are renumbered
+static void insert_burst() {
+    int next = random_attached_child(), i, n;
+    for(n = 0; n < 16; ++n) {
+        i = random_detached_child();
+        if (i < 0) return;
+        insert_child(i, next);
+    }
+}
+
+
+//moves a random range of children below a random child outside of it, within the same container
+static void splice_random_range() {
+    int first = random_attached_child(), last, next, n = test_random(8), tree;
+    ALGUI_WIDGET *wgt;
+    if (first < 0) return;
+    last = first;
+    while (n-- && algui_get_higher_sibling_widget(&children[0][last])) last = get_index(0, algui_get_higher_sibling_widget(&children[0][last]));
+    next = test_random(4) ? random_attached_child() : -1;
+    for(wgt = &children[0][first]; next >= 0; wgt = algui_get_higher_sibling_widget(wgt)) {
+        if (wgt == &children[0][next]) return;
+        if (wgt == &children[0][last]) break;
+    }
+    for(tree = 0; tree < 2; ++tree) {
+        algui_splice_widgets(&roots[tree], &children[tree][first], &children[tree][last], next >= 0 ? &children[tree][next] : NULL);
+    }
+}
+
+
+//resizes the containers, so as that the index is rebuilt
+static void resize_roots() {
+    ALGUI_RECT rect;
+    int tree;
+    algui_move_and_resize_rect(&rect, 0, 0, SIZE / 2 + test_random(SIZE / 2), SIZE / 2 + test_random(SIZE / 2));
+    for(tree = 0; tree < 2; ++tree) {
+        algui_set_widget_rect(&roots[tree], &rect);
+    }
+}
+
+
+//checks that hit testing finds the same widgets with and without the index
+static void check_hit_tests() {
+    int i, x, y;
+    for(i = 0; i < POINT_COUNT; ++i) {
+        x = test_random(SIZE);
+        y = test_random(SIZE);
+        TEST_CHECK(get_index(0, algui_get_widget_from_point(&roots[0], x, y)) == get_index(1, algui_get_widget_from_point(&roots[1], x, y)));
+    }
+}
+
+
+int main() {
+    int i, j, tree, visible;
+
+    al_init();
+
+    for(tree = 0; tree < 2; ++tree) {
+        algui_init_widget(&roots[tree], hit_proc, "root");
+        for(i = 0; i < CHILD_COUNT; ++i) {
+            algui_init_widget(&children[tree][i], hit_proc, "child");
+        }
+    }
+    algui_set_widget_spatial_index(&roots[0], ALGUI_SPATIAL_INDEX_ALWAYS);
+    algui_set_widget_spatial_index(&roots[1], ALGUI_SPATIAL_INDEX_NEVER);
+    resize_roots();
+
+    for(i = 0; i < OPERATION_COUNT; ++i) {
+        switch (test_random(10)) {
+            case 0:
+            case 1:
+            case 2:
+                j = random_detached_child();
+                if (j >= 0) insert_child(j, test_random(2) ? random_attached_child() : -1);
+                break;
+            case 3:
+                j = random_attached_child();
+                if (j >= 0) {
+                    for(tree = 0; tree < 2; ++tree) algui_detach_widget(&children[tree][j]);
+                }
+                break;
+            case 4:
+            case 5:
+                move_child(test_random(CHILD_COUNT));
+                break;
+            case 6:
+                insert_burst();
+                break;
+            case 7:
+                splice_random_range();
+                break;
+            case 8:
+                resize_roots();
+                break;
+            case 9:
+                j = test_random(CHILD_COUNT);
+                visible = test_random(4) != 0;
+                for(tree = 0; tree < 2; ++tree) algui_set_widget_visible(&children[tree][j], visible);
+                break;
+        }
+        TEST_CHECK(roots[0].grid && !roots[1].grid);
+        check_hit_tests();
+    }
+
+    for(tree = 0; tree < 2; ++tree) {
+        algui_cleanup_widget(&roots[tree]);
+    }
+
+    return test_result("test_spatial_index");
+}
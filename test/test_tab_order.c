@@ -0,0 +1,68 @@
+#include <limits.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of children; more than a 15-bit tab order can hold
+#define CHILD_COUNT 40000
+
+
+//the root widget, and the widget the second half of the children are spliced from
+static ALGUI_WIDGET root, holder;
+
+
+//the children of the root
+static ALGUI_WIDGET children[CHILD_COUNT];
+
+
+//checks that focus moves from the given child to the next one
+static void check_focus_forward(int index) {
+    TEST_CHECK(algui_set_focus_widget(&children[index]));
+    TEST_CHECK(algui_move_focus_forward(&root));
+    TEST_CHECK(algui_get_focus_widget(&root) == &children[index + 1]);
+}
+
+
+int main() {
+    int i;
+    
+    al_init();
+    
+    algui_init_widget(&root, algui_widget_proc, "root");
+    algui_init_widget(&holder, algui_widget_proc, "holder");
+    for(i = 0; i < CHILD_COUNT; ++i) {
+        algui_init_widget(&children[i], algui_widget_proc, "child");
+    }
+    
+    //the first half is added one by one, the second half is spliced in one call
+    for(i = 0; i < CHILD_COUNT / 2; ++i) {
+        algui_add_widget(&root, &children[i]);
+    }
+    for(i = CHILD_COUNT / 2; i < CHILD_COUNT; ++i) {
+        algui_add_widget(&holder, &children[i]);
+    }
+    TEST_CHECK(algui_splice_widgets(&root, &children[CHILD_COUNT / 2], &children[CHILD_COUNT - 1], NULL));
+    
+    for(i = 1; i < CHILD_COUNT; ++i) {
+        TEST_CHECK(algui_get_widget_tab_order(&children[i]) > algui_get_widget_tab_order(&children[i - 1]));
+    }
+    
+    check_focus_forward(16383);
+    check_focus_forward(32767);
+    check_focus_forward(CHILD_COUNT - 2);
+    
+    //a child with the highest tab order is skipped, and there is no child after it
+    algui_set_widget_tab_order(&children[CHILD_COUNT - 1], INT_MAX);
+    TEST_CHECK(algui_set_focus_widget(&children[CHILD_COUNT - 2]));
+    TEST_CHECK(algui_move_focus_forward(&root));
+    TEST_CHECK(algui_get_focus_widget(&root) == &root);
+    TEST_CHECK(algui_set_focus_widget(&children[CHILD_COUNT - 1]));
+    TEST_CHECK(algui_move_focus_forward(&root));
+    TEST_CHECK(algui_get_focus_widget(&root) == &root);
+    
+    algui_cleanup_widget(&root);
+    algui_cleanup_widget(&holder);
+    
+    return test_result("test_tab_order");
+}
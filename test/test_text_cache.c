@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_ttf.h>
+#include "algui.h"
+#include "algui_resource_manager.h"
+#include "algui_text.h"
+#include "test.h"
+
+
+//font of the texts
+#define FONT_FILE "test/test-skin/font.ttf"
+
+
+//number of fonts, texts and random operations
+#define FONT_COUNT 3
+#define TEXT_COUNT 8
+#define OPERATION_COUNT 20000
+
+
+//flags of measured texts in the model
+#define MEASURED -1
+
+
+//an entry of the text cache
+typedef struct ENTRY {
+    int font;
+    int text;
+    int flags;
+} ENTRY;
+
+
+//the fonts, their names and sizes
+static ALLEGRO_FONT *fonts[FONT_COUNT];
+static char font_names[FONT_COUNT][16];
+static const int font_sizes[FONT_COUNT] = {10, 12, 16};
+
+
+//the texts
+static const char *texts[TEXT_COUNT] = {"a", "OK", "Cancel", "File", "Open file...", "Save as", "", "the quick brown fox"};
+
+
+//the color of drawn texts
+static ALLEGRO_COLOR color;
+
+
+//the expected entries, from the most to the least recently used
+static ENTRY lru[FONT_COUNT * TEXT_COUNT * 3];
+static int lru_count;
+
+
+//the expected counters
+static unsigned long hits, misses, evictions;
+static size_t used, budget;
+
+
+//the memory of an entry without its text; learned from the first entry
+static size_t entry_size;
+
+
+//if set, drawn texts are expected to be kept as images
+static int rendering;
+
+
+//returns the memory of an entry
+static size_t size_of(ENTRY *entry) {
+    int bbx, bby, bbw, bbh;
+    size_t size = entry_size + strlen(texts[entry->text]) + 1;
+    if (entry->flags == MEASURED) return size;
+    al_get_text_dimensions(fonts[entry->font], texts[entry->text], &bbx, &bby, &bbw, &bbh);
+    if (bbw > 0 && bbh > 0) size += (size_t)bbw * bbh * 4;
+    return size;
+}
+
+
+//removes an entry
+static void remove_entry(int i) {
+    used -= size_of(&lru[i]);
+    memmove(lru + i, lru + i + 1, (lru_count - i - 1) * sizeof(ENTRY));
+    --lru_count;
+}
+
+
+//removes the least recently used entries until the memory used fits in the budget
+static void evict() {
+    while (used > budget && lru_count > 0) {
+        remove_entry(lru_count - 1);
+        ++evictions;
+    }
+}
+
+
+//looks up a text, like the text cache does: a found entry becomes the most recently used,
+//otherwise a new entry is added, unless it is larger than the budget
+static void look_up(int font, int text, int flags) {
+    ENTRY entry;
+    int i;
+
+    for(i = 0; i < lru_count; ++i) {
+        if (lru[i].font == font && lru[i].text == text && lru[i].flags == flags) break;
+    }
+    if (i < lru_count) {
+        ++hits;
+        entry = lru[i];
+        memmove(lru + 1, lru, i * sizeof(ENTRY));
+        lru[0] = entry;
+        return;
+    }
+
+    ++misses;
+    entry.font = font;
+    entry.text = text;
+    entry.flags = flags;
+    if (size_of(&entry) > budget) return;
+    memmove(lru + 1, lru, lru_count * sizeof(ENTRY));
+    lru[0] = entry;
+    ++lru_count;
+    used += size_of(&entry);
+    evict();
+}
+
+
+//removes the entries of a font, or the drawn ones
+static void remove_entries(int font, int drawn) {
+    int i;
+    for(i = lru_count - 1; i >= 0; --i) {
+        if (lru[i].font == font || (drawn && lru[i].flags != MEASURED)) remove_entry(i);
+    }
+}
+
+
+//loads a font and installs it as a resource
+static void load_font(int f) {
+    fonts[f] = al_load_font(FONT_FILE, font_sizes[f], 0);
+    TEST_CHECK(fonts[f] != NULL);
+    TEST_CHECK(algui_install_resource(fonts[f], font_names[f], algui_font_resource_destructor));
+}
+
+
+//checks the counters against the expected ones
+static void check_counters() {
+    TEST_CHECK(algui_get_text_cache_hit_count() == hits);
+    TEST_CHECK(algui_get_text_cache_miss_count() == misses);
+    TEST_CHECK(algui_get_text_cache_eviction_count() == evictions);
+    TEST_CHECK(algui_get_text_cache_size() == used);
+    TEST_CHECK(algui_get_text_cache_budget() == budget);
+    TEST_CHECK(algui_is_text_cache_rendering() == rendering);
+}
+
+
+int main() {
+    ALLEGRO_BITMAP *target;
+    int f, t, n, flags, width, height;
+
+    al_init();
+    al_init_font_addon();
+    al_init_ttf_addon();
+    algui_init();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    target = al_create_bitmap(200, 50);
+    al_set_target_bitmap(target);
+    color = al_map_rgb(255, 255, 255);
+
+    for(f = 0; f < FONT_COUNT; ++f) {
+        sprintf(font_names[f], "font %d", f);
+        load_font(f);
+    }
+    budget = algui_get_text_cache_budget();
+
+    //the first measurement is a miss, and the memory of an entry is learned from it
+    algui_get_cached_text_size(fonts[0], texts[0], &width, &height);
+    TEST_CHECK(width == al_get_text_width(fonts[0], texts[0]) && height == al_get_font_line_height(fonts[0]));
+    TEST_CHECK(algui_get_text_cache_miss_count() == 1);
+    entry_size = algui_get_text_cache_size() - strlen(texts[0]) - 1;
+    look_up(0, 0, MEASURED);
+    check_counters();
+
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        f = test_random(FONT_COUNT);
+        t = test_random(TEXT_COUNT);
+        switch (test_random(12)) {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                //measurements are the same as without the cache
+                algui_get_cached_text_size(fonts[f], texts[t], &width, &height);
+                TEST_CHECK(width == al_get_text_width(fonts[f], texts[t]));
+                TEST_CHECK(height == al_get_font_line_height(fonts[f]));
+                look_up(f, t, MEASURED);
+                break;
+
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+                //drawn texts are cached only when rendering
+                flags = test_random(2) ? 0 : ALLEGRO_ALIGN_RIGHT;
+                algui_draw_cached_text(fonts[f], color, 100, 10, flags, texts[t]);
+                if (rendering) look_up(f, t, flags);
+                break;
+
+            case 8:
+                //budgets from below the size of an image to above the size of all entries
+                budget = test_random(4) ? 200 + test_random(6000) : 1 << 20;
+                algui_set_text_cache_budget(budget);
+                evict();
+                break;
+
+            case 9:
+                //a destroyed font resource takes its texts with it; the model measures them before
+                remove_entries(f, 0);
+                algui_release_resource(fonts[f]);
+                load_font(f);
+                break;
+
+            case 10:
+                //images are dropped when rendering stops
+                rendering = !rendering;
+                algui_set_text_cache_rendering(rendering);
+                if (!rendering) remove_entries(-1, 1);
+                break;
+
+            case 11:
+                //removing the texts of a font that is not a resource
+                algui_remove_text_cache_font(fonts[f]);
+                remove_entries(f, 0);
+                break;
+        }
+        check_counters();
+    }
+    TEST_CHECK(hits > 0 && evictions > 0);
+
+    algui_clear_text_cache();
+    TEST_CHECK(algui_get_text_cache_size() == 0);
+
+    al_destroy_bitmap(target);
+
+    return test_result("test_text_cache");
+}
@@ -0,0 +1,58 @@
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of timers created and destroyed
+#define CHURN_COUNT 10000
+
+
+int main() {
+    int i;
+    unsigned long count;
+    ALGUI_WIDGET wgt;
+    ALLEGRO_EVENT_QUEUE *queue;
+    ALLEGRO_TIMER *live, *timer;
+    ALGUI_TIMER *live_wheel, *wheel_timer;
+    
+    al_init();
+    queue = al_create_event_queue();
+    algui_init_widget(&wgt, algui_widget_proc, "widget");
+    TEST_CHECK(algui_start_timer_wheel(queue, 0.01));
+    
+    //a timer stays alive while others come and go; the first churn cycle may allocate
+    live = algui_create_widget_timer(&wgt, 1.0, queue);
+    live_wheel = algui_create_widget_wheel_timer(&wgt, 1.0, 0, 0);
+    TEST_CHECK(live && live_wheel);
+    timer = algui_create_widget_timer(&wgt, 0.1, queue);
+    wheel_timer = algui_create_widget_wheel_timer(&wgt, 0.1, 0, 1);
+    algui_destroy_widget_timer(&wgt, timer);
+    algui_destroy_widget_wheel_timer(&wgt, wheel_timer);
+    count = algui_get_timer_allocation_count();
+    TEST_CHECK(count > 0);
+    
+    //steady state churn allocates nothing
+    for(i = 0; i < CHURN_COUNT; ++i) {
+        timer = algui_create_widget_timer(&wgt, 0.1, queue);
+        wheel_timer = algui_create_widget_wheel_timer(&wgt, 0.1, 0, 1);
+        TEST_CHECK(timer && wheel_timer);
+        TEST_CHECK(algui_destroy_widget_timer(&wgt, timer));
+        TEST_CHECK(algui_destroy_widget_wheel_timer(&wgt, wheel_timer));
+    }
+    TEST_CHECK(algui_get_timer_allocation_count() == count);
+    
+    //neither does destroying the last timer and creating one again
+    algui_destroy_widget_timer(&wgt, live);
+    algui_destroy_widget_wheel_timer(&wgt, live_wheel);
+    for(i = 0; i < CHURN_COUNT; ++i) {
+        timer = algui_create_widget_timer(&wgt, 0.1, queue);
+        TEST_CHECK(algui_destroy_widget_timer(&wgt, timer));
+    }
+    TEST_CHECK(algui_get_timer_allocation_count() == count);
+    
+    algui_cleanup_widget(&wgt);
+    algui_stop_timer_wheel();
+    al_destroy_event_queue(queue);
+    
+    return test_result("test_timer_allocations");
+}
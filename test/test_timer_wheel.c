@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include "algui_timer_wheel.h"
+#include "test.h"
+
+
+//number of entries
+#define ENTRY_COUNT 200
+
+
+//number of random operations
+#define OPERATION_COUNT 100000
+
+
+//number of ticks covered by the whole wheel
+#define WHEEL_RANGE ((int64_t)1 << (ALGUI_TIMER_WHEEL_LEVELS * ALGUI_TIMER_WHEEL_SLOT_BITS))
+
+
+//the wheel
+static ALGUI_TIMER_WHEEL wheel;
+
+
+//the entries
+static ALGUI_TIMER_WHEEL_ENTRY entries[ENTRY_COUNT];
+
+
+//the tick each entry is expected to expire at; -1 if the entry is not scheduled
+static int64_t expected[ENTRY_COUNT];
+
+
+//number of scheduled entries
+static unsigned long expected_count;
+
+
+//if set, the callback reschedules some of the expired entries
+static int reschedule;
+
+
+//returns a random delay, with many delays around the boundaries of the levels and beyond the range of the wheel
+static int64_t random_delay() {
+    static const int64_t boundaries[] = {1, 64, 4096, 262144, WHEEL_RANGE, 2 * WHEEL_RANGE};
+    int64_t boundary;
+    switch (test_random(4)) {
+        case 0:
+            return test_random(70) - 5;
+        case 1:
+            boundary = boundaries[test_random(6)];
+            return boundary + test_random(5) - 2;
+        case 2:
+            return test_random(5000);
+        default:
+            return (int64_t)test_random(1 << 15) * test_random(1 << 11);
+    }
+}
+
+
+//returns a random tolerance; most entries have none
+static int64_t random_tolerance() {
+    return test_random(3) ? 0 : test_random(1000);
+}
+
+
+//returns the tick an entry scheduled now is expected to expire at
+static int64_t expected_expiration(int64_t expires, int64_t tolerance) {
+    int64_t granularity = tolerance + 1, result;
+
+    if (expires <= wheel.now) expires = wheel.now + 1;
+
+    //the largest power of 2 that is not greater than the tolerance plus one
+    while (granularity & (granularity - 1)) granularity &= granularity - 1;
+
+    result = expires % granularity ? expires - expires % granularity + granularity : expires;
+
+    //the expiration is delayed by the tolerance at most
+    TEST_CHECK(result >= expires && result <= expires + tolerance);
+    return result;
+}
+
+
+//schedules an entry and records when it is expected to expire
+static void schedule(int i, int64_t expires, int64_t tolerance) {
+    if (expected[i] < 0) ++expected_count;
+    expected[i] = expected_expiration(expires, tolerance);
+    algui_schedule_timer_wheel_entry(&wheel, &entries[i], expires, tolerance);
+}
+
+
+//checks that an entry expires at the expected tick; may reschedule the entry
+static void expired(ALGUI_TIMER_WHEEL_ENTRY *entry, void *context) {
+    int i = (int)(entry - entries);
+
+    TEST_CHECK(context == &wheel);
+    TEST_CHECK(algui_get_list_node_data(&entry->node) == entry);
+    TEST_CHECK(expected[i] == wheel.now);
+    TEST_CHECK(!algui_is_timer_wheel_entry_scheduled(entry));
+    expected[i] = -1;
+    --expected_count;
+    TEST_CHECK(algui_get_timer_wheel_count(&wheel) == expected_count);
+
+    //reschedule from the callback, sometimes for the current tick
+    if (reschedule && test_random(4) == 0) {
+        schedule(i, wheel.now + random_delay(), random_tolerance());
+    }
+}
+
+
+//checks the scheduled entries against the expected ones
+static void check_entries() {
+    int i;
+    TEST_CHECK(algui_get_timer_wheel_count(&wheel) == expected_count);
+    for(i = 0; i < ENTRY_COUNT; ++i) {
+        TEST_CHECK(!algui_is_timer_wheel_entry_scheduled(&entries[i]) == (expected[i] < 0));
+        TEST_CHECK(expected[i] < 0 || expected[i] > wheel.now);
+    }
+}
+
+
+//advances the wheel tick by tick, checking that no entry is late
+static void advance(int64_t now) {
+    int i;
+    algui_advance_timer_wheel(&wheel, now, expired, &wheel);
+    TEST_CHECK(algui_get_timer_wheel_time(&wheel) == now);
+    for(i = 0; i < ENTRY_COUNT; ++i) {
+        TEST_CHECK(expected[i] < 0 || expected[i] > now);
+    }
+}
+
+
+int main() {
+    int64_t last;
+    int i, n, far = 0;
+
+    //start just before the end of a turn of every level, so as that all levels cascade soon
+    algui_init_timer_wheel(&wheel, 3 * WHEEL_RANGE - 3);
+    for(i = 0; i < ENTRY_COUNT; ++i) {
+        algui_init_timer_wheel_entry(&entries[i], &entries[i]);
+        expected[i] = -1;
+    }
+    check_entries();
+
+    reschedule = 1;
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        i = test_random(ENTRY_COUNT);
+        switch (test_random(8)) {
+            case 0:
+            case 1:
+            case 2:
+                schedule(i, wheel.now + random_delay(), random_tolerance());
+                break;
+            case 3:
+                algui_cancel_timer_wheel_entry(&wheel, &entries[i]);
+                if (expected[i] >= 0) --expected_count;
+                expected[i] = -1;
+                break;
+            case 4:
+            case 5:
+            case 6:
+                advance(wheel.now + test_random(100));
+                break;
+            case 7:
+                advance(wheel.now + test_random(1 << 14));
+                break;
+        }
+        check_entries();
+    }
+
+    //expire the remaining entries, including the ones beyond the range of the wheel
+    reschedule = 0;
+    last = wheel.now;
+    for(i = 0; i < ENTRY_COUNT; ++i) {
+        if (expected[i] > last) last = expected[i];
+        if (expected[i] - wheel.now >= WHEEL_RANGE) ++far;
+    }
+    TEST_CHECK(far > 0);
+    advance(last);
+    check_entries();
+    TEST_CHECK(expected_count == 0);
+
+    return test_result("test_timer_wheel");
+}
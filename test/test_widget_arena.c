@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//size of the slabs of growable arenas
+#define SLAB_SIZE 4096
+
+
+//number of widgets that fit in the fixed-capacity arena
+#define FIXED_COUNT 50
+
+
+//number of random allocations from the growable arena
+#define ALLOCATION_COUNT 2000
+
+
+//number of widgets in the trees destroyed along with their arena; the first one is the root
+#define WIDGET_COUNT 300
+
+
+//a block allocated from the growable arena
+typedef struct BLOCK {
+    unsigned char *memory;
+    size_t size;
+} BLOCK;
+
+
+//the blocks allocated from the growable arena
+static BLOCK blocks[ALLOCATION_COUNT];
+
+
+//the widgets of the tree, if each one was allocated from the arena or at the start of a slab, 
+//and the number of times each one was cleaned up and freed
+static ALGUI_WIDGET *widgets[WIDGET_COUNT];
+static int from_arena[WIDGET_COUNT];
+static int slab_start[WIDGET_COUNT];
+static int cleanups[WIDGET_COUNT];
+static int frees[WIDGET_COUNT];
+
+
+//the alignment of the arena allocations, learned from the allocation of a single byte
+static size_t alignment;
+
+
+//rounds a size up to the alignment of the arena allocations
+static size_t align(size_t size) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+
+//returns the index of a widget of the tree, or -1
+static int widget_index(void *ptr) {
+    int i;
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        if (widgets[i] == ptr) return i;
+    }
+    return -1;
+}
+
+
+//memory functions that count the frees of the widgets of the tree
+static void *test_malloc(size_t n, int line, const char *file, const char *func) {
+    return malloc(n);
+}
+static void test_free(void *ptr, int line, const char *file, const char *func) {
+    int i = widget_index(ptr);
+    if (i >= 0) ++frees[i];
+    free(ptr);
+}
+static void *test_realloc(void *ptr, size_t n, int line, const char *file, const char *func) {
+    return realloc(ptr, n);
+}
+static void *test_calloc(size_t count, size_t n, int line, const char *file, const char *func) {
+    return calloc(count, n);
+}
+static ALLEGRO_MEMORY_INTERFACE memory_interface = {test_malloc, test_free, test_realloc, test_calloc};
+
+
+//counts the cleanups of the widgets of the tree
+static int count_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    int i;
+    if (msg->id == ALGUI_MSG_CLEANUP) {
+        i = widget_index(wgt);
+        TEST_CHECK(i >= 0);
+        if (i >= 0) ++cleanups[i];
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//a fixed-capacity arena returns null once its memory runs out, and all of it can be used again after a reset
+static void test_fixed_arena(size_t unit) {
+    ALGUI_WIDGET_ARENA arena;
+    void *first = NULL, *ptr;
+    int i, round;
+
+    algui_init_widget_arena(&arena, 0, FIXED_COUNT * unit + unit / 2);
+    TEST_CHECK(algui_get_widget_arena_capacity(&arena) >= FIXED_COUNT * unit + unit / 2);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == algui_get_widget_arena_capacity(&arena));
+
+    for(round = 0; round < 2; ++round) {
+        for(i = 0; i < FIXED_COUNT; ++i) {
+            ptr = algui_allocate_widget_arena_memory(&arena, sizeof(ALGUI_WIDGET));
+            TEST_CHECK(ptr != NULL && algui_widget_arena_contains(&arena, ptr));
+            if (i == 0 && round == 0) first = ptr;
+            if (i == 0) TEST_CHECK(ptr == first);
+            TEST_CHECK(algui_get_widget_arena_used_size(&arena) == (i + 1) * unit);
+        }
+
+        //the rest of the memory is too small for a widget, let alone for a larger struct
+        TEST_CHECK(algui_allocate_widget_arena_memory(&arena, sizeof(ALGUI_WIDGET)) == NULL);
+        TEST_CHECK(algui_allocate_widget_arena_memory(&arena, FIXED_COUNT * unit) == NULL);
+        TEST_CHECK(algui_get_widget_arena_used_size(&arena) == FIXED_COUNT * unit);
+        TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == algui_get_widget_arena_capacity(&arena));
+
+        //a fixed-capacity arena keeps all its memory
+        algui_reset_widget_arena(&arena);
+        TEST_CHECK(algui_get_widget_arena_used_size(&arena) == 0);
+        TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == algui_get_widget_arena_capacity(&arena));
+    }
+
+    algui_cleanup_widget_arena(&arena);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == 0);
+}
+
+
+//a growable arena takes new slabs as needed; structs larger than a slab get slabs of their own
+static void test_growable_arena() {
+    ALGUI_WIDGET_ARENA arena;
+    size_t used = 0, reserved = 0, remaining = 0, size;
+    void *heap;
+    int i, j, large = 0;
+
+    algui_init_widget_arena(&arena, SLAB_SIZE, 0);
+    TEST_CHECK(algui_get_widget_arena_capacity(&arena) == 0);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == 0);
+
+    for(i = 0; i < ALLOCATION_COUNT; ++i) {
+        blocks[i].size = test_random(10) ? 1 + test_random(SLAB_SIZE / 8) : 1 + test_random(SLAB_SIZE * 2);
+        blocks[i].memory = (unsigned char *)algui_allocate_widget_arena_memory(&arena, blocks[i].size);
+        TEST_CHECK(blocks[i].memory != NULL);
+        memset(blocks[i].memory, i & 0xff, blocks[i].size);
+
+        //the model of the slabs: a struct takes the rest of the current slab, a slab of its own, or a new current slab
+        size = align(blocks[i].size);
+        if (size <= remaining) {
+            remaining -= size;
+        }
+        else if (size > SLAB_SIZE) {
+            reserved += size;
+            ++large;
+        }
+        else {
+            reserved += SLAB_SIZE;
+            remaining = SLAB_SIZE - size;
+        }
+        used += size;
+        TEST_CHECK(algui_get_widget_arena_used_size(&arena) == used);
+        TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == reserved);
+    }
+    TEST_CHECK(large > 0);
+
+    //the structs do not overlap, and every byte of them belongs to the arena
+    for(i = 0; i < ALLOCATION_COUNT; ++i) {
+        for(j = 0; j < (int)blocks[i].size && blocks[i].memory[j] == (i & 0xff); ++j);
+        TEST_CHECK(j == (int)blocks[i].size);
+        TEST_CHECK(algui_widget_arena_contains(&arena, blocks[i].memory));
+        TEST_CHECK(algui_widget_arena_contains(&arena, blocks[i].memory + blocks[i].size - 1));
+    }
+    heap = al_malloc(16);
+    TEST_CHECK(!algui_widget_arena_contains(&arena, heap));
+    al_free(heap);
+
+    //a reset keeps exactly one slab of regular size, which the next allocations fill
+    algui_reset_widget_arena(&arena);
+    TEST_CHECK(arena.slab_count == 1);
+    TEST_CHECK(algui_get_widget_arena_used_size(&arena) == 0);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == SLAB_SIZE);
+    TEST_CHECK(algui_allocate_widget_arena_memory(&arena, SLAB_SIZE) != NULL);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == SLAB_SIZE);
+    algui_cleanup_widget_arena(&arena);
+
+    //an arena with large structs only has no slab to keep
+    algui_init_widget_arena(&arena, SLAB_SIZE, 0);
+    TEST_CHECK(algui_allocate_widget_arena_memory(&arena, SLAB_SIZE + 1) != NULL);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == align(SLAB_SIZE + 1));
+    algui_reset_widget_arena(&arena);
+    TEST_CHECK(arena.slab_count == 0);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(&arena) == 0);
+    algui_cleanup_widget_arena(&arena);
+}
+
+
+//destroying a tree of widgets from the arena and from the heap cleans up all of them,
+//frees the ones from the heap once, and leaves the ones from the arena to it
+static void test_destroy_tree(ALGUI_WIDGET_ARENA *arena) {
+    int i, j;
+
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        from_arena[i] = i == 0 || test_random(3) > 0;
+        if (from_arena[i]) {
+            widgets[i] = (ALGUI_WIDGET *)algui_allocate_widget_arena_memory(arena, sizeof(ALGUI_WIDGET));
+        }
+        else {
+            widgets[i] = (ALGUI_WIDGET *)al_malloc(sizeof(ALGUI_WIDGET));
+        }
+        TEST_CHECK(widgets[i] != NULL);
+        algui_init_widget(widgets[i], count_proc, "widget");
+        if (i) TEST_CHECK(algui_add_widget(widgets[test_random(i)], widgets[i]));
+        cleanups[i] = frees[i] = 0;
+    }
+    TEST_CHECK(algui_get_widget_arena_reserved_size(arena) > SLAB_SIZE);
+
+    //the memory of a widget at the start of a slab is freed along with the slab
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        slab_start[i] = 0;
+        for(j = 0; j < arena->slab_count; ++j) {
+            if (arena->slabs[j].memory == (char *)widgets[i]) slab_start[i] = 1;
+        }
+    }
+
+    algui_destroy_arena_widget(widgets[0], arena);
+
+    for(i = 0; i < WIDGET_COUNT; ++i) {
+        TEST_CHECK(cleanups[i] == 1);
+        if (from_arena[i]) TEST_CHECK(frees[i] <= slab_start[i]); else TEST_CHECK(frees[i] == 1);
+        widgets[i] = NULL;
+    }
+    TEST_CHECK(algui_get_widget_arena_used_size(arena) == 0);
+    TEST_CHECK(algui_get_widget_arena_reserved_size(arena) == SLAB_SIZE);
+}
+
+
+int main() {
+    ALGUI_WIDGET_ARENA *arena;
+    size_t unit;
+
+    al_set_memory_interfaces(&memory_interface);
+    al_init();
+
+    //learn the alignment and the memory of a widget
+    arena = algui_create_widget_arena(SLAB_SIZE, 0);
+    algui_allocate_widget_arena_memory(arena, 1);
+    alignment = algui_get_widget_arena_used_size(arena);
+    TEST_CHECK(alignment > 0);
+    algui_reset_widget_arena(arena);
+    algui_allocate_widget_arena_memory(arena, sizeof(ALGUI_WIDGET));
+    unit = algui_get_widget_arena_used_size(arena);
+    TEST_CHECK(unit == align(sizeof(ALGUI_WIDGET)));
+    algui_destroy_widget_arena(arena);
+
+    test_fixed_arena(unit);
+    test_growable_arena();
+
+    //the slab kept after a tree is destroyed serves the next tree
+    arena = algui_create_widget_arena(SLAB_SIZE, 0);
+    test_destroy_tree(arena);
+    test_destroy_tree(arena);
+    algui_destroy_widget_arena(arena);
+
+    al_set_memory_interfaces(NULL);
+
+    return test_result("test_widget_arena");
+}
@@ -0,0 +1,141 @@
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "algui_widget.h"
+#include "test.h"
+
+
+//number of widgets of each tree
+#define WIDGET_COUNT 100
+
+
+//maximum number of timers per widget
+#define MAX_WIDGET_TIMERS 3
+
+
+//number of random operations
+#define OPERATION_COUNT 20000
+
+
+//the widgets of the two trees; the first widget of each tree is its root
+static ALGUI_WIDGET widgets[2][WIDGET_COUNT];
+
+
+//the timers of each widget
+static ALLEGRO_TIMER *timers[2][WIDGET_COUNT][MAX_WIDGET_TIMERS];
+
+
+//the widget and the timer of the last timer message
+static ALGUI_WIDGET *message_widget;
+static ALLEGRO_TIMER *message_timer;
+static int message_count;
+
+
+//records the timer messages
+static int timer_proc(ALGUI_WIDGET *wgt, ALGUI_MESSAGE *msg) {
+    ALGUI_TIMER_MESSAGE *timer_msg = (ALGUI_TIMER_MESSAGE *)msg;
+    if (msg->id == ALGUI_MSG_TIMER) {
+        message_widget = wgt;
+        message_timer = timer_msg->timer;
+        TEST_CHECK(timer_msg->wheel_timer == NULL);
+        ++message_count;
+    }
+    return algui_widget_proc(wgt, msg);
+}
+
+
+//dispatches an event of the given timer to the given tree; returns the widget that got the timer message
+static ALGUI_WIDGET *dispatch_timer_event(int tree, ALLEGRO_TIMER *timer) {
+    ALLEGRO_EVENT ev;
+    int processed;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = ALLEGRO_EVENT_TIMER;
+    ev.timer.source = timer;
+    ev.timer.count = 1;
+    message_widget = NULL;
+    message_timer = NULL;
+    message_count = 0;
+    processed = algui_dispatch_event(&widgets[tree][0], &ev);
+
+    TEST_CHECK(message_count <= 1);
+    TEST_CHECK(processed == (message_count == 1));
+    TEST_CHECK(!message_widget || message_timer == timer);
+    return message_widget;
+}
+
+
+//checks that the event of each timer reaches its widget, and only from the tree of the widget
+static void check_timers() {
+    int tree, i, j;
+    for(tree = 0; tree < 2; ++tree) {
+        for(i = 0; i < WIDGET_COUNT; ++i) {
+            for(j = 0; j < MAX_WIDGET_TIMERS; ++j) {
+                if (!timers[tree][i][j]) continue;
+                TEST_CHECK(dispatch_timer_event(tree, timers[tree][i][j]) == &widgets[tree][i]);
+                TEST_CHECK(dispatch_timer_event(1 - tree, timers[tree][i][j]) == NULL);
+            }
+        }
+    }
+}
+
+
+int main() {
+    ALLEGRO_EVENT_QUEUE *queue;
+    ALLEGRO_TIMER *other;
+    int tree, i, j, n;
+
+    al_init();
+    queue = al_create_event_queue();
+
+    for(tree = 0; tree < 2; ++tree) {
+        for(i = 0; i < WIDGET_COUNT; ++i) {
+            algui_init_widget(&widgets[tree][i], timer_proc, "widget");
+            if (i) algui_add_widget(&widgets[tree][test_random(i)], &widgets[tree][i]);
+        }
+    }
+
+    //create and destroy timers at random, so as that the table is grown, emptied and reused
+    for(n = 0; n < OPERATION_COUNT; ++n) {
+        tree = test_random(2);
+        i = test_random(WIDGET_COUNT);
+        j = test_random(MAX_WIDGET_TIMERS);
+        switch (test_random(8)) {
+            case 0:
+            case 1:
+            case 2:
+                if (timers[tree][i][j]) break;
+                timers[tree][i][j] = algui_create_widget_timer(&widgets[tree][i], 1000, queue);
+                TEST_CHECK(timers[tree][i][j] != NULL);
+                break;
+            case 3:
+            case 4:
+                if (!timers[tree][i][j]) break;
+                TEST_CHECK(!algui_destroy_widget_timer(&widgets[tree][(i + 1) % WIDGET_COUNT], timers[tree][i][j]));
+                TEST_CHECK(algui_destroy_widget_timer(&widgets[tree][i], timers[tree][i][j]));
+                timers[tree][i][j] = NULL;
+                break;
+            case 5:
+                algui_destroy_widget_timers(&widgets[tree][i]);
+                memset(timers[tree][i], 0, sizeof(timers[tree][i]));
+                break;
+            case 6:
+            case 7:
+                if (timers[tree][i][j]) TEST_CHECK(dispatch_timer_event(tree, timers[tree][i][j]) == &widgets[tree][i]);
+                break;
+        }
+        if (n % 1000 == 0) check_timers();
+    }
+    check_timers();
+
+    //a timer that does not belong to a widget is not processed
+    other = al_create_timer(1000);
+    TEST_CHECK(dispatch_timer_event(0, other) == NULL);
+    al_destroy_timer(other);
+
+    for(tree = 0; tree < 2; ++tree) {
+        algui_cleanup_widget(&widgets[tree][0]);
+    }
+    al_destroy_event_queue(queue);
+
+    return test_result("test_widget_timers");
+}